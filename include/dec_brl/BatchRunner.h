@@ -0,0 +1,345 @@
+/**
+ * @file BatchRunner.h
+ * Defines a class for running many independent learner and environment
+ * pairs in one process, for example to average over random seeds or to
+ * sweep hyperparameters.
+ */
+#ifndef DECBRL_BATCHRUNNER_H
+#define DECBRL_BATCHRUNNER_H
+
+#include <cassert>
+#include <cstddef>
+#include <map>
+#include <vector>
+#include <boost/shared_ptr.hpp>
+#include "dec_brl/random.h"
+#include "dec_brl/Executor.h"
+#include "common.h"
+
+/**
+ * Namespace all public functions and types defined in the DecBRL library.
+ */
+namespace dec_brl {
+
+/**
+ * Statistics of the total reward received at each timestep of a run.
+ */
+struct RunStats
+{
+   /**
+    * Number of timesteps run.
+    */
+   long noSteps;
+
+   /**
+    * Sum of total rewards.
+    */
+   double sumReward;
+
+   /**
+    * Sum of squared total rewards.
+    */
+   double sumSquaredReward;
+
+   /**
+    * Constructs statistics for a run with no timesteps.
+    */
+   RunStats() : noSteps(0), sumReward(0), sumSquaredReward(0) {}
+
+   /**
+    * Records the total reward received at one timestep.
+    */
+   void add(double reward)
+   {
+      ++noSteps;
+      sumReward += reward;
+      sumSquaredReward += reward*reward;
+   }
+
+   /**
+    * Returns the mean total reward per timestep.
+    */
+   double mean() const
+   {
+      return (0==noSteps) ? 0.0 : sumReward/noSteps;
+   }
+
+   /**
+    * Returns the sample variance of the total reward per timestep.
+    */
+   double variance() const
+   {
+      if(2>noSteps)
+      {
+         return 0.0;
+      }
+      const double m = mean();
+      return (sumSquaredReward - noSteps*m*m)/(noSteps-1);
+   }
+
+}; // struct RunStats
+
+/**
+ * Owns a set of independent runs, each consisting of a learner, an
+ * environment and a random number stream, and advances them all by a given
+ * number of timesteps, optionally in parallel using a dec_brl::Executor
+ * such as dec_brl::ThreadPool.
+ *
+ * While a run is stepped, its random stream is active in the stepping
+ * thread, so each run draws the same random numbers however runs are
+ * scheduled, and results are reproducible from each run's seed.
+ *
+ * @tparam Learner learner type, such as dec_brl::DecBayesQ or
+ * dec_brl::DecQLearner.
+ * @tparam Environment environment type, which must be copy constructible,
+ * and provide getState(), returning the current state as a map from
+ * maxsum::VarID to maxsum::ValIndex, and act(actions,rewards), which
+ * performs the specified actions, fills a map from maxsum::FactorID to the
+ * reward for each factor, and returns the total reward.
+ * @pre the learner and environment of each run share no mutable state with
+ * other runs, and all variables have been registered with the maxsum
+ * library before any runs are stepped.
+ */
+template<class Learner, class Environment> class BatchRunner
+{
+public:
+
+   /**
+    * Map type used to pass states and actions.
+    */
+   typedef std::map<maxsum::VarID,maxsum::ValIndex> VarMap;
+
+   /**
+    * Map type used to pass factored rewards.
+    */
+   typedef std::map<maxsum::FactorID,double> RewardMap;
+
+private:
+
+   /**
+    * A single learner and environment, with its random stream, statistics
+    * and the maps used to pass values between them.
+    */
+   struct Run
+   {
+      /**
+       * The learner.
+       */
+      Learner learner;
+
+      /**
+       * The environment.
+       */
+      Environment environment;
+
+      /**
+       * Random stream used while this run is stepped.
+       */
+      random::Stream stream;
+
+      /**
+       * Reward statistics.
+       */
+      RunStats stats;
+
+      /**
+       * State before the last action.
+       */
+      VarMap priorState;
+
+      /**
+       * State after the last action.
+       */
+      VarMap postState;
+
+      /**
+       * The last action.
+       */
+      VarMap action;
+
+      /**
+       * The last factored rewards.
+       */
+      RewardMap rewards;
+
+      /**
+       * Constructs a run from copies of a learner and environment.
+       */
+      Run(const Learner& l, const Environment& e, unsigned long seed)
+      : learner(l), environment(e), stream(seed), stats(), priorState(),
+        postState(), action(), rewards()
+      {
+         postState = environment.getState();
+      }
+
+      /**
+       * Advances this run by the specified number of timesteps.
+       */
+      void step(long noSteps)
+      {
+         random::StreamScope scope(stream);
+         for(long t=0; t<noSteps; ++t)
+         {
+            priorState.swap(postState);
+            learner.act(priorState,action);
+            stats.add(environment.act(action,rewards));
+            postState = environment.getState();
+            learner.observe(priorState,action,postState,rewards);
+         }
+      }
+   };
+
+   /**
+    * Task that advances each run by a fixed number of timesteps.
+    */
+   class StepTask : public Executor::Task
+   {
+   private:
+
+      /**
+       * The runs.
+       */
+      std::vector<boost::shared_ptr<Run> >& runs_i;
+
+      /**
+       * Number of timesteps to advance each run.
+       */
+      long noSteps_i;
+
+   public:
+
+      /**
+       * Constructs a task to advance the specified runs.
+       */
+      StepTask(std::vector<boost::shared_ptr<Run> >& runs, long noSteps)
+      : runs_i(runs), noSteps_i(noSteps) {}
+
+      /**
+       * Advances the k-th run.
+       */
+      void operator()(std::size_t k)
+      {
+         runs_i[k]->step(noSteps_i);
+      }
+   };
+
+   /**
+    * The runs, held by pointer because streams are not copyable.
+    */
+   std::vector<boost::shared_ptr<Run> > runs_i;
+
+   /**
+    * Batch runners are not copyable.
+    */
+   BatchRunner(const BatchRunner&);
+
+   /**
+    * Batch runners are not assignable.
+    */
+   BatchRunner& operator=(const BatchRunner&);
+
+public:
+
+   /**
+    * Constructs a runner with no runs.
+    */
+   BatchRunner() : runs_i() {}
+
+   /**
+    * Adds a run, using copies of the specified learner and environment.
+    * @param[in] learner learner to copy, which should already have its
+    * factors added.
+    * @param[in] environment environment to copy.
+    * @param[in] seed seed for the run's random stream.
+    * @returns the index of the new run.
+    */
+   std::size_t addRun
+   (
+    const Learner& learner,
+    const Environment& environment,
+    unsigned long seed
+   )
+   {
+      runs_i.push_back(boost::shared_ptr<Run>
+            (new Run(learner,environment,seed)));
+      return runs_i.size()-1;
+   }
+
+   /**
+    * Returns the number of runs.
+    */
+   std::size_t size() const
+   {
+      return runs_i.size();
+   }
+
+   /**
+    * Advances every run by the specified number of timesteps, in the
+    * calling thread.
+    */
+   void run(long noSteps)
+   {
+      SerialExecutor executor;
+      run(noSteps,executor);
+   }
+
+   /**
+    * Advances every run by the specified number of timesteps, using the
+    * specified executor to schedule runs.
+    */
+   void run(long noSteps, Executor& executor)
+   {
+      StepTask task(runs_i,noSteps);
+      executor.run(runs_i.size(),task);
+   }
+
+   /**
+    * Returns the reward statistics for the k-th run.
+    */
+   const RunStats& stats(std::size_t k) const
+   {
+      assert(k<runs_i.size());
+      return runs_i[k]->stats;
+   }
+
+   /**
+    * Returns the learner for the k-th run.
+    */
+   Learner& learner(std::size_t k)
+   {
+      assert(k<runs_i.size());
+      return runs_i[k]->learner;
+   }
+
+   /**
+    * Returns the environment for the k-th run.
+    */
+   Environment& environment(std::size_t k)
+   {
+      assert(k<runs_i.size());
+      return runs_i[k]->environment;
+   }
+
+   /**
+    * Returns the mean, over all runs, of each run's mean total reward per
+    * timestep.
+    */
+   double meanReward() const
+   {
+      if(runs_i.empty())
+      {
+         return 0.0;
+      }
+      double sum = 0;
+      for(std::size_t k=0; k<runs_i.size(); ++k)
+      {
+         sum += runs_i[k]->stats.mean();
+      }
+      return sum/runs_i.size();
+   }
+
+}; // class BatchRunner
+
+} // namespace dec_brl
+
+#endif // DECBRL_BATCHRUNNER_H
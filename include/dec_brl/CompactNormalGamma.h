@@ -0,0 +1,509 @@
+/**
+ * @file CompactNormalGamma.h
+ * Defines a vectorised Normal-Gamma distribution whose hyperparameters are
+ * stored in single precision, to halve the memory and bandwidth required by
+ * factored belief distributions. All arithmetic is performed in double
+ * precision.
+ */
+#ifndef DECBRL_COMPACTNORMALGAMMA_H
+#define DECBRL_COMPACTNORMALGAMMA_H
+
+#include <algorithm>
+#include <cassert>
+#include <vector>
+#include <boost/type_traits.hpp>
+#include <boost/utility/enable_if.hpp>
+#include "dec_brl/NormalGamma.h"
+#include "DiscreteFunction.h"
+
+/**
+ * Namespace all public functions and types defined in the DecBRL library.
+ */
+namespace dec_brl {
+
+/**
+ * Namespace for classes that represent probability distributions commonly
+ * used in Bayesian Reinforcement Learning and Bayesian Analysis.
+ */
+namespace dist {
+
+   /**
+    * Read-mostly function over the joint domain of a set of maxsum variables,
+    * whose values are stored as StorageType, but read and written as
+    * maxsum::ValType. Elements are indexed in the same order as
+    * maxsum::DiscreteFunction, so linear indices may be used interchangeably.
+    * A constant offset may be subtracted from each value before it is stored,
+    * so that values close to the offset keep their relative precision.
+    * @tparam StorageType type used to store each value, usually float.
+    */
+   template<class StorageType=float> class CompactFunction_Tmpl
+   {
+   public:
+
+      /**
+       * Type of iterator over the variables on which this function depends.
+       */
+      typedef std::vector<maxsum::VarID>::const_iterator VarIterator;
+
+   private:
+
+      /**
+       * Sorted list of variables on which this function depends.
+       */
+      std::vector<maxsum::VarID> vars_i;
+
+      /**
+       * Domain size of each variable in vars_i.
+       */
+      std::vector<maxsum::ValIndex> sizes_i;
+
+      /**
+       * Stored values, less offset_i.
+       */
+      std::vector<StorageType> values_i;
+
+      /**
+       * Constant added to each stored value when it is read.
+       */
+      maxsum::ValType offset_i;
+
+   public:
+
+      /**
+       * Constructs a constant function.
+       * @param[in] val the value of the function.
+       * @param[in] offset constant subtracted from each value before storage.
+       */
+      CompactFunction_Tmpl(maxsum::ValType val=0, maxsum::ValType offset=0)
+      : vars_i(), sizes_i(), values_i(1,static_cast<StorageType>(val-offset)),
+        offset_i(offset)
+      {}
+
+      /**
+       * Returns the number of variables on which this function depends.
+       */
+      int noVars() const
+      {
+         return static_cast<int>(vars_i.size());
+      }
+
+      /**
+       * Returns an iterator to the first variable on which this function
+       * depends.
+       */
+      VarIterator varBegin() const
+      {
+         return vars_i.begin();
+      }
+
+      /**
+       * Returns an iterator to the end of the variables on which this
+       * function depends.
+       */
+      VarIterator varEnd() const
+      {
+         return vars_i.end();
+      }
+
+      /**
+       * Returns the domain size of each variable on which this function
+       * depends, in the same order as varBegin().
+       */
+      const std::vector<maxsum::ValIndex>& sizes() const
+      {
+         return sizes_i;
+      }
+
+      /**
+       * Returns the size of this function's joint domain.
+       */
+      maxsum::ValIndex domainSize() const
+      {
+         return static_cast<maxsum::ValIndex>(values_i.size());
+      }
+
+      /**
+       * Returns the linear index of an element, which is the index itself.
+       */
+      maxsum::ValIndex linearIndex(maxsum::ValIndex k) const
+      {
+         return k;
+      }
+
+      /**
+       * Returns the linear index of the element specified by a map from
+       * each variable on which this function depends to its value.
+       * @tparam VarMap maps maxsum::VarID to maxsum::ValIndex, and implements
+       * find() with the same semantics as std::map.
+       */
+      template<class VarMap>
+      typename boost::disable_if<boost::is_arithmetic<VarMap>,
+                                 maxsum::ValIndex>::type
+      linearIndex(const VarMap& vars) const
+      {
+         maxsum::ValIndex index = 0;
+         maxsum::ValIndex stride = 1;
+         for(std::size_t k=0; k<vars_i.size(); ++k)
+         {
+            typename VarMap::const_iterator pos = vars.find(vars_i[k]);
+            assert(vars.end()!=pos);
+            index += stride*pos->second;
+            stride *= sizes_i[k];
+         }
+         return index;
+      }
+
+      /**
+       * Returns the value of the element with the specified linear index.
+       */
+      maxsum::ValType operator()(maxsum::ValIndex k) const
+      {
+         return offset_i + values_i[k];
+      }
+
+      /**
+       * Returns the value of the element specified by a map from each
+       * variable on which this function depends to its value.
+       */
+      template<class VarMap>
+      typename boost::disable_if<boost::is_arithmetic<VarMap>,
+                                 maxsum::ValType>::type
+      operator()(const VarMap& vars) const
+      {
+         return offset_i + values_i[linearIndex(vars)];
+      }
+
+      /**
+       * Sets the value of the element with the specified linear index.
+       * The value is rounded to StorageType precision.
+       */
+      void set(maxsum::ValIndex k, maxsum::ValType val)
+      {
+         values_i[k] = static_cast<StorageType>(val-offset_i);
+      }
+
+      /**
+       * Expands the domain of a constant function to include the specified
+       * variable, copying its value to every element.
+       * @pre this function does not yet depend on any variables.
+       */
+      void expand(maxsum::VarID var)
+      {
+         expand(&var,&var+1);
+      }
+
+      /**
+       * Expands the domain of a constant function to include the specified
+       * variables, copying its value to every element.
+       * @pre this function does not yet depend on any variables.
+       */
+      template<class Iterator> void expand(Iterator varBegin, Iterator varEnd)
+      {
+         assert(vars_i.empty());
+         vars_i.assign(varBegin,varEnd);
+         std::sort(vars_i.begin(),vars_i.end());
+         vars_i.erase(std::unique(vars_i.begin(),vars_i.end()),vars_i.end());
+
+         sizes_i.resize(vars_i.size());
+         maxsum::ValIndex size = 1;
+         for(std::size_t k=0; k<vars_i.size(); ++k)
+         {
+            sizes_i[k] = maxsum::getDomainSize(vars_i[k]);
+            size *= sizes_i[k];
+         }
+         const StorageType val = values_i.front();
+         values_i.assign(size,val);
+      }
+
+      /**
+       * Swaps the contents of this function with another.
+       */
+      void swap(CompactFunction_Tmpl& rhs)
+      {
+         vars_i.swap(rhs.vars_i);
+         sizes_i.swap(rhs.sizes_i);
+         values_i.swap(rhs.values_i);
+         std::swap(offset_i,rhs.offset_i);
+      }
+
+   }; // class CompactFunction_Tmpl
+
+   /**
+    * Convenience typedef for single precision functions.
+    */
+   typedef CompactFunction_Tmpl<> CompactFunction;
+
+   /**
+    * Normal-Gamma distribution with a separate set of hyperparameters for
+    * each element in the joint domain of a set of maxsum variables, stored
+    * in single precision. The interface mirrors
+    * CachedNormalGamma_Tmpl<maxsum::DiscreteFunction>, so either may be used
+    * for the beliefs maintained by dec_brl::DecBayesQ_Tmpl and
+    * dec_brl::DecBayesModelLearner.
+    *
+    * Alpha is stored less one, because it is only ever observed to be
+    * slightly greater than one, or greater than one by a multiple of a half.
+    * In particular, NormalGamma_Tmpl::DEFAULT_ALPHA would otherwise round to
+    * exactly one, and make the expected variance infinite.
+    * @tparam StorageType type used to store each hyperparameter.
+    * @tparam Policy Boost.Math policy used to calculate results.
+    * @see dec_brl::dist::CachedNormalGamma_Tmpl
+    */
+   template<class StorageType=float,
+            class Policy=boost::math::policies::policy<> >
+   class CompactNormalGamma_Tmpl
+   {
+   public:
+
+      /**
+       * Type used to represent each hyperparameter.
+       */
+      typedef CompactFunction_Tmpl<StorageType> value_type;
+
+      /**
+       * Boost.Math policy type used by this distribution.
+       */
+      typedef Policy policy_type;
+
+      /**
+       * The alpha hyperparameter.
+       */
+      value_type alpha;
+
+      /**
+       * The beta hyperparameter.
+       */
+      value_type beta;
+
+      /**
+       * The lambda hyperparameter.
+       */
+      value_type lambda;
+
+      /**
+       * The m hyperparameter.
+       */
+      value_type m;
+
+      /**
+       * The cached value of
+       * \f$\log\Gamma(\alpha-\frac{1}{2}) - \log\Gamma(\alpha)\f$.
+       */
+      value_type lgammaRatio;
+
+      /**
+       * Constructs a new distribution with specified parameters.
+       * @param[in] a value for alpha hyperparameter.
+       * @param[in] b value for beta hyperparameter.
+       * @param[in] l value for lambda hyperparmeter.
+       * @param[in] m value for m hyperparameter.
+       */
+      CompactNormalGamma_Tmpl
+      (
+       maxsum::ValType a=NormalGamma_Tmpl<double,Policy>::DEFAULT_ALPHA,
+       maxsum::ValType b=NormalGamma_Tmpl<double,Policy>::DEFAULT_BETA,
+       maxsum::ValType l=NormalGamma_Tmpl<double,Policy>::DEFAULT_LAMBDA,
+       maxsum::ValType m=NormalGamma_Tmpl<double,Policy>::DEFAULT_M
+      )
+      : alpha(a,1.0), beta(b), lambda(l), m(m),
+        lgammaRatio(logGammaRatio<maxsum::ValType,Policy>(a))
+      {}
+
+   }; // class CompactNormalGamma_Tmpl
+
+   /**
+    * Convenience typedef for single precision distributions that use the
+    * default Boost.Math policy.
+    */
+   typedef CompactNormalGamma_Tmpl<> CompactNormalGamma;
+
+   /**
+    * Conditions a maxsum::DiscreteFunction on the values of some of its
+    * variables. Forwards to maxsum::condition, so that generic code can
+    * condition either dense or compact hyperparameters in the same way.
+    * @see maxsum::condition
+    */
+   template<class StateMap> void condition
+   (
+    const maxsum::DiscreteFunction& inFun,
+    maxsum::DiscreteFunction& outFun,
+    const StateMap& states
+   )
+   {
+      maxsum::condition(inFun,outFun,states);
+   }
+
+   /**
+    * Conditions a compact function on the values of some of its variables,
+    * producing a double precision maxsum::DiscreteFunction over the
+    * remaining variables.
+    * @tparam StateMap maps maxsum::VarID to maxsum::ValIndex, and implements
+    * find() and end() with the same semantics as std::map.
+    * @param[in] inFun the function to condition.
+    * @param[out] outFun the conditioned function.
+    * @param[in] states values of the variables to condition on.
+    */
+   template<class StorageType, class StateMap> void condition
+   (
+    const CompactFunction_Tmpl<StorageType>& inFun,
+    maxsum::DiscreteFunction& outFun,
+    const StateMap& states
+   )
+   {
+      //************************************************************************
+      // Split the variables into those that are conditioned, which determine
+      // the base index, and those that remain, which are iterated over.
+      //************************************************************************
+      const std::vector<maxsum::ValIndex>& sizes = inFun.sizes();
+      std::vector<maxsum::VarID> freeVars;
+      std::vector<maxsum::ValIndex> freeSizes;
+      std::vector<maxsum::ValIndex> freeStrides;
+      maxsum::ValIndex base = 0;
+      maxsum::ValIndex stride = 1;
+      int k = 0;
+      for(typename CompactFunction_Tmpl<StorageType>::VarIterator
+            it=inFun.varBegin(); it!=inFun.varEnd(); ++it, ++k)
+      {
+         typename StateMap::const_iterator pos = states.find(*it);
+         if(states.end()!=pos)
+         {
+            base += stride*pos->second;
+         }
+         else
+         {
+            freeVars.push_back(*it);
+            freeSizes.push_back(sizes[k]);
+            freeStrides.push_back(stride);
+         }
+         stride *= sizes[k];
+      }
+
+      //************************************************************************
+      // Copy the selected elements in order, by counting through the free
+      // variables' values with the first variable changing fastest.
+      //************************************************************************
+      outFun = maxsum::DiscreteFunction(freeVars.begin(),freeVars.end(),0.0);
+      std::vector<maxsum::ValIndex> sub(freeVars.size(),0);
+      maxsum::ValIndex index = base;
+      for(maxsum::ValIndex outInd=0; outInd<outFun.domainSize(); ++outInd)
+      {
+         outFun(outInd) = inFun(index);
+         for(std::size_t j=0; j<sub.size(); ++j)
+         {
+            index += freeStrides[j];
+            if(++sub[j] < freeSizes[j])
+            {
+               break;
+            }
+            index -= freeStrides[j]*freeSizes[j];
+            sub[j] = 0;
+         }
+      }
+
+   } // condition
+
+   /**
+    * Expands the domain of a compact NormalGamma distribution, so that
+    * it includes the named variables registered by the maxsum library.
+    * @pre the distribution does not yet depend on any variables.
+    */
+   template<class StorageType, class Policy, class ValType> void expand
+   (
+    CompactNormalGamma_Tmpl<StorageType,Policy>& paramDist,
+    ValType var
+   )
+   {
+      paramDist.alpha.expand(var);
+      paramDist.beta.expand(var);
+      paramDist.lambda.expand(var);
+      paramDist.m.expand(var);
+      paramDist.lgammaRatio.expand(var);
+   }
+
+   /**
+    * Expands the domain of a compact NormalGamma distribution, so that
+    * it includes the named variables registered by the maxsum library.
+    * @pre the distribution does not yet depend on any variables.
+    */
+   template<class StorageType, class Policy, class Iterator> void expand
+   (
+    CompactNormalGamma_Tmpl<StorageType,Policy>& paramDist,
+    Iterator varBegin,
+    Iterator varEnd
+   )
+   {
+      paramDist.alpha.expand(varBegin,varEnd);
+      paramDist.beta.expand(varBegin,varEnd);
+      paramDist.lambda.expand(varBegin,varEnd);
+      paramDist.m.expand(varBegin,varEnd);
+      paramDist.lgammaRatio.expand(varBegin,varEnd);
+   }
+
+   /**
+    * Updates a specific element of a compact parameter distribution given
+    * sufficient statistics for a sample drawn from the target distribution,
+    * and updates its cached log gamma ratio. The old hyperparameters are
+    * read into double precision, updated exactly as for a
+    * maxsum::DiscreteFunction distribution, and only rounded when stored.
+    * @param[in] maxSteps largest n for which the log gamma ratio is updated
+    * by recurrence.
+    * @see observe(NormalGamma_Tmpl<maxsum::DiscreteFunction,Policy>&,IndexType,const ValType,const ValType,const int)
+    * @see updateLogGammaRatio
+    */
+   template<class IndexType, class ValType, class StorageType, class Policy>
+   void observe
+   (
+    CompactNormalGamma_Tmpl<StorageType,Policy>& paramDist,
+    IndexType index,
+    const ValType sm,
+    const ValType s2,
+    const int n,
+    const int maxSteps=MAX_RECURRENCE_STEPS
+   )
+   {
+      const maxsum::ValIndex k = paramDist.m.linearIndex(index);
+
+      maxsum::ValType oldAlpha = paramDist.alpha(k);
+      maxsum::ValType oldBeta = paramDist.beta(k);
+      maxsum::ValType oldLambda = paramDist.lambda(k);
+      maxsum::ValType oldM = paramDist.m(k);
+      maxsum::ValType ratio = paramDist.lgammaRatio(k);
+
+      updateLogGammaRatio<maxsum::ValType,Policy>(ratio,oldAlpha,n,maxSteps);
+      maxsum::ValType newAlpha = oldAlpha + n/2.0;
+      maxsum::ValType newLambda = oldLambda + n;
+      maxsum::ValType newM = (oldLambda*oldM + n*sm) / newLambda;
+      maxsum::ValType newBeta = oldBeta + s2/2.0 +
+         n*oldLambda*(oldM-sm)*(oldM-sm)/2.0/newLambda;
+
+      paramDist.alpha.set(k,newAlpha);
+      paramDist.beta.set(k,newBeta);
+      paramDist.lambda.set(k,newLambda);
+      paramDist.m.set(k,newM);
+      paramDist.lgammaRatio.set(k,ratio);
+
+   } // observe
+
+   /**
+    * Applies a batched sufficient statistics update to a single element of
+    * a compact distribution, allowing the log gamma ratio recurrence to run
+    * for up to MAX_BATCH_RECURRENCE_STEPS half steps.
+    * @see observeBatch
+    */
+   template<class StorageType, class Policy> void observeBatchElement
+   (
+    CompactNormalGamma_Tmpl<StorageType,Policy>& paramDist,
+    const maxsum::ValIndex k,
+    const maxsum::ValType sm,
+    const maxsum::ValType s2,
+    const int n
+   )
+   {
+      observe<maxsum::ValIndex>(paramDist, k, sm, s2, n,
+                                MAX_BATCH_RECURRENCE_STEPS);
+   }
+
+} // namespace dist
+} // namespace dec_brl
+
+#endif // DECBRL_COMPACTNORMALGAMMA_H
@@ -0,0 +1,259 @@
+/**
+ * @file ConditionedView.h
+ * Defines non-owning views of a function conditioned on the values of some
+ * of its variables, which read the function's own storage rather than
+ * copying it.
+ */
+#ifndef DECBRL_CONDITIONEDVIEW_H
+#define DECBRL_CONDITIONEDVIEW_H
+
+#include <cassert>
+#include <cstddef>
+#include <vector>
+#include "DiscreteFunction.h"
+#include "register.h"
+
+/**
+ * Namespace all public functions and types defined in the DecBRL library.
+ */
+namespace dec_brl {
+
+/**
+ * Describes which elements of a function over a set of maxsum variables
+ * remain when some of those variables are fixed. The k-th element of the
+ * conditioned function, in the order used by maxsum::condition (first free
+ * variable changing fastest), is element (*this)[k] of the full function.
+ *
+ * A layout depends only on the variables and states, so one layout may be
+ * shared by views of several functions over the same variables, such as the
+ * hyperparameters of a vectorised Normal-Gamma distribution. Its storage is
+ * reused by reset(), so that once it has grown to the largest conditioned
+ * domain, recalculating it does not allocate.
+ * @see dec_brl::ConditionedView
+ */
+class ConditionedLayout
+{
+private:
+
+   /**
+    * Linear index in the full function of the first conditioned element.
+    */
+   maxsum::ValIndex base_i;
+
+   /**
+    * Number of values of each free (unconditioned) variable.
+    */
+   std::vector<maxsum::ValIndex> extents_i;
+
+   /**
+    * Stride in the full function of each free variable.
+    */
+   std::vector<maxsum::ValIndex> strides_i;
+
+   /**
+    * Counter used to step through the free variables' values.
+    */
+   std::vector<maxsum::ValIndex> sub_i;
+
+   /**
+    * Linear index in the full function of each conditioned element.
+    */
+   std::vector<maxsum::ValIndex> offsets_i;
+
+public:
+
+   /**
+    * Constructs an empty layout.
+    */
+   ConditionedLayout()
+   : base_i(0), extents_i(), strides_i(), sub_i(), offsets_i()
+   {}
+
+   /**
+    * Recalculates this layout for a function over the specified variables,
+    * conditioned on the specified states.
+    * @tparam VarIt iterator over the function's maxsum::VarID values, in the
+    * order used to index the function.
+    * @tparam StateMap maps maxsum::VarID to maxsum::ValIndex, and implements
+    * find() and end() with the same semantics as std::map.
+    * @param[in] varBegin iterator to the function's first variable.
+    * @param[in] varEnd iterator to the end of the function's variables.
+    * @param[in] states values of the variables to condition on. Any
+    * variables on which the function does not depend are ignored.
+    */
+   template<class VarIt, class StateMap> void reset
+   (
+    VarIt varBegin,
+    VarIt varEnd,
+    const StateMap& states
+   )
+   {
+      //************************************************************************
+      // Split the variables into those that are conditioned, which determine
+      // the base index, and those that remain, which are iterated over.
+      //************************************************************************
+      base_i = 0;
+      extents_i.clear();
+      strides_i.clear();
+      maxsum::ValIndex stride = 1;
+      maxsum::ValIndex size = 1;
+      for(VarIt it=varBegin; it!=varEnd; ++it)
+      {
+         const maxsum::ValIndex extent = maxsum::getDomainSize(*it);
+         typename StateMap::const_iterator pos = states.find(*it);
+         if(states.end()!=pos)
+         {
+            base_i += stride*pos->second;
+         }
+         else
+         {
+            extents_i.push_back(extent);
+            strides_i.push_back(stride);
+            size *= extent;
+         }
+         stride *= extent;
+      }
+
+      //************************************************************************
+      // List the index of each conditioned element, by counting through the
+      // free variables' values with the first variable changing fastest.
+      //************************************************************************
+      sub_i.assign(extents_i.size(),0);
+      offsets_i.resize(size);
+      maxsum::ValIndex index = base_i;
+      for(maxsum::ValIndex k=0; k<size; ++k)
+      {
+         offsets_i[k] = index;
+         for(std::size_t j=0; j<sub_i.size(); ++j)
+         {
+            index += strides_i[j];
+            if(++sub_i[j] < extents_i[j])
+            {
+               break;
+            }
+            index -= strides_i[j]*extents_i[j];
+            sub_i[j] = 0;
+         }
+      }
+
+   } // reset
+
+   /**
+    * Returns the number of elements in the conditioned domain.
+    */
+   maxsum::ValIndex size() const
+   {
+      return static_cast<maxsum::ValIndex>(offsets_i.size());
+   }
+
+   /**
+    * Returns the number of free (unconditioned) variables.
+    */
+   std::size_t noFreeVars() const
+   {
+      return extents_i.size();
+   }
+
+   /**
+    * Returns the linear index in the full function of the first conditioned
+    * element.
+    */
+   maxsum::ValIndex base() const
+   {
+      return base_i;
+   }
+
+   /**
+    * Returns the linear index in the full function of the k-th conditioned
+    * element.
+    */
+   maxsum::ValIndex operator[](maxsum::ValIndex k) const
+   {
+      assert(k<size());
+      return offsets_i[k];
+   }
+
+   /**
+    * Returns the linear indices in the full function of all conditioned
+    * elements, in order.
+    * @pre size() is positive.
+    */
+   const maxsum::ValIndex* offsets() const
+   {
+      assert(!offsets_i.empty());
+      return &offsets_i[0];
+   }
+
+}; // class ConditionedLayout
+
+/**
+ * Read-only view of a function conditioned on the values of some of its
+ * variables. The view holds pointers to the function and to a layout, and
+ * copies neither, so the result of maxsum::condition can be read element by
+ * element without allocating a new function.
+ * @tparam Function type of the viewed function, such as
+ * maxsum::DiscreteFunction or dec_brl::dist::CompactFunction_Tmpl, which
+ * must provide a const operator() taking a linear index.
+ * @pre the function and layout outlive the view, and the function's domain
+ * does not change while the view is in use.
+ */
+template<class Function> class ConditionedView
+{
+private:
+
+   /**
+    * The viewed function.
+    */
+   const Function* fun_i;
+
+   /**
+    * Indices of the conditioned elements in the viewed function.
+    */
+   const ConditionedLayout* layout_i;
+
+public:
+
+   /**
+    * Constructs a view of a function through the specified layout.
+    */
+   ConditionedView(const Function& fun, const ConditionedLayout& layout)
+   : fun_i(&fun), layout_i(&layout)
+   {}
+
+   /**
+    * Returns the number of elements in the conditioned domain.
+    */
+   maxsum::ValIndex size() const
+   {
+      return layout_i->size();
+   }
+
+   /**
+    * Returns the viewed function.
+    */
+   const Function& function() const
+   {
+      return *fun_i;
+   }
+
+   /**
+    * Returns the layout through which the function is viewed.
+    */
+   const ConditionedLayout& layout() const
+   {
+      return *layout_i;
+   }
+
+   /**
+    * Returns the k-th element of the conditioned function.
+    */
+   maxsum::ValType operator[](maxsum::ValIndex k) const
+   {
+      return (*fun_i)((*layout_i)[k]);
+   }
+
+}; // class ConditionedView
+
+} // namespace dec_brl
+
+#endif // DECBRL_CONDITIONEDVIEW_H
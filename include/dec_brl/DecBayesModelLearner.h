@@ -4,11 +4,18 @@
 #include "dec_brl/random.h"
 #include "dec_brl/NormalGamma.h"
 #include "dec_brl/vpi.h"
+#include "dec_brl/FactorVPICache.h"
+#include "dec_brl/CompactNormalGamma.h"
 #include "dec_brl/util.h"
+#include "dec_brl/FlatVarMap.h"
+#include "dec_brl/GreedySolutionCache.h"
+#include "dec_brl/FactorAccessPlan.h"
+#include "dec_brl/Executor.h"
 #include "MaxSumController.h"
 #include <set>
 #include <list>
 #include <algorithm>
+#include <vector>
 
 namespace dec_brl {
 
@@ -16,8 +23,16 @@ namespace dec_brl {
  * Implements a factored a decentralised model based Bayesian Reinforcement
  * learner.
  * @tparam MDPSolver type used to solve factored MDPs in subroutines.
+ * @tparam BeliefDist type of vectorised Normal-Gamma distribution used to
+ * store reward beliefs, such as dist::CompactNormalGamma to store them in
+ * single precision.
  */
-template<class MDPSolver> class DecBayesModelLearner
+template
+<
+ class MDPSolver,
+ class BeliefDist=dist::CachedNormalGamma_Tmpl<maxsum::DiscreteFunction>
+>
+class DecBayesModelLearner
 {
 private:
 
@@ -59,9 +74,10 @@ private:
    /**
     * Convenience type def for a reward belief distribution.
     * This is a normal gamma distribution defined for each element of a
-    * DiscreteFunction.
+    * DiscreteFunction. We use a cached version, so that the log gamma
+    * ratios required for VPI are maintained as observations are made.
     */
-   typedef dist::NormalGamma_Tmpl<maxsum::DiscreteFunction> RewardDist;
+   typedef BeliefDist RewardDist;
 
    /**
     * Convenience type def for reward belief maps
@@ -73,6 +89,235 @@ private:
     */
    RewardBeliefMap rewardBeliefs_i;
 
+   /**
+    * Convenience type def for the cached conditioned beliefs and VPI of a
+    * single factor.
+    */
+   typedef FactorVPICache<RewardDist> VPICache;
+
+   /**
+    * Convenience type def for VPI cache maps.
+    */
+   typedef std::map<maxsum::FactorID, VPICache> VPICacheMap;
+
+   /**
+    * Conditioned beliefs and VPI for each factor, which are only
+    * recalculated for factors whose beliefs, states or total value have
+    * changed since the last call to act.
+    */
+   VPICacheMap vpiCache_i;
+
+   /**
+    * Convenience type def for access plan maps.
+    */
+   typedef std::map<maxsum::FactorID, FactorAccessPlan> PlanMap;
+
+   /**
+    * Stride table for each factor, used to compute the linear index of a
+    * joint state-action once, rather than once per hyperparameter.
+    */
+   PlanMap accessPlans_i;
+
+   /**
+    * True iff VPI is calculated using the fast Student's t CDF.
+    * @see setFastCdf
+    */
+   bool isFastCdf_i;
+
+   /**
+    * VPI values known to be less than this are set to zero.
+    * @see setVPIEpsilon
+    */
+   maxsum::ValType vpiEpsilon_i;
+
+   /**
+    * Union of the prior states and actions passed to observe. This is
+    * kept between calls, so that observe does not allocate memory.
+    */
+   FlatVarMap priorVars_i;
+
+   /**
+    * Union of the post states passed to observe and their greedy actions.
+    * This is kept between calls, so that observe does not allocate memory.
+    */
+   FlatVarMap postVars_i;
+
+   /**
+    * Records whether maxsum_i still holds the greedy solution computed by
+    * the last call to actGreedy, so that it can be reused by act.
+    */
+   GreedySolutionCache greedyCache_i;
+
+   /**
+    * Pointers to the beliefs, conditioned belief cache and max-sum total
+    * value of a single factor, gathered so that per-factor work in act can
+    * be handed to an executor.
+    */
+   struct FactorWork
+   {
+      /**
+       * The factor's id.
+       */
+      maxsum::FactorID factor;
+
+      /**
+       * The factor's beliefs.
+       */
+      const RewardDist* belief;
+
+      /**
+       * The factor's cached conditioned beliefs and VPI.
+       */
+      VPICache* cache;
+
+      /**
+       * The factor's total value from the last max-sum optimisation.
+       */
+      const maxsum::DiscreteFunction* totalValue;
+   };
+
+   /**
+    * Work items for each factor, rebuilt on each call to act.
+    */
+   std::vector<FactorWork> work_i;
+
+   /**
+    * Task that conditions the beliefs of each factor on the current states.
+    * @tparam StateMap type of map used to store current states
+    */
+   template<class StateMap> class ConditionTask : public Executor::Task
+   {
+   private:
+
+      /**
+       * Work item for each factor.
+       */
+      std::vector<FactorWork>& work_i;
+
+      /**
+       * The current states.
+       */
+      const StateMap& states_i;
+
+   public:
+
+      /**
+       * Constructs a task for the specified factors and states.
+       */
+      ConditionTask(std::vector<FactorWork>& work, const StateMap& states)
+      : work_i(work), states_i(states) {}
+
+      /**
+       * Conditions the beliefs of the k-th factor.
+       */
+      void operator()(std::size_t k)
+      {
+         work_i[k].cache->condition(*work_i[k].belief,states_i);
+      }
+   };
+
+   /**
+    * Task that calculates the VPI of each factor, given its total value.
+    */
+   class VPITask : public Executor::Task
+   {
+   private:
+
+      /**
+       * Work item for each factor.
+       */
+      std::vector<FactorWork>& work_i;
+
+      /**
+       * True iff VPI uses the fast Student's t CDF.
+       */
+      bool isFastCdf_i;
+
+      /**
+       * Threshold below which VPI is set to zero.
+       */
+      maxsum::ValType epsilon_i;
+
+   public:
+
+      /**
+       * Constructs a task for the specified factors and VPI settings.
+       */
+      VPITask
+      (
+       std::vector<FactorWork>& work,
+       bool isFastCdf,
+       maxsum::ValType epsilon
+      )
+      : work_i(work), isFastCdf_i(isFastCdf), epsilon_i(epsilon) {}
+
+      /**
+       * Calculates the VPI of the k-th factor.
+       */
+      void operator()(std::size_t k)
+      {
+         work_i[k].cache->updateVPI(*work_i[k].totalValue,0,isFastCdf_i,
+               epsilon_i);
+      }
+   };
+
+   /**
+    * Executor used to run per-factor work in act, or 0 to run it serially.
+    * @see setExecutor
+    */
+   Executor* executor_i;
+
+   /**
+    * Gathers a work item for each factor, and conditions each factor's
+    * beliefs on the current states, using the executor if there is one.
+    */
+   template<class StateMap> void conditionAll(const StateMap& states)
+   {
+      work_i.clear();
+      for(typename RewardBeliefMap::const_iterator it=rewardBeliefs_i.begin();
+            it!=rewardBeliefs_i.end(); ++it)
+      {
+         FactorWork item;
+         item.factor = it->first;
+         item.belief = &(it->second);
+         item.cache = &vpiCache_i[it->first];
+         item.totalValue = 0;
+         work_i.push_back(item);
+      }
+
+      ConditionTask<StateMap> task(work_i,states);
+      if(0==executor_i)
+      {
+         SerialExecutor().run(work_i.size(),task);
+      }
+      else
+      {
+         executor_i->run(work_i.size(),task);
+      }
+   }
+
+   /**
+    * Calculates the VPI of each factor gathered by conditionAll, given its
+    * max-sum total value, using the executor if there is one.
+    */
+   void updateAllVPI()
+   {
+      for(std::size_t k=0; k<work_i.size(); ++k)
+      {
+         work_i[k].totalValue = &maxsum_i.getTotalValue(work_i[k].factor);
+      }
+
+      VPITask task(work_i,isFastCdf_i,vpiEpsilon_i);
+      if(0==executor_i)
+      {
+         SerialExecutor().run(work_i.size(),task);
+      }
+      else
+      {
+         executor_i->run(work_i.size(),task);
+      }
+   }
+
 public:
 
    /**
@@ -87,7 +332,9 @@ public:
    )
    : solver_i(solver), gamma_i(gamma), 
      maxsum_i(maxIterations,maxnorm), actionSet_i(), isInitialised_i(false),
-     rewardBeliefs_i()
+     rewardBeliefs_i(), vpiCache_i(), accessPlans_i(), isFastCdf_i(false),
+     vpiEpsilon_i(0), priorVars_i(), postVars_i(), greedyCache_i(), work_i(),
+     executor_i(0)
    {}
 
    /**
@@ -96,7 +343,11 @@ public:
    DecBayesModelLearner(const DecBayesModelLearner& rhs)
    : solver_i(rhs.solver_i), gamma_i(rhs.gamma_i), 
      maxsum_i(rhs.maxsum_i), actionSet_i(rhs.actionSet_i), 
-     isInitialised_i(rhs.isInitialised_i), rewardBeliefs_i(rhs.rewardBeliefs_i)
+     isInitialised_i(rhs.isInitialised_i), rewardBeliefs_i(rhs.rewardBeliefs_i),
+     vpiCache_i(rhs.vpiCache_i), accessPlans_i(rhs.accessPlans_i),
+     isFastCdf_i(rhs.isFastCdf_i), vpiEpsilon_i(rhs.vpiEpsilon_i),
+     priorVars_i(), postVars_i(), greedyCache_i(rhs.greedyCache_i),
+     work_i(), executor_i(0)
    {}
 
    /**
@@ -110,9 +361,77 @@ public:
       actionSet_i = rhs.actionSet_i;
       isInitialised_i = rhs.isInitialised_i;
       rewardBeliefs_i = rhs.rewardBeliefs_i;
+      vpiCache_i = rhs.vpiCache_i;
+      accessPlans_i = rhs.accessPlans_i;
+      isFastCdf_i = rhs.isFastCdf_i;
+      vpiEpsilon_i = rhs.vpiEpsilon_i;
+      greedyCache_i = rhs.greedyCache_i;
+      executor_i = 0;
       return *this;
    }
 
+   /**
+    * Sets how the Student's t CDF is evaluated when calculating VPI.
+    * By default, this uses Boost.Math, but the fast mode is usually much
+    * cheaper, and each VPI value remains within
+    * dec_brl::dist::FastCdf::MAX_ABS_ERROR times the distance between its
+    * action's expected value and the best alternative.
+    * @param[in] isFast true to use dec_brl::dist::FastCdf, or false to use
+    * dec_brl::dist::ExactCdf.
+    */
+   void setFastCdf(bool isFast)
+   {
+      isFastCdf_i = isFast;
+   }
+
+   /**
+    * Returns true iff VPI is calculated using the fast Student's t CDF.
+    * @see setFastCdf
+    */
+   bool isFastCdf() const
+   {
+      return isFastCdf_i;
+   }
+
+   /**
+    * Sets the threshold below which VPI values are set to zero. Actions
+    * whose VPI is known to be below this are pruned without evaluating the
+    * Student's t CDF, so each value is within epsilon of its unpruned value.
+    * By default, nothing is pruned.
+    * @param[in] epsilon the pruning threshold, or 0 to disable pruning.
+    */
+   void setVPIEpsilon(maxsum::ValType epsilon)
+   {
+      assert(0<=epsilon);
+      vpiEpsilon_i = epsilon;
+   }
+
+   /**
+    * Returns the threshold below which VPI values are set to zero.
+    * @see setVPIEpsilon
+    */
+   maxsum::ValType getVPIEpsilon() const
+   {
+      return vpiEpsilon_i;
+   }
+
+   /**
+    * Sets the executor used by act to condition beliefs and calculate VPI
+    * for each factor. By default, this is done serially in the calling
+    * thread, but for graphs with many factors, a dec_brl::ThreadPool may be
+    * used to split factors across cores. Only the work for each factor is
+    * run by the executor: max-sum is always updated and run in the calling
+    * thread.
+    * @param[in] executor the executor to use, or 0 to run serially. This
+    * learner does not take ownership, so the executor must outlive its calls
+    * to act. The executor is not copied: copies of this learner, and learners
+    * assigned from it, run serially until they are given their own.
+    */
+   void setExecutor(Executor* executor)
+   {
+      executor_i = executor;
+   }
+
    /**
     * Adds a reward factor to the factor graph.
     * Adds a factored reward to the factor graph, given a specified unique
@@ -159,10 +478,11 @@ public:
       // This will copy the default hyperparameter values for each joint
       // state-action in the Q factor's domain.
       //************************************************************************
-      dist.alpha.expand(varBegin,varEnd);
-      dist.beta.expand(varBegin,varEnd);
-      dist.lambda.expand(varBegin,varEnd);
-      dist.m.expand(varBegin,varEnd);
+      dist::expand(dist,varBegin,varEnd);
+      accessPlans_i[factor] =
+         FactorAccessPlan(dist.m.varBegin(),dist.m.varEnd());
+      vpiCache_i[factor].touch();
+      greedyCache_i.invalidate();
       
    } // addFactor
 
@@ -197,7 +517,7 @@ public:
       // Construct set of all variables
       //************************************************************************
       std::set<maxsum::VarID> allVars;
-      for(RewardBeliefMap::const_iterator it=rewardBeliefs_i.begin();
+      for(typename RewardBeliefMap::const_iterator it=rewardBeliefs_i.begin();
             it!=rewardBeliefs_i.end(); ++it)
       {
          const RewardDist& fun = it->second;
@@ -219,6 +539,16 @@ public:
 
    } // setStates function
 
+   /**
+    * Returns the number of times that act or actGreedy reused the greedy
+    * solution found by the previous call to actGreedy, instead of running
+    * max-sum again.
+    */
+   long getGreedyReuseCount() const
+   {
+      return greedyCache_i.noReuses();
+   }
+
    /**
     * Return the next actions selected by the Learner.
     * This is equivalent to the act member function, except that
@@ -229,7 +559,8 @@ public:
     * The minimum requirement for the state and action map types is that
     * they implement operator[], begin(), and end() with the same semantics
     * as std::map<maxsum::VarID,maxsum::ValIndex>. Obviously, this type will
-    * do nicely, but the user is free to provide their own compatible type.
+    * do nicely, but the user is free to provide their own compatible type,
+    * such as dec_brl::FlatVarMap, which avoids allocation on each call.
     * @tparam ActionMap type of map used to store action selections
     * @tparam StateMap type of map used to store current states
     * @param[in] map of state variable ids to their current values.
@@ -237,7 +568,9 @@ public:
     * @pre states contains mapped values for each state.
     * @post each action variable will be mapped to its selected value.
     * @returns the number of max-sum iterations performs (0 means this was an
-    * exploratory move).
+    * exploratory move). If the last greedy solution is reused, this is the
+    * number of iterations taken to find it; reuse is counted separately by
+    * getGreedyReuseCount().
     */
    template<class ActionMap, class StateMap> int actGreedy
    (
@@ -268,23 +601,35 @@ public:
 
       } // if statement
 
+      //************************************************************************
+      // If max-sum still holds the greedy solution for these states, because
+      // nothing it depends on has changed since it was found, reuse it.
+      //************************************************************************
+      if(greedyCache_i.reuse(states))
+      {
+         actions.clear();
+         actions.insert(maxsum_i.valBegin(),maxsum_i.valEnd());
+         return greedyCache_i.noIterations();
+      }
+
       //************************************************************************
       // Condition the MaxSumController on the current states and expected
       // rewards. Note that the expected rewards are equal to the 'm'
       // hyperparameter of the NormalGamma distribution.
       //************************************************************************
-      maxsum::DiscreteFunction curFactor;
-      for(RewardBeliefMap::const_iterator it=rewardBeliefs_i.begin();
+      for(typename RewardBeliefMap::const_iterator it=rewardBeliefs_i.begin();
             it!=rewardBeliefs_i.end(); ++it)
       {
-         maxsum::condition(it->second.m,curFactor,states);
-         maxsum_i.setFactor(it->first,curFactor);
+         VPICache& cache = vpiCache_i[it->first];
+         cache.condition(it->second,states);
+         maxsum_i.setFactor(it->first,cache.expectedValue());
       }
 
       //************************************************************************
       // Run max-sum to optimise the set of actions
       //************************************************************************
       int msIterationCount = maxsum_i.optimise();
+      greedyCache_i.store(states,msIterationCount);
 
       //************************************************************************
       // Populate the action map with the optimised actions.
@@ -306,7 +651,8 @@ public:
     * The minimum requirement for the state and action map types is that
     * they implement operator[], begin(), and end() with the same semantics
     * as std::map<maxsum::VarID,maxsum::ValIndex>. Obviously, this type will
-    * do nicely, but the user is free to provide their own compatible type.
+    * do nicely, but the user is free to provide their own compatible type,
+    * such as dec_brl::FlatVarMap, which avoids allocation on each call.
     * @tparam ActionMap type of map used to store action selections
     * @tparam StateMap type of map used to store current states
     * @param[in] map of state variable ids to their current values.
@@ -314,7 +660,9 @@ public:
     * @pre states contains mapped values for each state.
     * @post each action variable will be mapped to its selected value.
     * @returns the number of max-sum iterations performs (0 means this was an
-    * exploratory move).
+    * exploratory move). If the last greedy solution is reused, this is the
+    * number of iterations taken to find it; reuse is counted separately by
+    * getGreedyReuseCount().
     */
    template<class ActionMap, class StateMap> int act
    (
@@ -322,6 +670,12 @@ public:
     ActionMap& actions
    )
    {
+      //************************************************************************
+      // Check whether max-sum still holds the greedy solution for these
+      // states, found by the last call to actGreedy.
+      //************************************************************************
+      const bool isGreedyReused = greedyCache_i.reuse(states);
+
       //************************************************************************
       // If this is the first call to act, construct the action set, from the
       // combined domain of all factors minus the specified states.
@@ -349,18 +703,30 @@ public:
          // rewards. Note that the expected rewards are equal to the 'm'
          // hyperparameter of the NormalGamma distribution.
          //*********************************************************************
-         maxsum::DiscreteFunction curFactor;
-         for(RewardBeliefMap::const_iterator it=rewardBeliefs_i.begin();
-               it!=rewardBeliefs_i.end(); ++it)
+         conditionAll(states);
+         for(std::size_t k=0; k<work_i.size(); ++k)
          {
-            maxsum::condition(it->second.m,curFactor,states);
-            maxsum_i.setFactor(it->first,curFactor);
+            maxsum_i.setFactor(work_i[k].factor,
+                  work_i[k].cache->expectedValue());
          }
 
       } 
       //************************************************************************
-      // If we've already initialised, then we modify the maxsum's factor
-      // the fast way.
+      // If max-sum still holds the greedy solution for these states, we can
+      // skip straight to calculating VPI.
+      //************************************************************************
+      else if(isGreedyReused)
+      {
+         //*********************************************************************
+         // The last call to actGreedy optimised the expected rewards for the
+         // same states, and max-sum still holds its factors and messages, so
+         // we only need to bring the conditioned beliefs up to date.
+         //*********************************************************************
+         conditionAll(states);
+      }
+      //************************************************************************
+      // Otherwise, if we've already initialised, then we modify the maxsum's
+      // factor the fast way.
       //************************************************************************
       else
       {
@@ -368,57 +734,51 @@ public:
          // Condition the MaxSumController on the current states and expected
          // rewards. Note that the expected rewards are equal to the 'm'
          // hyperparameter of the NormalGamma distribution.
+         // The conditioned values are only recalculated for dirty factors,
+         // but every factor must still be reset, because the last call to
+         // act added VPI to it.
          //*********************************************************************
-         for(RewardBeliefMap::const_iterator it=rewardBeliefs_i.begin();
-               it!=rewardBeliefs_i.end(); ++it)
+         conditionAll(states);
+         for(std::size_t k=0; k<work_i.size(); ++k)
          {
-            maxsum::DiscreteFunction& curFactor = 
-               maxsum_i.getUnSafeWritableFactorHandle(it->first);
-
-            maxsum::condition(it->second.m,curFactor,states);
-            maxsum_i.notifyFactor(it->first); // notify maxsum of change 
+            const maxsum::FactorID factor = work_i[k].factor;
+            maxsum_i.getUnSafeWritableFactorHandle(factor) =
+               work_i[k].cache->expectedValue();
+            maxsum_i.notifyFactor(factor); // notify maxsum of change 
 
          } // for
       } // else
 
       //************************************************************************
       // Run max-sum to calculate each factor's total local value
-      // (sum of factor plus its received messages).
+      // (sum of factor plus its received messages), unless we already have.
       //************************************************************************
-      int msIterationCount = maxsum_i.optimise();
+      int msIterationCount = greedyCache_i.noIterations();
+      if(!isGreedyReused)
+      {
+         msIterationCount = maxsum_i.optimise();
+      }
+      greedyCache_i.invalidate();
 
       //************************************************************************
-      // For each factor 
+      // Calculate local vpi for current state from the belief distribution
+      // over the local combined value of each factor. This is the same as the
+      // local belief distribution, except it is conditioned on the current
+      // state, and the mean is shifted to include the messages past from all
+      // neighbouring nodes. VPI is only recalculated if the factor is dirty
+      // or its total value has changed.
       //************************************************************************
-      for(RewardBeliefMap::const_iterator it=rewardBeliefs_i.begin();
-            it!=rewardBeliefs_i.end(); ++it)
-      {
-         const maxsum::FactorID factor = it->first;
-         const RewardDist& valDist = it->second;
-
-         //*********************************************************************
-         // Construct the belief distribution over the local combined value
-         // This is the same as the local belief distribution, except it is
-         // conditioned on the current state, and the mean is shifted to include
-         // the messages past from all neighbouring nodes.
-         //*********************************************************************
-         RewardDist totValDist;
-         totValDist.m = maxsum_i.getTotalValue(factor);
-         maxsum::condition(valDist.alpha,totValDist.alpha,states);
-         maxsum::condition(valDist.beta,totValDist.beta,states);
-         maxsum::condition(valDist.lambda,totValDist.lambda,states);
+      updateAllVPI();
 
-         //*********************************************************************
-         // Calculate local vpi for current state
-         //*********************************************************************
-         maxsum::DiscreteFunction localVPI;
-         exactVPI(totValDist, localVPI);
-
-         //*********************************************************************
-         // Add VPI to expected local Q - which is already stored in 
-         // maxsum controller
-         //*********************************************************************
-         maxsum_i.getUnSafeWritableFactorHandle(factor) += localVPI;
+      //************************************************************************
+      // For each factor, add VPI to expected local reward - which is already
+      // stored in maxsum controller
+      //************************************************************************
+      for(std::size_t k=0; k<work_i.size(); ++k)
+      {
+         const maxsum::FactorID factor = work_i[k].factor;
+         maxsum_i.getUnSafeWritableFactorHandle(factor) +=
+            work_i[k].cache->vpi();
          maxsum_i.notifyFactor(factor); // notify maxsum of change to factor
 
       } // for loop
@@ -472,23 +832,22 @@ public:
       // Take the union of the previous states and the last set of actions.
       // This specifies which rewards need to be updated.
       //************************************************************************
-      std::map<VarID,ValIndex> priorVars;
-      priorVars.insert(priorStates.begin(),priorStates.end());
-      priorVars.insert(actions.begin(),actions.end());
+      priorVars_i.clear();
+      priorVars_i.insert(priorStates.begin(),priorStates.end());
+      priorVars_i.insert(actions.begin(),actions.end());
 
       //************************************************************************
       // Choose greedy actions w.r.t. to current states. These are used to
       // perform the maximisation step in the update.
       //************************************************************************
-      std::map<VarID,ValIndex> postVars;
-      actGreedy(postStates,postVars);
+      actGreedy(postStates,postVars_i);
 
       //************************************************************************
       // Bundle the next states in with the greedy next actions. Again, this
       // is for the maximisation step - specifying the s' and a' together for
       // finding the value of Q(s',a').
       //************************************************************************
-      postVars.insert(postStates.begin(),postStates.end());
+      postVars_i.insert(postStates.begin(),postStates.end());
 
       //************************************************************************
       // For each observed reward 
@@ -499,7 +858,8 @@ public:
          //*********************************************************************
          // Find the corresponding factored q-value belief distribution
          //*********************************************************************
-         RewardBeliefMap::iterator qPos = rewardBeliefs_i.find(it->first);
+         typename RewardBeliefMap::iterator qPos =
+            rewardBeliefs_i.find(it->first);
 
          //*********************************************************************
          // If we can't find this factor, go on to the next one
@@ -510,13 +870,16 @@ public:
          }
          
          //*********************************************************************
-         // Retrieve the hyperparameters for the next local reward
+         // Retrieve the hyperparameters for the next local reward. These
+         // share the same domain, so we only compute their index once.
          //*********************************************************************
          RewardDist& dist = qPos->second;
-         const ValType nxtAlpha = dist.alpha(postVars);
-         const ValType nxtBeta = dist.beta(postVars);
-         const ValType nxtLambda = dist.lambda(postVars);
-         const ValType nxtM = dist.m(postVars);
+         const FactorAccessPlan& plan = accessPlans_i[it->first];
+         const ValIndex nxtIndex = plan.index(postVars_i);
+         const ValType nxtAlpha = dist.alpha(nxtIndex);
+         const ValType nxtBeta = dist.beta(nxtIndex);
+         const ValType nxtLambda = dist.lambda(nxtIndex);
+         const ValType nxtM = dist.m(nxtIndex);
          
          //*********************************************************************
          // Calculate the required moments
@@ -531,7 +894,9 @@ public:
          // Find the corresponding linear index for the current reward
          // distribution, and use the calculated moments to update it.
          //*********************************************************************
-         dist::observe<std::map<VarID,ValIndex>&>(dist,priorVars,expQ,expQ2,1);
+         dist::observe<ValIndex>(dist,plan.index(priorVars_i),expQ,expQ2,1);
+         vpiCache_i[it->first].touchState(priorVars_i);
+         greedyCache_i.update(dist.m.varBegin(),dist.m.varEnd(),priorVars_i);
 
       } // for loop
 
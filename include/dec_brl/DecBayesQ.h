@@ -4,18 +4,40 @@
 #include "dec_brl/random.h"
 #include "dec_brl/NormalGamma.h"
 #include "dec_brl/vpi.h"
+#include "dec_brl/FactorVPICache.h"
+#include "dec_brl/CompactNormalGamma.h"
+#include "dec_brl/InterleavedNormalGamma.h"
+#include "dec_brl/FlatVarMap.h"
+#include "dec_brl/GreedySolutionCache.h"
+#include "dec_brl/FactorAccessPlan.h"
+#include "dec_brl/Executor.h"
 #include "MaxSumController.h"
 #include <set>
 #include <list>
 #include <algorithm>
+#include <vector>
+#include <cmath>
 
 namespace dec_brl {
 
 /**
  * Implements a factored Q Learning policy using maxsum and e-greedy
  * exploration. 
+ * @tparam BeliefDist type of vectorised Normal-Gamma distribution used to
+ * store Q-value beliefs. By default, hyperparameters are stored in double
+ * precision, but dist::CompactNormalGamma may be used instead to store them
+ * in single precision, halving belief memory, or
+ * dist::InterleavedNormalGamma to store each element's hyperparameters in
+ * a single record, so that each update touches one cache line.
+ * @see dec_brl::DecBayesQ
+ * @see dec_brl::CompactDecBayesQ
+ * @see dec_brl::InterleavedDecBayesQ
  */
-class DecBayesQ
+template
+<
+ class BeliefDist=dist::CachedNormalGamma_Tmpl<maxsum::DiscreteFunction>
+>
+class DecBayesQ_Tmpl
 {
 private:
 
@@ -58,20 +80,407 @@ private:
    /**
     * Convenience type def for a Q-value belief distribution.
     * This is a normal gamma distribution defined for each element of a
-    * DiscreteFunction.
+    * DiscreteFunction. We use a cached version, so that the log gamma
+    * ratios required for VPI are maintained as observations are made.
     */
-   typedef dist::NormalGamma_Tmpl<maxsum::DiscreteFunction> QDist;
+   typedef BeliefDist QDist;
 
    /**
     * Convenience type def for Q-value belief maps
     */
    typedef std::map<maxsum::FactorID, QDist> BeliefMap;
 
+   /**
+    * Type of map used to store the access plan for each factor.
+    */
+   typedef std::map<maxsum::FactorID, FactorAccessPlan> PlanMap;
+
    /**
     * Estimated Q-values stored as DiscreteFunctions.
     */
    BeliefMap qBeliefs_i;
 
+   /**
+    * Convenience type def for the cached conditioned beliefs and VPI of a
+    * single factor.
+    */
+   typedef FactorVPICache<QDist> VPICache;
+
+   /**
+    * Convenience type def for VPI cache maps.
+    */
+   typedef std::map<maxsum::FactorID, VPICache> VPICacheMap;
+
+   /**
+    * Conditioned beliefs and VPI for each factor, which are only
+    * recalculated for factors whose beliefs, states or total value have
+    * changed since the last call to act.
+    */
+   VPICacheMap vpiCache_i;
+
+   /**
+    * Stride table for each factor, used to compute the linear index of a
+    * joint state-action once, rather than once per hyperparameter.
+    */
+   PlanMap accessPlans_i;
+
+   /**
+    * Number of samples used to estimate VPI for each joint action, or 0 if
+    * VPI is calculated exactly.
+    * @see setVPISamples
+    */
+   int vpiSamples_i;
+
+   /**
+    * True iff exact VPI is calculated using the fast Student's t CDF.
+    * @see setFastCdf
+    */
+   bool isFastCdf_i;
+
+   /**
+    * Exactly calculated VPI values known to be less than this are set to
+    * zero.
+    * @see setVPIEpsilon
+    */
+   maxsum::ValType vpiEpsilon_i;
+
+   /**
+    * Maximum number of joint states for which each factor caches its
+    * conditioned beliefs and VPI.
+    * @see setVPICacheSize
+    */
+   std::size_t vpiCacheSize_i;
+
+   /**
+    * Union of the prior states and actions passed to observe. This is
+    * kept between calls, so that observe does not allocate memory.
+    */
+   FlatVarMap priorVars_i;
+
+   /**
+    * Union of the post states passed to observe and their greedy actions.
+    * This is kept between calls, so that observe does not allocate memory.
+    */
+   FlatVarMap postVars_i;
+
+   /**
+    * Records whether maxsum_i still holds the greedy solution computed by
+    * the last call to actGreedy, so that it can be reused by act.
+    */
+   GreedySolutionCache greedyCache_i;
+
+   /**
+    * Pointers to the beliefs, conditioned belief cache and max-sum total
+    * value of a single factor, gathered so that per-factor work in act can
+    * be handed to an executor.
+    */
+   struct FactorWork
+   {
+      /**
+       * The factor's id.
+       */
+      maxsum::FactorID factor;
+
+      /**
+       * The factor's beliefs.
+       */
+      const QDist* belief;
+
+      /**
+       * The factor's cached conditioned beliefs and VPI.
+       */
+      VPICache* cache;
+
+      /**
+       * The factor's total value from the last max-sum optimisation.
+       */
+      const maxsum::DiscreteFunction* totalValue;
+   };
+
+   /**
+    * Work items for each factor, rebuilt on each call to act.
+    */
+   std::vector<FactorWork> work_i;
+
+   /**
+    * Task that conditions the beliefs of each factor on the current states.
+    * @tparam StateMap type of map used to store current states
+    */
+   template<class StateMap> class ConditionTask : public Executor::Task
+   {
+   private:
+
+      /**
+       * Work item for each factor.
+       */
+      std::vector<FactorWork>& work_i;
+
+      /**
+       * The current states.
+       */
+      const StateMap& states_i;
+
+   public:
+
+      /**
+       * Constructs a task for the specified factors and states.
+       */
+      ConditionTask(std::vector<FactorWork>& work, const StateMap& states)
+      : work_i(work), states_i(states) {}
+
+      /**
+       * Conditions the beliefs of the k-th factor.
+       */
+      void operator()(std::size_t k)
+      {
+         work_i[k].cache->condition(*work_i[k].belief,states_i);
+      }
+   };
+
+   /**
+    * Task that calculates the VPI of each factor, given its total value.
+    */
+   class VPITask : public Executor::Task
+   {
+   private:
+
+      /**
+       * Work item for each factor.
+       */
+      std::vector<FactorWork>& work_i;
+
+      /**
+       * Number of samples used to estimate VPI, or 0 for exact VPI.
+       */
+      int noSamples_i;
+
+      /**
+       * True iff exact VPI uses the fast Student's t CDF.
+       */
+      bool isFastCdf_i;
+
+      /**
+       * Threshold below which exact VPI is set to zero.
+       */
+      maxsum::ValType epsilon_i;
+
+   public:
+
+      /**
+       * Constructs a task for the specified factors and VPI settings.
+       */
+      VPITask
+      (
+       std::vector<FactorWork>& work,
+       int noSamples,
+       bool isFastCdf,
+       maxsum::ValType epsilon
+      )
+      : work_i(work), noSamples_i(noSamples), isFastCdf_i(isFastCdf),
+        epsilon_i(epsilon) {}
+
+      /**
+       * Calculates the VPI of the k-th factor.
+       */
+      void operator()(std::size_t k)
+      {
+         work_i[k].cache->updateVPI(*work_i[k].totalValue,noSamples_i,
+               isFastCdf_i,epsilon_i);
+      }
+   };
+
+   /**
+    * Executor used to run per-factor work in act, or 0 to run it serially.
+    * @see setExecutor
+    */
+   Executor* executor_i;
+
+   /**
+    * Gathers a work item for each factor, and conditions each factor's
+    * beliefs on the current states, using the executor if there is one.
+    */
+   template<class StateMap> void conditionAll(const StateMap& states)
+   {
+      work_i.clear();
+      for(typename BeliefMap::const_iterator it=qBeliefs_i.begin();
+            it!=qBeliefs_i.end(); ++it)
+      {
+         FactorWork item;
+         item.factor = it->first;
+         item.belief = &(it->second);
+         item.cache = &vpiCache_i[it->first];
+         item.totalValue = 0;
+         work_i.push_back(item);
+      }
+
+      ConditionTask<StateMap> task(work_i,states);
+      if(0==executor_i)
+      {
+         SerialExecutor().run(work_i.size(),task);
+      }
+      else
+      {
+         executor_i->run(work_i.size(),task);
+      }
+   }
+
+   /**
+    * Calculates the VPI of each factor gathered by conditionAll, given its
+    * max-sum total value, using the executor if there is one. Sampled VPI
+    * draws from the library's shared random number generator, so is always
+    * calculated serially.
+    */
+   void updateAllVPI()
+   {
+      for(std::size_t k=0; k<work_i.size(); ++k)
+      {
+         work_i[k].totalValue = &maxsum_i.getTotalValue(work_i[k].factor);
+      }
+
+      VPITask task(work_i,vpiSamples_i,isFastCdf_i,vpiEpsilon_i);
+      if( (0==executor_i) || (0<vpiSamples_i) )
+      {
+         SerialExecutor().run(work_i.size(),task);
+      }
+      else
+      {
+         executor_i->run(work_i.size(),task);
+      }
+   }
+
+   /**
+    * Factors passed to max-sum are only replaced, and max-sum notified,
+    * if some element changes by more than this amount.
+    * @see setNotifyTolerance
+    */
+   maxsum::ValType notifyTolerance_i;
+
+   /**
+    * Number of factor changes notified to max-sum by act.
+    */
+   unsigned long noNotified_i;
+
+   /**
+    * Number of factor changes that act did not notify to max-sum, because
+    * they were within notifyTolerance_i.
+    */
+   unsigned long noSkipped_i;
+
+   /**
+    * Number of factor to variable messages that max-sum was not asked to
+    * recompute, because the factors that send them were not notified.
+    */
+   unsigned long noSkippedMessages_i;
+
+   /**
+    * Largest difference between a factor and its value when max-sum was
+    * last notified, over all skipped notifications.
+    */
+   maxsum::ValType maxUnnotified_i;
+
+   /**
+    * Value of each factor when max-sum was last notified of it. Only kept
+    * if notifyTolerance_i is not negative.
+    */
+   FactorMap notified_i;
+
+   /**
+    * Notifies max-sum that a factor held by maxsum_i has changed, unless no
+    * element differs by more than notifyTolerance_i from its value when
+    * max-sum was last notified. Comparing with the last notified value,
+    * rather than the previous one, stops skipped changes from accumulating.
+    * Records the notification, or the messages saved by skipping it.
+    * @param[in] factor the factor that may have changed.
+    * @param[in] value the current value of the factor.
+    */
+   void notifyIfChanged
+   (
+    maxsum::FactorID factor,
+    const maxsum::DiscreteFunction& value
+   )
+   {
+      //************************************************************************
+      // Find the largest difference from the last notified value, if any.
+      //************************************************************************
+      bool isChanged = true;
+      maxsum::ValType maxDiff = 0;
+      FactorMap::iterator pos = notified_i.find(factor);
+      if( (0<=notifyTolerance_i) && (notified_i.end()!=pos) &&
+          (pos->second.domainSize()==value.domainSize()) )
+      {
+         const maxsum::ValIndex size = value.domainSize();
+         const maxsum::ValType* pOld = &(pos->second(0));
+         const maxsum::ValType* pNew = &value(0);
+         for(maxsum::ValIndex k=0; k<size; ++k)
+         {
+            maxDiff = std::max(maxDiff,std::abs(pNew[k]-pOld[k]));
+         }
+         isChanged = (notifyTolerance_i<maxDiff);
+      }
+
+      //************************************************************************
+      // Notify max-sum, and remember what it was notified of.
+      //************************************************************************
+      if(isChanged)
+      {
+         maxsum_i.notifyFactor(factor);
+         ++noNotified_i;
+         if(0>notifyTolerance_i)
+         {
+            return;
+         }
+         if(notified_i.end()==pos)
+         {
+            notified_i.insert(std::make_pair(factor,value));
+         }
+         else
+         {
+            pos->second = value;
+         }
+      }
+      else
+      {
+         ++noSkipped_i;
+         noSkippedMessages_i += value.noVars();
+         maxUnnotified_i = std::max(maxUnnotified_i,maxDiff);
+      }
+   }
+
+   /**
+    * Replaces the value of a factor held by maxsum_i, and notifies max-sum,
+    * unless it is still within notifyTolerance_i of the value max-sum was
+    * last notified of. The value is always replaced, so that the VPI added
+    * by the last call to act is removed even if max-sum is not notified.
+    */
+   void setFactorValue
+   (
+    maxsum::FactorID factor,
+    const maxsum::DiscreteFunction& value
+   )
+   {
+      maxsum::DiscreteFunction& handle =
+         maxsum_i.getUnSafeWritableFactorHandle(factor);
+      handle = value;
+      notifyIfChanged(factor,handle);
+   }
+
+   /**
+    * Adds a function to a factor held by maxsum_i, and notifies max-sum,
+    * unless the factor is still within notifyTolerance_i of the value
+    * max-sum was last notified of. The function is always added.
+    */
+   void addToFactor
+   (
+    maxsum::FactorID factor,
+    const maxsum::DiscreteFunction& delta
+   )
+   {
+      maxsum::DiscreteFunction& handle =
+         maxsum_i.getUnSafeWritableFactorHandle(factor);
+      handle += delta;
+      notifyIfChanged(factor,handle);
+   }
+
 public:
 
    /**
@@ -87,7 +496,7 @@ public:
    /**
     * Default Constructor.
     */
-   DecBayesQ
+   DecBayesQ_Tmpl
    (
     double alpha=DEFAULT_ALPHA,
     double gamma=DEFAULT_GAMMA,
@@ -96,22 +505,36 @@ public:
    )
    : alpha_i(alpha), gamma_i(gamma), 
      maxsum_i(maxIterations,maxnorm), actionSet_i(), isInitialised_i(false),
-     qBeliefs_i()
+     qBeliefs_i(), vpiCache_i(), accessPlans_i(), vpiSamples_i(0),
+     isFastCdf_i(false), vpiEpsilon_i(0),
+     vpiCacheSize_i(VPICache::DEFAULT_CAPACITY), priorVars_i(), postVars_i(),
+     greedyCache_i(), work_i(), executor_i(0), notifyTolerance_i(0),
+     noNotified_i(0), noSkipped_i(0), noSkippedMessages_i(0),
+     maxUnnotified_i(0), notified_i()
    {}
 
    /**
     * (Deep) Copy constructor.
     */
-   DecBayesQ(const DecBayesQ& rhs)
+   DecBayesQ_Tmpl(const DecBayesQ_Tmpl& rhs)
    : alpha_i(rhs.alpha_i), gamma_i(rhs.gamma_i), 
      maxsum_i(rhs.maxsum_i), actionSet_i(rhs.actionSet_i), 
-     isInitialised_i(rhs.isInitialised_i), qBeliefs_i(rhs.qBeliefs_i)
+     isInitialised_i(rhs.isInitialised_i), qBeliefs_i(rhs.qBeliefs_i),
+     vpiCache_i(rhs.vpiCache_i), accessPlans_i(rhs.accessPlans_i),
+     vpiSamples_i(rhs.vpiSamples_i), isFastCdf_i(rhs.isFastCdf_i),
+     vpiEpsilon_i(rhs.vpiEpsilon_i),
+     vpiCacheSize_i(rhs.vpiCacheSize_i), priorVars_i(), postVars_i(),
+     greedyCache_i(rhs.greedyCache_i), work_i(), executor_i(0),
+     notifyTolerance_i(rhs.notifyTolerance_i), noNotified_i(rhs.noNotified_i),
+     noSkipped_i(rhs.noSkipped_i),
+     noSkippedMessages_i(rhs.noSkippedMessages_i),
+     maxUnnotified_i(rhs.maxUnnotified_i), notified_i(rhs.notified_i)
    {}
 
    /**
     * (Deep) Copy assignment.
     */
-   DecBayesQ& operator=(const DecBayesQ& rhs)
+   DecBayesQ_Tmpl& operator=(const DecBayesQ_Tmpl& rhs)
    {
       alpha_i = rhs.alpha_i;
       gamma_i = rhs.gamma_i;
@@ -119,9 +542,264 @@ public:
       actionSet_i = rhs.actionSet_i;
       isInitialised_i = rhs.isInitialised_i;
       qBeliefs_i = rhs.qBeliefs_i;
+      vpiCache_i = rhs.vpiCache_i;
+      accessPlans_i = rhs.accessPlans_i;
+      vpiSamples_i = rhs.vpiSamples_i;
+      isFastCdf_i = rhs.isFastCdf_i;
+      vpiEpsilon_i = rhs.vpiEpsilon_i;
+      vpiCacheSize_i = rhs.vpiCacheSize_i;
+      greedyCache_i = rhs.greedyCache_i;
+      executor_i = 0;
+      notifyTolerance_i = rhs.notifyTolerance_i;
+      noNotified_i = rhs.noNotified_i;
+      noSkipped_i = rhs.noSkipped_i;
+      noSkippedMessages_i = rhs.noSkippedMessages_i;
+      maxUnnotified_i = rhs.maxUnnotified_i;
+      notified_i = rhs.notified_i;
       return *this;
    }
 
+   /**
+    * Sets how VPI is calculated when selecting actions.
+    * By default, VPI is calculated exactly using dec_brl::exactVPI, but for
+    * large action domains, it may be faster to estimate VPI by sampling,
+    * using dec_brl::sampledVPI. Fewer samples are faster, but less accurate.
+    * @param[in] noSamples the number of samples used to estimate VPI for
+    * each joint action, or 0 to calculate VPI exactly.
+    */
+   void setVPISamples(int noSamples)
+   {
+      assert(0<=noSamples);
+      vpiSamples_i = noSamples;
+   }
+
+   /**
+    * Returns the number of samples used to estimate VPI for each joint action,
+    * or 0 if VPI is calculated exactly.
+    * @see setVPISamples
+    */
+   int getVPISamples() const
+   {
+      return vpiSamples_i;
+   }
+
+   /**
+    * Sets how the Student's t CDF is evaluated when VPI is calculated
+    * exactly. By default, this uses Boost.Math, but the fast mode is
+    * usually much cheaper, and each VPI value remains within
+    * dec_brl::dist::FastCdf::MAX_ABS_ERROR times the distance between its
+    * action's expected value and the best alternative.
+    * @param[in] isFast true to use dec_brl::dist::FastCdf, or false to use
+    * dec_brl::dist::ExactCdf.
+    */
+   void setFastCdf(bool isFast)
+   {
+      isFastCdf_i = isFast;
+   }
+
+   /**
+    * Returns true iff exact VPI is calculated using the fast Student's t CDF.
+    * @see setFastCdf
+    */
+   bool isFastCdf() const
+   {
+      return isFastCdf_i;
+   }
+
+   /**
+    * Sets the threshold below which exactly calculated VPI values are set to
+    * zero. Actions whose VPI is known to be below this are pruned without
+    * evaluating the Student's t CDF, so each value is within epsilon of its
+    * unpruned value. By default, nothing is pruned.
+    * @param[in] epsilon the pruning threshold, or 0 to disable pruning.
+    */
+   void setVPIEpsilon(maxsum::ValType epsilon)
+   {
+      assert(0<=epsilon);
+      vpiEpsilon_i = epsilon;
+   }
+
+   /**
+    * Returns the threshold below which exactly calculated VPI values are
+    * set to zero.
+    * @see setVPIEpsilon
+    */
+   maxsum::ValType getVPIEpsilon() const
+   {
+      return vpiEpsilon_i;
+   }
+
+   /**
+    * Sets the maximum number of joint states for which each factor caches
+    * its conditioned beliefs and VPI. Cached states are discarded whenever
+    * observe updates the factor, so larger caches are only useful if the
+    * same states recur between updates. The default caches only the most
+    * recent state.
+    * @param[in] size the maximum number of cached states per factor.
+    * @see getVPICacheHitRate
+    */
+   void setVPICacheSize(std::size_t size)
+   {
+      assert(0<size);
+      vpiCacheSize_i = size;
+      for(typename VPICacheMap::iterator it=vpiCache_i.begin();
+            it!=vpiCache_i.end(); ++it)
+      {
+         it->second.setCapacity(size);
+      }
+   }
+
+   /**
+    * Returns the maximum number of joint states for which each factor caches
+    * its conditioned beliefs and VPI.
+    * @see setVPICacheSize
+    */
+   std::size_t getVPICacheSize() const
+   {
+      return vpiCacheSize_i;
+   }
+
+   /**
+    * Returns the proportion of factor conditioning operations that reused
+    * cached conditioned beliefs, over all factors, since construction or the
+    * last call to resetVPICacheStats.
+    */
+   double getVPICacheHitRate() const
+   {
+      unsigned long noHits = 0;
+      unsigned long noLookups = 0;
+      for(typename VPICacheMap::const_iterator it=vpiCache_i.begin();
+            it!=vpiCache_i.end(); ++it)
+      {
+         noHits += it->second.noHits();
+         noLookups += it->second.noLookups();
+      }
+      if(0==noLookups)
+      {
+         return 0.0;
+      }
+      return static_cast<double>(noHits)/noLookups;
+   }
+
+   /**
+    * Resets the statistics reported by getVPICacheHitRate.
+    */
+   void resetVPICacheStats()
+   {
+      for(typename VPICacheMap::iterator it=vpiCache_i.begin();
+            it!=vpiCache_i.end(); ++it)
+      {
+         it->second.resetStats();
+      }
+   }
+
+   /**
+    * Sets the tolerance used to decide whether changes to the factors
+    * optimised by max-sum need to be propagated. Between its two max-sum
+    * passes, and between timesteps, act resets each factor to its expected
+    * value, then adds VPI to it. Max-sum keeps its messages between passes,
+    * so max-sum is not notified of a factor whose elements all differ by no
+    * more than this tolerance from the value it was last notified of, and
+    * no messages are recomputed on its account. Because changes are
+    * measured from the last notified value, skipped changes cannot
+    * accumulate beyond the tolerance. The default of 0 only skips factors
+    * that do not change at all, and so does not affect the selected
+    * actions. A negative tolerance notifies max-sum of every factor.
+    * @param[in] tol the tolerance.
+    * @see getNoSkippedNotifications
+    * @see getNoSkippedMessages
+    * @see getMaxUnnotifiedChange
+    */
+   void setNotifyTolerance(maxsum::ValType tol)
+   {
+      notifyTolerance_i = tol;
+      notified_i.clear();
+   }
+
+   /**
+    * Returns the tolerance set by setNotifyTolerance.
+    */
+   maxsum::ValType getNotifyTolerance() const
+   {
+      return notifyTolerance_i;
+   }
+
+   /**
+    * Returns the number of factor changes that act notified to max-sum,
+    * since construction or the last call to resetNotifyStats.
+    */
+   unsigned long getNoNotifications() const
+   {
+      return noNotified_i;
+   }
+
+   /**
+    * Returns the number of factor changes that act did not notify to
+    * max-sum, because they were within the tolerance set by
+    * setNotifyTolerance, since construction or the last call to
+    * resetNotifyStats. Each saves max-sum from updating the messages sent
+    * by that factor.
+    */
+   unsigned long getNoSkippedNotifications() const
+   {
+      return noSkipped_i;
+   }
+
+   /**
+    * Returns the number of factor to variable messages that max-sum was not
+    * asked to recompute, because act skipped notifying their factors, since
+    * construction or the last call to resetNotifyStats. Each skipped
+    * notification saves one message for each of the factor's variables in
+    * the following max-sum pass. A skipped factor's messages may still be
+    * recomputed if the messages it receives change, so this is an upper
+    * bound on the message updates saved.
+    */
+   unsigned long getNoSkippedMessages() const
+   {
+      return noSkippedMessages_i;
+   }
+
+   /**
+    * Returns the largest difference between any element of a factor and
+    * its value when max-sum was last notified, over all notifications that
+    * act skipped since construction or the last call to resetNotifyStats.
+    * This is never more than the tolerance set by setNotifyTolerance.
+    */
+   maxsum::ValType getMaxUnnotifiedChange() const
+   {
+      return maxUnnotified_i;
+   }
+
+   /**
+    * Resets the statistics reported by getNoNotifications,
+    * getNoSkippedNotifications, getNoSkippedMessages and
+    * getMaxUnnotifiedChange.
+    */
+   void resetNotifyStats()
+   {
+      noNotified_i = 0;
+      noSkipped_i = 0;
+      noSkippedMessages_i = 0;
+      maxUnnotified_i = 0;
+   }
+
+   /**
+    * Sets the executor used by act to condition beliefs and calculate VPI
+    * for each factor. By default, this is done serially in the calling
+    * thread, but for graphs with many factors, a dec_brl::ThreadPool may be
+    * used to split factors across cores. Only the work for each factor is
+    * run by the executor: max-sum is always updated and run in the calling
+    * thread. Sampled VPI is always calculated serially.
+    * @param[in] executor the executor to use, or 0 to run serially. This
+    * learner does not take ownership, so the executor must outlive its calls
+    * to act. The executor is not copied: copies of this learner, and learners
+    * assigned from it, run serially until they are given their own.
+    */
+   void setExecutor(Executor* executor)
+   {
+      executor_i = executor;
+   }
+
    /**
     * Adds a Q-Value factor to the factor graph.
     * Adds a factored Q-Value to the factor graph, given a specified unique
@@ -168,10 +846,13 @@ public:
       // This will copy the default hyperparameter values for each joint
       // state-action in the Q factor's domain.
       //************************************************************************
-      dist.alpha.expand(varBegin,varEnd);
-      dist.beta.expand(varBegin,varEnd);
-      dist.lambda.expand(varBegin,varEnd);
-      dist.m.expand(varBegin,varEnd);
+      dist::expand(dist,varBegin,varEnd);
+      accessPlans_i[factor] =
+         FactorAccessPlan(dist.m.varBegin(),dist.m.varEnd());
+      VPICache& cache = vpiCache_i[factor];
+      cache.setCapacity(vpiCacheSize_i);
+      cache.touch();
+      greedyCache_i.invalidate();
       
    } // addFactor
 
@@ -206,7 +887,7 @@ public:
       // Construct set of all variables
       //************************************************************************
       std::set<maxsum::VarID> allVars;
-      for(BeliefMap::const_iterator it=qBeliefs_i.begin();
+      for(typename BeliefMap::const_iterator it=qBeliefs_i.begin();
             it!=qBeliefs_i.end(); ++it)
       {
          const QDist& fun = it->second;
@@ -228,6 +909,16 @@ public:
 
    } // setStates function
 
+   /**
+    * Returns the number of times that act or actGreedy reused the greedy
+    * solution found by the previous call to actGreedy, instead of running
+    * max-sum again.
+    */
+   long getGreedyReuseCount() const
+   {
+      return greedyCache_i.noReuses();
+   }
+
    /**
     * Return the next actions selected by the Q-Learner.
     * This is equivalent to the act member function, except that
@@ -238,7 +929,8 @@ public:
     * The minimum requirement for the state and action map types is that
     * they implement operator[], begin(), and end() with the same semantics
     * as std::map<maxsum::VarID,maxsum::ValIndex>. Obviously, this type will
-    * do nicely, but the user is free to provide their own compatible type.
+    * do nicely, but the user is free to provide their own compatible type,
+    * such as dec_brl::FlatVarMap, which avoids allocation on each call.
     * @tparam ActionMap type of map used to store action selections
     * @tparam StateMap type of map used to store current states
     * @param[in] map of state variable ids to their current values.
@@ -246,7 +938,9 @@ public:
     * @pre states contains mapped values for each state.
     * @post each action variable will be mapped to its selected value.
     * @returns the number of max-sum iterations performs (0 means this was an
-    * exploratory move).
+    * exploratory move). If the last greedy solution is reused, this is the
+    * number of iterations taken to find it; reuse is counted separately by
+    * getGreedyReuseCount().
     */
    template<class ActionMap, class StateMap> int actGreedy
    (
@@ -277,23 +971,35 @@ public:
 
       } // if statement
 
+      //************************************************************************
+      // If max-sum still holds the greedy solution for these states, because
+      // nothing it depends on has changed since it was found, reuse it.
+      //************************************************************************
+      if(greedyCache_i.reuse(states))
+      {
+         actions.clear();
+         actions.insert(maxsum_i.valBegin(),maxsum_i.valEnd());
+         return greedyCache_i.noIterations();
+      }
+
       //************************************************************************
       // Condition the MaxSumController on the current states and expected
       // Q-values. Note that the expected Q-values are equal to the 'm'
       // hyperparameter of the NormalGamma distribution.
       //************************************************************************
-      maxsum::DiscreteFunction curFactor;
-      for(BeliefMap::const_iterator it=qBeliefs_i.begin();
+      for(typename BeliefMap::const_iterator it=qBeliefs_i.begin();
             it!=qBeliefs_i.end(); ++it)
       {
-         maxsum::condition(it->second.m,curFactor,states);
-         maxsum_i.setFactor(it->first,curFactor);
+         VPICache& cache = vpiCache_i[it->first];
+         cache.condition(it->second,states);
+         maxsum_i.setFactor(it->first,cache.expectedValue());
       }
 
       //************************************************************************
       // Run max-sum to optimise the set of actions
       //************************************************************************
       int msIterationCount = maxsum_i.optimise();
+      greedyCache_i.store(states,msIterationCount);
 
       //************************************************************************
       // Populate the action map with the optimised actions.
@@ -315,7 +1021,8 @@ public:
     * The minimum requirement for the state and action map types is that
     * they implement operator[], begin(), and end() with the same semantics
     * as std::map<maxsum::VarID,maxsum::ValIndex>. Obviously, this type will
-    * do nicely, but the user is free to provide their own compatible type.
+    * do nicely, but the user is free to provide their own compatible type,
+    * such as dec_brl::FlatVarMap, which avoids allocation on each call.
     * @tparam ActionMap type of map used to store action selections
     * @tparam StateMap type of map used to store current states
     * @param[in] map of state variable ids to their current values.
@@ -323,7 +1030,9 @@ public:
     * @pre states contains mapped values for each state.
     * @post each action variable will be mapped to its selected value.
     * @returns the number of max-sum iterations performs (0 means this was an
-    * exploratory move).
+    * exploratory move). If the last greedy solution is reused, this is the
+    * number of iterations taken to find it; reuse is counted separately by
+    * getGreedyReuseCount().
     */
    template<class ActionMap, class StateMap> int act
    (
@@ -331,6 +1040,12 @@ public:
     ActionMap& actions
    )
    {
+      //************************************************************************
+      // Check whether max-sum still holds the greedy solution for these
+      // states, found by the last call to actGreedy.
+      //************************************************************************
+      const bool isGreedyReused = greedyCache_i.reuse(states);
+
       //************************************************************************
       // If this is the first call to act, construct the action set, from the
       // combined domain of all factors minus the specified states.
@@ -358,18 +1073,30 @@ public:
          // Q-values. Note that the expected Q-values are equal to the 'm'
          // hyperparameter of the NormalGamma distribution.
          //*********************************************************************
-         maxsum::DiscreteFunction curFactor;
-         for(BeliefMap::const_iterator it=qBeliefs_i.begin();
-               it!=qBeliefs_i.end(); ++it)
+         conditionAll(states);
+         for(std::size_t k=0; k<work_i.size(); ++k)
          {
-            maxsum::condition(it->second.m,curFactor,states);
-            maxsum_i.setFactor(it->first,curFactor);
+            maxsum_i.setFactor(work_i[k].factor,
+                  work_i[k].cache->expectedValue());
          }
 
       } 
       //************************************************************************
-      // If we've already initialised, then we modify the maxsum's factor
-      // the fast way.
+      // If max-sum still holds the greedy solution for these states, we can
+      // skip straight to calculating VPI.
+      //************************************************************************
+      else if(isGreedyReused)
+      {
+         //*********************************************************************
+         // The last call to actGreedy optimised the expected Q-values for the
+         // same states, and max-sum still holds its factors and messages, so
+         // we only need to bring the conditioned beliefs up to date.
+         //*********************************************************************
+         conditionAll(states);
+      }
+      //************************************************************************
+      // Otherwise, if we've already initialised, then we modify the maxsum's
+      // factor the fast way.
       //************************************************************************
       else
       {
@@ -377,58 +1104,47 @@ public:
          // Condition the MaxSumController on the current states and expected
          // Q-values. Note that the expected Q-values are equal to the 'm'
          // hyperparameter of the NormalGamma distribution.
+         // The conditioned values are only recalculated for dirty factors,
+         // but every factor must still be reset, because the last call to
+         // act added VPI to it. Max-sum is only notified of factors that
+         // have changed by more than the notify tolerance.
          //*********************************************************************
-         for(BeliefMap::const_iterator it=qBeliefs_i.begin();
-               it!=qBeliefs_i.end(); ++it)
+         conditionAll(states);
+         for(std::size_t k=0; k<work_i.size(); ++k)
          {
-            maxsum::DiscreteFunction& curFactor = 
-               maxsum_i.getUnSafeWritableFactorHandle(it->first);
-
-            maxsum::condition(it->second.m,curFactor,states);
-            maxsum_i.notifyFactor(it->first); // notify maxsum of change 
+            setFactorValue(work_i[k].factor,work_i[k].cache->expectedValue());
 
          } // for
       } // else
 
       //************************************************************************
       // Run max-sum to calculate each factor's total local value
-      // (sum of factor plus its received messages).
+      // (sum of factor plus its received messages), unless we already have.
       //************************************************************************
-      int msIterationCount = maxsum_i.optimise();
+      int msIterationCount = greedyCache_i.noIterations();
+      if(!isGreedyReused)
+      {
+         msIterationCount = maxsum_i.optimise();
+      }
+      greedyCache_i.invalidate();
 
       //************************************************************************
-      // For each factor 
+      // Calculate local vpi for current state from the belief distribution
+      // over the local combined value of each factor. This is the same as the
+      // local belief distribution, except it is conditioned on the current
+      // state, and the mean is shifted to include the messages past from all
+      // neighbouring nodes. VPI is only recalculated if the factor is dirty
+      // or its total value has changed.
       //************************************************************************
-      for(BeliefMap::const_iterator it=qBeliefs_i.begin();
-            it!=qBeliefs_i.end(); ++it)
-      {
-         const maxsum::FactorID factor = it->first;
-         const QDist& qValDist = it->second;
+      updateAllVPI();
 
-         //*********************************************************************
-         // Construct the belief distribution over the local combined value
-         // This is the same as the local belief distribution, except it is
-         // conditioned on the current state, and the mean is shifted to include
-         // the messages past from all neighbouring nodes.
-         //*********************************************************************
-         QDist totValDist;
-         totValDist.m = maxsum_i.getTotalValue(factor);
-         maxsum::condition(qValDist.alpha,totValDist.alpha,states);
-         maxsum::condition(qValDist.beta,totValDist.beta,states);
-         maxsum::condition(qValDist.lambda,totValDist.lambda,states);
-
-         //*********************************************************************
-         // Calculate local vpi for current state
-         //*********************************************************************
-         maxsum::DiscreteFunction localVPI;
-         exactVPI(totValDist, localVPI);
-
-         //*********************************************************************
-         // Add VPI to expected local Q - which is already stored in 
-         // maxsum controller
-         //*********************************************************************
-         maxsum_i.getUnSafeWritableFactorHandle(factor) += localVPI;
-         maxsum_i.notifyFactor(factor); // notify maxsum of change to factor
+      //************************************************************************
+      // For each factor, add VPI to expected local Q - which is already stored
+      // in maxsum controller - unless it is within the notify tolerance.
+      //************************************************************************
+      for(std::size_t k=0; k<work_i.size(); ++k)
+      {
+         addToFactor(work_i[k].factor,work_i[k].cache->vpi());
 
       } // for loop
 
@@ -476,29 +1192,60 @@ public:
     const RewardMap& rewards
    )
    {
-      using namespace maxsum;
-      
-      //************************************************************************
-      // Take the union of the previous states and the last set of actions.
-      // This specifies which Q-values need to be updated.
-      //************************************************************************
-      std::map<VarID,ValIndex> priorVars;
-      priorVars.insert(priorStates.begin(),priorStates.end());
-      priorVars.insert(actions.begin(),actions.end());
-
       //************************************************************************
       // Choose greedy actions w.r.t. to current states. These are used to
       // perform the maximisation step in the update.
       //************************************************************************
-      std::map<VarID,ValIndex> postVars;
-      actGreedy(postStates,postVars);
+      actGreedy(postStates,postVars_i);
 
       //************************************************************************
       // Bundle the next states in with the greedy next actions. Again, this
       // is for the maximisation step - specifying the s' and a' together for
       // finding the value of Q(s',a').
       //************************************************************************
-      postVars.insert(postStates.begin(),postStates.end());
+      postVars_i.insert(postStates.begin(),postStates.end());
+
+      observeGreedy(priorStates,actions,postVars_i,rewards);
+
+   } // observe
+
+   /**
+    * Updates Q-value distributions in the same way as observe(), but given the
+    * successor states together with their greedy actions, rather than
+    * calculating the greedy actions with max-sum. This allows callers that
+    * observe several transitions to the same successor states, such as
+    * dec_brl::ReplayBuffer_Tmpl, to calculate the greedy actions only once.
+    * @tparam RewardMap type with const_iterator over pairs of
+    * maxsum::FactorID and reward (double), such as std::map.
+    * @tparam VarMap maps maxsum::VarID to maxsum::ValIndex
+    * @tparam NextMap maps maxsum::VarID to maxsum::ValIndex, and implements
+    * find() with the same semantics as std::map.
+    * @param priorStates map of all state values immediately before performing
+    * specified actions.
+    * @param actions map of all performed action values.
+    * @param nextVars map of all state values immediately after performing
+    * specified actions, and the greedy action values for those states, as
+    * returned by actGreedy().
+    * @param rewards map of all observed rewards to their corresponding
+    * Q-value factors.
+    */
+   template<class RewardMap, class VarMap, class NextMap> void observeGreedy
+   (
+    const VarMap& priorStates,
+    const VarMap& actions,
+    const NextMap& nextVars,
+    const RewardMap& rewards
+   )
+   {
+      using namespace maxsum;
+      
+      //************************************************************************
+      // Take the union of the previous states and the last set of actions.
+      // This specifies which Q-values need to be updated.
+      //************************************************************************
+      priorVars_i.clear();
+      priorVars_i.insert(priorStates.begin(),priorStates.end());
+      priorVars_i.insert(actions.begin(),actions.end());
 
       //************************************************************************
       // For each observed reward 
@@ -509,7 +1256,7 @@ public:
          //*********************************************************************
          // Find the corresponding factored q-value belief distribution
          //*********************************************************************
-         BeliefMap::iterator qPos = qBeliefs_i.find(it->first);
+         typename BeliefMap::iterator qPos = qBeliefs_i.find(it->first);
 
          //*********************************************************************
          // If we can't find this factor, go on to the next one
@@ -520,13 +1267,19 @@ public:
          }
          
          //*********************************************************************
-         // Retrieve the hyperparameters for the next local Q-value
+         // Retrieve the hyperparameters for the next local Q-value. These
+         // share the same domain, so we only compute their index once, and
+         // read them as a single record, which interleaved beliefs store
+         // in one cache line.
          //*********************************************************************
          QDist& dist = qPos->second;
-         const ValType nxtAlpha = dist.alpha(postVars);
-         const ValType nxtBeta = dist.beta(postVars);
-         const ValType nxtLambda = dist.lambda(postVars);
-         const ValType nxtM = dist.m(postVars);
+         const FactorAccessPlan& plan = accessPlans_i[it->first];
+         const dist::NormalGammaRecord nxt =
+            dist::getRecord(dist,plan.index(nextVars));
+         const ValType nxtAlpha = nxt.alpha;
+         const ValType nxtBeta = nxt.beta;
+         const ValType nxtLambda = nxt.lambda;
+         const ValType nxtM = nxt.m;
          
          //*********************************************************************
          // Calculate the required moments
@@ -541,23 +1294,43 @@ public:
          // Find the corresponding linear index for the current Q-value
          // distribution, and use the calculated moments to update it.
          //*********************************************************************
-         dist::observe<std::map<VarID,ValIndex>&>(dist,priorVars,expQ,expQ2,1);
+         dist::observe<ValIndex>(dist,plan.index(priorVars_i),expQ,expQ2,1);
+         vpiCache_i[it->first].touchState(priorVars_i);
+         greedyCache_i.update(dist.m.varBegin(),dist.m.varEnd(),priorVars_i);
 
       } // for loop
 
-   } // observe
+   } // observeGreedy
 
-}; // class DecBayesQ
+}; // class DecBayesQ_Tmpl
 
 /**
  * Default weight to place in new reward estimates.
  */
-const double DecBayesQ::DEFAULT_ALPHA = 0.1;
+template<class BeliefDist>
+const double DecBayesQ_Tmpl<BeliefDist>::DEFAULT_ALPHA = 0.1;
 
 /**
  * Default MDP discount factor for future rewards.
  */
-const double DecBayesQ::DEFAULT_GAMMA = 0.95;
+template<class BeliefDist>
+const double DecBayesQ_Tmpl<BeliefDist>::DEFAULT_GAMMA = 0.95;
+
+/**
+ * Convenience typedef for learners that store beliefs in double precision.
+ */
+typedef DecBayesQ_Tmpl<> DecBayesQ;
+
+/**
+ * Convenience typedef for learners that store beliefs in single precision.
+ */
+typedef DecBayesQ_Tmpl<dist::CompactNormalGamma> CompactDecBayesQ;
+
+/**
+ * Convenience typedef for learners that store each element's beliefs in a
+ * single interleaved record.
+ */
+typedef DecBayesQ_Tmpl<dist::InterleavedNormalGamma> InterleavedDecBayesQ;
 
 } // namespace dec_brl
 
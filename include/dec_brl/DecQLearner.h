@@ -2,6 +2,10 @@
 #define DEC_BRL_DEC_Q_LEARNER_H
 
 #include "dec_brl/random.h"
+#include "dec_brl/FlatVarMap.h"
+#include "dec_brl/GreedySolutionCache.h"
+#include "dec_brl/FactorAccessPlan.h"
+#include "dec_brl/SparseTrace.h"
 #include "MaxSumController.h"
 #include <set>
 #include <list>
@@ -64,6 +68,84 @@ private:
     */
    FactorMap qValues_i;
 
+   /**
+    * Union of the prior states and actions passed to observe. This is
+    * kept between calls, so that observe does not allocate memory.
+    */
+   FlatVarMap priorVars_i;
+
+   /**
+    * Union of the post states passed to observe and their greedy actions.
+    * This is kept between calls, so that observe does not allocate memory.
+    */
+   FlatVarMap postVars_i;
+
+   /**
+    * Records whether maxsum_i still holds the greedy solution computed by
+    * the last call to actGreedy, so that it can be reused by act.
+    */
+   GreedySolutionCache greedyCache_i;
+
+   /**
+    * Trace decay parameter, lambda. If zero, observe performs one-step
+    * Q-learning updates, and no traces are kept.
+    * @see setTraceDecay
+    */
+   double lambda_i;
+
+   /**
+    * Traces smaller than this are discarded.
+    */
+   double traceCutoff_i;
+
+   /**
+    * Convenience type def for maps of access plans.
+    */
+   typedef std::map<maxsum::FactorID, FactorAccessPlan> PlanMap;
+
+   /**
+    * Access plan for each factor, used to find the linear index of the
+    * element updated by observe.
+    */
+   PlanMap accessPlans_i;
+
+   /**
+    * Convenience type def for maps of eligibility traces.
+    */
+   typedef std::map<maxsum::FactorID, SparseTrace> TraceMap;
+
+   /**
+    * Eligibility trace for each factor.
+    */
+   TraceMap traces_i;
+
+   /**
+    * Updates every element of a factor with a non-zero trace, given the
+    * temporal difference error for the element just visited, which is
+    * first given a trace of one.
+    * @param[in] factor the factor's id.
+    * @param[in] fun the factor's Q-values.
+    * @param[in] index linear index of the element just visited.
+    * @param[in] tdError temporal difference error for that element.
+    */
+   void updateTrace
+   (
+    maxsum::FactorID factor,
+    maxsum::DiscreteFunction& fun,
+    maxsum::ValIndex index,
+    maxsum::ValType tdError
+   )
+   {
+      SparseTrace& trace = traces_i[factor];
+      trace.decay(gamma_i*lambda_i,traceCutoff_i);
+      trace.set(index,1.0);
+      const maxsum::ValType step = alpha_i*tdError;
+      for(SparseTrace::const_iterator it=trace.begin(); it!=trace.end(); ++it)
+      {
+         fun(it->first) += step*it->second;
+      }
+   }
+
 public:
 
    /**
@@ -81,6 +163,11 @@ public:
     */
    static const double DEFAULT_EPSILON;
 
+   /**
+    * Default smallest eligibility trace kept.
+    */
+   static const double DEFAULT_TRACE_CUTOFF;
+
    /**
     * Default Constructor.
     * 
@@ -95,7 +182,8 @@ public:
    )
    : alpha_i(alpha), gamma_i(gamma), epsilon_i(epsilon),
      maxsum_i(maxIterations,maxnorm), actionSet_i(), isInitialised_i(false),
-     qValues_i()
+     qValues_i(), priorVars_i(), postVars_i(), greedyCache_i(), lambda_i(0),
+     traceCutoff_i(DEFAULT_TRACE_CUTOFF), accessPlans_i(), traces_i()
    {}
 
    /**
@@ -104,7 +192,10 @@ public:
    DecQLearner(const DecQLearner& rhs)
    : alpha_i(rhs.alpha_i), gamma_i(rhs.gamma_i), epsilon_i(rhs.epsilon_i),
      maxsum_i(rhs.maxsum_i), actionSet_i(rhs.actionSet_i), 
-     isInitialised_i(rhs.isInitialised_i), qValues_i(rhs.qValues_i)
+     isInitialised_i(rhs.isInitialised_i), qValues_i(rhs.qValues_i),
+     priorVars_i(), postVars_i(), greedyCache_i(rhs.greedyCache_i),
+     lambda_i(rhs.lambda_i), traceCutoff_i(rhs.traceCutoff_i),
+     accessPlans_i(rhs.accessPlans_i), traces_i(rhs.traces_i)
    {}
 
    /**
@@ -119,6 +210,11 @@ public:
       actionSet_i = rhs.actionSet_i;
       isInitialised_i = rhs.isInitialised_i;
       qValues_i = rhs.qValues_i;
+      greedyCache_i = rhs.greedyCache_i;
+      lambda_i = rhs.lambda_i;
+      traceCutoff_i = rhs.traceCutoff_i;
+      accessPlans_i = rhs.accessPlans_i;
+      traces_i = rhs.traces_i;
       return *this;
    }
 
@@ -152,6 +248,10 @@ public:
       // the specified list of variables. All values are initially zero.
       //************************************************************************
       qValues_i[factor] = maxsum::DiscreteFunction(varBegin,varEnd,0.0);
+      accessPlans_i[factor] = FactorAccessPlan(qValues_i[factor].varBegin(),
+            qValues_i[factor].varEnd());
+      traces_i[factor].clear();
+      greedyCache_i.invalidate();
 
    } // addFactor
 
@@ -208,6 +308,81 @@ public:
 
    } // setStates function
 
+   /**
+    * Returns the number of times that act or actGreedy reused the greedy
+    * solution found by the previous call to actGreedy, instead of running
+    * max-sum again.
+    */
+   long getGreedyReuseCount() const
+   {
+      return greedyCache_i.noReuses();
+   }
+
+   /**
+    * Sets the trace decay parameter, lambda, used by observe.
+    * If lambda is positive, observe performs naive Q(lambda) updates with
+    * replacing traces: each temporal difference error is applied to every
+    * recently visited joint state-action of its factor, weighted by its
+    * eligibility trace, which decays by gamma*lambda on each step. Traces
+    * are not cut after exploratory actions. They are stored sparsely, and
+    * discarded once they fall below the cutoff, which bounds the cost of
+    * each update. Otherwise, observe performs one-step Q-learning updates.
+    * Traces are cleared whenever the parameters change.
+    * @param[in] lambda trace decay, in the range [0,1].
+    * @param[in] cutoff smallest trace kept, which must be positive.
+    * @see clearTraces
+    */
+   void setTraceDecay(double lambda, double cutoff=DEFAULT_TRACE_CUTOFF)
+   {
+      assert( (0<=lambda) && (1>=lambda) );
+      assert(0<cutoff);
+      lambda_i = lambda;
+      traceCutoff_i = cutoff;
+      clearTraces();
+   }
+
+   /**
+    * Returns the trace decay parameter, lambda.
+    */
+   double getTraceDecay() const
+   {
+      return lambda_i;
+   }
+
+   /**
+    * Returns the smallest eligibility trace kept.
+    */
+   double getTraceCutoff() const
+   {
+      return traceCutoff_i;
+   }
+
+   /**
+    * Clears all eligibility traces, for example at the end of an episode.
+    */
+   void clearTraces()
+   {
+      for(TraceMap::iterator it=traces_i.begin(); it!=traces_i.end(); ++it)
+      {
+         it->second.clear();
+      }
+   }
+
+   /**
+    * Returns the number of joint state-actions with active eligibility
+    * traces, over all factors.
+    */
+   std::size_t getNoActiveTraces() const
+   {
+      std::size_t total = 0;
+      for(TraceMap::const_iterator it=traces_i.begin();
+            it!=traces_i.end(); ++it)
+      {
+         total += it->second.size();
+      }
+      return total;
+   }
+
    /**
     * Return the next actions selected by the Q-Learner.
     * This is equivalent to the act member function, except that
@@ -218,7 +393,8 @@ public:
     * The minimum requirement for the state and action map types is that
     * they implement operator[], begin(), and end() with the same semantics
     * as std::map<maxsum::VarID,maxsum::ValIndex>. Obviously, this type will
-    * do nicely, but the user is free to provide their own compatible type.
+    * do nicely, but the user is free to provide their own compatible type,
+    * such as dec_brl::FlatVarMap, which avoids allocation on each call.
     * @tparam ActionMap type of map used to store action selections
     * @tparam StateMap type of map used to store current states
     * @param[in] map of state variable ids to their current values.
@@ -226,7 +402,9 @@ public:
     * @pre states contains mapped values for each state.
     * @post each action variable will be mapped to its selected value.
     * @returns the number of max-sum iterations performs (0 means this was an
-    * exploratory move).
+    * exploratory move). If the last greedy solution is reused, this is the
+    * number of iterations taken to find it; reuse is counted separately by
+    * getGreedyReuseCount().
     */
    template<class ActionMap, class StateMap> int actGreedy
    (
@@ -257,6 +435,17 @@ public:
 
       } // if statement
 
+      //************************************************************************
+      // If max-sum still holds the greedy solution for these states, because
+      // nothing it depends on has changed since it was found, reuse it.
+      //************************************************************************
+      if(greedyCache_i.reuse(states))
+      {
+         actions.clear();
+         actions.insert(maxsum_i.valBegin(),maxsum_i.valEnd());
+         return greedyCache_i.noIterations();
+      }
+
       //************************************************************************
       // Condition the MaxSumController on the current states.
       //************************************************************************
@@ -272,6 +461,7 @@ public:
       // Run max-sum to optimise the set of actions
       //************************************************************************
       int msIterationCount = maxsum_i.optimise();
+      greedyCache_i.store(states,msIterationCount);
 
       //************************************************************************
       // Populate the action map with the optimised actions.
@@ -293,7 +483,8 @@ public:
     * The minimum requirement for the state and action map types is that
     * they implement operator[], begin(), and end() with the same semantics
     * as std::map<maxsum::VarID,maxsum::ValIndex>. Obviously, this type will
-    * do nicely, but the user is free to provide their own compatible type.
+    * do nicely, but the user is free to provide their own compatible type,
+    * such as dec_brl::FlatVarMap, which avoids allocation on each call.
     * @tparam ActionMap type of map used to store action selections
     * @tparam StateMap type of map used to store current states
     * @param[in] map of state variable ids to their current values.
@@ -301,7 +492,9 @@ public:
     * @pre states contains mapped values for each state.
     * @post each action variable will be mapped to its selected value.
     * @returns the number of max-sum iterations performs (0 means this was an
-    * exploratory move).
+    * exploratory move). If the last greedy solution is reused, this is the
+    * number of iterations taken to find it; reuse is counted separately by
+    * getGreedyReuseCount().
     */
    template<class ActionMap, class StateMap> int act
    (
@@ -390,27 +583,103 @@ public:
     const RewardMap& rewards
    )
    {
-      //************************************************************************
-      // Take the union of the previous states and the last set of actions.
-      // This specifies which Q-values need to be updated.
-      //************************************************************************
-      std::map<maxsum::VarID,maxsum::ValIndex> priorVars;
-      priorVars.insert(priorStates.begin(),priorStates.end());
-      priorVars.insert(actions.begin(),actions.end());
-
       //************************************************************************
       // Choose greedy actions w.r.t. to current states. These are used to
       // perform the maximisation step in the update.
       //************************************************************************
-      std::map<maxsum::VarID,maxsum::ValIndex> postVars;
-      actGreedy(postStates,postVars);
+      actGreedy(postStates,postVars_i);
 
       //************************************************************************
       // Bundle the next states in with the greedy next actions. Again, this
       // is for the maximisation step - specifying the s' and a' together for
       // finding the value of Q(s',a').
       //************************************************************************
-      postVars.insert(postStates.begin(),postStates.end());
+      postVars_i.insert(postStates.begin(),postStates.end());
+
+      //************************************************************************
+      // Without traces, this is a one-step update.
+      //************************************************************************
+      if(0>=lambda_i)
+      {
+         observeGreedy(priorStates,actions,postVars_i,rewards);
+         return;
+      }
+
+      //************************************************************************
+      // Otherwise, apply the temporal difference error for each factor to
+      // all its elements with active traces.
+      //************************************************************************
+      priorVars_i.clear();
+      priorVars_i.insert(priorStates.begin(),priorStates.end());
+      priorVars_i.insert(actions.begin(),actions.end());
+
+      typedef typename RewardMap::const_iterator Iterator;
+      for(Iterator it=rewards.begin(); it!=rewards.end(); ++it)
+      {
+         FactorMap::iterator qPos = qValues_i.find(it->first);
+         if(qValues_i.end()==qPos)
+         {
+            continue;
+         }
+
+         //*********************************************************************
+         // delta = r + gamma*Q(s',a') - Q(s,a)
+         //*********************************************************************
+         maxsum::DiscreteFunction& fun = qPos->second;
+         const maxsum::ValIndex index =
+            accessPlans_i[it->first].index(priorVars_i);
+         const maxsum::ValType tdError =
+            it->second + gamma_i*fun(postVars_i) - fun(index);
+         updateTrace(it->first,fun,index,tdError);
+
+      } // for loop
+
+      //************************************************************************
+      // Elements outside the slice for the current states may have changed,
+      // so the greedy solution can't be reused.
+      //************************************************************************
+      greedyCache_i.invalidate();
+
+   } // observe
+
+   /**
+    * Updates Q-value estimates in the same way as observe(), but given the
+    * successor states together with their greedy actions, rather than
+    * calculating the greedy actions with max-sum. This is always a one-step
+    * update, which neither uses nor changes the eligibility traces, because
+    * the transitions passed to it need not follow a single trajectory. This
+    * allows callers that observe several transitions to the same successor
+    * states, such as dec_brl::ReplayBuffer_Tmpl, to calculate the greedy
+    * actions only once.
+    * @tparam RewardMap type with const_iterator over pairs of
+    * maxsum::FactorID and reward (double), such as std::map.
+    * @tparam VarMap maps maxsum::VarID to maxsum::ValIndex
+    * @tparam NextMap maps maxsum::VarID to maxsum::ValIndex, and implements
+    * find() with the same semantics as std::map.
+    * @param priorStates map of all state values immediately before performing
+    * specified actions.
+    * @param actions map of all performed action values.
+    * @param nextVars map of all state values immediately after performing
+    * specified actions, and the greedy action values for those states, as
+    * returned by actGreedy().
+    * @param rewards map of all observed rewards to their corresponding
+    * Q-value factors.
+    */
+   template<class RewardMap, class VarMap, class NextMap> void observeGreedy
+   (
+    const VarMap& priorStates,
+    const VarMap& actions,
+    const NextMap& nextVars,
+    const RewardMap& rewards
+   )
+   {
+      //************************************************************************
+      // Take the union of the previous states and the last set of actions.
+      // This specifies which Q-values need to be updated.
+      //************************************************************************
+      priorVars_i.clear();
+      priorVars_i.insert(priorStates.begin(),priorStates.end());
+      priorVars_i.insert(actions.begin(),actions.end());
 
       //************************************************************************
       // For each observed reward 
@@ -435,15 +704,17 @@ public:
          // Update the estimate with the current reward:
          // Q(s,a) = (1-alpha)*Q(s,a) + alpha*(r + gamma*Q(s',a') )
          //*********************************************************************
-         maxsum::ValType& priorQ = qPos->second(priorVars);
-         const maxsum::ValType postQ = qPos->second(postVars);
+         maxsum::ValType& priorQ = qPos->second(priorVars_i);
+         const maxsum::ValType postQ = qPos->second(nextVars);
          const maxsum::ValType curReward = it->second;
          const maxsum::ValType update = curReward + gamma_i*postQ;
          priorQ = (1.0-alpha_i)*priorQ + alpha_i*update;
+         greedyCache_i.update(qPos->second.varBegin(),qPos->second.varEnd(),
+               priorVars_i);
 
       } // for loop
 
-   } // observe
+   } // observeGreedy
 
 }; // class DecQLearner
 
@@ -462,6 +733,11 @@ const double DecQLearner::DEFAULT_GAMMA = 0.95;
  */
 const double DecQLearner::DEFAULT_EPSILON = 0.1;
 
+/**
+ * Default smallest eligibility trace kept.
+ */
+const double DecQLearner::DEFAULT_TRACE_CUTOFF = 0.01;
+
 } // namespace dec_brl
 
 #endif // DEC_BRL_DEC_Q_LEARNER_H
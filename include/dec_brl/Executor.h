@@ -0,0 +1,85 @@
+/**
+ * @file Executor.h
+ * Defines the interface used by learners to run independent per-factor
+ * work, optionally in parallel.
+ */
+#ifndef DECBRL_EXECUTOR_H
+#define DECBRL_EXECUTOR_H
+
+#include <cstddef>
+
+/**
+ * Namespace all public functions and types defined in the DecBRL library.
+ */
+namespace dec_brl {
+
+/**
+ * Runs a set of independent, indexed tasks, and returns when they are all
+ * complete. Learners such as dec_brl::DecBayesQ_Tmpl use an executor to
+ * condition beliefs and calculate VPI for each factor, and then pass the
+ * results to max-sum themselves, in a single thread.
+ * @see dec_brl::SerialExecutor
+ * @see dec_brl::ThreadPool
+ */
+class Executor
+{
+public:
+
+   /**
+    * Interface for a set of tasks, each identified by an index.
+    * Tasks with different indices may be run concurrently, so must not
+    * modify any shared state, and should not throw exceptions.
+    */
+   class Task
+   {
+   public:
+
+      /**
+       * Virtual destructor.
+       */
+      virtual ~Task() {}
+
+      /**
+       * Runs the task with the specified index.
+       */
+      virtual void operator()(std::size_t k) = 0;
+
+   }; // class Task
+
+   /**
+    * Virtual destructor.
+    */
+   virtual ~Executor() {}
+
+   /**
+    * Runs tasks 0 to n-1, and returns when they are all complete.
+    * @param[in] n the number of tasks.
+    * @param[in] task the tasks to run.
+    */
+   virtual void run(std::size_t n, Task& task) = 0;
+
+}; // class Executor
+
+/**
+ * Executor that runs each task in turn in the calling thread.
+ */
+class SerialExecutor : public Executor
+{
+public:
+
+   /**
+    * Runs tasks 0 to n-1 in order.
+    */
+   void run(std::size_t n, Task& task)
+   {
+      for(std::size_t k=0; k<n; ++k)
+      {
+         task(k);
+      }
+   }
+
+}; // class SerialExecutor
+
+} // namespace dec_brl
+
+#endif // DECBRL_EXECUTOR_H
@@ -0,0 +1,113 @@
+/**
+ * @file FactorAccessPlan.h
+ * Defines a precomputed stride table for mapping variable assignments to
+ * the linear index of an element in a factor's domain.
+ */
+#ifndef DECBRL_FACTORACCESSPLAN_H
+#define DECBRL_FACTORACCESSPLAN_H
+
+#include <cassert>
+#include <cstddef>
+#include <vector>
+#include "common.h"
+#include "register.h"
+
+/**
+ * Namespace all public functions and types defined in the DecBRL library.
+ */
+namespace dec_brl {
+
+/**
+ * Stride table for the domain of a single factor.
+ * Functions over the same variables share the same layout, so a factor's
+ * hyperparameter functions can all be indexed by a single linear index,
+ * which this class computes from an assignment of values to variables in
+ * one pass, without consulting the functions themselves. Plans are built
+ * once, when a factor is added, and reused on every access.
+ */
+class FactorAccessPlan
+{
+private:
+
+   /**
+    * Variables on which the factor depends, in the order used by its
+    * functions to lay out their elements.
+    */
+   std::vector<maxsum::VarID> vars_i;
+
+   /**
+    * Stride of each variable in vars_i.
+    */
+   std::vector<maxsum::ValIndex> strides_i;
+
+   /**
+    * Number of elements in the factor's domain.
+    */
+   maxsum::ValIndex domainSize_i;
+
+public:
+
+   /**
+    * Constructs a plan for a factor that depends on no variables.
+    */
+   FactorAccessPlan() : vars_i(), strides_i(), domainSize_i(1) {}
+
+   /**
+    * Constructs a plan for a factor that depends on the specified variables.
+    * @tparam VarIt iterator over maxsum::VarID values.
+    * @param[in] varBegin iterator to the first variable.
+    * @param[in] varEnd iterator to the end of the variables.
+    * @pre the variables are listed in the same order as the factor's
+    * functions, i.e. from DiscreteFunction::varBegin() to varEnd(), and are
+    * registered with the maxsum library.
+    */
+   template<class VarIt> FactorAccessPlan(VarIt varBegin, VarIt varEnd)
+   : vars_i(varBegin,varEnd), strides_i(vars_i.size()), domainSize_i(1)
+   {
+      for(std::size_t k=0; k<vars_i.size(); ++k)
+      {
+         strides_i[k] = domainSize_i;
+         domainSize_i *= maxsum::getDomainSize(vars_i[k]);
+      }
+   }
+
+   /**
+    * Returns the number of variables in the factor's domain.
+    */
+   int noVars() const
+   {
+      return vars_i.size();
+   }
+
+   /**
+    * Returns the number of elements in the factor's domain.
+    */
+   maxsum::ValIndex domainSize() const
+   {
+      return domainSize_i;
+   }
+
+   /**
+    * Returns the linear index of the element specified by a map from
+    * variables to values.
+    * @tparam VarMap maps maxsum::VarID to maxsum::ValIndex, and implements
+    * find() with the same semantics as std::map.
+    * @pre every variable in the factor's domain is in the map.
+    */
+   template<class VarMap> maxsum::ValIndex index(const VarMap& vals) const
+   {
+      maxsum::ValIndex result = 0;
+      for(std::size_t k=0; k<vars_i.size(); ++k)
+      {
+         typename VarMap::const_iterator pos = vals.find(vars_i[k]);
+         assert(vals.end()!=pos);
+         result += strides_i[k]*pos->second;
+      }
+      return result;
+   }
+
+}; // class FactorAccessPlan
+
+} // namespace dec_brl
+
+#endif // DECBRL_FACTORACCESSPLAN_H
@@ -0,0 +1,817 @@
+/**
+ * @file FactorVPICache.h
+ * Defines a class used to cache the conditioned beliefs and VPI of a single
+ * factor, so that they are only recalculated when the factor changes.
+ */
+#ifndef DECBRL_FACTORVPICACHE_H
+#define DECBRL_FACTORVPICACHE_H
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <vector>
+#include "dec_brl/random.h"
+#include "dec_brl/vpi.h"
+#include "dec_brl/CompactNormalGamma.h"
+#include "dec_brl/InterleavedNormalGamma.h"
+#include "dec_brl/ConditionedView.h"
+#include "dec_brl/FactorAccessPlan.h"
+#include "DiscreteFunction.h"
+
+/**
+ * Namespace all public functions and types defined in the DecBRL library.
+ */
+namespace dec_brl {
+
+/**
+ * Caches the conditioned hyperparameters and VPI for a single factor of a
+ * factored belief distribution, such as those maintained by
+ * dec_brl::DecBayesQ. Conditioned beliefs and VPI are cached for up to
+ * capacity() joint states of the factor's state variables, keyed by their
+ * linear index. When the beliefs for a single joint state change, as they
+ * do when a transition from that state is observed, the owner calls
+ * touchState(), which only invalidates the entry for that state. Entries
+ * for other states remain valid, so that the cache helps whenever states
+ * are revisited. When the factor's beliefs change as a whole, the owner
+ * calls touch(), which increments a version stamp, and all entries are
+ * discarded. Conditioned beliefs are only recalculated for states that are
+ * not cached or have been invalidated, and VPI is only recalculated if, in
+ * addition, the factor's max-sum total value has changed since it was last
+ * calculated for the same state. Hit rate statistics are recorded, so that
+ * the capacity can be chosen to suit the number of states revisited.
+ *
+ * Only the expected value is copied when beliefs are conditioned. VPI is
+ * calculated by reading the remaining hyperparameters directly from the
+ * factor's beliefs, through dec_brl::ConditionedView. Entries are held in a
+ * pool of up to capacity() slots, indexed by a small open-addressed hash
+ * table, and a slot is reused with its functions' storage when its state
+ * is evicted. Once every slot has been filled for the factor's conditioned
+ * domain, condition() and updateVPI() do not allocate memory, because the
+ * variates drawn for sampled VPI are also held in reusable scratch space.
+ * @tparam Dist type of vectorised Normal-Gamma distribution, such as
+ * dec_brl::dist::CachedNormalGamma_Tmpl<maxsum::DiscreteFunction> or
+ * dec_brl::dist::CompactNormalGamma. Conditioned expected values and VPI
+ * are always held in double precision.
+ */
+template<class Dist> class FactorVPICache
+{
+private:
+
+   /**
+    * Type of view used to read conditioned hyperparameters.
+    */
+   typedef ConditionedView<typename Dist::value_type> View;
+
+   /**
+    * Slot index used to mark the ends of the list of entries in order of
+    * use, and empty positions in the hash table.
+    */
+   enum { NO_ENTRY = -1 };
+
+   /**
+    * Conditioned beliefs and VPI cached for a single joint state.
+    */
+   struct Entry
+   {
+      /**
+       * Linear index of the joint state of the factor's state variables.
+       */
+      maxsum::ValIndex key;
+
+      /**
+       * Expected value of the factor conditioned on the state.
+       */
+      maxsum::DiscreteFunction expected;
+
+      /**
+       * Total value last used to calculate VPI.
+       */
+      maxsum::DiscreteFunction totalValue;
+
+      /**
+       * VPI last calculated for this state.
+       */
+      maxsum::DiscreteFunction vpi;
+
+      /**
+       * Number of samples used to estimate vpi, or 0 if it was calculated
+       * exactly.
+       */
+      int noSamples;
+
+      /**
+       * True iff vpi was calculated using the fast Student's t CDF.
+       */
+      bool isFastCdf;
+
+      /**
+       * Threshold below which exactly calculated VPI was pruned to zero.
+       */
+      maxsum::ValType epsilon;
+
+      /**
+       * True iff vpi is consistent with totalValue and the beliefs. Sampled
+       * VPI is never reused, even if this is true.
+       */
+      bool isVPIValid;
+
+      /**
+       * True iff expected is consistent with the beliefs.
+       */
+      bool isExpectedValid;
+
+      /**
+       * Slot of the next more recently used entry, or NO_ENTRY if this is
+       * the most recently used.
+       */
+      int newer;
+
+      /**
+       * Slot of the next less recently used entry, or NO_ENTRY if this is
+       * the least recently used.
+       */
+      int older;
+
+      /**
+       * Constructs an empty entry.
+       */
+      Entry()
+      : key(0), expected(), totalValue(), vpi(), noSamples(0), isFastCdf(false),
+        epsilon(0), isVPIValid(false), isExpectedValid(false), newer(NO_ENTRY),
+        older(NO_ENTRY)
+      {}
+   };
+
+   /**
+    * Current version of the factor's beliefs.
+    */
+   unsigned long version_i;
+
+   /**
+    * Version of the factor's beliefs used to calculate the cached entries.
+    */
+   unsigned long condVersion_i;
+
+   /**
+    * True iff condition() has been called at least once.
+    */
+   bool isConditioned_i;
+
+   /**
+    * Stride table for the factor's state variables, from which the key of
+    * each joint state is found. Built by the first call to condition().
+    */
+   FactorAccessPlan statePlan_i;
+
+   /**
+    * Maximum number of joint states for which entries are cached.
+    */
+   std::size_t capacity_i;
+
+   /**
+    * Pool of entries, of which the first noEntries_i hold cached states.
+    * Slots are kept when entries are discarded, so that the storage of
+    * their functions can be reused.
+    */
+   std::vector<Entry> entries_i;
+
+   /**
+    * Number of slots in entries_i that hold cached states.
+    */
+   std::size_t noEntries_i;
+
+   /**
+    * Open-addressed hash table with linear probing, mapping the key of each
+    * cached state to its slot in entries_i. The size is always a power of
+    * two, and more than twice the capacity.
+    */
+   std::vector<int> table_i;
+
+   /**
+    * Slot of the states passed to the last call to condition().
+    */
+   int curSlot_i;
+
+   /**
+    * Beliefs passed to the last call to condition().
+    */
+   const Dist* belief_i;
+
+   /**
+    * Indices of the elements of the factor's hyperparameters that are
+    * conditioned on the states passed to the last call to condition().
+    */
+   ConditionedLayout layout_i;
+
+   /**
+    * Slot of the most recently used entry, or NO_ENTRY if there are none.
+    * Entries are linked through their newer and older slots, in order of
+    * use, so that the least recently used can be found without a search.
+    */
+   int newest_i;
+
+   /**
+    * Slot of the least recently used entry, or NO_ENTRY if there are none.
+    */
+   int oldest_i;
+
+   /**
+    * Number of calls to condition() since the statistics were last reset.
+    */
+   unsigned long noLookups_i;
+
+   /**
+    * Number of calls to condition() that found a valid cached entry, since
+    * the statistics were last reset.
+    */
+   unsigned long noHits_i;
+
+   /**
+    * Scratch space reused for the variates drawn when VPI is sampled.
+    */
+   SampledVPIScratch sampleScratch_i;
+
+   /**
+    * Returns true iff two functions have the same domain and values.
+    */
+   static bool isEqual
+   (
+    const maxsum::DiscreteFunction& f1,
+    const maxsum::DiscreteFunction& f2
+   )
+   {
+      if( (f1.noVars()!=f2.noVars()) || (f1.domainSize()!=f2.domainSize()) )
+      {
+         return false;
+      }
+      if(!std::equal(f1.varBegin(),f1.varEnd(),f2.varBegin()))
+      {
+         return false;
+      }
+      for(maxsum::ValIndex k=0; k<f1.domainSize(); ++k)
+      {
+         if(f1(k)!=f2(k))
+         {
+            return false;
+         }
+      }
+      return true;
+   }
+
+   /**
+    * Returns the first position in table_i to probe for a key.
+    */
+   std::size_t hash(maxsum::ValIndex key) const
+   {
+      // Fibonacci hashing spreads neighbouring indices across the table.
+      const unsigned long h = static_cast<unsigned long>(key)*2654435761ul;
+      return static_cast<std::size_t>(h) & (table_i.size()-1);
+   }
+
+   /**
+    * Returns the position in table_i holding a key, or the empty position
+    * at which it should be inserted.
+    */
+   std::size_t probe(maxsum::ValIndex key) const
+   {
+      std::size_t pos = hash(key);
+      while( (NO_ENTRY!=table_i[pos]) && (entries_i[table_i[pos]].key!=key) )
+      {
+         pos = (pos+1) & (table_i.size()-1);
+      }
+      return pos;
+   }
+
+   /**
+    * Removes a key from table_i, shifting later keys in its probe sequence
+    * back, so that no tombstones are needed.
+    */
+   void eraseKey(maxsum::ValIndex key)
+   {
+      const std::size_t mask = table_i.size()-1;
+      std::size_t hole = probe(key);
+      assert(NO_ENTRY!=table_i[hole]);
+      for(std::size_t pos=(hole+1)&mask; NO_ENTRY!=table_i[pos];
+            pos=(pos+1)&mask)
+      {
+         //*********************************************************************
+         // The key at pos may fill the hole only if the hole lies between
+         // its first probe position and pos.
+         //*********************************************************************
+         const std::size_t home = hash(entries_i[table_i[pos]].key);
+         if( ((pos-home)&mask) >= ((pos-hole)&mask) )
+         {
+            table_i[hole] = table_i[pos];
+            hole = pos;
+         }
+      }
+      table_i[hole] = NO_ENTRY;
+   }
+
+   /**
+    * Rebuilds table_i from the cached entries, sizing it for the current
+    * capacity.
+    */
+   void rehash()
+   {
+      std::size_t size = 8;
+      while(size < 2*capacity_i+2)
+      {
+         size *= 2;
+      }
+      table_i.assign(size,NO_ENTRY);
+      for(std::size_t k=0; k<noEntries_i; ++k)
+      {
+         table_i[probe(entries_i[k].key)] = static_cast<int>(k);
+      }
+   }
+
+   /**
+    * Removes an entry from the list of entries in order of use.
+    */
+   void unlink(int slot)
+   {
+      Entry& entry = entries_i[slot];
+      if(NO_ENTRY==entry.newer)
+      {
+         newest_i = entry.older;
+      }
+      else
+      {
+         entries_i[entry.newer].older = entry.older;
+      }
+      if(NO_ENTRY==entry.older)
+      {
+         oldest_i = entry.newer;
+      }
+      else
+      {
+         entries_i[entry.older].newer = entry.newer;
+      }
+      entry.newer = NO_ENTRY;
+      entry.older = NO_ENTRY;
+   }
+
+   /**
+    * Adds an entry to the list of entries in order of use, as the most
+    * recently used.
+    */
+   void pushNewest(int slot)
+   {
+      Entry& entry = entries_i[slot];
+      entry.newer = NO_ENTRY;
+      entry.older = newest_i;
+      if(NO_ENTRY==newest_i)
+      {
+         oldest_i = slot;
+      }
+      else
+      {
+         entries_i[newest_i].newer = slot;
+      }
+      newest_i = slot;
+   }
+
+   /**
+    * Discards all cached states, keeping their slots for reuse.
+    */
+   void clearEntries()
+   {
+      noEntries_i = 0;
+      newest_i = NO_ENTRY;
+      oldest_i = NO_ENTRY;
+      table_i.assign(table_i.size(),NO_ENTRY);
+   }
+
+   /**
+    * Returns the slot to use for a state that is not cached: an unused slot
+    * if there are fewer than capacity() cached states, and otherwise the
+    * slot of the least recently used state, which is discarded.
+    */
+   int acquireSlot()
+   {
+      if(noEntries_i<capacity_i)
+      {
+         if(entries_i.size()==noEntries_i)
+         {
+            entries_i.push_back(Entry());
+         }
+         return static_cast<int>(noEntries_i++);
+      }
+      const int slot = oldest_i;
+      assert(NO_ENTRY!=slot);
+      unlink(slot);
+      eraseKey(entries_i[slot].key);
+      return slot;
+   }
+
+   /**
+    * Recalculates an entry's expected value, which is passed to max-sum,
+    * from the conditioned layout of the factor's beliefs. If the entry
+    * already holds a function over the conditioned domain, its values are
+    * overwritten in place.
+    */
+   template<class StateMap> void recondition
+   (
+    Entry& entry,
+    const Dist& dist,
+    const StateMap& states
+   )
+   {
+      if( (entry.expected.domainSize()!=layout_i.size()) ||
+          (static_cast<std::size_t>(entry.expected.noVars())
+               !=layout_i.noFreeVars()) )
+      {
+         dist::condition(dist.m,entry.expected,states);
+      }
+      else
+      {
+         const View mean(dist.m,layout_i);
+         for(maxsum::ValIndex k=0; k<layout_i.size(); ++k)
+         {
+            entry.expected(k) = mean[k];
+         }
+      }
+      entry.isExpectedValid = true;
+      entry.isVPIValid = false;
+   }
+
+   /**
+    * Returns the entry for the states passed to the last call to
+    * condition().
+    */
+   const Entry& current() const
+   {
+      assert(isConditioned_i);
+      assert(NO_ENTRY!=curSlot_i);
+      return entries_i[curSlot_i];
+   }
+
+   /**
+    * Returns the entry for the states passed to the last call to
+    * condition().
+    */
+   Entry& current()
+   {
+      assert(isConditioned_i);
+      assert(NO_ENTRY!=curSlot_i);
+      return entries_i[curSlot_i];
+   }
+
+public:
+
+   /**
+    * Default maximum number of joint states cached per factor.
+    * With a single entry, only the most recent state is remembered.
+    */
+   static const std::size_t DEFAULT_CAPACITY = 1;
+
+   /**
+    * Constructs an empty cache. The first calls to condition() and
+    * updateVPI() will always calculate their results.
+    * @param[in] capacity maximum number of joint states to cache.
+    */
+   FactorVPICache(std::size_t capacity=DEFAULT_CAPACITY)
+   : version_i(0), condVersion_i(0), isConditioned_i(false), statePlan_i(),
+     capacity_i(capacity), entries_i(), noEntries_i(0), table_i(),
+     curSlot_i(NO_ENTRY), belief_i(0), layout_i(), newest_i(NO_ENTRY),
+     oldest_i(NO_ENTRY), noLookups_i(0), noHits_i(0), sampleScratch_i()
+   {
+      assert(0<capacity_i);
+      entries_i.reserve(capacity_i);
+      rehash();
+   }
+
+   /**
+    * Marks the factor's beliefs as changed, so that all cached conditioned
+    * beliefs and VPI will be recalculated on next use.
+    */
+   void touch()
+   {
+      ++version_i;
+   }
+
+   /**
+    * Marks the factor's beliefs as changed only for the joint state of its
+    * state variables given by a map, so that the conditioned beliefs and
+    * VPI cached for that state, if any, are recalculated on next use.
+    * Entries for other states are kept.
+    * @tparam VarMap maps maxsum::VarID to maxsum::ValIndex, and implements
+    * find() with the same semantics as std::map.
+    * @param[in] vars map containing at least the factor's state variables,
+    * such as the prior states and actions of an observed transition.
+    */
+   template<class VarMap> void touchState(const VarMap& vars)
+   {
+      if(!isConditioned_i)
+      {
+         return; // nothing is cached yet
+      }
+      const std::size_t pos = probe(statePlan_i.index(vars));
+      if(NO_ENTRY!=table_i[pos])
+      {
+         Entry& entry = entries_i[table_i[pos]];
+         entry.isExpectedValid = false;
+         entry.isVPIValid = false;
+      }
+   }
+
+   /**
+    * Returns the current version stamp of the factor's beliefs.
+    */
+   unsigned long version() const
+   {
+      return version_i;
+   }
+
+   /**
+    * Sets the maximum number of joint states for which conditioned beliefs
+    * and VPI are cached. If there are more cached states than this, the
+    * least recently used are discarded.
+    * @param[in] capacity the new capacity, which must be positive.
+    */
+   void setCapacity(std::size_t capacity)
+   {
+      assert(0<capacity);
+      capacity_i = capacity;
+
+      //************************************************************************
+      // Move the most recently used entries to the front of the pool, in
+      // order of use, and discard the rest.
+      //************************************************************************
+      std::vector<Entry> kept;
+      kept.reserve(capacity_i);
+      for(int slot=newest_i; (NO_ENTRY!=slot) && (kept.size()<capacity_i);
+            slot=entries_i[slot].older)
+      {
+         kept.push_back(entries_i[slot]);
+      }
+      const int noKept = static_cast<int>(kept.size());
+      for(int k=0; k<noKept; ++k)
+      {
+         kept[k].newer = (0==k) ? NO_ENTRY : k-1;
+         kept[k].older = (noKept-1==k) ? NO_ENTRY : k+1;
+      }
+      entries_i.swap(kept);
+      noEntries_i = entries_i.size();
+      newest_i = (0==noKept) ? NO_ENTRY : 0;
+      oldest_i = noKept-1;
+      curSlot_i = newest_i; // condition() always leaves the current newest
+      rehash();
+   }
+
+   /**
+    * Returns the maximum number of joint states cached.
+    */
+   std::size_t capacity() const
+   {
+      return capacity_i;
+   }
+
+   /**
+    * Returns the number of calls to condition() since construction or
+    * the last call to resetStats().
+    */
+   unsigned long noLookups() const
+   {
+      return noLookups_i;
+   }
+
+   /**
+    * Returns the number of calls to condition() that reused cached
+    * conditioned beliefs, since construction or the last call to
+    * resetStats().
+    */
+   unsigned long noHits() const
+   {
+      return noHits_i;
+   }
+
+   /**
+    * Returns the proportion of calls to condition() that reused cached
+    * conditioned beliefs, or 0 if there have been no calls.
+    */
+   double hitRate() const
+   {
+      if(0==noLookups_i)
+      {
+         return 0.0;
+      }
+      return static_cast<double>(noHits_i)/noLookups_i;
+   }
+
+   /**
+    * Resets the hit rate statistics.
+    */
+   void resetStats()
+   {
+      noLookups_i = 0;
+      noHits_i = 0;
+   }
+
+   /**
+    * Conditions the factor's beliefs on the current states, unless the
+    * beliefs have not changed since they were last conditioned on the same
+    * values of the factor's state variables, as recorded by touch() and
+    * touchState().
+    * @tparam StateMap maps maxsum::VarID to maxsum::ValIndex, and implements
+    * find() and end() with the same semantics as std::map.
+    * @param[in] dist the factor's current beliefs.
+    * @param[in] states map of state variable ids to their current values.
+    * @pre the same subset of the factor's variables are specified in states
+    * on every call.
+    * @returns true iff the conditioned beliefs were recalculated.
+    */
+   template<class StateMap> bool condition
+   (
+    const Dist& dist,
+    const StateMap& states
+   )
+   {
+      //************************************************************************
+      // Find the linear index of the current values of the factor's state
+      // variables, first finding which of its variables are states.
+      //************************************************************************
+      if(!isConditioned_i)
+      {
+         std::vector<maxsum::VarID> stateVars;
+         for(typename Dist::value_type::VarIterator it=dist.m.varBegin();
+               it!=dist.m.varEnd(); ++it)
+         {
+            if(states.end()!=states.find(*it))
+            {
+               stateVars.push_back(*it);
+            }
+         }
+         statePlan_i = FactorAccessPlan(stateVars.begin(),stateVars.end());
+      }
+      const maxsum::ValIndex stateInd = statePlan_i.index(states);
+
+      //************************************************************************
+      // If the beliefs have changed, all cached entries are stale.
+      //************************************************************************
+      if(condVersion_i!=version_i)
+      {
+         clearEntries();
+         condVersion_i = version_i;
+      }
+
+      ++noLookups_i;
+      isConditioned_i = true;
+
+      //************************************************************************
+      // Remember where the conditioned hyperparameters lie in the beliefs,
+      // so that VPI can read them in place.
+      //************************************************************************
+      belief_i = &dist;
+      layout_i.reset(dist.m.varBegin(),dist.m.varEnd(),states);
+
+      //************************************************************************
+      // Nothing to do if this state is cached, and has not been invalidated
+      // by touchState() since.
+      //************************************************************************
+      const std::size_t pos = probe(stateInd);
+      if(NO_ENTRY!=table_i[pos])
+      {
+         curSlot_i = table_i[pos];
+         unlink(curSlot_i);
+         pushNewest(curSlot_i);
+         Entry& entry = entries_i[curSlot_i];
+         if(entry.isExpectedValid)
+         {
+            ++noHits_i;
+            return false;
+         }
+         recondition(entry,dist,states);
+         return true;
+      }
+
+      //************************************************************************
+      // Otherwise make room, reusing the least recently used slot if the
+      // cache is full. The key is reinserted after any eviction, because
+      // removing a key can move others in the hash table.
+      //************************************************************************
+      curSlot_i = acquireSlot();
+      Entry& entry = entries_i[curSlot_i];
+      entry.key = stateInd;
+      table_i[probe(stateInd)] = curSlot_i;
+      pushNewest(curSlot_i);
+      recondition(entry,dist,states);
+      return true;
+
+   } // condition
+
+   /**
+    * Returns the factor's expected value conditioned on the states passed to
+    * the last call to condition().
+    */
+   const maxsum::DiscreteFunction& expectedValue() const
+   {
+      return current().expected;
+   }
+
+   /**
+    * Calculates the factor's VPI given its max-sum total value (the sum of
+    * the factor and its received messages), unless neither the conditioned
+    * beliefs nor the total value have changed since exact VPI was last
+    * calculated for the current states, with the same CDF mode and pruning
+    * threshold. Sampled VPI is always recalculated, so that each call draws
+    * a fresh estimate.
+    * @param[in] totalValue the factor's total value in the current state.
+    * @param[in] noSamples if positive, VPI is estimated using
+    * dec_brl::sampledVPI with this many samples per joint action, rather
+    * than calculated by dec_brl::exactVPI.
+    * @param[in] isFastCdf if true, exact VPI uses dec_brl::dist::FastCdf
+    * rather than dec_brl::dist::ExactCdf to evaluate the Student's t CDF.
+    * @param[in] epsilon if positive, exactly calculated VPI values that are
+    * known to be less than epsilon are set to zero.
+    * @see dec_brl::exactVPIBatch
+    * @pre condition() has been called with the current beliefs and states,
+    * and the beliefs have not been moved or modified since, because they are
+    * read in place.
+    * @returns true iff VPI was recalculated.
+    */
+   bool updateVPI
+   (
+    const maxsum::DiscreteFunction& totalValue,
+    const int noSamples=0,
+    const bool isFastCdf=false,
+    const maxsum::ValType epsilon=0
+   )
+   {
+      Entry& entry = current();
+      if( entry.isVPIValid && (0==noSamples) && (0==entry.noSamples) &&
+          (isFastCdf==entry.isFastCdf) && (epsilon==entry.epsilon) &&
+          isEqual(totalValue,entry.totalValue) )
+      {
+         return false;
+      }
+      entry.totalValue = totalValue;
+
+      //************************************************************************
+      // Find the first and second best actions for the total value.
+      //************************************************************************
+      assert(0!=belief_i);
+      assert(totalValue.domainSize()==layout_i.size());
+      int firstBestInd = 0;
+      maxsum::ValType firstBestVal = 0;
+      maxsum::ValType secondBestVal = 0;
+      findBestTwo(totalValue.domainSize(), &totalValue(0), firstBestInd,
+                  firstBestVal, secondBestVal);
+
+      //************************************************************************
+      // Calculate VPI, reading the conditioned hyperparameters in place.
+      //************************************************************************
+      const View alpha(belief_i->alpha,layout_i);
+      const View beta(belief_i->beta,layout_i);
+      const View lambda(belief_i->lambda,layout_i);
+      entry.vpi = totalValue; // get the correct domain
+      if(0<noSamples)
+      {
+         sampledVPIArrays(entry.vpi.domainSize(), alpha, beta, lambda,
+                          &totalValue(0), firstBestInd, firstBestVal,
+                          secondBestVal, noSamples, random::unirnd,
+                          &entry.vpi(0), sampleScratch_i);
+      }
+      else if(isFastCdf)
+      {
+         const View lgammaRatio(belief_i->lgammaRatio,layout_i);
+         exactVPIArrays<typename Dist::policy_type>(entry.vpi.domainSize(),
+               alpha, beta, lambda, &totalValue(0), firstBestInd,
+               firstBestVal, secondBestVal, &entry.vpi(0), &lgammaRatio,
+               dist::FastCdf(), epsilon);
+      }
+      else
+      {
+         const View lgammaRatio(belief_i->lgammaRatio,layout_i);
+         exactVPIArrays<typename Dist::policy_type>(entry.vpi.domainSize(),
+               alpha, beta, lambda, &totalValue(0), firstBestInd,
+               firstBestVal, secondBestVal, &entry.vpi(0), &lgammaRatio,
+               dist::ExactCdf(), epsilon);
+      }
+      assert(entry.vpi>=0);
+      entry.noSamples = noSamples;
+      entry.isFastCdf = isFastCdf;
+      entry.epsilon = epsilon;
+      entry.isVPIValid = true;
+      return true;
+   }
+
+   /**
+    * Returns the VPI calculated by the last call to updateVPI().
+    */
+   const maxsum::DiscreteFunction& vpi() const
+   {
+      return current().vpi;
+   }
+
+}; // class FactorVPICache
+
+/**
+ * Default maximum number of joint states cached per factor.
+ */
+template<class Dist> const std::size_t FactorVPICache<Dist>::DEFAULT_CAPACITY;
+
+} // namespace dec_brl
+
+#endif // DECBRL_FACTORVPICACHE_H
@@ -0,0 +1,269 @@
+/**
+ * @file FlatVarMap.h
+ * Defines a flat map from maxsum variable ids to values, which can be used
+ * in place of std::map<maxsum::VarID,maxsum::ValIndex> to pass states and
+ * actions to the learners, without per-step allocation or tree walks.
+ */
+#ifndef DECBRL_FLATVARMAP_H
+#define DECBRL_FLATVARMAP_H
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+#include "common.h"
+
+/**
+ * Namespace all public functions and types defined in the DecBRL library.
+ */
+namespace dec_brl {
+
+/**
+ * Map from maxsum::VarID to maxsum::ValIndex, with the subset of the
+ * std::map interface used by the learners and maxsum::DiscreteFunction.
+ * Mapped values are stored contiguously, in the order in which their keys
+ * were inserted, and each variable id is remapped to its position in this
+ * compact array through a table indexed directly by id. Lookups are
+ * therefore constant time, and once the map has held its largest set of
+ * variables, clearing and refilling it performs no allocation.
+ *
+ * Unlike std::map, iteration is in insertion order rather than key order,
+ * keys must not be modified through iterators, and the size of the lookup
+ * table grows with the largest variable id, so this is intended for problems
+ * in which variable ids are reasonably dense.
+ */
+class FlatVarMap
+{
+public:
+
+   /**
+    * Type of keys.
+    */
+   typedef maxsum::VarID key_type;
+
+   /**
+    * Type of mapped values.
+    */
+   typedef maxsum::ValIndex mapped_type;
+
+   /**
+    * Type of stored key-value pairs.
+    */
+   typedef std::pair<maxsum::VarID,maxsum::ValIndex> value_type;
+
+   /**
+    * Iterator over key-value pairs.
+    */
+   typedef std::vector<value_type>::iterator iterator;
+
+   /**
+    * Const iterator over key-value pairs.
+    */
+   typedef std::vector<value_type>::const_iterator const_iterator;
+
+   /**
+    * Type used to represent sizes.
+    */
+   typedef std::vector<value_type>::size_type size_type;
+
+private:
+
+   /**
+    * Marks variables that are not in the map.
+    */
+   static const std::size_t NOT_FOUND = static_cast<std::size_t>(-1);
+
+   /**
+    * Key-value pairs in insertion order.
+    */
+   std::vector<value_type> entries_i;
+
+   /**
+    * Position of each variable in entries_i, indexed by variable id, or
+    * NOT_FOUND if the variable is not in the map.
+    */
+   std::vector<std::size_t> pos_i;
+
+   /**
+    * Returns the position of a variable in entries_i, or NOT_FOUND.
+    */
+   std::size_t position(key_type var) const
+   {
+      if(pos_i.size() <= var)
+      {
+         return NOT_FOUND;
+      }
+      return pos_i[var];
+   }
+
+public:
+
+   /**
+    * Constructs an empty map.
+    */
+   FlatVarMap() : entries_i(), pos_i() {}
+
+   /**
+    * Constructs a map containing the key-value pairs in a range.
+    * @tparam Iterator iterator over pairs of maxsum::VarID and
+    * maxsum::ValIndex.
+    */
+   template<class Iterator> FlatVarMap(Iterator begin, Iterator end)
+   : entries_i(), pos_i()
+   {
+      insert(begin,end);
+   }
+
+   /**
+    * Returns an iterator to the first key-value pair.
+    */
+   iterator begin()
+   {
+      return entries_i.begin();
+   }
+
+   /**
+    * Returns an iterator to the end of the key-value pairs.
+    */
+   iterator end()
+   {
+      return entries_i.end();
+   }
+
+   /**
+    * Returns an iterator to the first key-value pair.
+    */
+   const_iterator begin() const
+   {
+      return entries_i.begin();
+   }
+
+   /**
+    * Returns an iterator to the end of the key-value pairs.
+    */
+   const_iterator end() const
+   {
+      return entries_i.end();
+   }
+
+   /**
+    * Returns the number of variables in the map.
+    */
+   size_type size() const
+   {
+      return entries_i.size();
+   }
+
+   /**
+    * Returns true iff the map is empty.
+    */
+   bool empty() const
+   {
+      return entries_i.empty();
+   }
+
+   /**
+    * Returns an iterator to the specified variable, or end() if it is not in
+    * the map.
+    */
+   iterator find(key_type var)
+   {
+      const std::size_t pos = position(var);
+      if(NOT_FOUND==pos)
+      {
+         return entries_i.end();
+      }
+      return entries_i.begin()+pos;
+   }
+
+   /**
+    * Returns an iterator to the specified variable, or end() if it is not in
+    * the map.
+    */
+   const_iterator find(key_type var) const
+   {
+      const std::size_t pos = position(var);
+      if(NOT_FOUND==pos)
+      {
+         return entries_i.end();
+      }
+      return entries_i.begin()+pos;
+   }
+
+   /**
+    * Returns 1 if the specified variable is in the map, and 0 otherwise.
+    */
+   size_type count(key_type var) const
+   {
+      return (NOT_FOUND==position(var)) ? 0 : 1;
+   }
+
+   /**
+    * Inserts a key-value pair, unless the key is already in the map.
+    * @returns an iterator to the key's entry, and true iff it was inserted.
+    */
+   std::pair<iterator,bool> insert(const value_type& val)
+   {
+      const std::size_t pos = position(val.first);
+      if(NOT_FOUND!=pos)
+      {
+         return std::make_pair(entries_i.begin()+pos,false);
+      }
+
+      if(pos_i.size() <= val.first)
+      {
+         pos_i.resize(val.first+1,std::size_t(NOT_FOUND));
+      }
+      pos_i[val.first] = entries_i.size();
+      entries_i.push_back(val);
+      return std::make_pair(entries_i.end()-1,true);
+   }
+
+   /**
+    * Inserts each key-value pair in a range, unless its key is already in
+    * the map.
+    * @tparam Iterator iterator over pairs of maxsum::VarID and
+    * maxsum::ValIndex.
+    */
+   template<class Iterator> void insert(Iterator begin, Iterator end)
+   {
+      for(Iterator it=begin; it!=end; ++it)
+      {
+         insert(value_type(it->first,it->second));
+      }
+   }
+
+   /**
+    * Returns a reference to the value of the specified variable, inserting
+    * it with value 0 if it is not already in the map.
+    */
+   mapped_type& operator[](key_type var)
+   {
+      return insert(value_type(var,0)).first->second;
+   }
+
+   /**
+    * Removes all variables from the map, without releasing memory.
+    */
+   void clear()
+   {
+      for(const_iterator it=entries_i.begin(); it!=entries_i.end(); ++it)
+      {
+         pos_i[it->first] = NOT_FOUND;
+      }
+      entries_i.clear();
+   }
+
+   /**
+    * Swaps the contents of this map with another.
+    */
+   void swap(FlatVarMap& rhs)
+   {
+      entries_i.swap(rhs.entries_i);
+      pos_i.swap(rhs.pos_i);
+   }
+
+}; // class FlatVarMap
+
+} // namespace dec_brl
+
+#endif // DECBRL_FLATVARMAP_H
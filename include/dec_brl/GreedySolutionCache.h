@@ -0,0 +1,200 @@
+/**
+ * @file GreedySolutionCache.h
+ * Defines a class used to record when a learner's max-sum controller still
+ * holds the greedy solution for a given joint state.
+ */
+#ifndef DECBRL_GREEDYSOLUTIONCACHE_H
+#define DECBRL_GREEDYSOLUTIONCACHE_H
+
+#include "dec_brl/FlatVarMap.h"
+#include "common.h"
+
+/**
+ * Namespace all public functions and types defined in the DecBRL library.
+ */
+namespace dec_brl {
+
+/**
+ * Records the joint state for which a learner last optimised its expected
+ * values with max-sum, and whether that solution is still current.
+ * Each learner's observe function calls actGreedy on the successor state,
+ * and the next call to act is normally made with the same state. If none of
+ * the values updated in between lie in the slice of their factor that is
+ * conditioned on that state, the max-sum controller still holds the same
+ * factors, messages and solution, so the second optimisation can be
+ * skipped.
+ *
+ * The owner must call store() after optimising the expected values,
+ * update() whenever a factor's value changes for a given joint
+ * state-action, and invalidate() whenever it changes the max-sum factors in
+ * any other way.
+ */
+class GreedySolutionCache
+{
+private:
+
+   /**
+    * States on which the cached solution is conditioned.
+    */
+   FlatVarMap states_i;
+
+   /**
+    * True iff the max-sum controller holds the greedy solution for
+    * states_i.
+    */
+   bool isValid_i;
+
+   /**
+    * Number of times the cached solution has been reused.
+    */
+   long noReuses_i;
+
+   /**
+    * Number of max-sum iterations taken to find the cached solution.
+    */
+   int noIterations_i;
+
+public:
+
+   /**
+    * Constructs an empty cache.
+    */
+   GreedySolutionCache()
+   : states_i(), isValid_i(false), noReuses_i(0), noIterations_i(0) {}
+
+   /**
+    * Copy constructor. The copy is always invalid, because it will belong to
+    * a different learner, whose max-sum controller may be modified
+    * independently.
+    */
+   GreedySolutionCache(const GreedySolutionCache& rhs)
+   : states_i(), isValid_i(false), noReuses_i(rhs.noReuses_i),
+     noIterations_i(0) {}
+
+   /**
+    * Copy assignment. As for the copy constructor, the result is invalid.
+    */
+   GreedySolutionCache& operator=(const GreedySolutionCache& rhs)
+   {
+      isValid_i = false;
+      noReuses_i = rhs.noReuses_i;
+      noIterations_i = 0;
+      return *this;
+   }
+
+   /**
+    * Records that the max-sum controller now holds the greedy solution for
+    * the specified states.
+    * @tparam StateMap maps maxsum::VarID to maxsum::ValIndex.
+    * @param[in] states the states on which the solution is conditioned.
+    * @param[in] noIterations number of max-sum iterations taken to find the
+    * solution, which is reported again whenever it is reused.
+    */
+   template<class StateMap> void store
+   (
+    const StateMap& states,
+    int noIterations
+   )
+   {
+      states_i.clear();
+      states_i.insert(states.begin(),states.end());
+      isValid_i = true;
+      noIterations_i = noIterations;
+   }
+
+   /**
+    * Records that the max-sum controller no longer holds a greedy solution.
+    */
+   void invalidate()
+   {
+      isValid_i = false;
+   }
+
+   /**
+    * Returns true iff the max-sum controller holds the greedy solution for
+    * the specified states. If so, the caller is expected to reuse it, and
+    * this is counted by noReuses().
+    * @tparam StateMap maps maxsum::VarID to maxsum::ValIndex.
+    */
+   template<class StateMap> bool reuse(const StateMap& states)
+   {
+      if(!isValid_i || (states.size()!=states_i.size()))
+      {
+         return false;
+      }
+
+      for(typename StateMap::const_iterator it=states.begin();
+            it!=states.end(); ++it)
+      {
+         FlatVarMap::const_iterator pos = states_i.find(it->first);
+         if( (states_i.end()==pos) || (pos->second!=it->second) )
+         {
+            return false;
+         }
+      }
+      ++noReuses_i;
+      return true;
+   }
+
+   /**
+    * Informs the cache that a factor's value has changed for a single
+    * joint state-action. The cached solution is invalidated if, and only
+    * if, the changed element lies in the slice of the factor conditioned on
+    * the cached states.
+    * @tparam VarIt iterator over the factor's maxsum::VarID values.
+    * @tparam VarMap maps maxsum::VarID to maxsum::ValIndex.
+    * @param[in] varBegin iterator to the first of the factor's variables.
+    * @param[in] varEnd iterator to the end of the factor's variables.
+    * @param[in] vars the joint state-action whose value has changed.
+    */
+   template<class VarIt, class VarMap> void update
+   (
+    VarIt varBegin,
+    VarIt varEnd,
+    const VarMap& vars
+   )
+   {
+      if(!isValid_i)
+      {
+         return;
+      }
+
+      for(VarIt it=varBegin; it!=varEnd; ++it)
+      {
+         FlatVarMap::const_iterator statePos = states_i.find(*it);
+         if(states_i.end()==statePos)
+         {
+            continue;
+         }
+
+         typename VarMap::const_iterator pos = vars.find(*it);
+         if( (vars.end()!=pos) && (pos->second!=statePos->second) )
+         {
+            return;
+         }
+      }
+      isValid_i = false;
+   }
+
+   /**
+    * Returns the number of times the cached solution has been reused.
+    */
+   long noReuses() const
+   {
+      return noReuses_i;
+   }
+
+   /**
+    * Returns the number of max-sum iterations taken to find the cached
+    * solution, as passed to store().
+    */
+   int noIterations() const
+   {
+      return noIterations_i;
+   }
+
+}; // class GreedySolutionCache
+
+} // namespace dec_brl
+
+#endif // DECBRL_GREEDYSOLUTIONCACHE_H
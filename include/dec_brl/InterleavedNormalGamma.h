@@ -0,0 +1,767 @@
+/**
+ * @file InterleavedNormalGamma.h
+ * Defines a vectorised Normal-Gamma distribution whose four hyperparameters
+ * are stored together in one 32 byte record per element, so that random
+ * access updates touch a single cache line, rather than one per
+ * hyperparameter.
+ */
+#ifndef DECBRL_INTERLEAVEDNORMALGAMMA_H
+#define DECBRL_INTERLEAVEDNORMALGAMMA_H
+
+#include <algorithm>
+#include <cassert>
+#include <vector>
+#include <boost/static_assert.hpp>
+#include <boost/type_traits.hpp>
+#include <boost/utility/enable_if.hpp>
+#include "dec_brl/NormalGamma.h"
+#include "dec_brl/ConditionedView.h"
+#include "DiscreteFunction.h"
+
+/**
+ * Namespace all public functions and types defined in the DecBRL library.
+ */
+namespace dec_brl {
+
+/**
+ * Namespace for classes that represent probability distributions commonly
+ * used in Bayesian Reinforcement Learning and Bayesian Analysis.
+ */
+namespace dist {
+
+   /**
+    * Each record must fill exactly half of a 64 byte cache line, so that
+    * records in an aligned array never straddle two lines.
+    */
+   BOOST_STATIC_ASSERT(sizeof(NormalGammaRecord)==32);
+
+   template<class Policy> class InterleavedNormalGamma_Tmpl;
+
+   /**
+    * Read-only view of a single hyperparameter of an
+    * InterleavedNormalGamma_Tmpl, with the same interface as
+    * CompactFunction_Tmpl, so that generic code can read either in the same
+    * way. A field refers to the distribution that owns it, and is rebound
+    * when that distribution is copied.
+    * @tparam Policy Boost.Math policy of the owning distribution.
+    */
+   template<class Policy> class InterleavedField_Tmpl
+   {
+   public:
+
+      /**
+       * Type of iterator over the variables on which this field depends.
+       */
+      typedef std::vector<maxsum::VarID>::const_iterator VarIterator;
+
+      /**
+       * Type of pointer to the member of NormalGammaRecord that holds this
+       * field's values, or null for the owner's cached log gamma ratios.
+       */
+      typedef maxsum::ValType NormalGammaRecord::* Member;
+
+   private:
+
+      /**
+       * The distribution that owns this field.
+       */
+      const InterleavedNormalGamma_Tmpl<Policy>* owner_i;
+
+      /**
+       * The member of each record that holds this field's values.
+       */
+      Member member_i;
+
+      /**
+       * Fields are rebound by their owner, rather than assigned.
+       */
+      InterleavedField_Tmpl& operator=(const InterleavedField_Tmpl&);
+
+   public:
+
+      /**
+       * Constructs a view of a member of each record of a distribution.
+       * @param[in] owner the distribution that owns this field.
+       * @param[in] member the member to view, or null to view the owner's
+       * cached log gamma ratios.
+       */
+      InterleavedField_Tmpl
+      (
+       const InterleavedNormalGamma_Tmpl<Policy>& owner,
+       Member member
+      )
+      : owner_i(&owner), member_i(member)
+      {}
+
+      /**
+       * Returns the number of variables on which this field depends.
+       */
+      int noVars() const
+      {
+         return owner_i->noVars();
+      }
+
+      /**
+       * Returns an iterator to the first variable on which this field
+       * depends.
+       */
+      VarIterator varBegin() const
+      {
+         return owner_i->varBegin();
+      }
+
+      /**
+       * Returns an iterator to the end of the variables on which this
+       * field depends.
+       */
+      VarIterator varEnd() const
+      {
+         return owner_i->varEnd();
+      }
+
+      /**
+       * Returns the domain size of each variable on which this field
+       * depends, in the same order as varBegin().
+       */
+      const std::vector<maxsum::ValIndex>& sizes() const
+      {
+         return owner_i->sizes();
+      }
+
+      /**
+       * Returns the size of this field's joint domain.
+       */
+      maxsum::ValIndex domainSize() const
+      {
+         return owner_i->domainSize();
+      }
+
+      /**
+       * Returns the linear index of an element, which is the index itself.
+       */
+      maxsum::ValIndex linearIndex(maxsum::ValIndex k) const
+      {
+         return k;
+      }
+
+      /**
+       * Returns the linear index of the element specified by a map from
+       * each variable on which this field depends to its value.
+       */
+      template<class VarMap>
+      typename boost::disable_if<boost::is_arithmetic<VarMap>,
+                                 maxsum::ValIndex>::type
+      linearIndex(const VarMap& vars) const
+      {
+         return owner_i->linearIndex(vars);
+      }
+
+      /**
+       * Returns the value of the element with the specified linear index.
+       */
+      maxsum::ValType operator()(maxsum::ValIndex k) const
+      {
+         if(0==member_i)
+         {
+            return owner_i->ratio(k);
+         }
+         return (*owner_i)[k].*member_i;
+      }
+
+      /**
+       * Returns the value of the element specified by a map from each
+       * variable on which this field depends to its value.
+       */
+      template<class VarMap>
+      typename boost::disable_if<boost::is_arithmetic<VarMap>,
+                                 maxsum::ValType>::type
+      operator()(const VarMap& vars) const
+      {
+         return (*this)(linearIndex(vars));
+      }
+
+   }; // class InterleavedField_Tmpl
+
+   /**
+    * Normal-Gamma distribution with a separate set of hyperparameters for
+    * each element in the joint domain of a set of maxsum variables, stored
+    * as an array of NormalGammaRecord structures rather than four separate
+    * arrays. Elements are indexed in the same order as
+    * maxsum::DiscreteFunction, and the interface mirrors
+    * CachedNormalGamma_Tmpl<maxsum::DiscreteFunction>, so either may be used
+    * for the beliefs maintained by dec_brl::DecBayesQ_Tmpl.
+    *
+    * This layout suits beliefs over large factors that are mostly updated
+    * one element at a time, where the separate arrays cost one cache miss
+    * per hyperparameter. Conditioning and VPI read the hyperparameters
+    * through strided views instead, so beliefs that are mostly conditioned
+    * over large free domains should keep the separate layout. The cached
+    * log gamma ratios are only read by VPI, and so are kept in their own
+    * array. Use toInterleaved() and toSeparate() to convert between the
+    * two layouts.
+    * @tparam Policy Boost.Math policy used to calculate results.
+    * @see dec_brl::dist::CachedNormalGamma_Tmpl
+    */
+   template<class Policy=boost::math::policies::policy<> >
+   class InterleavedNormalGamma_Tmpl
+   {
+   public:
+
+      /**
+       * Type used to read each hyperparameter.
+       */
+      typedef InterleavedField_Tmpl<Policy> value_type;
+
+      /**
+       * Boost.Math policy type used by this distribution.
+       */
+      typedef Policy policy_type;
+
+      /**
+       * Type of iterator over the variables on which this distribution
+       * depends.
+       */
+      typedef std::vector<maxsum::VarID>::const_iterator VarIterator;
+
+   private:
+
+      /**
+       * Sorted list of variables on which this distribution depends.
+       */
+      std::vector<maxsum::VarID> vars_i;
+
+      /**
+       * Domain size of each variable in vars_i.
+       */
+      std::vector<maxsum::ValIndex> sizes_i;
+
+      /**
+       * Hyperparameters of each element.
+       */
+      std::vector<NormalGammaRecord> records_i;
+
+      /**
+       * Cached log gamma ratio of each element.
+       */
+      std::vector<maxsum::ValType> ratios_i;
+
+   public:
+
+      /**
+       * The alpha hyperparameter.
+       */
+      const value_type alpha;
+
+      /**
+       * The beta hyperparameter.
+       */
+      const value_type beta;
+
+      /**
+       * The lambda hyperparameter.
+       */
+      const value_type lambda;
+
+      /**
+       * The m hyperparameter.
+       */
+      const value_type m;
+
+      /**
+       * The cached value of
+       * \f$\log\Gamma(\alpha-\frac{1}{2}) - \log\Gamma(\alpha)\f$.
+       */
+      const value_type lgammaRatio;
+
+      /**
+       * Constructs a new distribution with specified parameters.
+       * @param[in] a value for alpha hyperparameter.
+       * @param[in] b value for beta hyperparameter.
+       * @param[in] l value for lambda hyperparmeter.
+       * @param[in] m value for m hyperparameter.
+       */
+      InterleavedNormalGamma_Tmpl
+      (
+       maxsum::ValType a=NormalGamma_Tmpl<double,Policy>::DEFAULT_ALPHA,
+       maxsum::ValType b=NormalGamma_Tmpl<double,Policy>::DEFAULT_BETA,
+       maxsum::ValType l=NormalGamma_Tmpl<double,Policy>::DEFAULT_LAMBDA,
+       maxsum::ValType m=NormalGamma_Tmpl<double,Policy>::DEFAULT_M
+      )
+      : vars_i(), sizes_i(), records_i(1),
+        ratios_i(1,logGammaRatio<maxsum::ValType,Policy>(a)),
+        alpha(*this,&NormalGammaRecord::alpha),
+        beta(*this,&NormalGammaRecord::beta),
+        lambda(*this,&NormalGammaRecord::lambda),
+        m(*this,&NormalGammaRecord::m),
+        lgammaRatio(*this,0)
+      {
+         records_i[0].alpha = a;
+         records_i[0].beta = b;
+         records_i[0].lambda = l;
+         records_i[0].m = m;
+      }
+
+      /**
+       * Copy constructor, whose fields view the copy.
+       */
+      InterleavedNormalGamma_Tmpl(const InterleavedNormalGamma_Tmpl& rhs)
+      : vars_i(rhs.vars_i), sizes_i(rhs.sizes_i), records_i(rhs.records_i),
+        ratios_i(rhs.ratios_i),
+        alpha(*this,&NormalGammaRecord::alpha),
+        beta(*this,&NormalGammaRecord::beta),
+        lambda(*this,&NormalGammaRecord::lambda),
+        m(*this,&NormalGammaRecord::m),
+        lgammaRatio(*this,0)
+      {}
+
+      /**
+       * Copies the contents of another distribution. The fields of this
+       * distribution continue to view this distribution.
+       */
+      InterleavedNormalGamma_Tmpl& operator=
+      (
+       const InterleavedNormalGamma_Tmpl& rhs
+      )
+      {
+         vars_i = rhs.vars_i;
+         sizes_i = rhs.sizes_i;
+         records_i = rhs.records_i;
+         ratios_i = rhs.ratios_i;
+         return *this;
+      }
+
+      /**
+       * Returns the number of variables on which this distribution depends.
+       */
+      int noVars() const
+      {
+         return static_cast<int>(vars_i.size());
+      }
+
+      /**
+       * Returns an iterator to the first variable on which this
+       * distribution depends.
+       */
+      VarIterator varBegin() const
+      {
+         return vars_i.begin();
+      }
+
+      /**
+       * Returns an iterator to the end of the variables on which this
+       * distribution depends.
+       */
+      VarIterator varEnd() const
+      {
+         return vars_i.end();
+      }
+
+      /**
+       * Returns the domain size of each variable on which this distribution
+       * depends, in the same order as varBegin().
+       */
+      const std::vector<maxsum::ValIndex>& sizes() const
+      {
+         return sizes_i;
+      }
+
+      /**
+       * Returns the size of this distribution's joint domain.
+       */
+      maxsum::ValIndex domainSize() const
+      {
+         return static_cast<maxsum::ValIndex>(records_i.size());
+      }
+
+      /**
+       * Returns the linear index of an element, which is the index itself.
+       */
+      maxsum::ValIndex linearIndex(maxsum::ValIndex k) const
+      {
+         return k;
+      }
+
+      /**
+       * Returns the linear index of the element specified by a map from
+       * each variable on which this distribution depends to its value.
+       * @tparam VarMap maps maxsum::VarID to maxsum::ValIndex, and implements
+       * find() with the same semantics as std::map.
+       */
+      template<class VarMap>
+      typename boost::disable_if<boost::is_arithmetic<VarMap>,
+                                 maxsum::ValIndex>::type
+      linearIndex(const VarMap& vars) const
+      {
+         maxsum::ValIndex index = 0;
+         maxsum::ValIndex stride = 1;
+         for(std::size_t k=0; k<vars_i.size(); ++k)
+         {
+            typename VarMap::const_iterator pos = vars.find(vars_i[k]);
+            assert(vars.end()!=pos);
+            index += stride*pos->second;
+            stride *= sizes_i[k];
+         }
+         return index;
+      }
+
+      /**
+       * Returns the hyperparameters of the element with the specified
+       * linear index.
+       */
+      NormalGammaRecord& operator[](maxsum::ValIndex k)
+      {
+         return records_i[k];
+      }
+
+      /**
+       * Returns the hyperparameters of the element with the specified
+       * linear index.
+       */
+      const NormalGammaRecord& operator[](maxsum::ValIndex k) const
+      {
+         return records_i[k];
+      }
+
+      /**
+       * Returns the cached log gamma ratio of the element with the
+       * specified linear index.
+       */
+      maxsum::ValType& ratio(maxsum::ValIndex k)
+      {
+         return ratios_i[k];
+      }
+
+      /**
+       * Returns the cached log gamma ratio of the element with the
+       * specified linear index.
+       */
+      maxsum::ValType ratio(maxsum::ValIndex k) const
+      {
+         return ratios_i[k];
+      }
+
+      /**
+       * Expands the domain of a constant distribution to include the
+       * specified variables, copying its hyperparameters to every element.
+       * @pre this distribution does not yet depend on any variables.
+       */
+      template<class Iterator> void expand(Iterator varBegin, Iterator varEnd)
+      {
+         assert(vars_i.empty());
+         vars_i.assign(varBegin,varEnd);
+         std::sort(vars_i.begin(),vars_i.end());
+         vars_i.erase(std::unique(vars_i.begin(),vars_i.end()),vars_i.end());
+
+         sizes_i.resize(vars_i.size());
+         maxsum::ValIndex size = 1;
+         for(std::size_t k=0; k<vars_i.size(); ++k)
+         {
+            sizes_i[k] = maxsum::getDomainSize(vars_i[k]);
+            size *= sizes_i[k];
+         }
+         const NormalGammaRecord rec = records_i.front();
+         const maxsum::ValType lgr = ratios_i.front();
+         records_i.assign(size,rec);
+         ratios_i.assign(size,lgr);
+      }
+
+      /**
+       * Swaps the contents of this distribution with another. The fields of
+       * each distribution continue to view that distribution.
+       */
+      void swap(InterleavedNormalGamma_Tmpl& rhs)
+      {
+         vars_i.swap(rhs.vars_i);
+         sizes_i.swap(rhs.sizes_i);
+         records_i.swap(rhs.records_i);
+         ratios_i.swap(rhs.ratios_i);
+      }
+
+   }; // class InterleavedNormalGamma_Tmpl
+
+   /**
+    * Convenience typedef for interleaved distributions that use the default
+    * Boost.Math policy.
+    */
+   typedef InterleavedNormalGamma_Tmpl<> InterleavedNormalGamma;
+
+   /**
+    * Conditions a hyperparameter of an interleaved distribution on the
+    * values of some of its variables, producing a maxsum::DiscreteFunction
+    * over the remaining variables.
+    * @tparam StateMap maps maxsum::VarID to maxsum::ValIndex, and implements
+    * find() and end() with the same semantics as std::map.
+    * @param[in] inFun the hyperparameter to condition.
+    * @param[out] outFun the conditioned function.
+    * @param[in] states values of the variables to condition on.
+    */
+   template<class Policy, class StateMap> void condition
+   (
+    const InterleavedField_Tmpl<Policy>& inFun,
+    maxsum::DiscreteFunction& outFun,
+    const StateMap& states
+   )
+   {
+      ConditionedLayout layout;
+      layout.reset(inFun.varBegin(),inFun.varEnd(),states);
+
+      std::vector<maxsum::VarID> freeVars;
+      for(typename InterleavedField_Tmpl<Policy>::VarIterator
+            it=inFun.varBegin(); it!=inFun.varEnd(); ++it)
+      {
+         if(states.end()==states.find(*it))
+         {
+            freeVars.push_back(*it);
+         }
+      }
+
+      outFun = maxsum::DiscreteFunction(freeVars.begin(),freeVars.end(),0.0);
+      for(maxsum::ValIndex k=0; k<layout.size(); ++k)
+      {
+         outFun(k) = inFun(layout[k]);
+      }
+
+   } // condition
+
+   /**
+    * Expands the domain of an interleaved NormalGamma distribution, so that
+    * it includes the named variables registered by the maxsum library.
+    * @pre the distribution does not yet depend on any variables.
+    */
+   template<class Policy, class ValType> void expand
+   (
+    InterleavedNormalGamma_Tmpl<Policy>& paramDist,
+    ValType var
+   )
+   {
+      const maxsum::VarID id = var;
+      paramDist.expand(&id,&id+1);
+   }
+
+   /**
+    * Expands the domain of an interleaved NormalGamma distribution, so that
+    * it includes the named variables registered by the maxsum library.
+    * @pre the distribution does not yet depend on any variables.
+    */
+   template<class Policy, class Iterator> void expand
+   (
+    InterleavedNormalGamma_Tmpl<Policy>& paramDist,
+    Iterator varBegin,
+    Iterator varEnd
+   )
+   {
+      paramDist.expand(varBegin,varEnd);
+   }
+
+   /**
+    * Returns the hyperparameters of a single element of an interleaved
+    * distribution, which are already stored together.
+    * @see getRecord(const Dist&,const maxsum::ValIndex)
+    */
+   template<class Policy> const NormalGammaRecord& getRecord
+   (
+    const InterleavedNormalGamma_Tmpl<Policy>& paramDist,
+    const maxsum::ValIndex k
+   )
+   {
+      return paramDist[k];
+   }
+
+   /**
+    * Recalculates the cached log gamma ratio of each element of an
+    * interleaved distribution from its current value of alpha.
+    * @param[in,out] dist the distribution whose cache should be reset.
+    */
+   template<class Policy> void resetLogGammaRatio
+   (
+    InterleavedNormalGamma_Tmpl<Policy>& dist
+   )
+   {
+      for(maxsum::ValIndex k=0; k<dist.domainSize(); ++k)
+      {
+         dist.ratio(k) = logGammaRatio<maxsum::ValType,Policy>(dist[k].alpha);
+      }
+   }
+
+   /**
+    * Copies the hyperparameters of a distribution with separate
+    * maxsum::DiscreteFunction hyperparameters into an interleaved
+    * distribution, and calculates its cached log gamma ratios.
+    * @param[in] in the distribution to copy.
+    * @param[out] out the copy, whose previous contents are discarded.
+    */
+   template<class Policy> void toInterleaved
+   (
+    const NormalGamma_Tmpl<maxsum::DiscreteFunction,Policy>& in,
+    InterleavedNormalGamma_Tmpl<Policy>& out
+   )
+   {
+      NormalGamma_Tmpl<maxsum::DiscreteFunction,Policy> shared(in);
+      shareDomain(shared);
+
+      InterleavedNormalGamma_Tmpl<Policy> result;
+      result.expand(shared.m.varBegin(),shared.m.varEnd());
+      for(maxsum::ValIndex k=0; k<result.domainSize(); ++k)
+      {
+         NormalGammaRecord& rec = result[k];
+         rec.alpha = shared.alpha(k);
+         rec.beta = shared.beta(k);
+         rec.lambda = shared.lambda(k);
+         rec.m = shared.m(k);
+      }
+      resetLogGammaRatio(result);
+      out.swap(result);
+
+   } // toInterleaved
+
+   /**
+    * Copies the hyperparameters and cached log gamma ratios of a cached
+    * distribution with separate maxsum::DiscreteFunction hyperparameters
+    * into an interleaved distribution.
+    * @param[in] in the distribution to copy.
+    * @param[out] out the copy, whose previous contents are discarded.
+    */
+   template<class Policy> void toInterleaved
+   (
+    const CachedNormalGamma_Tmpl<maxsum::DiscreteFunction,Policy>& in,
+    InterleavedNormalGamma_Tmpl<Policy>& out
+   )
+   {
+      CachedNormalGamma_Tmpl<maxsum::DiscreteFunction,Policy> shared(in);
+      shareDomain(shared);
+
+      InterleavedNormalGamma_Tmpl<Policy> result;
+      result.expand(shared.m.varBegin(),shared.m.varEnd());
+      for(maxsum::ValIndex k=0; k<result.domainSize(); ++k)
+      {
+         NormalGammaRecord& rec = result[k];
+         rec.alpha = shared.alpha(k);
+         rec.beta = shared.beta(k);
+         rec.lambda = shared.lambda(k);
+         rec.m = shared.m(k);
+         result.ratio(k) = shared.lgammaRatio(k);
+      }
+      out.swap(result);
+
+   } // toInterleaved
+
+   /**
+    * Copies the hyperparameters of an interleaved distribution into
+    * separate maxsum::DiscreteFunction hyperparameters.
+    * @param[in] in the distribution to copy.
+    * @param[out] out the copy, whose previous contents are discarded.
+    */
+   template<class Policy> void toSeparate
+   (
+    const InterleavedNormalGamma_Tmpl<Policy>& in,
+    NormalGamma_Tmpl<maxsum::DiscreteFunction,Policy>& out
+   )
+   {
+      maxsum::DiscreteFunction alpha(in.varBegin(),in.varEnd(),0.0);
+      maxsum::DiscreteFunction beta(alpha), lambda(alpha), m(alpha);
+      for(maxsum::ValIndex k=0; k<in.domainSize(); ++k)
+      {
+         const NormalGammaRecord& rec = in[k];
+         alpha(k) = rec.alpha;
+         beta(k) = rec.beta;
+         lambda(k) = rec.lambda;
+         m(k) = rec.m;
+      }
+      out.alpha.swap(alpha);
+      out.beta.swap(beta);
+      out.lambda.swap(lambda);
+      out.m.swap(m);
+
+   } // toSeparate
+
+   /**
+    * Copies the hyperparameters and cached log gamma ratios of an
+    * interleaved distribution into a cached distribution with separate
+    * maxsum::DiscreteFunction hyperparameters.
+    * @param[in] in the distribution to copy.
+    * @param[out] out the copy, whose previous contents are discarded.
+    */
+   template<class Policy> void toSeparate
+   (
+    const InterleavedNormalGamma_Tmpl<Policy>& in,
+    CachedNormalGamma_Tmpl<maxsum::DiscreteFunction,Policy>& out
+   )
+   {
+      NormalGamma_Tmpl<maxsum::DiscreteFunction,Policy>& base = out;
+      toSeparate(in,base);
+      maxsum::DiscreteFunction ratio(in.varBegin(),in.varEnd(),0.0);
+      for(maxsum::ValIndex k=0; k<in.domainSize(); ++k)
+      {
+         ratio(k) = in.ratio(k);
+      }
+      out.lgammaRatio.swap(ratio);
+
+   } // toSeparate
+
+   /**
+    * Updates a specific element of an interleaved parameter distribution
+    * given sufficient statistics for a sample drawn from the target
+    * distribution, and updates its cached log gamma ratio. The update reads
+    * and writes a single record, using the same equations and order of
+    * operations as CachedNormalGamma_Tmpl<maxsum::DiscreteFunction>, so
+    * the results are identical.
+    * @param[in] maxSteps largest n for which the log gamma ratio is updated
+    * by recurrence.
+    * @see observe(CachedNormalGamma_Tmpl<maxsum::DiscreteFunction,Policy>&,IndexType,const ValType,const ValType,const int,const int)
+    */
+   template<class IndexType, class ValType, class Policy> void observe
+   (
+    InterleavedNormalGamma_Tmpl<Policy>& paramDist,
+    IndexType index,
+    const ValType sm,
+    const ValType s2,
+    const int n,
+    const int maxSteps=MAX_RECURRENCE_STEPS
+   )
+   {
+      const maxsum::ValIndex k = paramDist.linearIndex(index);
+      NormalGammaRecord& rec = paramDist[k];
+
+      const maxsum::ValType oldAlpha = rec.alpha;
+      const maxsum::ValType oldBeta = rec.beta;
+      const maxsum::ValType oldLambda = rec.lambda;
+      const maxsum::ValType oldM = rec.m;
+
+      updateLogGammaRatio<maxsum::ValType,Policy>
+         (paramDist.ratio(k),oldAlpha,n,maxSteps);
+      const maxsum::ValType newAlpha = oldAlpha + n/2.0;
+      const maxsum::ValType newLambda = oldLambda + n;
+      const maxsum::ValType newM = (oldLambda*oldM + n*sm) / newLambda;
+      const maxsum::ValType newBeta = oldBeta + s2/2.0 +
+         n*oldLambda*(oldM-sm)*(oldM-sm)/2.0/newLambda;
+
+      rec.alpha = newAlpha;
+      rec.beta = newBeta;
+      rec.lambda = newLambda;
+      rec.m = newM;
+
+   } // observe
+
+   /**
+    * Applies a batched sufficient statistics update to a single element of
+    * an interleaved distribution, allowing the log gamma ratio recurrence
+    * to run for up to MAX_BATCH_RECURRENCE_STEPS half steps.
+    * @see observeBatch
+    */
+   template<class Policy> void observeBatchElement
+   (
+    InterleavedNormalGamma_Tmpl<Policy>& paramDist,
+    const maxsum::ValIndex k,
+    const maxsum::ValType sm,
+    const maxsum::ValType s2,
+    const int n
+   )
+   {
+      observe<maxsum::ValIndex>(paramDist, k, sm, s2, n,
+                                MAX_BATCH_RECURRENCE_STEPS);
+   }
+
+} // namespace dist
+} // namespace dec_brl
+
+#endif // DECBRL_INTERLEAVEDNORMALGAMMA_H
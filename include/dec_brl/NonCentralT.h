@@ -7,7 +7,10 @@
 #define DECBRL_NONCENTRALT_H
 
 #include <cassert>
+#include <cmath>
 #include <boost/math/distributions/students_t.hpp>
+#include <boost/math/special_functions/erf.hpp>
+#include <boost/math/constants/constants.hpp>
 #include <boost/type_traits/is_base_of.hpp>
 #include <boost/utility/enable_if.hpp>
 #include <boost/random/uniform_real.hpp>
@@ -432,6 +435,255 @@ namespace dist {
 
    } // operator()
 
+   /**
+    * Tag type used to select the Student's t cumulative distribution
+    * function provided by Boost.Math, which is accurate to the precision
+    * set by the Boost.Math policy. This is the default CDF mode.
+    * @see dec_brl::dist::FastCdf_Tmpl
+    */
+   struct ExactCdf {};
+
+   /**
+    * Tag type used to select a fast approximation of the Student's t
+    * cumulative distribution function, in place of the incomplete beta
+    * function used by Boost.Math.
+    * Normal-Gamma distributions produce marginals with \f$2\alpha\f$ degrees
+    * of freedom, and \f$\alpha\f$ increases in steps of \f$\frac{1}{2}\f$
+    * with each observation, so the degrees of freedom are normally (very
+    * nearly) integers. For integer degrees of freedom, \f$\nu\f$, up to
+    * MAX_SERIES_DF, the CDF is calculated using the finite series in
+    * Abramowitz and Stegun (26.7.3 and 26.7.4), which has \f$O(\nu)\f$
+    * terms. Beyond that, we use the normal approximation
+    * \f[
+    * F_\nu(t) \approx \Phi\left(
+    * \frac{t(1-\frac{1}{4\nu})}{\sqrt{1+\frac{t^2}{2\nu}}} \right)
+    * \f]
+    * For any other degrees of freedom, we fall back on the Boost.Math CDF.
+    * @tparam RealType scalar type used for parameters and return values.
+    * @see dec_brl::dist::ExactCdf
+    */
+   template<class RealType=double> struct FastCdf_Tmpl
+   {
+      /**
+       * Maximum absolute difference between the CDF calculated in this mode,
+       * and the CDF calculated by Boost.Math. This is dominated by the
+       * normal approximation at MAX_SERIES_DF degrees of freedom.
+       * The series is accurate to around 1e-12.
+       */
+      static const RealType MAX_ABS_ERROR;
+
+      /**
+       * Maximum distance between the degrees of freedom and the nearest
+       * integer for the degrees of freedom to be treated as an integer.
+       * This adds no more than 1e-8 to the error.
+       */
+      static const RealType DF_TOLERANCE;
+
+      /**
+       * Largest degrees of freedom for which the finite series is used.
+       */
+      static const int MAX_SERIES_DF = 64;
+
+   }; // struct FastCdf_Tmpl
+
+   /**
+    * Convenience typedef for fast CDF mode with the default template
+    * parameters.
+    */
+   typedef FastCdf_Tmpl<> FastCdf;
+
+   template<class RealType> const RealType
+      FastCdf_Tmpl<RealType>::MAX_ABS_ERROR = 2.5e-5;
+
+   template<class RealType> const RealType
+      FastCdf_Tmpl<RealType>::DF_TOLERANCE = 1e-6;
+
+   /**
+    * Cumulative distribution function of the standard Student's t
+    * distribution, calculated using Boost.Math.
+    * @tparam RealType scalar type used for parameters and return values.
+    * @tparam Policy Boost.Math policy used to calculate results.
+    * @param[in] df the degrees of freedom.
+    * @param[in] t the point at which to evaluate the CDF.
+    * @returns \f$P(T \leq t)\f$
+    */
+   template<class RealType, class Policy> RealType studentsTCdf
+   (
+    const RealType df,
+    const RealType t,
+    ExactCdf
+   )
+   {
+      boost::math::students_t_distribution<RealType,Policy> base(df);
+      return boost::math::cdf(base,t);
+   }
+
+   /**
+    * Complement of the cumulative distribution function of the standard
+    * Student's t distribution, calculated using Boost.Math.
+    * @tparam RealType scalar type used for parameters and return values.
+    * @tparam Policy Boost.Math policy used to calculate results.
+    * @param[in] df the degrees of freedom.
+    * @param[in] t the point at which to evaluate the CDF complement.
+    * @returns \f$P(T > t)\f$
+    */
+   template<class RealType, class Policy> RealType studentsTCdfComplement
+   (
+    const RealType df,
+    const RealType t,
+    ExactCdf
+   )
+   {
+      boost::math::students_t_distribution<RealType,Policy> base(df);
+      return boost::math::cdf(boost::math::complement(base,t));
+   }
+
+   /**
+    * Cumulative distribution function of the standard Student's t
+    * distribution, calculated using the fast approximation described in
+    * dec_brl::dist::FastCdf_Tmpl.
+    * @tparam RealType scalar type used for parameters and return values.
+    * @tparam Policy Boost.Math policy used to calculate results.
+    * @param[in] df the degrees of freedom.
+    * @param[in] t the point at which to evaluate the CDF.
+    * @returns \f$P(T \leq t)\f$, to within FastCdf_Tmpl::MAX_ABS_ERROR.
+    */
+   template<class RealType, class Policy, class ModeRealType>
+   RealType studentsTCdf
+   (
+    const RealType df,
+    const RealType t,
+    FastCdf_Tmpl<ModeRealType>
+   )
+   {
+      typedef FastCdf_Tmpl<ModeRealType> Mode;
+
+      //************************************************************************
+      // Fall back on Boost.Math for non-integer degrees of freedom.
+      //************************************************************************
+      const RealType nu = std::floor(df+0.5);
+      if( (1>nu) || (Mode::DF_TOLERANCE < std::abs(df-nu)) )
+      {
+         return studentsTCdf<RealType,Policy>(df,t,ExactCdf());
+      }
+
+      //************************************************************************
+      // Use the normal approximation for large degrees of freedom.
+      //************************************************************************
+      if(Mode::MAX_SERIES_DF < nu)
+      {
+         const RealType z = t*(1-1/(4*nu)) / std::sqrt(1+t*t/(2*nu));
+         return 0.5*boost::math::erfc(-z/std::sqrt(RealType(2.0)),Policy());
+      }
+
+      //************************************************************************
+      // Otherwise sum the finite series in terms of
+      // theta = atan(t/sqrt(nu)), using cos^2(theta) = nu/(nu+t^2) and
+      // sin(theta) = t/sqrt(nu+t^2). Each term is the previous term
+      // multiplied by cos^2(theta)*(k-1)/k.
+      //************************************************************************
+      const int n = static_cast<int>(nu);
+      const RealType cos2 = nu/(nu+t*t);
+      const RealType sinTheta = t/std::sqrt(nu+t*t);
+      RealType a; // P(|T|<t) for positive t, and its negation otherwise
+      if(0==n%2)
+      {
+         RealType term = 1;
+         RealType sum = 1;
+         for(int k=2; k<=n-2; k+=2)
+         {
+            term *= cos2*(k-1)/k;
+            sum += term;
+         }
+         a = sinTheta*sum;
+      }
+      else
+      {
+         const RealType theta = std::atan(t/std::sqrt(nu));
+         RealType sum = 0;
+         if(1<n)
+         {
+            RealType term = std::sqrt(cos2);
+            sum = term;
+            for(int k=3; k<=n-2; k+=2)
+            {
+               term *= cos2*(k-1)/k;
+               sum += term;
+            }
+         }
+         const RealType PI = boost::math::constants::pi<RealType>();
+         a = (theta + sinTheta*sum) * 2 / PI;
+      }
+      return 0.5 + 0.5*a;
+
+   } // studentsTCdf
+
+   /**
+    * Complement of the cumulative distribution function of the standard
+    * Student's t distribution, calculated using the fast approximation
+    * described in dec_brl::dist::FastCdf_Tmpl.
+    * @tparam RealType scalar type used for parameters and return values.
+    * @tparam Policy Boost.Math policy used to calculate results.
+    * @param[in] df the degrees of freedom.
+    * @param[in] t the point at which to evaluate the CDF complement.
+    * @returns \f$P(T > t)\f$, to within FastCdf_Tmpl::MAX_ABS_ERROR.
+    */
+   template<class RealType, class Policy, class ModeRealType>
+   RealType studentsTCdfComplement
+   (
+    const RealType df,
+    const RealType t,
+    FastCdf_Tmpl<ModeRealType> mode
+   )
+   {
+      // by symmetry of the t distribution
+      return studentsTCdf<RealType,Policy>(df,-t,mode);
+   }
+
+   /**
+    * Cumulative distribution function for a NonCentralT distribution,
+    * calculated using the specified CDF mode.
+    * @tparam CdfMode either dec_brl::dist::ExactCdf or
+    * dec_brl::dist::FastCdf_Tmpl.
+    * @param[in] dist the distribution.
+    * @param[in] x the point at which to evaluate the CDF.
+    * @param[in] mode tag selecting how the CDF is calculated.
+    */
+   template<class RealType, class Policy, class CdfMode>
+   RealType studentsTCdf
+   (
+    const NonCentralT_Tmpl<RealType,Policy>& dist,
+    const RealType x,
+    CdfMode mode
+   )
+   {
+      RealType unscaled_param = (x-dist.location()) / dist.scale();
+      return studentsTCdf<RealType,Policy>
+         (dist.degrees_of_freedom(),unscaled_param,mode);
+   }
+
+   /**
+    * Complement of the cumulative distribution function for a NonCentralT
+    * distribution, calculated using the specified CDF mode.
+    * @tparam CdfMode either dec_brl::dist::ExactCdf or
+    * dec_brl::dist::FastCdf_Tmpl.
+    * @param[in] dist the distribution.
+    * @param[in] x the point at which to evaluate the CDF complement.
+    * @param[in] mode tag selecting how the CDF is calculated.
+    */
+   template<class RealType, class Policy, class CdfMode>
+   RealType studentsTCdfComplement
+   (
+    const NonCentralT_Tmpl<RealType,Policy>& dist,
+    const RealType x,
+    CdfMode mode
+   )
+   {
+      RealType unscaled_param = (x-dist.location()) / dist.scale();
+      return studentsTCdfComplement<RealType,Policy>
+         (dist.degrees_of_freedom(),unscaled_param,mode);
+   }
+
 }} // namespace dec_brl::dist
 
 
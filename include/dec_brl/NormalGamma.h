@@ -6,8 +6,13 @@
 #ifndef DECBRL_NORMALGAMMA_H
 #define DECBRL_NORMALGAMMA_H
 
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <vector>
 #include <boost/type_traits.hpp>
 #include <boost/utility/enable_if.hpp>
+#include <boost/math/special_functions/gamma.hpp>
 #include "DiscreteFunction.h"
 #include "NonCentralT.h"
 
@@ -158,6 +163,152 @@ namespace dist {
     */
    typedef NormalGamma_Tmpl<> NormalGamma;
 
+   /**
+    * Normal-Gamma distribution that also caches the log gamma ratio
+    * \f$\log\Gamma(\alpha-\frac{1}{2}) - \log\Gamma(\alpha)\f$
+    * required by the truncation bias function. The cache is kept up to date
+    * by the observe functions, so that VPI calculations require no calls to
+    * lgamma once the distribution has been constructed.
+    * @tparam RealType scalar type used for parameters and return values.
+    * @tparam Policy Boost.Math policy used to calculate results. This effects
+    * result accuracy, but the default policy is normally suffice.
+    * @see dec_brl::truncationBias
+    */
+   template<class RealType=double, class Policy=boost::math::policies::policy<> >
+   class CachedNormalGamma_Tmpl : public NormalGamma_Tmpl<RealType,Policy>
+   {
+   public:
+
+      /**
+       * The cached value of
+       * \f$\log\Gamma(\alpha-\frac{1}{2}) - \log\Gamma(\alpha)\f$.
+       */
+      RealType lgammaRatio;
+
+      /**
+       * Constructs a new distribution with specified parameters.
+       * @param[in] a value for alpha hyperparameter.
+       * @param[in] b value for beta hyperparameter.
+       * @param[in] l value for lambda hyperparmeter.
+       * @param[in] m value for m hyperparameter.
+       */
+      CachedNormalGamma_Tmpl
+      (
+       RealType a=NormalGamma_Tmpl<RealType,Policy>::DEFAULT_ALPHA,
+       RealType b=NormalGamma_Tmpl<RealType,Policy>::DEFAULT_BETA,
+       RealType l=NormalGamma_Tmpl<RealType,Policy>::DEFAULT_LAMBDA,
+       RealType m=NormalGamma_Tmpl<RealType,Policy>::DEFAULT_M
+      )
+      : NormalGamma_Tmpl<RealType,Policy>(a,b,l,m), lgammaRatio(a)
+      {
+         resetLogGammaRatio(*this);
+      }
+
+   }; // class CachedNormalGamma_Tmpl
+
+   /**
+    * Convenience typedef for cached distributions that use the
+    * default template parameters.
+    */
+   typedef CachedNormalGamma_Tmpl<> CachedNormalGamma;
+
+   /**
+    * Calculates \f$\log\Gamma(\alpha-\frac{1}{2}) - \log\Gamma(\alpha)\f$
+    * directly from its definition.
+    * @param[in] alpha the alpha hyperparameter.
+    */
+   template<class RealType, class Policy> RealType logGammaRatio
+   (
+    const RealType alpha
+   )
+   {
+      Policy policy; // Boost.Math policy used for calculations.
+      return boost::math::lgamma<RealType,Policy>(alpha-0.5, policy)
+           - boost::math::lgamma<RealType,Policy>(alpha, policy);
+   }
+
+   /**
+    * Default maximum number of half steps for which updateLogGammaRatio()
+    * uses its recurrence, rather than recalculating the ratio directly.
+    */
+   const int MAX_RECURRENCE_STEPS = 4;
+
+   /**
+    * Maximum number of half steps for which observeBatch() uses the log
+    * gamma ratio recurrence. Batched updates often advance alpha by many
+    * half steps at once, and up to this limit, the recurrence is still
+    * cheaper than two calls to lgamma.
+    */
+   const int MAX_BATCH_RECURRENCE_STEPS = 32;
+
+   /**
+    * Updates a cached log gamma ratio after \f$\alpha\f$ has increased by
+    * \f$\frac{n}{2}\f$. For small n, we use the recurrence
+    * \f[
+    * r(\alpha+\frac{1}{2}) = -\log(\alpha-\frac{1}{2}) - r(\alpha),
+    * \f]
+    * which follows from \f$\Gamma(x+1)=x\Gamma(x)\f$, and requires only a
+    * single log per half step. Otherwise, the ratio is recalculated directly.
+    * @param[in,out] ratio cached ratio for the old value of alpha.
+    * @param[in] oldAlpha the value of alpha before the update.
+    * @param[in] n number of observations, i.e. number of half steps in alpha.
+    * @param[in] maxSteps largest n for which the recurrence is used.
+    */
+   template<class RealType, class Policy> void updateLogGammaRatio
+   (
+    RealType& ratio,
+    RealType oldAlpha,
+    const int n,
+    const int maxSteps=MAX_RECURRENCE_STEPS
+   )
+   {
+      //************************************************************************
+      // Recurrence is only defined if alpha-0.5 is positive, and is only
+      // cheaper than two calls to lgamma for a limited number of steps.
+      //************************************************************************
+      if( (0.5>=oldAlpha) || (maxSteps<n) || (0>n) )
+      {
+         ratio = logGammaRatio<RealType,Policy>(oldAlpha+n/2.0);
+         return;
+      }
+
+      for(int k=0; k<n; ++k)
+      {
+         ratio = -std::log(oldAlpha-0.5) - ratio;
+         oldAlpha += 0.5;
+      }
+   }
+
+   /**
+    * Recalculates the cached log gamma ratio from the current value of alpha.
+    * @param[in,out] dist the distribution whose cache should be reset.
+    */
+   template<class RealType, class Policy>
+   typename boost::disable_if
+      < boost::is_base_of<maxsum::DiscreteFunction,RealType> >::type
+   resetLogGammaRatio(CachedNormalGamma_Tmpl<RealType,Policy>& dist)
+   {
+      dist.lgammaRatio = logGammaRatio<RealType,Policy>(dist.alpha);
+   }
+
+   /**
+    * Recalculates the cached log gamma ratio from the current value of alpha,
+    * for each element of a maxsum::DiscreteFunction.
+    * @param[in,out] dist the distribution whose cache should be reset.
+    */
+   template<class RealType, class Policy>
+   typename boost::enable_if
+      < boost::is_base_of<maxsum::DiscreteFunction,RealType> >::type
+   resetLogGammaRatio(CachedNormalGamma_Tmpl<RealType,Policy>& dist)
+   {
+      dist.lgammaRatio = dist.alpha; // get the correct domain
+      for(int k=0; k<dist.alpha.domainSize(); ++k)
+      {
+         dist.lgammaRatio(k) =
+            logGammaRatio<maxsum::ValType,Policy>(dist.alpha(k));
+      }
+   }
+
    /**
     * Constructs a new NonCentralT distribution representing the marginal
     * distribution of the mean, for an unknown Gaussian distribution.
@@ -173,6 +324,144 @@ namespace dist {
       return NonCentralT_Tmpl<RealType,Policy>(df,loc,scale);
    }
 
+   /**
+    * Returns true iff two functions are defined over the same variables.
+    */
+   template<class Function> bool isSameDomain
+   (
+    const Function& f1,
+    const Function& f2
+   )
+   {
+      return (f1.noVars()==f2.noVars()) &&
+             std::equal(f1.varBegin(),f1.varEnd(),f2.varBegin());
+   }
+
+   /**
+    * Expands the hyperparameters of a distribution with DiscreteFunction
+    * parameters to the union of their domains, so that they can be updated
+    * element by element. This is the same expansion that DiscreteFunction
+    * arithmetic performs, and does nothing in the usual case, in which all
+    * hyperparameters have been expanded together.
+    */
+   template<class RealType, class Policy> void shareDomain
+   (
+    NormalGamma_Tmpl<RealType,Policy>& paramDist
+   )
+   {
+      if( isSameDomain(paramDist.m,paramDist.alpha) &&
+          isSameDomain(paramDist.m,paramDist.beta) &&
+          isSameDomain(paramDist.m,paramDist.lambda) )
+      {
+         return;
+      }
+      paramDist.m.expand(paramDist.alpha.varBegin(),paramDist.alpha.varEnd());
+      paramDist.m.expand(paramDist.beta.varBegin(),paramDist.beta.varEnd());
+      paramDist.m.expand(paramDist.lambda.varBegin(),
+                         paramDist.lambda.varEnd());
+      paramDist.alpha.expand(paramDist.m.varBegin(),paramDist.m.varEnd());
+      paramDist.beta.expand(paramDist.m.varBegin(),paramDist.m.varEnd());
+      paramDist.lambda.expand(paramDist.m.varBegin(),paramDist.m.varEnd());
+   }
+
+   /**
+    * Expands the hyperparameters and cached log gamma ratios of a
+    * distribution with DiscreteFunction parameters to the union of their
+    * domains.
+    * @see shareDomain(NormalGamma_Tmpl<RealType,Policy>&)
+    */
+   template<class RealType, class Policy> void shareDomain
+   (
+    CachedNormalGamma_Tmpl<RealType,Policy>& paramDist
+   )
+   {
+      shareDomain(static_cast<NormalGamma_Tmpl<RealType,Policy>&>(paramDist));
+      if(!isSameDomain(paramDist.lgammaRatio,paramDist.alpha))
+      {
+         paramDist.lgammaRatio.expand(paramDist.alpha.varBegin(),
+                                      paramDist.alpha.varEnd());
+      }
+   }
+
+   /**
+    * Updates n Normal-Gamma distributions, whose hyperparameters are stored
+    * in separate arrays, given the same sufficient statistics for each.
+    * All hyperparameters are updated in a single pass, without temporary
+    * arrays, using the same update equations (and order of operations) as
+    * observe(NormalGamma_Tmpl<RealType,Policy>&,const ValType,const ValType,const int).
+    * @param[in] size the number of distributions.
+    * @param[in,out] alpha array of alpha hyperparameters.
+    * @param[in,out] beta array of beta hyperparameters.
+    * @param[in,out] lambda array of lambda hyperparameters.
+    * @param[in,out] m array of m hyperparameters.
+    * @param[in] sm sample mean for observations.
+    * @param[in] s2 sum of squared differences from the sample mean.
+    * @param[in] n the number of observations.
+    */
+   template<class RealType> void observeAll
+   (
+    const int size,
+    RealType* alpha,
+    RealType* beta,
+    RealType* lambda,
+    RealType* m,
+    const RealType sm,
+    const RealType s2,
+    const int n
+   )
+   {
+      const RealType halfN = n/2.0;
+      const RealType halfS2 = s2/2.0;
+      for(int k=0; k<size; ++k)
+      {
+         const RealType oldLambda = lambda[k];
+         const RealType newLambda = oldLambda + n;
+         const RealType diff = m[k] - sm;
+
+         alpha[k] += halfN;
+         beta[k] += halfS2;
+         beta[k] += diff*diff*oldLambda*halfN/newLambda;
+         m[k] = (m[k]*oldLambda + n*sm)/newLambda;
+         lambda[k] = newLambda;
+      }
+   }
+
+   /**
+    * Updates n Normal-Gamma distributions, whose hyperparameters are stored
+    * in separate arrays, given the same single observation for each.
+    * All hyperparameters are updated in a single pass, without temporary
+    * arrays, using the same update equations (and order of operations) as
+    * observe(NormalGamma_Tmpl<RealType,Policy>&,ValType).
+    * @param[in] size the number of distributions.
+    * @param[in,out] alpha array of alpha hyperparameters.
+    * @param[in,out] beta array of beta hyperparameters.
+    * @param[in,out] lambda array of lambda hyperparameters.
+    * @param[in,out] m array of m hyperparameters.
+    * @param[in] x the observation.
+    */
+   template<class RealType> void observeAll
+   (
+    const int size,
+    RealType* alpha,
+    RealType* beta,
+    RealType* lambda,
+    RealType* m,
+    const RealType x
+   )
+   {
+      for(int k=0; k<size; ++k)
+      {
+         const RealType oldLambda = lambda[k];
+         const RealType newLambda = oldLambda + 1;
+         const RealType diff = m[k] - x;
+
+         alpha[k] += 0.5;
+         beta[k] += diff*diff*oldLambda/2.0/newLambda;
+         m[k] = (m[k]*oldLambda + x)/newLambda;
+         lambda[k] = newLambda;
+      }
+   }
+
    /**
     * Updates a parameter distribution given sufficient statistics for a sample
     * drawn from the target distribution. The update equations here are based on
@@ -259,49 +548,16 @@ namespace dist {
    )
    {
       //************************************************************************
-      // Convenience references
-      //************************************************************************
-      RealType& alpha = paramDist.alpha;
-      RealType& beta = paramDist.beta;
-      RealType& lambda = paramDist.lambda;
-      RealType& m = paramDist.m;
-
-      //************************************************************************
-      // Update hyperparameters. Here we use assigment operators as much as 
-      // possible, because these are more efficient for DiscreteFunction
-      // objects. For primitive types, this shouldn't make much difference to
-      // performance.
-      //
-      // This would probably be faster if we implemented lazy function
-      // evaluation and did everything in a single pass.
+      // Hyperparameters are normally expanded together, but if any has a
+      // smaller domain, it must be expanded before we index it.
       //************************************************************************
+      shareDomain(paramDist);
+      const int size = paramDist.m.domainSize();
 
-      // lambda = lambda + n (but need to perserve old value for now)
-      RealType newLambda(lambda);
-      newLambda += n;
-
-      // a = a + n/2;
-      alpha += n/2.0;
-
-      // tmp = n*lambda*(m-sm)^2/(2*[lambda+n])  (used for beta update)
-      RealType tmp(m);
-      tmp -= sm;         // result: m-sm
-      tmp *= tmp;        // result: (m-sm)^2
-      tmp *= lambda;     // result: lambda*(m-sm)^2
-      tmp *= n/2.0;      // result: n*lambda*(m-sm)^2/2
-      tmp /= newLambda;  // result: n*lambda*(m-sm)^2/(2*[lambda+1])
-
-      // b = b + s2/2 + lambda*(m-ms)^2/(2*[lambda+1])
-      beta += s2/2.0;
-      beta += tmp;
-
-      // m = (m*lambda+n*ms) / (lambda + n)
-      m *= lambda;
-      m += n*sm;
-      m /= newLambda;
-
-      // apply lambda update by swapping pointers (more efficient)
-      lambda.swap(newLambda);
+      observeAll(size, &paramDist.alpha(0), &paramDist.beta(0),
+                 &paramDist.lambda(0), &paramDist.m(0),
+                 static_cast<maxsum::ValType>(sm),
+                 static_cast<maxsum::ValType>(s2), n);
 
    } // observe
 
@@ -417,46 +673,12 @@ namespace dist {
       < boost::is_base_of<maxsum::DiscreteFunction,RealType> >::type
    observe (NormalGamma_Tmpl<RealType,Policy>& paramDist, ValType x)
    {
-      //************************************************************************
-      // Convenience references
-      //************************************************************************
-      RealType& alpha = paramDist.alpha;
-      RealType& beta = paramDist.beta;
-      RealType& lambda = paramDist.lambda;
-      RealType& m = paramDist.m;
-
-      //************************************************************************
-      // Update hyperparameters. Here we use assigment operators as much as 
-      // possible, because these are more efficient for DiscreteFunction
-      // objects. For primitive types, this shouldn't make much difference to
-      // performance.
-      //************************************************************************
-
-      // lambda = lambda + 1 (but need to perserve old value for now)
-      RealType newLambda(lambda);
-      newLambda += 1;
-
-      // a = a + 0.5
-      alpha += 0.5;
+      shareDomain(paramDist);
+      const int size = paramDist.m.domainSize();
 
-      // tmp = lambda*(m-x)^2/(2*[lambda+1])  (used for beta update)
-      RealType tmp(m);
-      tmp -= x;          // result: m-x
-      tmp *= tmp;        // result: (m-x)^2
-      tmp *= lambda;     // result: lambda*(m-x)^2
-      tmp /= 2.0;        // result: lambda*(m-x)^2/2
-      tmp /= newLambda;  // result: lambda*(m-x)^2/(2*[lambda+1])
-
-      // b = b + lambda*(m-x)^2/(2*[lambda+1])
-      beta += tmp;
-
-      // m = (m*lambda+x) / (lambda + 1)
-      m *= lambda;
-      m += x;
-      m /= newLambda;
-
-      // apply lambda update by swapping pointers (more efficient)
-      lambda.swap(newLambda);
+      observeAll(size, &paramDist.alpha(0), &paramDist.beta(0),
+                 &paramDist.lambda(0), &paramDist.m(0),
+                 static_cast<maxsum::ValType>(x));
 
    } // function observe
 
@@ -545,6 +767,383 @@ namespace dist {
       paramDist.m.expand(varBegin,varEnd);
    }
 
+   /**
+    * Expands the domain of a CachedNormalGamma distribution with
+    * DiscreteFunction parameters, including its cached log gamma ratios.
+    * @see dec_brl::dist::expand
+    */
+   template<class Policy, class ValType> void expand
+   (
+    CachedNormalGamma_Tmpl<maxsum::DiscreteFunction,Policy>& paramDist,
+    ValType var
+   )
+   {
+      expand(static_cast<NormalGamma_Tmpl<maxsum::DiscreteFunction,Policy>&>
+             (paramDist), var);
+      paramDist.lgammaRatio.expand(var);
+   }
+
+   /**
+    * Expands the domain of a CachedNormalGamma distribution with
+    * DiscreteFunction parameters, including its cached log gamma ratios.
+    * @see dec_brl::dist::expand
+    */
+   template<class Policy, class Iterator> void expand
+   (
+    CachedNormalGamma_Tmpl<maxsum::DiscreteFunction,Policy>& paramDist,
+    Iterator varBegin,
+    Iterator varEnd
+   )
+   {
+      expand(static_cast<NormalGamma_Tmpl<maxsum::DiscreteFunction,Policy>&>
+             (paramDist), varBegin, varEnd);
+      paramDist.lgammaRatio.expand(varBegin,varEnd);
+   }
+
+   /**
+    * Updates a cached parameter distribution given sufficient statistics for
+    * a sample drawn from the target distribution, and updates its cached
+    * log gamma ratio.
+    * @see observe(NormalGamma_Tmpl<RealType,Policy>&,const ValType,const ValType,const int)
+    */
+   template<class RealType, class ValType, class Policy>
+   typename boost::disable_if
+      < boost::is_base_of<maxsum::DiscreteFunction,RealType> >::type
+   observe
+   (
+    CachedNormalGamma_Tmpl<RealType,Policy>& paramDist,
+    const ValType sm,
+    const ValType s2,
+    const int n
+   )
+   {
+      updateLogGammaRatio<RealType,Policy>(paramDist.lgammaRatio,
+                                           paramDist.alpha, n);
+      observe(static_cast<NormalGamma_Tmpl<RealType,Policy>&>(paramDist),
+              sm, s2, n);
+   }
+
+   /**
+    * Updates a cached parameter distribution given sufficient statistics for
+    * a sample drawn from the target distribution, and updates its cached
+    * log gamma ratios.
+    * @see observe(NormalGamma_Tmpl<RealType,Policy>&,const ValType,const ValType,const int)
+    */
+   template<class RealType, class ValType, class Policy>
+   typename boost::enable_if
+      < boost::is_base_of<maxsum::DiscreteFunction,RealType> >::type
+   observe
+   (
+    CachedNormalGamma_Tmpl<RealType,Policy>& paramDist,
+    const ValType sm,
+    const ValType s2,
+    const int n
+   )
+   {
+      shareDomain(paramDist);
+      for(int k=0; k<paramDist.alpha.domainSize(); ++k)
+      {
+         updateLogGammaRatio<maxsum::ValType,Policy>(paramDist.lgammaRatio(k),
+                                                     paramDist.alpha(k), n);
+      }
+      observe(static_cast<NormalGamma_Tmpl<RealType,Policy>&>(paramDist),
+              sm, s2, n);
+   }
+
+   /**
+    * Updates a specific element of a cached parameter distribution given
+    * sufficient statistics for a sample drawn from the target distribution,
+    * and updates its cached log gamma ratio.
+    * @param[in] maxSteps largest n for which the log gamma ratio is updated
+    * by recurrence.
+    * @see observe(NormalGamma_Tmpl<maxsum::DiscreteFunction,Policy>&,IndexType,const ValType,const ValType,const int)
+    * @see updateLogGammaRatio
+    */
+   template<class IndexType, class ValType, class Policy> void observe
+   (
+    CachedNormalGamma_Tmpl<maxsum::DiscreteFunction,Policy>& paramDist,
+    IndexType index,
+    const ValType sm,
+    const ValType s2,
+    const int n,
+    const int maxSteps=MAX_RECURRENCE_STEPS
+   )
+   {
+      updateLogGammaRatio<maxsum::ValType,Policy>
+         (paramDist.lgammaRatio(index), paramDist.alpha(index), n, maxSteps);
+      observe<IndexType>
+         (static_cast<NormalGamma_Tmpl<maxsum::DiscreteFunction,Policy>&>
+          (paramDist), index, sm, s2, n);
+   }
+
+   /**
+    * Updates a cached parameter distribution given an observation drawn from
+    * its target distribution, and updates its cached log gamma ratio.
+    * @see observe(NormalGamma_Tmpl<RealType,Policy>&,ValType)
+    */
+   template<class RealType, class ValType, class Policy>
+   typename boost::disable_if
+      < boost::is_base_of<maxsum::DiscreteFunction,RealType> >::type
+   observe(CachedNormalGamma_Tmpl<RealType,Policy>& paramDist, ValType x)
+   {
+      updateLogGammaRatio<RealType,Policy>(paramDist.lgammaRatio,
+                                           paramDist.alpha, 1);
+      observe(static_cast<NormalGamma_Tmpl<RealType,Policy>&>(paramDist), x);
+   }
+
+   /**
+    * Updates a cached parameter distribution given an observation drawn from
+    * its target distribution, and updates its cached log gamma ratios.
+    * @see observe(NormalGamma_Tmpl<RealType,Policy>&,ValType)
+    */
+   template<class RealType, class ValType, class Policy>
+   typename boost::enable_if
+      < boost::is_base_of<maxsum::DiscreteFunction,RealType> >::type
+   observe(CachedNormalGamma_Tmpl<RealType,Policy>& paramDist, ValType x)
+   {
+      shareDomain(paramDist);
+      for(int k=0; k<paramDist.alpha.domainSize(); ++k)
+      {
+         updateLogGammaRatio<maxsum::ValType,Policy>(paramDist.lgammaRatio(k),
+                                                     paramDist.alpha(k), 1);
+      }
+      observe(static_cast<NormalGamma_Tmpl<RealType,Policy>&>(paramDist), x);
+   }
+
+   /**
+    * Updates a specific element of a cached parameter distribution given an
+    * observation drawn from its target distribution, and updates its cached
+    * log gamma ratio.
+    * @see observe(NormalGamma_Tmpl<maxsum::DiscreteFunction,Policy>&,maxsum::ValIndex,ValType)
+    */
+   template<class ValType, class Policy> void observe
+   (
+    CachedNormalGamma_Tmpl<maxsum::DiscreteFunction,Policy>& paramDist,
+    maxsum::ValIndex index,
+    ValType x
+   )
+   {
+      updateLogGammaRatio<maxsum::ValType,Policy>
+         (paramDist.lgammaRatio(index), paramDist.alpha(index), 1);
+      observe(static_cast<NormalGamma_Tmpl<maxsum::DiscreteFunction,Policy>&>
+              (paramDist), index, x);
+   }
+
+   /**
+    * The four hyperparameters of a single element of a vectorised
+    * Normal-Gamma distribution, packed into 32 bytes so that they can be
+    * read or written together in a single cache line.
+    * @see dec_brl::dist::InterleavedNormalGamma_Tmpl
+    */
+   struct NormalGammaRecord
+   {
+      /**
+       * The alpha hyperparameter.
+       */
+      maxsum::ValType alpha;
+
+      /**
+       * The beta hyperparameter.
+       */
+      maxsum::ValType beta;
+
+      /**
+       * The lambda hyperparameter.
+       */
+      maxsum::ValType lambda;
+
+      /**
+       * The m hyperparameter.
+       */
+      maxsum::ValType m;
+
+   }; // struct NormalGammaRecord
+
+   /**
+    * Returns the hyperparameters of a single element of a vectorised
+    * distribution, gathered from its separate hyperparameter arrays.
+    * Distributions that store hyperparameters in records overload this to
+    * return the stored record directly.
+    * @param[in] paramDist the distribution to read.
+    * @param[in] k linear index of the element to read.
+    */
+   template<class Dist> NormalGammaRecord getRecord
+   (
+    const Dist& paramDist,
+    const maxsum::ValIndex k
+   )
+   {
+      NormalGammaRecord result;
+      result.alpha = paramDist.alpha(k);
+      result.beta = paramDist.beta(k);
+      result.lambda = paramDist.lambda(k);
+      result.m = paramDist.m(k);
+      return result;
+   }
+
+   /**
+    * Scratch space used by observeBatch() to accumulate per-element
+    * sufficient statistics. Reusing the same scratch space across batches
+    * avoids allocating three domain-sized arrays for every batch. Between
+    * calls, every entry is zero, so it only needs to grow when the domain
+    * does.
+    */
+   struct ObserveBatchScratch
+   {
+      /**
+       * Number of observations of each element in the current batch.
+       */
+      std::vector<int> count;
+
+      /**
+       * Running sample mean of each element in the current batch.
+       */
+      std::vector<maxsum::ValType> mean;
+
+      /**
+       * Running sum of squared differences of each element in the current
+       * batch.
+       */
+      std::vector<maxsum::ValType> s2;
+
+   }; // struct ObserveBatchScratch
+
+   /**
+    * Applies a batched sufficient statistics update to a single element of
+    * an uncached distribution.
+    * @see observeBatch
+    */
+   template<class Policy> void observeBatchElement
+   (
+    NormalGamma_Tmpl<maxsum::DiscreteFunction,Policy>& paramDist,
+    const maxsum::ValIndex k,
+    const maxsum::ValType sm,
+    const maxsum::ValType s2,
+    const int n
+   )
+   {
+      observe<maxsum::ValIndex>(paramDist, k, sm, s2, n);
+   }
+
+   /**
+    * Applies a batched sufficient statistics update to a single element of
+    * a cached distribution, allowing the log gamma ratio recurrence to run
+    * for up to MAX_BATCH_RECURRENCE_STEPS half steps.
+    * @see observeBatch
+    */
+   template<class Policy> void observeBatchElement
+   (
+    CachedNormalGamma_Tmpl<maxsum::DiscreteFunction,Policy>& paramDist,
+    const maxsum::ValIndex k,
+    const maxsum::ValType sm,
+    const maxsum::ValType s2,
+    const int n
+   )
+   {
+      observe<maxsum::ValIndex>(paramDist, k, sm, s2, n,
+                                MAX_BATCH_RECURRENCE_STEPS);
+   }
+
+   /**
+    * Updates a vectorised parameter distribution given a batch of
+    * observations, each drawn from the target distribution of a specific
+    * element. All observations of the same element are folded into a
+    * single sufficient statistics update, which is then applied to each
+    * observed element in turn, in memory order. The result is the same (up
+    * to rounding) as observing each value in turn, but much faster when
+    * indices are repeated, particularly for cached distributions, whose
+    * log gamma ratio is then updated once per element rather than once per
+    * observation.
+    *
+    * The sample mean and sum of squared differences for each element are
+    * accumulated in a single pass using Welford's method, in scratch arrays
+    * with one entry per element of the distribution's domain. This is
+    * therefore best suited to batches that are not much smaller than the
+    * domain.
+    * @tparam Dist a vectorised Normal-Gamma distribution, such as
+    * NormalGamma_Tmpl<maxsum::DiscreteFunction>, or a cached or compact
+    * equivalent.
+    * @tparam Iterator iterator over pairs of maxsum::ValIndex and observed
+    * value, such as std::pair<maxsum::ValIndex,maxsum::ValType>.
+    * @param paramDist the parameter distribution to update.
+    * @param[in] begin iterator to the first observation.
+    * @param[in] end iterator to the end of the observations.
+    * @param scratch scratch space, which may be reused across calls, and
+    * is grown if it is smaller than the domain of paramDist.
+    * @see observe(NormalGamma_Tmpl<maxsum::DiscreteFunction,Policy>&,IndexType,const ValType,const ValType,const int)
+    */
+   template<class Dist, class Iterator> void observeBatch
+   (
+    Dist& paramDist,
+    Iterator begin,
+    Iterator end,
+    ObserveBatchScratch& scratch
+   )
+   {
+      //************************************************************************
+      // Grow the scratch space if necessary. New entries are zero, as are
+      // all existing ones, because they are reset after each batch.
+      //************************************************************************
+      const maxsum::ValIndex size = paramDist.m.domainSize();
+      if(static_cast<maxsum::ValIndex>(scratch.count.size())<size)
+      {
+         scratch.count.resize(size,0);
+         scratch.mean.resize(size,0.0);
+         scratch.s2.resize(size,0.0);
+      }
+      std::vector<int>& count = scratch.count;
+      std::vector<maxsum::ValType>& mean = scratch.mean;
+      std::vector<maxsum::ValType>& s2 = scratch.s2;
+
+      //************************************************************************
+      // Accumulate the number, mean and sum of squared differences of the
+      // observations for each element.
+      //************************************************************************
+      for(Iterator it=begin; it!=end; ++it)
+      {
+         const maxsum::ValIndex k = it->first;
+         const maxsum::ValType x = it->second;
+         assert( (0<=k) && (size>k) );
+
+         const maxsum::ValType diff = x - mean[k];
+         mean[k] += diff / ++count[k];
+         s2[k] += diff * (x - mean[k]);
+      }
+
+      //************************************************************************
+      // Apply a single update to each observed element, and reset its
+      // scratch entries for the next batch.
+      //************************************************************************
+      for(maxsum::ValIndex k=0; k<size; ++k)
+      {
+         if(0<count[k])
+         {
+            observeBatchElement(paramDist, k, mean[k], s2[k], count[k]);
+            count[k] = 0;
+            mean[k] = 0.0;
+            s2[k] = 0.0;
+         }
+      }
+
+   } // observeBatch
+
+   /**
+    * Updates a vectorised parameter distribution given a batch of
+    * observations, using temporary scratch space. Callers that observe many
+    * batches should reuse an ObserveBatchScratch instead.
+    * @see observeBatch(Dist&,Iterator,Iterator,ObserveBatchScratch&)
+    */
+   template<class Dist, class Iterator> void observeBatch
+   (
+    Dist& paramDist,
+    Iterator begin,
+    Iterator end
+   )
+   {
+      ObserveBatchScratch scratch;
+      observeBatch(paramDist, begin, end, scratch);
+   }
+
 } // namespace dist
 } // namespace dec_brl
 
@@ -0,0 +1,482 @@
+/**
+ * @file ReplayBuffer.h
+ * Defines a fixed capacity buffer of observed transitions, which can be
+ * replayed to a learner in minibatches.
+ */
+#ifndef DECBRL_REPLAYBUFFER_H
+#define DECBRL_REPLAYBUFFER_H
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <limits>
+#include <utility>
+#include <vector>
+#include "dec_brl/random.h"
+#include "dec_brl/FlatVarMap.h"
+#include "register.h"
+
+/**
+ * Namespace all public functions and types defined in the DecBRL library.
+ */
+namespace dec_brl {
+
+/**
+ * Ring buffer holding the most recent transitions observed by a learner,
+ * each consisting of prior states, actions, post states and factored
+ * rewards. Variable values are stored in a single array of StorageType, and
+ * rewards in a single array of doubles, so that a buffer holding many
+ * thousands of transitions needs no per-transition allocation.
+ *
+ * Stored transitions can be replayed to any learner that provides
+ * actGreedy() and observeGreedy(), such as dec_brl::DecQLearner or
+ * dec_brl::DecBayesQ_Tmpl, to make more use of each interaction with the
+ * environment. Each minibatch is ordered by post state, and the greedy
+ * actions for each distinct post state are calculated only once, rather
+ * than once per transition as a sequence of calls to observe() would.
+ *
+ * The set of state variables, action variables and rewarded factors is
+ * fixed by the first transition added, and must be the same for all later
+ * transitions.
+ * @tparam StorageType unsigned integer type used to store each variable
+ * value, which must be able to represent every value in each variable's
+ * domain.
+ */
+template<class StorageType=unsigned short> class ReplayBuffer_Tmpl
+{
+public:
+
+   /**
+    * Type used to pass factored rewards to learners.
+    */
+   typedef std::vector<std::pair<maxsum::FactorID,double> > RewardList;
+
+private:
+
+   /**
+    * Maximum number of transitions stored.
+    */
+   std::size_t capacity_i;
+
+   /**
+    * Number of transitions stored.
+    */
+   std::size_t size_i;
+
+   /**
+    * Index of the slot that the next transition will be written to.
+    */
+   std::size_t nextSlot_i;
+
+   /**
+    * State variables, in the order their values are stored.
+    */
+   std::vector<maxsum::VarID> stateVars_i;
+
+   /**
+    * Action variables, in the order their values are stored.
+    */
+   std::vector<maxsum::VarID> actionVars_i;
+
+   /**
+    * Rewarded factors, in the order their rewards are stored.
+    */
+   std::vector<maxsum::FactorID> factors_i;
+
+   /**
+    * Prior state, action, and post state values for each slot, stored in
+    * that order, one row per slot.
+    */
+   std::vector<StorageType> values_i;
+
+   /**
+    * Rewards for each slot, one row per slot.
+    */
+   std::vector<double> rewards_i;
+
+   /**
+    * Slots of the current minibatch.
+    */
+   std::vector<std::size_t> batch_i;
+
+   /**
+    * Prior states of the transition being replayed.
+    */
+   FlatVarMap priorMap_i;
+
+   /**
+    * Actions of the transition being replayed.
+    */
+   FlatVarMap actionMap_i;
+
+   /**
+    * Post states of the transitions being replayed.
+    */
+   FlatVarMap postMap_i;
+
+   /**
+    * Post states of the transitions being replayed, with their greedy
+    * actions.
+    */
+   FlatVarMap nextMap_i;
+
+   /**
+    * Rewards of the transition being replayed.
+    */
+   RewardList rewardList_i;
+
+   /**
+    * Orders slots by the values of their post states, compared
+    * lexicographically, and then by slot. Comparing the stored values
+    * directly, rather than a linear index of the joint post state, cannot
+    * overflow however large the joint state space is.
+    */
+   class PostStateLess
+   {
+   private:
+
+      /**
+       * Post state values of slot 0.
+       */
+      const StorageType* post_i;
+
+      /**
+       * Number of values stored for each slot.
+       */
+      std::size_t stride_i;
+
+      /**
+       * Number of state variables.
+       */
+      std::size_t noStates_i;
+
+   public:
+
+      /**
+       * Constructs a comparison for the specified buffer layout.
+       */
+      PostStateLess
+      (
+       const StorageType* post,
+       std::size_t stride,
+       std::size_t noStates
+      )
+      : post_i(post), stride_i(stride), noStates_i(noStates) {}
+
+      /**
+       * Returns true if slot s1 has the same post state as slot s2.
+       */
+      bool isSame(std::size_t s1, std::size_t s2) const
+      {
+         const StorageType* p1 = post_i + s1*stride_i;
+         return std::equal(p1, p1+noStates_i, post_i + s2*stride_i);
+      }
+
+      /**
+       * Returns true if slot s1 should be replayed before slot s2.
+       */
+      bool operator()(std::size_t s1, std::size_t s2) const
+      {
+         const StorageType* p1 = post_i + s1*stride_i;
+         const StorageType* p2 = post_i + s2*stride_i;
+         for(std::size_t k=0; k<noStates_i; ++k)
+         {
+            if(p1[k]!=p2[k])
+            {
+               return p1[k]<p2[k];
+            }
+         }
+         return s1<s2;
+      }
+
+   }; // class PostStateLess
+
+   /**
+    * Returns the number of values stored for each slot.
+    */
+   std::size_t rowSize() const
+   {
+      return 2*stateVars_i.size() + actionVars_i.size();
+   }
+
+   /**
+    * Records the variables and factors of the first transition, and
+    * allocates storage for the whole buffer.
+    */
+   template<class VarMap, class RewardMap> void init
+   (
+    const VarMap& states,
+    const VarMap& actions,
+    const RewardMap& rewards
+   )
+   {
+      for(typename VarMap::const_iterator it=states.begin();
+            it!=states.end(); ++it)
+      {
+         stateVars_i.push_back(it->first);
+      }
+      for(typename VarMap::const_iterator it=actions.begin();
+            it!=actions.end(); ++it)
+      {
+         actionVars_i.push_back(it->first);
+      }
+      for(typename RewardMap::const_iterator it=rewards.begin();
+            it!=rewards.end(); ++it)
+      {
+         factors_i.push_back(it->first);
+      }
+      values_i.resize(capacity_i*rowSize());
+      rewards_i.resize(capacity_i*factors_i.size());
+   }
+
+   /**
+    * Stores the values of the specified variables.
+    * @returns the position after the last value stored.
+    */
+   template<class VarMap> StorageType* store
+   (
+    const std::vector<maxsum::VarID>& vars,
+    const VarMap& vals,
+    StorageType* out
+   )
+   {
+      for(std::size_t k=0; k<vars.size(); ++k)
+      {
+         typename VarMap::const_iterator pos = vals.find(vars[k]);
+         assert(vals.end()!=pos);
+         assert(0<=pos->second);
+         assert(static_cast<unsigned long>(pos->second) <=
+               static_cast<unsigned long>
+               (std::numeric_limits<StorageType>::max()));
+         *out++ = static_cast<StorageType>(pos->second);
+      }
+      return out;
+   }
+
+   /**
+    * Loads the values of the specified variables into a map.
+    * @returns the position after the last value loaded.
+    */
+   const StorageType* load
+   (
+    const std::vector<maxsum::VarID>& vars,
+    const StorageType* in,
+    FlatVarMap& vals
+   ) const
+   {
+      vals.clear();
+      for(std::size_t k=0; k<vars.size(); ++k)
+      {
+         vals[vars[k]] = *in++;
+      }
+      return in;
+   }
+
+public:
+
+   /**
+    * Constructs an empty buffer.
+    * @param[in] capacity maximum number of transitions stored, after which
+    * each new transition replaces the oldest.
+    */
+   explicit ReplayBuffer_Tmpl(std::size_t capacity)
+   : capacity_i(capacity), size_i(0), nextSlot_i(0), stateVars_i(),
+     actionVars_i(), factors_i(), values_i(), rewards_i(), batch_i(),
+     priorMap_i(), actionMap_i(), postMap_i(), nextMap_i(), rewardList_i()
+   {
+      assert(0<capacity_i);
+   }
+
+   /**
+    * Returns the maximum number of transitions stored.
+    */
+   std::size_t capacity() const
+   {
+      return capacity_i;
+   }
+
+   /**
+    * Returns the number of transitions stored.
+    */
+   std::size_t size() const
+   {
+      return size_i;
+   }
+
+   /**
+    * Removes all transitions.
+    */
+   void clear()
+   {
+      size_i = 0;
+      nextSlot_i = 0;
+   }
+
+   /**
+    * Adds a transition, replacing the oldest if the buffer is full.
+    * The arguments are the same as for the observe() function of the
+    * learners.
+    * @tparam RewardMap maps maxsum::FactorID to rewards (double)
+    * @tparam VarMap maps maxsum::VarID to maxsum::ValIndex
+    */
+   template<class RewardMap, class VarMap> void add
+   (
+    const VarMap& priorStates,
+    const VarMap& actions,
+    const VarMap& postStates,
+    const RewardMap& rewards
+   )
+   {
+      if(stateVars_i.empty() && actionVars_i.empty())
+      {
+         init(priorStates,actions,rewards);
+      }
+      assert(priorStates.size()==stateVars_i.size());
+      assert(postStates.size()==stateVars_i.size());
+      assert(actions.size()==actionVars_i.size());
+      assert(rewards.size()==factors_i.size());
+
+      //************************************************************************
+      // Store the variable values.
+      //************************************************************************
+      StorageType* row = &values_i[nextSlot_i*rowSize()];
+      row = store(stateVars_i,priorStates,row);
+      row = store(actionVars_i,actions,row);
+      store(stateVars_i,postStates,row);
+
+      //************************************************************************
+      // Store the rewards.
+      //************************************************************************
+      double* rewardRow = &rewards_i[nextSlot_i*factors_i.size()];
+      for(std::size_t k=0; k<factors_i.size(); ++k)
+      {
+         typename RewardMap::const_iterator pos = rewards.find(factors_i[k]);
+         assert(rewards.end()!=pos);
+         rewardRow[k] = pos->second;
+      }
+
+      //************************************************************************
+      // Advance to the next slot.
+      //************************************************************************
+      nextSlot_i = (nextSlot_i+1) % capacity_i;
+      if(size_i<capacity_i)
+      {
+         ++size_i;
+      }
+
+   } // add
+
+   /**
+    * Retrieves a stored transition.
+    * @param[in] k index of the transition, from 0 for the oldest to size()-1
+    * for the most recent.
+    * @param[out] priorStates the prior states.
+    * @param[out] actions the actions.
+    * @param[out] postStates the post states.
+    * @param[out] rewards the factored rewards.
+    */
+   void get
+   (
+    std::size_t k,
+    FlatVarMap& priorStates,
+    FlatVarMap& actions,
+    FlatVarMap& postStates,
+    RewardList& rewards
+   ) const
+   {
+      assert(k<size_i);
+      const std::size_t slot = (nextSlot_i+capacity_i-size_i+k) % capacity_i;
+      const StorageType* row = &values_i[slot*rowSize()];
+      row = load(stateVars_i,row,priorStates);
+      row = load(actionVars_i,row,actions);
+      load(stateVars_i,row,postStates);
+
+      const double* rewardRow = &rewards_i[slot*factors_i.size()];
+      rewards.clear();
+      for(std::size_t j=0; j<factors_i.size(); ++j)
+      {
+         rewards.push_back(std::make_pair(factors_i[j],rewardRow[j]));
+      }
+   }
+
+   /**
+    * Replays a minibatch of stored transitions to a learner.
+    * Transitions are sampled uniformly with replacement, using
+    * dec_brl::random::unidrnd, and ordered by post state. For each distinct
+    * post state, the learner's greedy actions are found once with
+    * actGreedy(), and every transition to that state is then passed to
+    * observeGreedy(). Within a minibatch, the greedy actions for a post
+    * state are therefore fixed, but the values they select are read as they
+    * are updated.
+    * @tparam Learner learner type, such as dec_brl::DecQLearner or
+    * dec_brl::DecBayesQ_Tmpl.
+    * @param[in,out] learner the learner to update.
+    * @param[in] batchSize the number of transitions to replay.
+    * @returns the number of distinct post states in the minibatch, which is
+    * the number of calls made to actGreedy().
+    */
+   template<class Learner> int replay(Learner& learner, int batchSize)
+   {
+      if( (0==size_i) || (0>=batchSize) )
+      {
+         return 0;
+      }
+
+      //************************************************************************
+      // Sample the minibatch, and sort it by post state. Ties are broken by
+      // slot, so that the order does not depend on the sort algorithm.
+      //************************************************************************
+      const std::size_t stride = rowSize();
+      const std::size_t postOffset = stateVars_i.size()+actionVars_i.size();
+      const PostStateLess postLess(&values_i[0]+postOffset, stride,
+                                   stateVars_i.size());
+      batch_i.clear();
+      for(int k=0; k<batchSize; ++k)
+      {
+         batch_i.push_back(random::unidrnd(0,size_i-1));
+      }
+      std::sort(batch_i.begin(),batch_i.end(),postLess);
+
+      //************************************************************************
+      // Replay each transition, calculating greedy actions whenever the
+      // post state changes.
+      //************************************************************************
+      int noGreedy = 0;
+      for(std::size_t k=0; k<batch_i.size(); ++k)
+      {
+         const std::size_t slot = batch_i[k];
+         const StorageType* row = &values_i[slot*stride];
+
+         if( (0==k) || !postLess.isSame(batch_i[k-1],slot) )
+         {
+            load(stateVars_i,row+postOffset,postMap_i);
+            learner.actGreedy(postMap_i,nextMap_i);
+            nextMap_i.insert(postMap_i.begin(),postMap_i.end());
+            ++noGreedy;
+         }
+
+         row = load(stateVars_i,row,priorMap_i);
+         load(actionVars_i,row,actionMap_i);
+         const double* rewardRow = &rewards_i[slot*factors_i.size()];
+         rewardList_i.clear();
+         for(std::size_t j=0; j<factors_i.size(); ++j)
+         {
+            rewardList_i.push_back(std::make_pair(factors_i[j],rewardRow[j]));
+         }
+         learner.observeGreedy(priorMap_i,actionMap_i,nextMap_i,rewardList_i);
+      }
+      return noGreedy;
+
+   } // replay
+
+}; // class ReplayBuffer_Tmpl
+
+/**
+ * Convenience typedef for buffers that store each variable value in an
+ * unsigned short.
+ */
+typedef ReplayBuffer_Tmpl<> ReplayBuffer;
+
+} // namespace dec_brl
+
+#endif // DECBRL_REPLAYBUFFER_H
@@ -0,0 +1,213 @@
+/**
+ * @file SparseTrace.h
+ * Defines a sparse eligibility trace over the elements of a single factor.
+ */
+#ifndef DECBRL_SPARSETRACE_H
+#define DECBRL_SPARSETRACE_H
+
+#include <cassert>
+#include <cstddef>
+#include <utility>
+#include <vector>
+#include "common.h"
+
+/**
+ * Namespace all public functions and types defined in the DecBRL library.
+ */
+namespace dec_brl {
+
+/**
+ * Eligibility trace for the elements of a single factor, stored sparsely.
+ * Only elements whose trace is at least a cutoff value are kept, so if
+ * traces decay by a factor \f$\gamma\lambda<1\f$ on each step, and one
+ * element is set on each step, at most
+ * \f$1+\log(\mathrm{cutoff})/\log(\gamma\lambda)\f$ elements are ever
+ * active, however large the factor.
+ *
+ * Active elements are held in a dense array, which is iterated over to
+ * apply updates, and indexed by a small open-addressed hash table with
+ * linear probing, which is used to find an element when its trace is set.
+ * Both are rebuilt in place when elements fall below the cutoff, so once
+ * they have grown to their maximum size, no further memory is allocated.
+ */
+class SparseTrace
+{
+public:
+
+   /**
+    * Type of each active element: its linear index and trace.
+    */
+   typedef std::pair<maxsum::ValIndex,double> Entry;
+
+   /**
+    * Iterator over active elements.
+    */
+   typedef std::vector<Entry>::const_iterator const_iterator;
+
+private:
+
+   /**
+    * Marks an empty slot in table_i.
+    */
+   enum { EMPTY = -1 };
+
+   /**
+    * Active elements.
+    */
+   std::vector<Entry> entries_i;
+
+   /**
+    * Open-addressed hash table mapping linear indices to their position in
+    * entries_i. The size is always a power of two, and at least twice the
+    * number of active elements.
+    */
+   std::vector<int> table_i;
+
+   /**
+    * Returns the first slot to probe for a linear index.
+    */
+   std::size_t hash(maxsum::ValIndex index) const
+   {
+      // Fibonacci hashing spreads neighbouring indices across the table.
+      const unsigned long h = static_cast<unsigned long>(index)*2654435761ul;
+      return static_cast<std::size_t>(h) & (table_i.size()-1);
+   }
+
+   /**
+    * Returns the slot holding a linear index, or the empty slot at which
+    * it should be inserted.
+    */
+   std::size_t probe(maxsum::ValIndex index) const
+   {
+      std::size_t slot = hash(index);
+      while( (EMPTY!=table_i[slot]) &&
+             (entries_i[table_i[slot]].first!=index) )
+      {
+         slot = (slot+1) & (table_i.size()-1);
+      }
+      return slot;
+   }
+
+   /**
+    * Rebuilds the hash table from entries_i, growing it if necessary.
+    */
+   void rehash()
+   {
+      std::size_t size = table_i.empty() ? 8 : table_i.size();
+      while(size < 2*entries_i.size()+2)
+      {
+         size *= 2;
+      }
+      table_i.assign(size,EMPTY);
+      for(std::size_t k=0; k<entries_i.size(); ++k)
+      {
+         table_i[probe(entries_i[k].first)] = static_cast<int>(k);
+      }
+   }
+
+public:
+
+   /**
+    * Constructs an empty trace.
+    */
+   SparseTrace() : entries_i(), table_i(8,EMPTY) {}
+
+   /**
+    * Returns the number of active elements.
+    */
+   std::size_t size() const
+   {
+      return entries_i.size();
+   }
+
+   /**
+    * Returns an iterator to the first active element.
+    */
+   const_iterator begin() const
+   {
+      return entries_i.begin();
+   }
+
+   /**
+    * Returns an iterator to the end of the active elements.
+    */
+   const_iterator end() const
+   {
+      return entries_i.end();
+   }
+
+   /**
+    * Returns the trace of the specified element, which is zero if it is
+    * not active.
+    */
+   double operator()(maxsum::ValIndex index) const
+   {
+      const int pos = table_i[probe(index)];
+      return (EMPTY==pos) ? 0.0 : entries_i[pos].second;
+   }
+
+   /**
+    * Removes all active elements.
+    */
+   void clear()
+   {
+      entries_i.clear();
+      table_i.assign(table_i.size(),EMPTY);
+   }
+
+   /**
+    * Multiplies every trace by a decay factor, and removes elements whose
+    * trace is then less than the cutoff.
+    * @param[in] decay the decay factor, normally \f$\gamma\lambda\f$.
+    * @param[in] cutoff the smallest trace kept.
+    */
+   void decay(double decay, double cutoff)
+   {
+      std::size_t kept = 0;
+      for(std::size_t k=0; k<entries_i.size(); ++k)
+      {
+         const double trace = decay*entries_i[k].second;
+         if(cutoff<=trace)
+         {
+            entries_i[kept].first = entries_i[k].first;
+            entries_i[kept].second = trace;
+            ++kept;
+         }
+      }
+
+      if(kept<entries_i.size())
+      {
+         entries_i.resize(kept);
+         rehash();
+      }
+   }
+
+   /**
+    * Sets the trace of an element, which is activated if necessary.
+    * Setting the trace to one gives replacing traces.
+    */
+   void set(maxsum::ValIndex index, double trace)
+   {
+      const std::size_t slot = probe(index);
+      if(EMPTY!=table_i[slot])
+      {
+         entries_i[table_i[slot]].second = trace;
+         return;
+      }
+
+      entries_i.push_back(Entry(index,trace));
+      if(table_i.size() < 2*entries_i.size()+2)
+      {
+         rehash();
+      }
+      else
+      {
+         table_i[slot] = static_cast<int>(entries_i.size()-1);
+      }
+   }
+
+}; // class SparseTrace
+
+} // namespace dec_brl
+
+#endif // DECBRL_SPARSETRACE_H
@@ -0,0 +1,533 @@
+/**
+ * @file SparseTransBelief.h
+ * Defines class for representing Bayesian beliefs about factored transition
+ * probabilities using Diriclet conjugate priors, storing only observed
+ * counts.
+ */
+#ifndef DEC_BRL_SPARSE_TRANS_BELIEF_H
+#define DEC_BRL_SPARSE_TRANS_BELIEF_H
+
+#include <boost/random/gamma_distribution.hpp>
+#include "EigenWithPlugin.h"
+#include <algorithm>
+#include <map>
+#include <utility>
+#include <vector>
+#include "common.h"
+#include "register.h"
+#include "TransBelief.h"
+
+namespace dec_brl {
+
+    /**
+     * Represents Bayesian Beliefs about a factored transition CPT using
+     * Dirichlet conjugate priors, with the same interface as TransBelief.
+     * Every hyperparameter is the sum of a prior value, which is the same for
+     * all elements, and a count of observations. Only non-zero counts are
+     * stored, grouped by condition, so memory is proportional to the number
+     * of distinct observed transitions, rather than to the size of the CPT.
+     * The implicit prior is also exploited when calculating means and
+     * sampling, so that unobserved elements cost nothing beyond writing
+     * their output. CPTs may be sampled from these beliefs using
+     * SparseSampledTransProb, which is best used lazily for large tables.
+     */
+    class SparseTransBelief
+    {
+    private:
+
+        /**
+         * Observation counts for a single condition.
+         */
+        struct Column
+        {
+            /**
+             * Total number of observations for this condition.
+             */
+            double total;
+
+            /**
+             * Linear domain index and count of each observed element,
+             * sorted by domain index.
+             */
+            std::vector<std::pair<int,double> > counts;
+
+            /**
+             * Construct a column with no observations.
+             */
+            Column() : total(0), counts() {}
+        };
+
+        /**
+         * Type of map from linear condition index to observation counts.
+         */
+        typedef std::map<int,Column> ColumnMap;
+
+        /**
+         * Prior value of all hyperparameters.
+         */
+        double prior_i;
+
+        /**
+         * Observation counts for each observed condition.
+         */
+        ColumnMap columns_i;
+
+        /**
+         * Number of observed elements, over all conditions.
+         */
+        int noObserved_i;
+
+        /**
+         * Input (condition) variables for the Conditional Probability Table
+         */
+        Eigen::VectorXi condVars_i;
+
+        /**
+         * Domain size cache for condition variables.
+         */
+        Eigen::VectorXi condSize_i;
+
+        /**
+         * Output (domain) variables for the Conditional Probability Table.
+         */
+        Eigen::VectorXi domainVars_i;
+
+        /**
+         * Domain size cache for the domain variable sizes.
+         */
+        Eigen::VectorXi domainSize_i;
+
+        /**
+         * Total size of the conditional domain of the CPT.
+         */
+        int condSizeProd_i;
+
+        /**
+         * Total domain size of the CPT.
+         */
+        int domainSizeProd_i;
+
+        /**
+         * Statically allocated vector for storing conditional variable values.
+         * Putting this here avoids unnecessary temporary.
+         * @see SparseTransBelief::observeByMap
+         */
+        Eigen::VectorXi condValueCache_i;
+
+        /**
+         * Statically allocated vector for storing conditional variable values.
+         * Putting this here avoids unnecessary temporary.
+         * @see SparseTransBelief::observeByMap
+         */
+        Eigen::VectorXi domainValueCache_i;
+
+        /**
+         * Returns the observation counts for a condition, or NULL if there
+         * are none.
+         */
+        const Column* findColumn(int condInd) const
+        {
+            ColumnMap::const_iterator pos = columns_i.find(condInd);
+            if(columns_i.end()==pos)
+            {
+                return 0;
+            }
+            return &(pos->second);
+        }
+
+        /**
+         * Extract conditional variable values from map into the value cache.
+         */
+        template<class M1> void cacheCondValues(M1& condMap)
+        {
+            for(int k=0; k<condVars_i.size(); ++k)
+            {
+                int var = condVars_i[k];
+                int val = condMap[var];
+                condValueCache_i[k] = val;
+            }
+        }
+
+    public:
+
+        /**
+         * Let Sampled CPTs shared their parents domain.
+         */
+        template<class Belief> friend class SampledTransProb_Tmpl;
+
+        // Make new operator work with eigen3 library
+        EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+        /**
+         * Default prior value for alpha hyperparameters.
+         */
+        const static double DEFAULT_ALPHA;
+
+        /**
+         * Construct a belief distribution for a conditional probability
+         * table CPT with specified condition and domain variables.
+         * @pre condition and domain variable IDs must be registered with
+         * maxsum library.
+         * @tparam VecType1 vector type with size() returning number of
+         * contained elements of type maxsum::VarID, and [] operator providing
+         * access to each element.
+         * @tparam VecType2 same semantics as VecType2, but for 2nd parameter.
+         * @param cond vector of registered condition variable ids.
+         * @param domain vector of registered domain variable ids.
+         * @param priorAlpha prior value for all \f$\alpha_i\f$ hyperparameters.
+         */
+        template<class VecType1, class VecType2> SparseTransBelief
+        (
+         const VecType1& cond,
+         const VecType2& domain,
+         const double priorAlpha=DEFAULT_ALPHA
+        )
+        : prior_i(priorAlpha), columns_i(), noObserved_i(0),
+          condVars_i(cond.size()), condSize_i(cond.size()),
+          domainVars_i(domain.size()), domainSize_i(domain.size()),
+          condSizeProd_i(1), domainSizeProd_i(1),
+          condValueCache_i(cond.size()), domainValueCache_i(domain.size())
+        {
+            //******************************************************************
+            // Set conditional variables and cache their registered domain
+            // sizes.
+            //******************************************************************
+            for(int k=0; k<cond.size(); ++k)
+            {
+                condVars_i[k] = cond[k];
+                condSize_i[k] = maxsum::getDomainSize(cond[k]);
+                condSizeProd_i *= condSize_i[k];
+            }
+
+            //******************************************************************
+            // Do the same for the domain variables
+            //******************************************************************
+            for(int k=0; k<domain.size(); ++k)
+            {
+                domainVars_i[k] = domain[k];
+                domainSize_i[k] = maxsum::getDomainSize(domain[k]);
+                domainSizeProd_i *= domainSize_i[k];
+            }
+
+        } // constructor
+
+        /**
+         * Accessor method for a single Dirichlet hyperparameter.
+         * @param domainInd linear index of domain variables.
+         * @param condInd linear index of condition variables.
+         */
+        double getAlpha(int domainInd, int condInd) const
+        {
+            const Column* column = findColumn(condInd);
+            if(0==column)
+            {
+                return prior_i;
+            }
+            std::vector<std::pair<int,double> >::const_iterator pos =
+                std::lower_bound(column->counts.begin(), column->counts.end(),
+                                 std::make_pair(domainInd,0.0));
+            if( (column->counts.end()==pos) || (domainInd!=pos->first) )
+            {
+                return prior_i;
+            }
+            return prior_i + pos->second;
+        }
+
+        /**
+         * Returns the prior value of all hyperparameters.
+         */
+        double getPrior() const
+        {
+            return prior_i;
+        }
+
+        /**
+         * Set all hyperparameters to constant scalar, discarding all
+         * observations.
+         */
+        void setAlpha(double scalar)
+        {
+            prior_i = scalar;
+            columns_i.clear();
+            noObserved_i = 0;
+        }
+
+        /**
+         * Returns the number of hyperparameters that differ from the prior,
+         * which determines the memory used by this object.
+         */
+        int noObserved() const
+        {
+            return noObserved_i;
+        }
+
+        /**
+         * Returns the total size of the conditional domain of the CPT.
+         */
+        int condSize() const
+        {
+            return condSizeProd_i;
+        }
+
+        /**
+         * Returns the total domain size of the CPT.
+         */
+        int domainSize() const
+        {
+            return domainSizeProd_i;
+        }
+
+        /**
+         * Update beliefs based on observed condition and domain variables
+         * stored in associative arrays.
+         * @param condInd linear index of observed condition variables
+         * @param domainInd linear index of observed domain variables
+         */
+        void observeByInd(int condInd, int domainInd)
+        {
+            Column& column = columns_i[condInd];
+            std::vector<std::pair<int,double> >::iterator pos =
+                std::lower_bound(column.counts.begin(), column.counts.end(),
+                                 std::make_pair(domainInd,0.0));
+            if( (column.counts.end()==pos) || (domainInd!=pos->first) )
+            {
+                pos = column.counts.insert(pos,std::make_pair(domainInd,0.0));
+                ++noObserved_i;
+            }
+            pos->second += 1;
+            column.total += 1;
+        }
+
+        /**
+         * Update beliefs based on observed condition and domain variables,
+         * whose values are passed in vectors. Each vector is specifed by
+         * an iterator to the first and one past the last values.
+         * for example, std::vector::begin() and std::vector::end() qualify
+         * as valid iterators for this purpose.
+         */
+        template<class It1, class It2> void observeByVec
+            (It1 condStart, It1 condEnd, It2 domainStart, It2 domainEnd)
+        {
+            int condInd = maxsum::sub2ind(condSize_i.begin(), condSize_i.end(),
+                                          condStart, condEnd);
+
+            int domainInd = maxsum::sub2ind(domainSize_i.begin(),
+                                            domainSize_i.end(),
+                                            domainStart, domainEnd);
+
+            observeByInd(condInd, domainInd);
+        }
+
+        /**
+         * Update beliefs based on observed condition and domain variables
+         * stored in associative arrays. Each map should overload the
+         * [] operator s.t. <code>map[x]</code> is the value observed for
+         * the variable with maxsum::VarID <code>x</code>.
+         * @param condMap map of observed condition variable values
+         * @param domainMap map of observed observed domain variable values
+         */
+        template<class M1, class M2> void observeByMap
+        (
+         M1& condMap,
+         M2& domainMap
+        )
+        {
+            cacheCondValues(condMap);
+            for(int k=0; k<domainVars_i.size(); ++k)
+            {
+                domainValueCache_i[k] = domainMap[domainVars_i[k]];
+            }
+            observeByVec(condValueCache_i.begin(), condValueCache_i.end(),
+                         domainValueCache_i.begin(), domainValueCache_i.end());
+
+        } // observeByMap
+
+        /**
+         * Returns the expected CPT given the current beliefs. This
+         * materialises the whole table, so should only be used for small
+         * CPTs.
+         * @param[out] eigen object in which to store result.
+         */
+        template<class Derived>
+        void getMean(Eigen::DenseBase<Derived>& result)
+        {
+            //******************************************************************
+            //  Unobserved conditions have uniform means.
+            //******************************************************************
+            result.derived().resize(domainSizeProd_i,condSizeProd_i);
+            result.setConstant(1.0/domainSizeProd_i);
+
+            //******************************************************************
+            //  Fill in the columns for the observed conditions.
+            //******************************************************************
+            for(ColumnMap::const_iterator it=columns_i.begin();
+                it!=columns_i.end(); ++it)
+            {
+                const Column& column = it->second;
+                const double total = domainSizeProd_i*prior_i + column.total;
+                result.col(it->first).setConstant(prior_i/total);
+                for(std::size_t k=0; k<column.counts.size(); ++k)
+                {
+                    const std::pair<int,double>& cell = column.counts[k];
+                    result(cell.first,it->first) = (prior_i+cell.second)/total;
+                }
+            }
+        }
+
+        /**
+         * Get expected CPT for given condition (as linear column index).
+         * Unobserved conditions have uniform means, and the mean of each
+         * unobserved element is the same for any condition.
+         */
+        template<class Derived> void getMeanByInd
+        (
+         Eigen::DenseBase<Derived>& result,
+         int condInd
+        )
+        {
+            const Column* column = findColumn(condInd);
+            const double total = domainSizeProd_i*prior_i +
+                                 ((0==column) ? 0.0 : column->total);
+            result.derived().resize(domainSizeProd_i,1);
+            result.setConstant(prior_i/total);
+            if(0==column)
+            {
+                return;
+            }
+            for(std::size_t k=0; k<column->counts.size(); ++k)
+            {
+                const std::pair<int,double>& cell = column->counts[k];
+                result(cell.first) = (prior_i+cell.second)/total;
+            }
+        }
+
+        /**
+         * Get expected CPT for given vector of conditional variable values.
+         */
+        template<class It, class Derived> void getMeanByVec
+        (
+         Eigen::DenseBase<Derived>& result,
+         It condStart,
+         It condEnd
+        )
+        {
+            int condInd = maxsum::sub2ind(condSize_i.begin(), condSize_i.end(),
+                                          condStart, condEnd);
+            getMeanByInd(result, condInd);
+        }
+
+        /**
+         * Get expected CPT for given mapped conditional variables.
+         */
+        template<class M1, class Derived> void getMeanByMap
+        (
+         Eigen::DenseBase<Derived>& result,
+         M1& condMap
+        )
+        {
+            cacheCondValues(condMap);
+            getMeanByVec(result, condValueCache_i.begin(),
+                         condValueCache_i.end());
+
+        } // method getMeanByMap
+
+        /**
+         * Generate a sampled CPT from the Dirichlet distributions. This
+         * materialises the whole table, so should only be used for small
+         * CPTs. For large CPTs, use sampleColumn() to sample only the
+         * conditions that are needed.
+         * @tparam RandType boost::random UniformRandomNumberGenerator type.
+         * @tparam Derived eigen library type for output array.
+         * @param random random generator used to generate samples.
+         * @param[out] cpt the sampled conditional probability table.
+         */
+        template<class RandType, class Derived>
+        void sample
+        (
+         RandType& random,
+         Eigen::DenseBase<Derived>& cpt
+        ) const
+        {
+            cpt.derived().resize(domainSizeProd_i,condSizeProd_i);
+            for(int condInd=0; condInd<condSizeProd_i; ++condInd)
+            {
+                typename Derived::ColXpr column = cpt.derived().col(condInd);
+                sampleColumn(random,condInd,column);
+            }
+
+        } // method sample
+
+        /**
+         * Generate a single column of a sampled CPT from the Dirichlet
+         * distribution for the specified condition. Unobserved elements are
+         * all drawn from the same gamma distribution, whose parameters are
+         * only set once.
+         * @tparam RandType boost::random UniformRandomNumberGenerator type.
+         * @tparam Derived eigen library type for output vector, which may be
+         * a column of a larger matrix.
+         * @param random random generator used to generate samples.
+         * @param condInd linear index of the condition to sample.
+         * @param[out] column the sampled distribution over the domain, which
+         * must already have domainSize() elements.
+         */
+        template<class RandType, class Derived>
+        void sampleColumn
+        (
+         RandType& random,
+         int condInd,
+         Eigen::DenseBase<Derived>& column
+        ) const
+        {
+            using namespace boost::random;
+            typedef gamma_distribution<double>::param_type Params;
+
+            //******************************************************************
+            //  Walk through the domain, drawing unobserved elements from the
+            //  prior, and observed elements from their posterior.
+            //******************************************************************
+            const Column* observed = findColumn(condInd);
+            const std::size_t noCounts =
+                (0==observed) ? 0 : observed->counts.size();
+            gamma_distribution<double> prior(prior_i,1);
+            gamma_distribution<double> posterior;
+            std::size_t next = 0;
+            double total = 0.0;
+            for(int k=0; k<domainSizeProd_i; ++k)
+            {
+                if( (next<noCounts) && (k==observed->counts[next].first) )
+                {
+                    posterior.param
+                        (Params(prior_i+observed->counts[next].second,1));
+                    column(k) = posterior(random);
+                    ++next;
+                }
+                else
+                {
+                    column(k) = prior(random);
+                }
+                total += column(k);
+            }
+
+            //******************************************************************
+            //  Normalise to get the sampled distribution.
+            //******************************************************************
+            column /= total;
+
+        } // method sampleColumn
+
+    }; // class SparseTransBelief
+
+    /**
+     * Default prior value for alpha hyperparameters.
+     */
+    const double SparseTransBelief::DEFAULT_ALPHA = 1;
+
+    /**
+     * Transition probability matrix sampled from a SparseTransBelief.
+     */
+    typedef SampledTransProb_Tmpl<SparseTransBelief> SparseSampledTransProb;
+
+} // namespace dec_brl
+
+
+#endif // DEC_BRL_SPARSE_TRANS_BELIEF_H
@@ -0,0 +1,315 @@
+/**
+ * @file ThreadPool.h
+ * Defines a work-stealing thread pool that implements dec_brl::Executor.
+ */
+#ifndef DECBRL_THREADPOOL_H
+#define DECBRL_THREADPOOL_H
+
+#include <cstddef>
+#include <stdexcept>
+#include <vector>
+#include <boost/bind.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread.hpp>
+#include "dec_brl/Executor.h"
+
+/**
+ * Namespace all public functions and types defined in the DecBRL library.
+ */
+namespace dec_brl {
+
+/**
+ * Executor that runs tasks on a fixed set of worker threads.
+ * Each call to run() divides the task indices evenly between the workers.
+ * Each worker takes tasks one at a time from the front of its own range,
+ * and once its range is empty, steals the back half of another worker's
+ * remaining range, so that the load stays balanced when some tasks take much
+ * longer than others. The calling thread blocks until every task is
+ * complete.
+ *
+ * Only one thread may call run() at a time, and tasks must not call run()
+ * on the same pool.
+ */
+class ThreadPool : public Executor, private boost::noncopyable
+{
+private:
+
+   /**
+    * Range of task indices waiting to be run by one worker.
+    */
+   struct Range
+   {
+      /**
+       * Protects begin and end.
+       */
+      boost::mutex mutex;
+
+      /**
+       * Index of the next task to run.
+       */
+      std::size_t begin;
+
+      /**
+       * One past the index of the last task to run.
+       */
+      std::size_t end;
+
+      /**
+       * Constructs an empty range.
+       */
+      Range() : mutex(), begin(0), end(0) {}
+   };
+
+   /**
+    * Remaining range of task indices for each worker.
+    */
+   std::vector<boost::shared_ptr<Range> > ranges_i;
+
+   /**
+    * Worker threads.
+    */
+   boost::thread_group threads_i;
+
+   /**
+    * Protects all of the following members.
+    */
+   boost::mutex mutex_i;
+
+   /**
+    * Signalled when a new set of tasks is ready, or the pool is stopping.
+    */
+   boost::condition_variable start_i;
+
+   /**
+    * Signalled when the last busy worker finishes.
+    */
+   boost::condition_variable done_i;
+
+   /**
+    * Tasks currently being run.
+    */
+   Task* task_i;
+
+   /**
+    * Incremented for each call to run(), so that workers can tell when new
+    * tasks are ready.
+    */
+   unsigned long generation_i;
+
+   /**
+    * Number of workers still running the current tasks.
+    */
+   std::size_t noBusy_i;
+
+   /**
+    * True iff a task threw an exception during the current call to run().
+    */
+   bool hasFailed_i;
+
+   /**
+    * True iff the pool is being destroyed.
+    */
+   bool isStopping_i;
+
+   /**
+    * Finds the index of the next task for a worker to run, stealing from
+    * another worker if its own range is empty.
+    * @param[in] id the worker's index.
+    * @param[out] k the task index.
+    * @returns false iff no tasks remain.
+    */
+   bool next(std::size_t id, std::size_t& k)
+   {
+      Range& own = *ranges_i[id];
+      {
+         boost::mutex::scoped_lock lock(own.mutex);
+         if(own.begin<own.end)
+         {
+            k = own.begin++;
+            return true;
+         }
+      }
+
+      //************************************************************************
+      // Our own range is empty, so look for a victim, and take the back half
+      // of its range, starting with our neighbour.
+      //************************************************************************
+      const std::size_t noWorkers = ranges_i.size();
+      for(std::size_t v=1; v<noWorkers; ++v)
+      {
+         Range& victim = *ranges_i[(id+v)%noWorkers];
+         std::size_t stolenBegin, stolenEnd;
+         {
+            boost::mutex::scoped_lock lock(victim.mutex);
+            if(victim.begin>=victim.end)
+            {
+               continue;
+            }
+            stolenBegin = victim.begin + (victim.end-victim.begin)/2;
+            stolenEnd = victim.end;
+            victim.end = stolenBegin;
+         }
+
+         k = stolenBegin;
+         boost::mutex::scoped_lock lock(own.mutex);
+         own.begin = stolenBegin+1;
+         own.end = stolenEnd;
+         return true;
+      }
+      return false;
+   }
+
+   /**
+    * Main loop for each worker thread.
+    * @param[in] id the worker's index.
+    */
+   void work(std::size_t id)
+   {
+      unsigned long generation = 0;
+      while(true)
+      {
+         //*********************************************************************
+         // Wait for new tasks, or for the pool to stop.
+         //*********************************************************************
+         Task* task = 0;
+         {
+            boost::mutex::scoped_lock lock(mutex_i);
+            while(!isStopping_i && (generation==generation_i))
+            {
+               start_i.wait(lock);
+            }
+            if(isStopping_i)
+            {
+               return;
+            }
+            generation = generation_i;
+            task = task_i;
+         }
+
+         //*********************************************************************
+         // Run tasks until none remain.
+         //*********************************************************************
+         bool hasFailed = false;
+         std::size_t k;
+         while(next(id,k))
+         {
+            try
+            {
+               (*task)(k);
+            }
+            catch(...)
+            {
+               hasFailed = true;
+            }
+         }
+
+         boost::mutex::scoped_lock lock(mutex_i);
+         hasFailed_i = hasFailed_i || hasFailed;
+         if(0==--noBusy_i)
+         {
+            done_i.notify_all();
+         }
+      }
+   }
+
+public:
+
+   /**
+    * Constructs a pool with the specified number of worker threads.
+    * @param[in] noThreads number of worker threads, which defaults to the
+    * number of hardware threads.
+    */
+   explicit ThreadPool
+   (
+    std::size_t noThreads=boost::thread::hardware_concurrency()
+   )
+   : ranges_i(), threads_i(), mutex_i(), start_i(), done_i(), task_i(0),
+     generation_i(0), noBusy_i(0), hasFailed_i(false), isStopping_i(false)
+   {
+      if(0==noThreads)
+      {
+         noThreads = 1;
+      }
+      for(std::size_t k=0; k<noThreads; ++k)
+      {
+         ranges_i.push_back(boost::shared_ptr<Range>(new Range()));
+      }
+      for(std::size_t k=0; k<noThreads; ++k)
+      {
+         threads_i.create_thread(boost::bind(&ThreadPool::work,this,k));
+      }
+   }
+
+   /**
+    * Stops and joins all worker threads.
+    */
+   ~ThreadPool()
+   {
+      {
+         boost::mutex::scoped_lock lock(mutex_i);
+         isStopping_i = true;
+      }
+      start_i.notify_all();
+      threads_i.join_all();
+   }
+
+   /**
+    * Returns the number of worker threads.
+    */
+   std::size_t size() const
+   {
+      return ranges_i.size();
+   }
+
+   /**
+    * Runs tasks 0 to n-1 on the worker threads, and returns when they are
+    * all complete.
+    * @throws std::runtime_error if any task threw an exception, after all
+    * other tasks have completed.
+    */
+   void run(std::size_t n, Task& task)
+   {
+      if(0==n)
+      {
+         return;
+      }
+
+      //************************************************************************
+      // Divide the tasks evenly between workers. The workers are all idle,
+      // so this is safe, but we take the locks to publish the new ranges.
+      //************************************************************************
+      const std::size_t noWorkers = ranges_i.size();
+      for(std::size_t w=0; w<noWorkers; ++w)
+      {
+         boost::mutex::scoped_lock lock(ranges_i[w]->mutex);
+         ranges_i[w]->begin = n*w/noWorkers;
+         ranges_i[w]->end = n*(w+1)/noWorkers;
+      }
+
+      //************************************************************************
+      // Wake the workers, and wait for them to finish.
+      //************************************************************************
+      boost::mutex::scoped_lock lock(mutex_i);
+      task_i = &task;
+      noBusy_i = noWorkers;
+      hasFailed_i = false;
+      ++generation_i;
+      start_i.notify_all();
+      while(0<noBusy_i)
+      {
+         done_i.wait(lock);
+      }
+      task_i = 0;
+
+      if(hasFailed_i)
+      {
+         throw std::runtime_error("ThreadPool: task threw an exception");
+      }
+   }
+
+}; // class ThreadPool
+
+} // namespace dec_brl
+
+#endif // DECBRL_THREADPOOL_H
@@ -9,6 +9,8 @@
 #include <boost/random/gamma_distribution.hpp>
 #include  <boost/random/uniform_01.hpp>
 #include "EigenWithPlugin.h"
+#include <algorithm>
+#include <map>
 #include <vector>
 #include "common.h"
 #include "register.h"
@@ -30,8 +32,15 @@ namespace dec_brl {
      * allows the implmentation to be simple, efficient, and sufficient for
      * our purposes. Although making the class work beyond the lifetime of
      * the parent shouldn't be too difficult.
+     * @tparam Belief type of the parent parameter distribution, such as
+     * TransBelief or SparseTransBelief.
      */
-    class SampledTransProb;
+    template<class Belief> class SampledTransProb_Tmpl;
+    
+    /**
+     * Transition probability matrix sampled from a TransBelief.
+     */
+    typedef SampledTransProb_Tmpl<TransBelief> SampledTransProb;
     
     /**
      * Produce text representation of beliefs for diagnostics.
@@ -51,6 +60,12 @@ namespace dec_brl {
          */
         Eigen::MatrixXd alpha_i;
         
+        /**
+         * Sum of each column of alpha_i, maintained as observations are made,
+         * so that normalised means can be found without summing columns.
+         */
+        Eigen::RowVectorXd totals_i;
+        
         /**
          * Input (condition) variables for the Conditional Probability Table
          */
@@ -85,12 +100,35 @@ namespace dec_brl {
          */
         Eigen::VectorXi domainValueCache_i;
         
+        /**
+         * Stride of each condition variable in the linear condition index,
+         * so that the index of a row of values is its product with this.
+         */
+        Eigen::VectorXi condStrides_i;
+        
+        /**
+         * Stride of each domain variable in the linear domain index.
+         */
+        Eigen::VectorXi domainStrides_i;
+        
+        /**
+         * Statically allocated vector for storing linear condition indices.
+         * @see TransBelief::observeBulk
+         */
+        Eigen::VectorXi condIndCache_i;
+        
+        /**
+         * Statically allocated vector for storing linear domain indices.
+         * @see TransBelief::observeBulk
+         */
+        Eigen::VectorXi domainIndCache_i;
+        
     public:
         
         /**
          * Let Sampled CPTs shared their parents domain.
          */
-        friend SampledTransProb;
+        template<class Belief> friend class SampledTransProb_Tmpl;
         
         // Make new operator work with eigen3 library
         EIGEN_MAKE_ALIGNED_OPERATOR_NEW
@@ -119,27 +157,37 @@ namespace dec_brl {
          const VecType2& domain,
          const double priorAlpha=DEFAULT_ALPHA
         )
-        : alpha_i(), condVars_i(cond.size()), condSize_i(cond.size()),
+        : alpha_i(), totals_i(), condVars_i(cond.size()),
+          condSize_i(cond.size()),
           domainVars_i(domain.size()), domainSize_i(domain.size()),
-          condValueCache_i(cond.size()), domainValueCache_i(domain.size())
+          condValueCache_i(cond.size()), domainValueCache_i(domain.size()),
+          condStrides_i(cond.size()), domainStrides_i(domain.size()),
+          condIndCache_i(), domainIndCache_i()
         {
             //******************************************************************
             // Set conditional variables and cache their registered domain
-            // sizes.
+            // sizes and strides, with the first variable changing fastest,
+            // as in maxsum::sub2ind.
             //******************************************************************
+            int stride = 1;
             for(int k=0; k<cond.size(); ++k)
             {
                 condVars_i[k] = cond[k];
                 condSize_i[k] = maxsum::getDomainSize(cond[k]);
+                condStrides_i[k] = stride;
+                stride *= condSize_i[k];
             }
             
             //******************************************************************
             // Do the same for the domain variables
             //******************************************************************
+            stride = 1;
             for(int k=0; k<domain.size(); ++k)
             {
                 domainVars_i[k] = domain[k];
                 domainSize_i[k] = maxsum::getDomainSize(domain[k]);
+                domainStrides_i[k] = stride;
+                stride *= domainSize_i[k];
             }
             
             //******************************************************************
@@ -148,6 +196,7 @@ namespace dec_brl {
             //******************************************************************
             alpha_i.setConstant(domainSize_i.prod(), condSize_i.prod(),
                                 priorAlpha);
+            totals_i.setConstant(alpha_i.cols(), priorAlpha*alpha_i.rows());
             
         } // constructor
         
@@ -165,6 +214,15 @@ namespace dec_brl {
         void setAlpha(double scalar)
         {
             alpha_i.setConstant(scalar);
+            totals_i.setConstant(scalar*alpha_i.rows());
+        }
+        
+        /**
+         * Accessor for the sum of the hyperparameters for each condition.
+         */
+        const Eigen::RowVectorXd& getTotals() const
+        {
+            return totals_i;
         }
         
         /**
@@ -192,6 +250,7 @@ namespace dec_brl {
         void observeByInd(int condInd, int domainInd)
         {
             alpha_i(domainInd,condInd) += 1;
+            totals_i(condInd) += 1;
         }
         
         /**
@@ -256,6 +315,46 @@ namespace dec_brl {
         
         } // observeByMap
         
+        /**
+         * Update beliefs based on many observations at once. Each row of the
+         * input matrices holds one observation, with one column for each
+         * condition or domain variable, in the order passed to the
+         * constructor. The linear indices of all observations are found in a
+         * single matrix-vector product for each matrix, and the counts are
+         * then added to the hyperparameters, which is much faster than
+         * calling observeByVec or observeByMap for each observation.
+         * @tparam Derived1 eigen integer matrix type for condition values.
+         * @tparam Derived2 eigen integer matrix type for domain values.
+         * @param condVals observed condition variable values.
+         * @param domainVals observed domain variable values.
+         */
+        template<class Derived1, class Derived2> void observeBulk
+        (
+         const Eigen::MatrixBase<Derived1>& condVals,
+         const Eigen::MatrixBase<Derived2>& domainVals
+        )
+        {
+            eigen_assert(condVals.rows()==domainVals.rows());
+            eigen_assert(condVals.cols()==condStrides_i.size());
+            eigen_assert(domainVals.cols()==domainStrides_i.size());
+            
+            //******************************************************************
+            //  Find the linear indices of every observation.
+            //******************************************************************
+            condIndCache_i.noalias() = condVals * condStrides_i;
+            domainIndCache_i.noalias() = domainVals * domainStrides_i;
+            
+            //******************************************************************
+            //  Add the histogram of observed indices to the hyperparameters.
+            //******************************************************************
+            for(int k=0; k<condIndCache_i.size(); ++k)
+            {
+                alpha_i(domainIndCache_i[k],condIndCache_i[k]) += 1;
+                totals_i(condIndCache_i[k]) += 1;
+            }
+            
+        } // observeBulk
+        
         /**
          * Returns the expected CPT given the current beliefs.
          * @param[out] eigen object in which to store result.
@@ -264,7 +363,7 @@ namespace dec_brl {
         void getMean(Eigen::DenseBase<Derived>& result)
         {
             result.derived().resize(alpha_i.rows(),alpha_i.cols());
-            result=alpha_i.array().rowwise() / alpha_i.array().colwise().sum();
+            result = alpha_i.array().rowwise() / totals_i.array();
         }
         
         /**
@@ -276,8 +375,19 @@ namespace dec_brl {
          int condInd
         )
         {
-            result.derived().resize(1,alpha_i.cols());
-            result = alpha_i.col(condInd) / alpha_i.col(condInd).sum();
+            result.derived().resize(alpha_i.rows(),1);
+            result = alpha_i.col(condInd) / totals_i(condInd);
+        }
+        
+        /**
+         * Get the expected probability of a single element of the CPT, in
+         * constant time.
+         * @param domainInd linear index of domain variables.
+         * @param condInd linear index of condition variables.
+         */
+        double getMeanElement(int domainInd, int condInd) const
+        {
+            return alpha_i(domainInd,condInd) / totals_i(condInd);
         }
         
         /**
@@ -337,29 +447,59 @@ namespace dec_brl {
          RandType& random,
          Eigen::DenseBase<Derived>& cpt
         ) const
+        {
+            cpt.derived().resize(alpha_i.rows(),alpha_i.cols());
+            for(int condInd=0; condInd<alpha_i.cols(); ++condInd)
+            {
+                typename Derived::ColXpr column = cpt.derived().col(condInd);
+                sampleColumn(random,condInd,column);
+            }
+            
+        } // method sample
+        
+        /**
+         * Generate a single column of a sampled CPT from the Dirichlet
+         * distribution for the specified condition. Columns are independent,
+         * so sampling each column in turn gives a sample from the same
+         * distribution as sample().
+         * @tparam RandType boost::random UniformRandomNumberGenerator type.
+         * @tparam Derived eigen library type for output vector, which may be
+         * a column of a larger matrix.
+         * @param random random generator used to generate samples.
+         * @param condInd linear index of the condition to sample.
+         * @param[out] column the sampled distribution over the domain, which
+         * must already have domainSize() elements.
+         */
+        template<class RandType, class Derived>
+        void sampleColumn
+        (
+         RandType& random,
+         int condInd,
+         Eigen::DenseBase<Derived>& column
+        ) const
         {
             using namespace boost::random;
             //******************************************************************
             //  Initialise Random Sample using Gamma distribution independent
             //  variates.
             //******************************************************************
-            cpt.derived().resize(alpha_i.rows(),alpha_i.cols());
             gamma_distribution<double> gamrnd;
-            for(int k=0; k<cpt.size(); ++k)
+            double total = 0.0;
+            for(int k=0; k<alpha_i.rows(); ++k)
             {
-                gamma_distribution<double>::param_type params(alpha_i(k),1);
+                gamma_distribution<double>::param_type
+                    params(alpha_i(k,condInd),1);
                 gamrnd.param(params);
-                cpt(k) = gamrnd(random);
+                column(k) = gamrnd(random);
+                total += column(k);
             }
             
             //******************************************************************
             //  In theory, we now just need to normalise, and we're done.
             //******************************************************************
-            Eigen::Array<double, 1, Eigen::Dynamic> totals;
-            totals = cpt.colwise().sum();
-            cpt.derived().array().rowwise() /= totals;
+            column /= total;
             
-        } // method sample
+        } // method sampleColumn
         
         /**
          * Get << operator access to private members so that can be printed.
@@ -381,18 +521,80 @@ namespace dec_brl {
      * allows the implmentation to be simple, efficient, and sufficient for
      * our purposes. Although making the class work beyond the lifetime of
      * the parent shouldn't be too difficult.
+     *
+     * By default, next states are drawn by following the cumulative
+     * distribution of the relevant CPT column, which takes time linear in the
+     * domain size. Optionally, each column may instead be drawn from using a
+     * Walker alias table, which takes constant time per draw. Alias tables
+     * are built using Vose's method, the first time each column is drawn
+     * from after the CPT is sampled, so columns that are never visited cost
+     * nothing.
+     *
+     * The CPT may also be sampled lazily, in which case drawNewCPT() only
+     * discards the previous sample, and each column is sampled from the
+     * parent distribution the first time it is queried. The column is then
+     * reused until the next call to drawNewCPT(). Only the columns sampled
+     * since the last call to drawNewCPT() are stored, along with their alias
+     * tables. This reduces both the cost of sampling a model and its memory
+     * from the size of the table to the number of conditions visited, which
+     * is much smaller for large condition sets.
+     *
+     * The parent may be any belief type with the same interface as
+     * TransBelief, such as SparseTransBelief, which declares this class
+     * as a friend.
+     * @tparam Belief type of the parent parameter distribution.
      */
-    class SampledTransProb
+    template<class Belief> class SampledTransProb_Tmpl
     {
     private:
         
+        /**
+         * A lazily sampled column of the CPT, together with its alias
+         * table, which is only built if the column is drawn from using
+         * alias tables.
+         */
+        struct LazyColumn
+        {
+            /**
+             * Sampled distribution over the domain for this condition.
+             */
+            Eigen::VectorXd prob;
+            
+            /**
+             * Probability of keeping each domain value, rather than its
+             * alias.
+             */
+            Eigen::VectorXd aliasProb;
+            
+            /**
+             * Alias of each domain value.
+             */
+            Eigen::VectorXi alias;
+            
+            /**
+             * True if the alias table is valid for prob.
+             */
+            bool aliasBuilt;
+            
+            /**
+             * Construct a column that has not yet been sampled.
+             */
+            LazyColumn() : prob(), aliasProb(), alias(), aliasBuilt(false) {}
+        };
+        
+        /**
+         * Type of map from linear condition index to lazily sampled column.
+         */
+        typedef std::map<int,LazyColumn> LazyColumnMap;
+        
         /**
          * The transition belief object that created this object.
          */
-        const TransBelief& parent_i;
+        const Belief& parent_i;
         
         /**
          * The conditional probability CPT that defines this distribution.
+         * Empty if the CPT is lazy.
          */
         Eigen::MatrixXd cpt_i;
         
@@ -410,8 +612,161 @@ namespace dec_brl {
          */
         Eigen::VectorXi domainCache_i;
         
+        /**
+         * True if next states are drawn using alias tables.
+         */
+        bool useAlias_i;
+        
+        /**
+         * True if CPT columns are only sampled when they are queried.
+         */
+        bool lazy_i;
+        
+        /**
+         * Columns sampled since the last call to drawNewCPT, if the CPT is
+         * lazy. Memory is therefore proportional to the number of conditions
+         * visited, rather than to the size of the table.
+         */
+        LazyColumnMap lazyColumns_i;
+        
+        /**
+         * Probability of keeping each domain value, rather than its alias,
+         * for each column of the alias tables. Only used if the CPT is not
+         * lazy.
+         */
+        Eigen::MatrixXd aliasProb_i;
+        
+        /**
+         * Alias of each domain value, for each column of the alias tables.
+         * Only used if the CPT is not lazy.
+         */
+        Eigen::MatrixXi alias_i;
+        
+        /**
+         * Records which columns of the alias tables are valid for the
+         * current CPT. Only used if the CPT is not lazy.
+         */
+        std::vector<bool> aliasBuilt_i;
+        
+        /**
+         * Work list of under-full domain values used to build alias tables.
+         */
+        std::vector<int> small_i;
+        
+        /**
+         * Work list of over-full domain values used to build alias tables.
+         */
+        std::vector<int> large_i;
+        
+        /**
+         * Returns the linear index of the conditional distribution specified
+         * by mapped condition variable values.
+         */
+        template<class CondMap> int condIndex(CondMap& condVars)
+        {
+            for(int k=0; k<parent_i.condVars_i.size(); ++k)
+            {
+                int var = parent_i.condVars_i(k);
+                int val = condVars[var];
+                condCache_i(k) = val;
+            }
+            
+            return maxsum::sub2ind(parent_i.condSize_i.begin(),
+                                   parent_i.condSize_i.end(),
+                                   condCache_i.begin(),
+                                   condCache_i.end());
+        }
+        
+        /**
+         * Returns a column of a lazy CPT, sampling it first if it has not
+         * already been sampled.
+         * @param generator random generator used for sampling.
+         * @param condInd linear index of the column.
+         */
+        template<class Rand>
+        LazyColumn& lazyColumn(Rand& generator, int condInd)
+        {
+            typename LazyColumnMap::iterator pos =
+                lazyColumns_i.lower_bound(condInd);
+            if( (lazyColumns_i.end()==pos) || (condInd!=pos->first) )
+            {
+                pos = lazyColumns_i.insert(pos,
+                    typename LazyColumnMap::value_type(condInd,LazyColumn()));
+                pos->second.prob.resize(parent_i.domainSize());
+                parent_i.sampleColumn(generator,condInd,pos->second.prob);
+            }
+            return pos->second;
+        }
+        
+        /**
+         * Builds the alias table for a column of the current CPT, using
+         * Vose's method.
+         * @param[in] prob the column's probabilities.
+         * @param[out] aliasProb probability of keeping each domain value.
+         * @param[out] alias alias of each domain value.
+         */
+        void buildAlias(const double* prob, double* aliasProb, int* alias)
+        {
+            //******************************************************************
+            //  Scale the probabilities so that their mean is one, and split
+            //  the domain values into those below and above the mean.
+            //******************************************************************
+            const int n = parent_i.domainSize();
+            small_i.clear();
+            large_i.clear();
+            for(int k=0; k<n; ++k)
+            {
+                aliasProb[k] = prob[k]*n;
+                alias[k] = k;
+                if(1.0>aliasProb[k])
+                {
+                    small_i.push_back(k);
+                }
+                else
+                {
+                    large_i.push_back(k);
+                }
+            }
+            
+            //******************************************************************
+            //  Fill each under-full value's slot with an over-full value,
+            //  which gives up the probability needed to do so.
+            //******************************************************************
+            while(!small_i.empty() && !large_i.empty())
+            {
+                const int less = small_i.back();
+                const int more = large_i.back();
+                small_i.pop_back();
+                alias[less] = more;
+                aliasProb[more] += aliasProb[less] - 1.0;
+                if(1.0>aliasProb[more])
+                {
+                    large_i.pop_back();
+                    small_i.push_back(more);
+                }
+            }
+            
+            //******************************************************************
+            //  Any values left over are full, up to rounding error.
+            //******************************************************************
+            for(std::size_t k=0; k<small_i.size(); ++k)
+            {
+                aliasProb[small_i[k]] = 1.0;
+            }
+            for(std::size_t k=0; k<large_i.size(); ++k)
+            {
+                aliasProb[large_i[k]] = 1.0;
+            }
+            
+        } // function buildAlias
+        
     public:
         
+        /**
+         * Read only view of a single column of the CPT.
+         */
+        typedef Eigen::Map<const Eigen::VectorXd> ConstColumn;
+        
         // Make new operator work with eigen3 library
         EIGEN_MAKE_ALIGNED_OPERATOR_NEW
         
@@ -420,17 +775,93 @@ namespace dec_brl {
          * @tparam Rand Type of boost random generator used for sampling.
          * @param parent this object's parent parameter distribution.
          * @param generator random generator used for sampling.
+         * @param useAlias if true, next states are drawn using alias tables.
+         * @param lazy if true, CPT columns are only sampled when queried.
          */
         template<class Rand>
-        SampledTransProb(const TransBelief& parent, Rand& generator)
+        SampledTransProb_Tmpl
+        (
+         const Belief& parent,
+         Rand& generator,
+         bool useAlias=false,
+         bool lazy=false
+        )
         : parent_i(parent), cpt_i(), condCache_i(parent.condVars_i.size()),
-        domainCache_i(parent.domainVars_i.size())
+        domainCache_i(parent.domainVars_i.size()), useAlias_i(useAlias),
+        lazy_i(lazy), lazyColumns_i(), aliasProb_i(), alias_i(),
+        aliasBuilt_i(), small_i(), large_i()
         {
             drawNewCPT(generator);
         }
         
         /**
-         * Accessor to CPT.
+         * Chooses whether next states are drawn using alias tables, which
+         * take constant time per draw, or by following the cumulative
+         * distribution, which takes time linear in the domain size.
+         * Both give the same distribution, but not the same draws.
+         */
+        void setUseAlias(bool useAlias)
+        {
+            useAlias_i = useAlias;
+        }
+        
+        /**
+         * Returns true if next states are drawn using alias tables.
+         */
+        bool getUseAlias() const
+        {
+            return useAlias_i;
+        }
+        
+        /**
+         * Returns true if CPT columns are only sampled when queried.
+         * @see drawNewCPT
+         */
+        bool isLazy() const
+        {
+            return lazy_i;
+        }
+        
+        /**
+         * Returns true if the specified column of the CPT has been sampled
+         * since the last call to drawNewCPT(), which is always the case
+         * unless the CPT is lazy.
+         */
+        bool isColumnDrawn(int condInd) const
+        {
+            return !lazy_i || (0!=lazyColumns_i.count(condInd));
+        }
+        
+        /**
+         * Returns the number of columns currently stored for a lazy CPT.
+         */
+        int noColumnsDrawn() const
+        {
+            return lazy_i ? static_cast<int>(lazyColumns_i.size())
+                          : static_cast<int>(cpt_i.cols());
+        }
+        
+        /**
+         * Samples the specified column of the CPT if it has not already been
+         * sampled, and returns it. The result is valid until the next call
+         * to drawNewCPT().
+         * @param generator random generator used for sampling.
+         * @param condInd linear index of the condition.
+         */
+        template<class Rand>
+        ConstColumn getColumn(Rand& generator, int condInd)
+        {
+            if(lazy_i)
+            {
+                const LazyColumn& column = lazyColumn(generator,condInd);
+                return ConstColumn(column.prob.data(),column.prob.size());
+            }
+            return ConstColumn(cpt_i.col(condInd).data(),cpt_i.rows());
+        }
+        
+        /**
+         * Accessor to CPT. If the CPT is lazy, this is empty, and columns
+         * should be accessed using getColumn() instead.
          */
         const Eigen::MatrixXd& getCPT() const
         {
@@ -444,8 +875,23 @@ namespace dec_brl {
          */
         template<class Rand> void drawNewCPT(Rand& generator)
         {
+            //******************************************************************
+            //  Lazy CPTs just discard the old sample. Each column is sampled
+            //  when it is first queried.
+            //******************************************************************
+            if(lazy_i)
+            {
+                lazyColumns_i.clear();
+                return;
+            }
             parent_i.sample(generator,cpt_i);
             
+            //******************************************************************
+            //  Alias tables for the old CPT are no longer valid, and are only
+            //  rebuilt for columns that are drawn from.
+            //******************************************************************
+            aliasBuilt_i.assign(cpt_i.cols(),false);
+            
         } // function drawNewCPT
         
         /**
@@ -464,19 +910,52 @@ namespace dec_brl {
         )
         {
             //******************************************************************
-            //  Get linear index for conditional distribution
+            //  Get linear index for conditional distribution, and find its
+            //  probabilities and, if needed, its alias table.
             //******************************************************************
-            for(int k=0; k<parent_i.condVars_i.size(); ++k)
+            const int n = parent_i.domainSize();
+            int condInd = condIndex(condVars);
+            const double* prob = 0;
+            const double* aliasProb = 0;
+            const int* alias = 0;
+            if(lazy_i)
             {
-                int var = parent_i.condVars_i(k);
-                int val = condVars[var];
-                condCache_i(k) = val;
+                LazyColumn& column = lazyColumn(generator,condInd);
+                prob = column.prob.data();
+                if(useAlias_i)
+                {
+                    if(!column.aliasBuilt)
+                    {
+                        column.aliasProb.resize(n);
+                        column.alias.resize(n);
+                        buildAlias(prob,column.aliasProb.data(),
+                                   column.alias.data());
+                        column.aliasBuilt = true;
+                    }
+                    aliasProb = column.aliasProb.data();
+                    alias = column.alias.data();
+                }
+            }
+            else
+            {
+                prob = cpt_i.col(condInd).data();
+                if(useAlias_i)
+                {
+                    if(aliasProb_i.cols()!=cpt_i.cols())
+                    {
+                        aliasProb_i.resize(cpt_i.rows(),cpt_i.cols());
+                        alias_i.resize(cpt_i.rows(),cpt_i.cols());
+                    }
+                    aliasProb = aliasProb_i.col(condInd).data();
+                    alias = alias_i.col(condInd).data();
+                    if(!aliasBuilt_i[condInd])
+                    {
+                        buildAlias(prob,aliasProb_i.col(condInd).data(),
+                                   alias_i.col(condInd).data());
+                        aliasBuilt_i[condInd] = true;
+                    }
+                }
             }
-            
-            int condInd = maxsum::sub2ind(parent_i.condSize_i.begin(),
-                                          parent_i.condSize_i.end(),
-                                          condCache_i.begin(),
-                                          condCache_i.end());
             
             //******************************************************************
             //  Draw a number between 0 and 1
@@ -484,17 +963,31 @@ namespace dec_brl {
             boost::random::uniform_01<> unirnd;
             double draw = unirnd(generator);
             
-            //******************************************************************
-            //  follow the cumulative probability function up to the draw
-            //******************************************************************
             int domainInd = 0;
-            double cdf = 0.0;
-            for(; domainInd<parent_i.domainSize(); ++domainInd)
+            if(useAlias_i)
+            {
+                //**************************************************************
+                //  Use the draw to choose a slot uniformly, and the remainder
+                //  to choose between its value and its alias.
+                //**************************************************************
+                const double scaled = draw*n;
+                const int slot = std::min(static_cast<int>(scaled),n-1);
+                domainInd = (scaled-slot < aliasProb[slot]) ?
+                    slot : alias[slot];
+            }
+            else
             {
-                cdf += cpt_i(domainInd,condInd);
-                if(cdf>=draw)
+                //**************************************************************
+                //  follow the cumulative probability function up to the draw
+                //**************************************************************
+                double cdf = 0.0;
+                for(; domainInd<n; ++domainInd)
                 {
-                    break;
+                    cdf += prob[domainInd];
+                    if(cdf>=draw)
+                    {
+                        break;
+                    }
                 }
             }
             
@@ -512,7 +1005,7 @@ namespace dec_brl {
             
         } // function drawNextStates
         
-    }; // class TransProb
+    }; // class SampledTransProb_Tmpl
     
 } // namespace dec_brl
 
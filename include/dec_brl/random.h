@@ -1,6 +1,8 @@
 #ifndef DEC_BRL_RANDOM_H
 #define DEC_BRL_RANDOM_H
 
+#include <cmath>
+
 /**
  * A set of wrapper functions for random number generation.
  * These allow us to keep coupling to a minimum. For example
@@ -17,6 +19,102 @@ namespace dec_brl
        */
       void initRandomEngineByTime();
 
+      /**
+       * Opaque type of the random engine used by this library.
+       */
+      class Engine;
+
+      /**
+       * An independent stream of random numbers.
+       * By default, all functions in this namespace draw from a single
+       * engine shared by the whole process, which is not safe to use from
+       * more than one thread at once. Independent streams allow several
+       * learners to run concurrently, each with its own reproducible
+       * sequence: while a StreamScope is active in a thread, every function
+       * in this namespace called from that thread draws from its stream
+       * instead.
+       * @see dec_brl::random::StreamScope
+       */
+      class Stream
+      {
+      private:
+
+         friend class StreamScope;
+
+         /**
+          * The engine used to generate this stream.
+          */
+         Engine* engine_i;
+
+         /**
+          * Streams are not copyable.
+          */
+         Stream(const Stream&);
+
+         /**
+          * Streams are not assignable.
+          */
+         Stream& operator=(const Stream&);
+
+      public:
+
+         /**
+          * Constructs a stream with the specified seed.
+          */
+         explicit Stream(unsigned long seed);
+
+         /**
+          * Destructor.
+          */
+         ~Stream();
+
+         /**
+          * Restarts this stream with the specified seed.
+          */
+         void seed(unsigned long seed);
+
+      }; // class Stream
+
+      /**
+       * Redirects random number generation in the current thread to a
+       * stream, for the lifetime of this object. Scopes may be nested, in
+       * which case the previous stream is restored on destruction.
+       */
+      class StreamScope
+      {
+      private:
+
+         /**
+          * Engine used by this thread before this scope was entered, or 0
+          * if it was using the shared engine.
+          */
+         Engine* previous_i;
+
+         /**
+          * Scopes are not copyable.
+          */
+         StreamScope(const StreamScope&);
+
+         /**
+          * Scopes are not assignable.
+          */
+         StreamScope& operator=(const StreamScope&);
+
+      public:
+
+         /**
+          * Redirects random number generation in this thread to a stream.
+          * @pre the stream outlives this scope.
+          */
+         explicit StreamScope(Stream& stream);
+
+         /**
+          * Restores the previous stream for this thread.
+          */
+         ~StreamScope();
+
+      }; // class StreamScope
+
       /**
        * Generate integer from uniform distribution
        * over closed interval [min, max]
@@ -31,6 +129,144 @@ namespace dec_brl
        */
       double unirnd();
 
+      /**
+       * Generates standard normal variates from uniform variates, using the
+       * Box-Muller transform. Each pair of uniform variates produces two
+       * normal variates, so the second of each pair is kept for the next call.
+       * @tparam Uniform functor or function that returns uniform random
+       * numbers in the range [0,1), such as dec_brl::random::unirnd.
+       */
+      template<class Uniform> class NormalSampler
+      {
+      private:
+
+         /**
+          * Source of uniform random numbers.
+          */
+         Uniform& unirnd_i;
+
+         /**
+          * True iff spare_i holds a normal variate not yet returned.
+          */
+         bool hasSpare_i;
+
+         /**
+          * The second normal variate produced by the last transform.
+          */
+         double spare_i;
+
+      public:
+
+         /**
+          * Constructs a new sampler using the given uniform generator.
+          */
+         NormalSampler(Uniform& unirnd)
+         : unirnd_i(unirnd), hasSpare_i(false), spare_i(0) {}
+
+         /**
+          * Returns a standard normal variate.
+          */
+         double operator()()
+         {
+            if(hasSpare_i)
+            {
+               hasSpare_i = false;
+               return spare_i;
+            }
+            const double TWO_PI = 6.283185307179586;
+            const double radius = std::sqrt(-2*std::log(1-unirnd_i()));
+            const double angle = TWO_PI*unirnd_i();
+            spare_i = radius*std::sin(angle);
+            hasSpare_i = true;
+            return radius*std::cos(angle);
+         }
+
+      }; // class NormalSampler
+
+      /**
+       * Generates an array of standard normal variates.
+       * @tparam RealType scalar type of generated values.
+       * @tparam Uniform functor or function that returns uniform random
+       * numbers in the range [0,1), such as dec_brl::random::unirnd.
+       * @param[in] n number of values to generate.
+       * @param[out] out array of size \c n in which to store the values.
+       * @param[in] unirnd source of uniform random numbers.
+       */
+      template<class RealType, class Uniform> void normalVariates
+      (
+       const int n,
+       RealType* out,
+       Uniform& unirnd
+      )
+      {
+         NormalSampler<Uniform> normrnd(unirnd);
+         for(int k=0; k<n; ++k)
+         {
+            out[k] = normrnd();
+         }
+      }
+
+      /**
+       * Generates an array of variates from the Gamma distribution with
+       * the specified shape and unit scale, using Marsaglia and Tsang's
+       * method. For shape less than 1, we use the fact that
+       * \f$G_aU^{1/a}\f$ is Gamma distributed with shape \f$a\f$, if
+       * \f$G_a\f$ is Gamma distributed with shape \f$a+1\f$.
+       * @tparam RealType scalar type of generated values.
+       * @tparam Uniform functor or function that returns uniform random
+       * numbers in the range [0,1), such as dec_brl::random::unirnd.
+       * @param[in] n number of values to generate.
+       * @param[in] shape the shape parameter, which must be positive.
+       * @param[out] out array of size \c n in which to store the values.
+       * @param[in] unirnd source of uniform random numbers.
+       * @see Marsaglia & Tsang, A Simple Method for Generating Gamma Variables,
+       * ACM Transactions on Mathematical Software, 26(3), 2000.
+       */
+      template<class RealType, class Uniform> void gammaVariates
+      (
+       const int n,
+       const RealType shape,
+       RealType* out,
+       Uniform& unirnd
+      )
+      {
+         NormalSampler<Uniform> normrnd(unirnd);
+         const bool isBoosted = shape<1;
+         const double d = (isBoosted ? shape+1 : shape) - 1.0/3.0;
+         const double c = 1/std::sqrt(9*d);
+         for(int k=0; k<n; ++k)
+         {
+            //******************************************************************
+            // Rejection sampling, usually accepted on the first attempt.
+            //******************************************************************
+            double v = 0;
+            while(true)
+            {
+               double x = normrnd();
+               v = 1+c*x;
+               if(v<=0)
+               {
+                  continue;
+               }
+               v = v*v*v;
+               const double u = 1-unirnd(); // in range (0,1]
+               const double x2 = x*x;
+               if( (u < 1-0.0331*x2*x2) ||
+                   (std::log(u) < 0.5*x2+d*(1-v+std::log(v))) )
+               {
+                  break;
+               }
+            }
+            out[k] = d*v;
+
+            if(isBoosted)
+            {
+               out[k] *= std::pow(1-unirnd(),1/shape);
+            }
+         }
+
+      } // gammaVariates
+
    } // namespace random
 
 } // namespace dec_brl
@@ -8,11 +8,16 @@
 #include <cmath>
 #include <cassert>
 #include <limits>
+#include <algorithm>
+#include <vector>
 #include <boost/utility/enable_if.hpp>
 #include <boost/math/special_functions/gamma.hpp>
 #include "util.h"
+#include "random.h"
+#include "ConditionedView.h"
 #include "NonCentralT.h"
 #include "NormalGamma.h"
+#include "vpiAvx2.h"
 
 /**
  * Namespace all public functions and types defined in the DecBRL library.
@@ -275,6 +280,395 @@ namespace dec_brl
       
    } // vpi function
    
+   /**
+    * Finds the first and second best values in an array in a single pass.
+    * This gives the same result as calling maxsum::DiscreteFunction::argmax
+    * followed by maxsum::DiscreteFunction::argmax2, but reads the array once.
+    * @tparam RealType scalar type used for values.
+    * @param[in] n the number of values in the array.
+    * @param[in] m the array of values.
+    * @param[out] firstBestInd the index of the first occurrence of the
+    * largest value.
+    * @param[out] firstBestVal the largest value.
+    * @param[out] secondBestVal the largest value, excluding the value at
+    * firstBestInd. If \c n is 1, this is equal to firstBestVal.
+    * @pre n is greater than 0.
+    */
+   template<class RealType> void findBestTwo
+   (
+    const int n,
+    const RealType* m,
+    int& firstBestInd,
+    RealType& firstBestVal,
+    RealType& secondBestVal
+   )
+   {
+      assert(0<n);
+      firstBestInd = 0;
+      firstBestVal = m[0];
+      secondBestVal = -Limits<RealType>::infinity();
+      for(int k=1; k<n; ++k)
+      {
+         const RealType v = m[k];
+         if(firstBestVal<v)
+         {
+            secondBestVal = firstBestVal;
+            firstBestVal = v;
+            firstBestInd = k;
+         }
+         else if(secondBestVal<v)
+         {
+            secondBestVal = v;
+         }
+      }
+      if(1==n)
+      {
+         secondBestVal = firstBestVal;
+      }
+
+   } // findBestTwo
+
+   /**
+    * Calculates exact VPI for a batch of actions using
+    * dec_brl::avx2::exactVPIFast, if it is enabled and supports the array
+    * types and CDF mode. This version is used for all unsupported
+    * combinations, and does nothing.
+    * @returns true iff the kernel was used, in which case any results it
+    * could not calculate are NaN.
+    * @see dec_brl::exactVPIArrays for details of the parameters.
+    */
+   template<class RealType, class Array, class CdfMode> bool exactVPIAvx2
+   (
+    const int,
+    const Array&,
+    const Array&,
+    const Array&,
+    const RealType*,
+    const int,
+    const RealType,
+    const RealType,
+    RealType*,
+    const Array*,
+    CdfMode,
+    const RealType
+   )
+   {
+      return false;
+   }
+
+   /**
+    * Calculates exact VPI for a batch of actions using
+    * dec_brl::avx2::exactVPIFast, for contiguous double precision arrays
+    * with cached log gamma ratios in fast CDF mode.
+    * @returns true iff the kernel was used.
+    */
+   inline bool exactVPIAvx2
+   (
+    const int n,
+    const double* const& alpha,
+    const double* const& beta,
+    const double* const& lambda,
+    const double* m,
+    const int firstBestInd,
+    const double firstBestVal,
+    const double secondBestVal,
+    double* result,
+    const double* const* lgammaRatio,
+    dist::FastCdf,
+    const double epsilon
+   )
+   {
+      if( (0==lgammaRatio) || !avx2::isEnabled() )
+      {
+         return false;
+      }
+      avx2::exactVPIFast(n, alpha, beta, lambda, *lgammaRatio, 0, m,
+                         firstBestInd, firstBestVal, secondBestVal, epsilon,
+                         result);
+      return true;
+   }
+
+   /**
+    * Calculates exact VPI for a batch of actions using
+    * dec_brl::avx2::exactVPIFast, for conditioned views of double precision
+    * functions with cached log gamma ratios in fast CDF mode. The kernel
+    * gathers each hyperparameter through the views' shared layout.
+    * @returns true iff the kernel was used.
+    */
+   inline bool exactVPIAvx2
+   (
+    const int n,
+    const ConditionedView<maxsum::DiscreteFunction>& alpha,
+    const ConditionedView<maxsum::DiscreteFunction>& beta,
+    const ConditionedView<maxsum::DiscreteFunction>& lambda,
+    const double* m,
+    const int firstBestInd,
+    const double firstBestVal,
+    const double secondBestVal,
+    double* result,
+    const ConditionedView<maxsum::DiscreteFunction>* lgammaRatio,
+    dist::FastCdf,
+    const double epsilon
+   )
+   {
+      if( (0==lgammaRatio) || (0==n) || !avx2::isEnabled() )
+      {
+         return false;
+      }
+      const ConditionedLayout& layout = alpha.layout();
+      if( (&layout!=&beta.layout()) || (&layout!=&lambda.layout()) ||
+          (&layout!=&lgammaRatio->layout()) )
+      {
+         return false;
+      }
+      avx2::exactVPIFast(n, &alpha.function()(0), &beta.function()(0),
+                         &lambda.function()(0),
+                         &lgammaRatio->function()(0), layout.offsets(), m,
+                         firstBestInd, firstBestVal, secondBestVal, epsilon,
+                         result);
+      return true;
+   }
+
+   /**
+    * Calculates the Value of Perfect Information (VPI) analytically for a
+    * batch of actions, reading the alpha, beta, lambda and log gamma ratio
+    * hyperparameters through any random access array type, such as a raw
+    * pointer or dec_brl::ConditionedView. This allows VPI to be calculated
+    * directly from a factor's beliefs, conditioned on the current states,
+    * without first copying the conditioned hyperparameters.
+    * In fast CDF mode, with cached log gamma ratios in double precision
+    * arrays or views, elements are calculated four at a time by
+    * dec_brl::avx2::exactVPIFast if the processor supports it, and only
+    * those it cannot handle are calculated by the scalar loop.
+    * @tparam Array type with operator[] taking an element index, and
+    * returning a value convertible to RealType.
+    * @param[in] lgammaRatio pointer to an array of cached log gamma ratios,
+    * or null if these should be calculated using lgamma.
+    * @see the tagged version of dec_brl::exactVPIBatch for all other
+    * parameters.
+    */
+   template<class Policy, class RealType, class Array, class CdfMode>
+   void exactVPIArrays
+   (
+    const int n,
+    const Array& alpha,
+    const Array& beta,
+    const Array& lambda,
+    const RealType* m,
+    const int firstBestInd,
+    const RealType firstBestVal,
+    const RealType secondBestVal,
+    RealType* result,
+    const Array* lgammaRatio,
+    CdfMode mode,
+    const RealType epsilon=0
+   )
+   {
+      using namespace boost::math;
+
+      Policy policy; // Boost.Math policy used for calculations.
+
+      //************************************************************************
+      // Constant parts of the truncation bias, which were previously
+      // recalculated for every element.
+      //************************************************************************
+      const RealType LOG_2 = std::log(RealType(2.0));
+      const RealType LGAMMA_HALF = lgamma<RealType,Policy>(0.5, policy);
+
+      const bool isVectorised = exactVPIAvx2(n, alpha, beta, lambda, m,
+            firstBestInd, firstBestVal, secondBestVal, result, lgammaRatio,
+            mode, epsilon);
+
+      for(int k=0; k<n; ++k)
+      {
+         //*********************************************************************
+         // Skip elements already calculated by the AVX2 kernel, which leaves
+         // those it cannot handle set to NaN.
+         //*********************************************************************
+         if(isVectorised && (result[k]==result[k]))
+         {
+            continue;
+         }
+
+         //*********************************************************************
+         // Truncation bias undefined for alpha<0.5, so gain is infinite.
+         //*********************************************************************
+         const RealType a = alpha[k];
+         if(a<0.5)
+         {
+            result[k] = Limits<RealType>::infinity();
+            continue;
+         }
+         const RealType b = beta[k];
+         const RealType l = lambda[k];
+
+         //*********************************************************************
+         // The best action is compared with the 2nd best value, while all
+         // other actions are compared with the 1st best value.
+         //*********************************************************************
+         const bool isBest = (firstBestInd==k);
+         const RealType z = (isBest ? secondBestVal : firstBestVal) - m[k];
+
+         //*********************************************************************
+         // Skip elements whose VPI is bounded below epsilon by the variance
+         // bound. This is rearranged as var/(2*(sqrt(var+d^2)+d)) to avoid
+         // cancellation.
+         //*********************************************************************
+         if( (0<epsilon) && (1<a) )
+         {
+            const RealType d = isBest ? -z : z; // distance beyond the mean
+            const RealType var = b/(l*(a-1));
+            const RealType bound = 0.5*var/(std::sqrt(var+d*d)+d);
+            if(bound<epsilon)
+            {
+               result[k] = 0;
+               continue;
+            }
+         }
+
+         //*********************************************************************
+         // Log truncation bias: equivalent to truncationBias(dist,x), but
+         // using log1p directly on the fraction, rather than on exp(log(...)).
+         //*********************************************************************
+         RealType lnBias  = (0!=lgammaRatio) ? (*lgammaRatio)[k] :
+                  dist::logGammaRatio<RealType,Policy>(a);
+                  lnBias -= LGAMMA_HALF;
+                  lnBias += 0.5*(std::log(b/l)-LOG_2);
+                  lnBias += (0.5-a)*log1p(l*z*z/(2*b), policy);
+
+         //*********************************************************************
+         // The second term below is never positive, so the truncation bias
+         // is also an upper bound on VPI. This is much tighter than the
+         // variance bound in the tails, and lets us skip the CDF.
+         //*********************************************************************
+         RealType vpi = std::exp(lnBias);
+         if(vpi<epsilon)
+         {
+            result[k] = 0;
+            continue;
+         }
+
+         //*********************************************************************
+         // Standardised distance from the mean, for the mean marginal
+         // t distribution with 2*alpha degrees of freedom.
+         //*********************************************************************
+         const RealType t = z*std::sqrt(l*a/b);
+
+         //*********************************************************************
+         // Combine truncation bias with the expected difference in value.
+         // The true result is never negative, but approximation error in the
+         // fast CDF can take it slightly below zero, so we clamp it.
+         //*********************************************************************
+         if(isBest)
+         {
+            vpi += z*dist::studentsTCdf<RealType,Policy>(2*a,t,mode);
+         }
+         else
+         {
+            vpi -= z*dist::studentsTCdfComplement<RealType,Policy>(2*a,t,mode);
+         }
+         result[k] = std::max(RealType(0),vpi);
+
+      } // for loop
+
+   } // exactVPIArrays
+
+   /**
+    * Calculates the Value of Perfect Information (VPI) analytically for a
+    * batch of actions, whose Normal-Gamma hyperparameters are stored in
+    * separate contiguous arrays (structure of arrays form).
+    * The result is the same as calling the scalar version of exactVPI for
+    * each element in turn, but avoids constructing a scalar distribution per
+    * element, and hoists all constant terms out of the loop. With
+    * dec_brl::dist::ExactCdf, or without cached log gamma ratios, the loop
+    * is scalar: each element branches on its hyperparameters and pruning
+    * bounds, and calls scalar special functions (log gamma, log1p and the
+    * Student's t CDF), so the saving comes from avoiding per-element setup
+    * and, where epsilon is positive, from skipping those calls. With
+    * dec_brl::dist::FastCdf and cached log gamma ratios in double
+    * precision, dec_brl::avx2::exactVPIFast calculates four elements at a
+    * time on processors with AVX2 and FMA instructions.
+    * @tparam Policy Boost.Math policy used to calculate results. This effects
+    * result accuracy, but the default policy is normally suffice.
+    * @tparam RealType scalar type used for parameters and return values.
+    * @param[in] n the number of actions in the batch.
+    * @param[in] alpha array of alpha hyperparameters for each action.
+    * @param[in] beta array of beta hyperparameters for each action.
+    * @param[in] lambda array of lambda hyperparameters for each action.
+    * @param[in] m array of m hyperparameters (expected values) for each action.
+    * @param[in] firstBestInd index of the 1st best action in the batch.
+    * @param[in] firstBestVal the expected value of the 1st best action.
+    * @param[in] secondBestVal the expected value of the 2nd best action.
+    * @param[out] result array of size \c n in which to store the results.
+    * @param[in] lgammaRatio optional array of cached values of
+    * \f$\log\Gamma(\alpha-\frac{1}{2}) - \log\Gamma(\alpha)\f$ for each
+    * action. If null, these are calculated using lgamma.
+    * @param[in] mode tag selecting how the Student's t CDF is calculated:
+    * either dec_brl::dist::ExactCdf or dec_brl::dist::FastCdf. In fast mode,
+    * each result is within \f$|z|\f$ times FastCdf::MAX_ABS_ERROR of the
+    * exact result, where \f$z\f$ is the distance between the action's
+    * expected value and the value it is compared with. Results are never
+    * negative in either mode.
+    * @param[in] epsilon if positive, actions whose VPI is known to be less than
+    * epsilon are given a VPI of zero. Where possible, this is done without
+    * evaluating the truncation bias or CDF, using the bound
+    * \f$E[(X-c)^+] \leq \frac{1}{2}(\sqrt{\sigma^2+d^2}-d)\f$, which holds
+    * for any random variable with mean \f$c-d\f$, \f$d\geq0\f$, and
+    * variance \f$\sigma^2\f$. For the mean marginal,
+    * \f$\sigma^2=\frac{\beta}{\lambda(\alpha-1)}\f$, so only actions with
+    * \f$\alpha>1\f$ can be pruned this way. Otherwise, actions are pruned
+    * if their truncation bias, which is also an upper bound on VPI, is less
+    * than epsilon, which avoids evaluating the CDF. Each result is therefore
+    * within epsilon of its unpruned value.
+    * @see http://eprints.soton.ac.uk/273201/
+    * @see dec_brl::dist::CachedNormalGamma_Tmpl
+    */
+   template<class Policy, class RealType, class CdfMode> void exactVPIBatch
+   (
+    const int n,
+    const RealType* alpha,
+    const RealType* beta,
+    const RealType* lambda,
+    const RealType* m,
+    const int firstBestInd,
+    const RealType firstBestVal,
+    const RealType secondBestVal,
+    RealType* result,
+    const RealType* lgammaRatio,
+    CdfMode mode,
+    const RealType epsilon=0
+   )
+   {
+      exactVPIArrays<Policy>(n, alpha, beta, lambda, m, firstBestInd,
+                             firstBestVal, secondBestVal, result,
+                             (0!=lgammaRatio) ? &lgammaRatio : 0, mode,
+                             epsilon);
+   }
+
+   /**
+    * Calculates the Value of Perfect Information (VPI) analytically for a
+    * batch of actions, using the Boost.Math Student's t CDF.
+    * @see the tagged version of dec_brl::exactVPIBatch for details.
+    */
+   template<class Policy, class RealType> void exactVPIBatch
+   (
+    const int n,
+    const RealType* alpha,
+    const RealType* beta,
+    const RealType* lambda,
+    const RealType* m,
+    const int firstBestInd,
+    const RealType firstBestVal,
+    const RealType secondBestVal,
+    RealType* result,
+    const RealType* lgammaRatio=0
+   )
+   {
+      exactVPIBatch<Policy>(n, alpha, beta, lambda, m, firstBestInd,
+                            firstBestVal, secondBestVal, result, lgammaRatio,
+                            dist::ExactCdf());
+   }
+
    /**
     * Calculates the Value of Perfect Information (VPI) analytically for a value
     * function stored in a maxsum::DiscreteFunction object.
@@ -283,49 +677,359 @@ namespace dec_brl
     * @param[in] dist the parameter distribution for the action for which
     * VPI is to be calculated.
     * @param[out] result object in which to store result
+    * @param[in] mode tag selecting how the Student's t CDF is calculated:
+    * either dec_brl::dist::ExactCdf or dec_brl::dist::FastCdf.
+    * @param[in] epsilon if positive, VPI values that are bounded below epsilon
+    * are set to zero without being calculated.
     * @see http://eprints.soton.ac.uk/273201/
     */
-   template<class Policy> void exactVPI
+   template<class Policy, class CdfMode> void exactVPI
    (
     const dist::NormalGamma_Tmpl<maxsum::DiscreteFunction,Policy>& dist,
-    maxsum::DiscreteFunction& result
+    maxsum::DiscreteFunction& result,
+    CdfMode mode,
+    const maxsum::ValType epsilon=0
    )
    {
       using namespace boost::math;
       using namespace maxsum;
       using namespace dist;
-      
+
       //************************************************************************
-      // Find the first and second best actions for the function
+      // Find the first and second best actions for the function, in a single
+      // pass over the expected values.
       //************************************************************************
-      const ValIndex firstBestInd = dist.m.argmax();
-      const ValIndex secondBestInd = dist.m.argmax2(firstBestInd);
-      const ValType firstBestVal = dist.m(firstBestInd);
-      const ValType secondBestVal = dist.m(secondBestInd);
+      int firstBestInd = 0;
+      ValType firstBestVal = 0;
+      ValType secondBestVal = 0;
+      findBestTwo(dist.m.domainSize(), &dist.m(0), firstBestInd,
+                  firstBestVal, secondBestVal);
 
       //************************************************************************
-      // For now, we just iterate through and do this for each element
-      // separate. However, in future, we may find it more efficient to do this
-      // in one go using lazy evaluation and vectorised code.
+      // Calculate VPI for all elements in one go, reading the hyperparameter
+      // arrays directly.
       //************************************************************************
       result = dist.m; // get the correct domain (values will be overwritten)
-      for(int k=0; k<result.domainSize(); ++k)
+      exactVPIBatch<Policy>(result.domainSize(), &dist.alpha(0), &dist.beta(0),
+                            &dist.lambda(0), &dist.m(0), firstBestInd,
+                            firstBestVal, secondBestVal, &result(0),
+                            static_cast<const ValType*>(0), mode, epsilon);
+
+      //************************************************************************
+      // Sanity check result is greater than zero for all values
+      //************************************************************************
+      assert(result>=0);
+
+   } // vpi function
+
+   /**
+    * Calculates the Value of Perfect Information (VPI) analytically for a value
+    * function stored in a maxsum::DiscreteFunction object, using the
+    * Boost.Math Student's t CDF.
+    * @see the tagged version of dec_brl::exactVPI for details.
+    */
+   template<class Policy> void exactVPI
+   (
+    const dist::NormalGamma_Tmpl<maxsum::DiscreteFunction,Policy>& dist,
+    maxsum::DiscreteFunction& result
+   )
+   {
+      exactVPI(dist,result,dist::ExactCdf());
+   }
+
+   /**
+    * Calculates the Value of Perfect Information (VPI) analytically for a value
+    * function stored in a maxsum::DiscreteFunction object, using the log
+    * gamma ratios cached by the distribution, rather than calling lgamma.
+    * @tparam Policy Boost.Math policy used to calculate results. This effects
+    * result accuracy, but the default policy is normally suffice.
+    * @param[in] dist the parameter distribution for the action for which
+    * VPI is to be calculated.
+    * @param[out] result object in which to store result
+    * @param[in] mode tag selecting how the Student's t CDF is calculated:
+    * either dec_brl::dist::ExactCdf or dec_brl::dist::FastCdf.
+    * @param[in] epsilon if positive, VPI values that are bounded below epsilon
+    * are set to zero without being calculated.
+    * @see http://eprints.soton.ac.uk/273201/
+    */
+   template<class Policy, class CdfMode> void exactVPI
+   (
+    const dist::CachedNormalGamma_Tmpl<maxsum::DiscreteFunction,Policy>& dist,
+    maxsum::DiscreteFunction& result,
+    CdfMode mode,
+    const maxsum::ValType epsilon=0
+   )
+   {
+      using namespace maxsum;
+
+      //************************************************************************
+      // Find the first and second best actions for the function, in a single
+      // pass over the expected values.
+      //************************************************************************
+      int firstBestInd = 0;
+      ValType firstBestVal = 0;
+      ValType secondBestVal = 0;
+      findBestTwo(dist.m.domainSize(), &dist.m(0), firstBestInd,
+                  firstBestVal, secondBestVal);
+
+      //************************************************************************
+      // Calculate VPI for all elements in one go, using cached ratios.
+      //************************************************************************
+      result = dist.m; // get the correct domain (values will be overwritten)
+      exactVPIBatch<Policy>(result.domainSize(), &dist.alpha(0), &dist.beta(0),
+                            &dist.lambda(0), &dist.m(0), firstBestInd,
+                            firstBestVal, secondBestVal, &result(0),
+                            &dist.lgammaRatio(0), mode, epsilon);
+
+      //************************************************************************
+      // Sanity check result is greater than zero for all values
+      //************************************************************************
+      assert(result>=0);
+
+   } // vpi function
+
+   /**
+    * Calculates the Value of Perfect Information (VPI) analytically for a value
+    * function stored in a maxsum::DiscreteFunction object, using cached log
+    * gamma ratios and the Boost.Math Student's t CDF.
+    * @see the tagged version of dec_brl::exactVPI for details.
+    */
+   template<class Policy> void exactVPI
+   (
+    const dist::CachedNormalGamma_Tmpl<maxsum::DiscreteFunction,Policy>& dist,
+    maxsum::DiscreteFunction& result
+   )
+   {
+      exactVPI(dist,result,dist::ExactCdf());
+   }
+
+   /**
+    * Scratch space used by sampledVPIArrays() to hold the normal and gamma
+    * variates drawn for a batch. Reusing the same scratch space across
+    * batches avoids allocating two arrays of \c n*noSamples variates every
+    * time VPI is estimated, so it only needs to grow when the batch does.
+    * @tparam RealType scalar type of the variates.
+    */
+   template<class RealType> struct SampledVPIScratch_Tmpl
+   {
+      /**
+       * Standard normal variates for every sample of every action.
+       */
+      std::vector<RealType> z;
+
+      /**
+       * Gamma variates for every sample of every action, which are replaced
+       * by their inverse square roots before the gains are evaluated.
+       */
+      std::vector<RealType> g;
+
+   }; // struct SampledVPIScratch_Tmpl
+
+   /**
+    * Scratch space for sampled VPI with maxsum::ValType variates.
+    */
+   typedef SampledVPIScratch_Tmpl<maxsum::ValType> SampledVPIScratch;
+
+   /**
+    * Estimates the Value of Perfect Information (VPI) by Monte Carlo sampling
+    * for a batch of actions, reading the alpha, beta and lambda
+    * hyperparameters through any random access array type, such as a raw
+    * pointer or dec_brl::ConditionedView. The variates are drawn into the
+    * specified scratch space, which is grown if necessary.
+    * @tparam Array type with operator[] taking an element index, and
+    * returning a value convertible to RealType.
+    * @param[in,out] scratch space in which to store the variates.
+    * @see dec_brl::sampledVPIBatch for details of the other parameters.
+    */
+   template<class RealType, class Array, class Uniform> void sampledVPIArrays
+   (
+    const int n,
+    const Array& alpha,
+    const Array& beta,
+    const Array& lambda,
+    const RealType* m,
+    const int firstBestInd,
+    const RealType firstBestVal,
+    const RealType secondBestVal,
+    const int noSamples,
+    Uniform& unirnd,
+    RealType* result,
+    SampledVPIScratch_Tmpl<RealType>& scratch
+   )
+   {
+      assert(0<noSamples);
+
+      //************************************************************************
+      // Draw the standard normal and gamma variates for the whole batch.
+      //************************************************************************
+      const int total = n*noSamples;
+      if(scratch.z.size()<static_cast<std::size_t>(total))
       {
-         dist::NormalGamma_Tmpl<maxsum::ValType> scalarDist(dist.alpha(k),
-                                                            dist.beta(k),
-                                                            dist.lambda(k),
-                                                            dist.m(k));
-         
-         bool isBest = (firstBestInd==k);
-         result(k) = exactVPI(isBest, firstBestVal, secondBestVal, scalarDist);
+         scratch.z.resize(total);
+         scratch.g.resize(total);
       }
-      
+      RealType* const z = &scratch.z[0];
+      RealType* const g = &scratch.g[0];
+      random::normalVariates(total,z,unirnd);
+      for(int k=0; k<n; ++k)
+      {
+         random::gammaVariates(noSamples,alpha[k],g+k*noSamples,unirnd);
+      }
+
+      //************************************************************************
+      // Replace each gamma variate by its inverse square root in a separate
+      // pass, so that the gain loop below is only multiplies, adds and max.
+      //************************************************************************
+      for(int j=0; j<total; ++j)
+      {
+         g[j] = 1/std::sqrt(g[j]);
+      }
+
+      //************************************************************************
+      // For each action, the gain is the amount by which a sample falls
+      // below the 2nd best value (for the best action), or exceeds the 1st
+      // best value (for all other actions). Both are written as the positive
+      // part of sign*(sample-threshold), so the inner loop has no branches.
+      //************************************************************************
+      for(int k=0; k<n; ++k)
+      {
+         const bool isBest = (firstBestInd==k);
+         const RealType sign = isBest ? -1 : 1;
+         const RealType offset = sign*(m[k] -
+                                 (isBest ? secondBestVal : firstBestVal));
+         const RealType scale = sign*std::sqrt(beta[k]/lambda[k]);
+         const RealType* const zk = z+k*noSamples;
+         const RealType* const rk = g+k*noSamples;
+
+         RealType expGain = 0;
+         for(int j=0; j<noSamples; ++j)
+         {
+            expGain += std::max(RealType(0),offset + scale*zk[j]*rk[j]);
+         }
+         result[k] = expGain/noSamples;
+      }
+
+   } // sampledVPIArrays
+
+   /**
+    * Estimates the Value of Perfect Information (VPI) by Monte Carlo sampling
+    * for a batch of actions, using temporary scratch space.
+    * @see the scratch space version of dec_brl::sampledVPIArrays.
+    */
+   template<class RealType, class Array, class Uniform> void sampledVPIArrays
+   (
+    const int n,
+    const Array& alpha,
+    const Array& beta,
+    const Array& lambda,
+    const RealType* m,
+    const int firstBestInd,
+    const RealType firstBestVal,
+    const RealType secondBestVal,
+    const int noSamples,
+    Uniform& unirnd,
+    RealType* result
+   )
+   {
+      SampledVPIScratch_Tmpl<RealType> scratch;
+      sampledVPIArrays(n, alpha, beta, lambda, m, firstBestInd, firstBestVal,
+                       secondBestVal, noSamples, unirnd, result, scratch);
+   }
+
+   /**
+    * Estimates the Value of Perfect Information (VPI) by Monte Carlo sampling
+    * for a batch of actions, whose Normal-Gamma hyperparameters are stored in
+    * separate contiguous arrays (structure of arrays form).
+    * Rather than drawing each sample by inverting the t distribution's CDF,
+    * as NonCentralT_Tmpl does, all samples for the batch are drawn in bulk
+    * using the Normal-Gamma hierarchy: if \f$Z\f$ is standard normal and
+    * \f$G\f$ is Gamma distributed with shape \f$\alpha\f$, then
+    * \f$m + Z\sqrt{\beta/(\lambda G)}\f$ is a sample from the mean marginal.
+    * The gains are then evaluated in a single branch free loop over the
+    * samples, which compilers can vectorise.
+    * @tparam RealType scalar type used for parameters and return values.
+    * @tparam Uniform functor or function that returns uniform random
+    * numbers in the range [0,1), such as dec_brl::random::unirnd.
+    * @param[in] n the number of actions in the batch.
+    * @param[in] alpha array of alpha hyperparameters for each action.
+    * @param[in] beta array of beta hyperparameters for each action.
+    * @param[in] lambda array of lambda hyperparameters for each action.
+    * @param[in] m array of m hyperparameters (expected values) for each action.
+    * @param[in] firstBestInd index of the 1st best action in the batch.
+    * @param[in] firstBestVal the expected value of the 1st best action.
+    * @param[in] secondBestVal the expected value of the 2nd best action.
+    * @param[in] noSamples the number of samples used for each action.
+    * @param[in] unirnd source of uniform random numbers.
+    * @param[out] result array of size \c n in which to store the results.
+    * @see dec_brl::sampledVPI
+    */
+   template<class RealType, class Uniform> void sampledVPIBatch
+   (
+    const int n,
+    const RealType* alpha,
+    const RealType* beta,
+    const RealType* lambda,
+    const RealType* m,
+    const int firstBestInd,
+    const RealType firstBestVal,
+    const RealType secondBestVal,
+    const int noSamples,
+    Uniform& unirnd,
+    RealType* result
+   )
+   {
+      sampledVPIArrays(n, alpha, beta, lambda, m, firstBestInd, firstBestVal,
+                       secondBestVal, noSamples, unirnd, result);
+   }
+
+   /**
+    * Estimates the Value of Perfect Information (VPI) by Monte Carlo sampling
+    * for a value function stored in a maxsum::DiscreteFunction object.
+    * This is an alternative to dec_brl::exactVPI, which trades accuracy for
+    * speed on large action domains through the number of samples.
+    * @tparam Policy Boost.Math policy of the distribution.
+    * @tparam Uniform functor or function that returns uniform random
+    * numbers in the range [0,1), such as dec_brl::random::unirnd.
+    * @param[in] dist the parameter distribution for the action for which
+    * VPI is to be calculated.
+    * @param[out] result object in which to store result
+    * @param[in] noSamples the number of samples used for each action.
+    * @param[in] unirnd source of uniform random numbers.
+    * @see dec_brl::sampledVPIBatch
+    */
+   template<class Policy, class Uniform> void sampledVPI
+   (
+    const dist::NormalGamma_Tmpl<maxsum::DiscreteFunction,Policy>& dist,
+    maxsum::DiscreteFunction& result,
+    const int noSamples,
+    Uniform& unirnd
+   )
+   {
+      using namespace maxsum;
+
+      //************************************************************************
+      // Find the first and second best actions for the function
+      //************************************************************************
+      int firstBestInd = 0;
+      ValType firstBestVal = 0;
+      ValType secondBestVal = 0;
+      findBestTwo(dist.m.domainSize(), &dist.m(0), firstBestInd,
+                  firstBestVal, secondBestVal);
+
+      //************************************************************************
+      // Estimate VPI for all elements in one go.
+      //************************************************************************
+      result = dist.m; // get the correct domain (values will be overwritten)
+      sampledVPIBatch(result.domainSize(), &dist.alpha(0), &dist.beta(0),
+                      &dist.lambda(0), &dist.m(0), firstBestInd, firstBestVal,
+                      secondBestVal, noSamples, unirnd, &result(0));
+
       //************************************************************************
       // Sanity check result is greater than zero for all values
       //************************************************************************
       assert(result>=0);
-      
-   } // vpi function
+
+   } // sampledVPI
 
 } // namespace dec_brl
 
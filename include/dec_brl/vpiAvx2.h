@@ -0,0 +1,98 @@
+/**
+ * @file vpiAvx2.h
+ * Declares a batched exact VPI kernel that uses AVX2 and FMA instructions,
+ * where the processor supports them, for the fast CDF mode.
+ */
+#ifndef DECBRL_VPI_AVX2_H
+#define DECBRL_VPI_AVX2_H
+
+/**
+ * Namespace all public functions and types defined in the DecBRL library.
+ */
+namespace dec_brl {
+
+/**
+ * Namespace for functions that use AVX2 and FMA instructions. These are
+ * compiled for those instructions individually, rather than by setting
+ * architecture flags for the whole build, and are only called once
+ * isEnabled() has confirmed that the processor supports them.
+ */
+namespace avx2 {
+
+   /**
+    * Returns true iff the processor supports AVX2 and FMA instructions,
+    * and this library was built with a compiler that can target them.
+    */
+   bool isSupported();
+
+   /**
+    * Returns true iff dec_brl::exactVPIArrays should use exactVPIFast()
+    * where it can. This is initially equal to isSupported().
+    */
+   bool isEnabled();
+
+   /**
+    * Enables or disables the use of exactVPIFast() by
+    * dec_brl::exactVPIArrays, which is useful for comparing it with the
+    * scalar path. This should not be called while VPI is being calculated
+    * in another thread.
+    * @param[in] enable true to use the kernel where possible. This is
+    * ignored if the kernel is not supported.
+    * @returns the previous value of isEnabled().
+    */
+   bool setEnabled(bool enable);
+
+   /**
+    * Calculates exact VPI for a batch of actions four at a time, using the
+    * fast Student's t CDF described in dec_brl::dist::FastCdf_Tmpl.
+    * The log, log1p, exp and atan functions are evaluated with branch free
+    * polynomial approximations, and the Student's t CDF series is summed
+    * for all four actions at once, up to the largest number of terms
+    * needed by any of them. For more than FastCdf_Tmpl::MAX_SERIES_DF
+    * degrees of freedom, the normal CDF is approximated using Abramowitz
+    * and Stegun (7.1.26), which keeps the total error within
+    * FastCdf_Tmpl::MAX_ABS_ERROR.
+    *
+    * Actions with alpha below 0.5 are given infinite VPI, as in the scalar
+    * path. Actions whose degrees of freedom are not integers are skipped,
+    * because the fast CDF falls back on Boost.Math for these, and their
+    * results are set to NaN so that the caller can calculate them itself.
+    * @param[in] n the number of actions in the batch.
+    * @param[in] alpha array of alpha hyperparameters.
+    * @param[in] beta array of beta hyperparameters.
+    * @param[in] lambda array of lambda hyperparameters.
+    * @param[in] lgammaRatio array of cached log gamma ratios.
+    * @param[in] index if not null, the k-th action's hyperparameters are
+    * read from element index[k] of each of the previous arrays, rather than
+    * element k.
+    * @param[in] m array of expected values for each action.
+    * @param[in] firstBestInd index of the 1st best action in the batch.
+    * @param[in] firstBestVal the expected value of the 1st best action.
+    * @param[in] secondBestVal the expected value of the 2nd best action.
+    * @param[in] epsilon if positive, VPI values that are known to be less
+    * than epsilon are set to zero.
+    * @param[out] result array of size \c n in which to store the results.
+    * @pre isSupported() returns true.
+    * @see dec_brl::exactVPIArrays
+    */
+   void exactVPIFast
+   (
+    const int n,
+    const double* alpha,
+    const double* beta,
+    const double* lambda,
+    const double* lgammaRatio,
+    const int* index,
+    const double* m,
+    const int firstBestInd,
+    const double firstBestVal,
+    const double secondBestVal,
+    const double epsilon,
+    double* result
+   );
+
+} // namespace avx2
+
+} // namespace dec_brl
+
+#endif // DECBRL_VPI_AVX2_H
@@ -11,6 +11,24 @@
 #include <boost/random/uniform_01.hpp>
 #include "dec_brl/random.h"
 
+/**
+ * Random engine used by this library.
+ */
+class dec_brl::random::Engine
+{
+public:
+
+   /**
+    * The underlying generator.
+    */
+   boost::random::mt19937 gen;
+
+   /**
+    * Constructs an engine with the specified seed.
+    */
+   explicit Engine(unsigned long seed) : gen(seed) {}
+};
+
 /**
  * Module namespace defines objects used for random
  * number generation.
@@ -19,6 +37,24 @@ namespace
 {
    boost::random::mt19937 gen_m;
 
+   /**
+    * Engine used by the current thread, or 0 to use gen_m.
+    * Engines are owned by their streams, so a plain thread local pointer
+    * suffices. Unlike boost::thread_specific_ptr, it needs no cleanup
+    * function to stop the engine being deleted when the thread exits, and
+    * reading it on every draw is a single thread local load rather than a
+    * call into boost_thread.
+    */
+   __thread dec_brl::random::Engine* current_m = 0;
+
+   /**
+    * Returns the generator used by the current thread.
+    */
+   boost::random::mt19937& generator()
+   {
+      return (0==current_m) ? gen_m : current_m->gen;
+   }
+
 } // module namespace
 
 /**
@@ -29,6 +65,46 @@ void dec_brl::random::initRandomEngineByTime()
    gen_m.seed(std::time(0));
 }
 
+/**
+ * Constructs a stream with the specified seed.
+ */
+dec_brl::random::Stream::Stream(unsigned long seed)
+: engine_i(new Engine(seed))
+{}
+
+/**
+ * Destructor.
+ */
+dec_brl::random::Stream::~Stream()
+{
+   delete engine_i;
+}
+
+/**
+ * Restarts this stream with the specified seed.
+ */
+void dec_brl::random::Stream::seed(unsigned long seed)
+{
+   engine_i->gen.seed(seed);
+}
+
+/**
+ * Redirects random number generation in this thread to a stream.
+ */
+dec_brl::random::StreamScope::StreamScope(Stream& stream)
+: previous_i(current_m)
+{
+   current_m = stream.engine_i;
+}
+
+/**
+ * Restores the previous stream for this thread.
+ */
+dec_brl::random::StreamScope::~StreamScope()
+{
+   current_m = previous_i;
+}
+
 /**
  * Generate integer from uniform distribution
  * over closed interval [min, max]
@@ -39,7 +115,7 @@ void dec_brl::random::initRandomEngineByTime()
 int dec_brl::random::unidrnd(int min, int max)
 {
    boost::random::uniform_int_distribution<> dist(min, max);
-   return dist(gen_m);
+   return dist(generator());
 }
 
 /**
@@ -48,6 +124,5 @@ int dec_brl::random::unidrnd(int min, int max)
 double dec_brl::random::unirnd()
 {
    boost::random::uniform_01<> dist;
-   return dist(gen_m);
+   return dist(generator());
 }
-
@@ -0,0 +1,577 @@
+/**
+ * @file vpiAvx2.cpp
+ * Implementation of the AVX2 exact VPI kernel declared in vpiAvx2.h.
+ * Each function that uses AVX2 or FMA instructions is compiled for them
+ * through its own target attribute, so the rest of the library, and any
+ * processor without them, is unaffected.
+ */
+
+#include <limits>
+#include "dec_brl/vpiAvx2.h"
+#include "dec_brl/NonCentralT.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define DECBRL_AVX2_KERNEL
+#define DECBRL_AVX2_TARGET __attribute__((target("avx2,fma")))
+#include <immintrin.h>
+#endif
+
+/**
+ * Module namespace defines the vectorised special functions used by the
+ * kernel.
+ */
+namespace
+{
+   /**
+    * True iff dec_brl::exactVPIArrays should use the kernel where it can.
+    */
+   bool isEnabled_m = dec_brl::avx2::isSupported();
+
+   /**
+    * Fast CDF mode used for the kernel's degrees of freedom limits.
+    */
+   typedef dec_brl::dist::FastCdf_Tmpl<double> Mode;
+
+#ifdef DECBRL_AVX2_KERNEL
+
+   /**
+    * Natural logarithm of four positive, normal or infinite values.
+    * The argument is split into \f$2^e f\f$, with \f$f\f$ in
+    * \f$[\frac{1}{\sqrt{2}},\sqrt{2})\f$, and \f$\log f\f$ is calculated
+    * using the polynomial from fdlibm's e_log.c, which is accurate to
+    * within 1 ulp.
+    */
+   DECBRL_AVX2_TARGET inline __m256d log4(const __m256d x)
+   {
+      const __m256d ONE = _mm256_set1_pd(1.0);
+      const __m256d TWO52 = _mm256_set1_pd(4503599627370496.0);
+      const __m256d LN2_HI = _mm256_set1_pd(6.93147180369123816490e-01);
+      const __m256d LN2_LO = _mm256_set1_pd(1.90821492927058770002e-10);
+
+      //************************************************************************
+      // Read the mantissa as a value in [1,2), and the biased exponent as a
+      // double by placing it in the mantissa of 2^52.
+      //************************************************************************
+      const __m256i bits = _mm256_castpd_si256(x);
+      __m256d f = _mm256_castsi256_pd(_mm256_or_si256(
+         _mm256_and_si256(bits,_mm256_set1_epi64x(0x000FFFFFFFFFFFFFLL)),
+         _mm256_castpd_si256(ONE)));
+      __m256d e = _mm256_sub_pd(_mm256_castsi256_pd(_mm256_or_si256(
+         _mm256_srli_epi64(bits,52),_mm256_castpd_si256(TWO52))),TWO52);
+
+      const __m256d isBig = _mm256_cmp_pd(f,
+         _mm256_set1_pd(1.41421356237309504880),_CMP_GT_OQ);
+      f = _mm256_blendv_pd(f,_mm256_mul_pd(f,_mm256_set1_pd(0.5)),isBig);
+      e = _mm256_add_pd(_mm256_sub_pd(e,_mm256_set1_pd(1023.0)),
+                        _mm256_and_pd(isBig,ONE));
+      f = _mm256_sub_pd(f,ONE);
+
+      //************************************************************************
+      // log(1+f) = f - hfsq + s*(hfsq+R), where s = f/(2+f).
+      //************************************************************************
+      const __m256d s = _mm256_div_pd(f,_mm256_add_pd(_mm256_set1_pd(2.0),f));
+      const __m256d z = _mm256_mul_pd(s,s);
+      __m256d r = _mm256_set1_pd(1.479819860511658591e-01);
+      r = _mm256_fmadd_pd(r,z,_mm256_set1_pd(1.531383769920937332e-01));
+      r = _mm256_fmadd_pd(r,z,_mm256_set1_pd(1.818357216161805012e-01));
+      r = _mm256_fmadd_pd(r,z,_mm256_set1_pd(2.222219843214978396e-01));
+      r = _mm256_fmadd_pd(r,z,_mm256_set1_pd(2.857142874366239149e-01));
+      r = _mm256_fmadd_pd(r,z,_mm256_set1_pd(3.999999999940941908e-01));
+      r = _mm256_fmadd_pd(r,z,_mm256_set1_pd(6.666666666666735130e-01));
+      r = _mm256_mul_pd(r,z);
+      const __m256d hfsq = _mm256_mul_pd(_mm256_set1_pd(0.5),
+                                         _mm256_mul_pd(f,f));
+      __m256d t = _mm256_fmadd_pd(s,_mm256_add_pd(hfsq,r),
+                                  _mm256_mul_pd(e,LN2_LO));
+      t = _mm256_sub_pd(_mm256_sub_pd(hfsq,t),f);
+      const __m256d result = _mm256_fmsub_pd(e,LN2_HI,t);
+
+      const __m256d INF =
+         _mm256_set1_pd(std::numeric_limits<double>::infinity());
+      return _mm256_blendv_pd(result,x,_mm256_cmp_pd(x,INF,_CMP_EQ_OQ));
+   }
+
+   /**
+    * Calculates \f$\log(1+u)\f$ for four non-negative values, correcting
+    * for the rounding error in \f$1+u\f$ so that small values of \f$u\f$
+    * keep their accuracy.
+    */
+   DECBRL_AVX2_TARGET inline __m256d log1p4(const __m256d u)
+   {
+      const __m256d ONE = _mm256_set1_pd(1.0);
+      const __m256d w = _mm256_add_pd(ONE,u);
+      const __m256d c = _mm256_div_pd(_mm256_sub_pd(u,_mm256_sub_pd(w,ONE)),w);
+      return _mm256_add_pd(log4(w),c);
+   }
+
+   /**
+    * Exponential of four values. The argument is reduced to
+    * \f$x = n\log 2 + r\f$, with \f$|r| \leq \frac{1}{2}\log 2\f$, and
+    * \f$e^r\f$ is calculated from its Taylor series to 13th order, which
+    * is accurate to around 1e-16. Results below 1e-307 are flushed to zero.
+    */
+   DECBRL_AVX2_TARGET inline __m256d exp4(const __m256d x)
+   {
+      const __m256d MIN_ARG = _mm256_set1_pd(-708.0);
+      const __m256d MAX_ARG = _mm256_set1_pd(709.78);
+      const __m256d ONE = _mm256_set1_pd(1.0);
+
+      const __m256d xc = _mm256_min_pd(_mm256_max_pd(x,MIN_ARG),MAX_ARG);
+      const __m256d n = _mm256_round_pd(
+         _mm256_mul_pd(xc,_mm256_set1_pd(1.44269504088896340736)),
+         _MM_FROUND_TO_NEAREST_INT|_MM_FROUND_NO_EXC);
+      __m256d r = _mm256_fnmadd_pd(n,_mm256_set1_pd(6.93147180369123816490e-01),
+                                   xc);
+      r = _mm256_fnmadd_pd(n,_mm256_set1_pd(1.90821492927058770002e-10),r);
+
+      __m256d p = _mm256_set1_pd(1.0/6227020800.0);
+      p = _mm256_fmadd_pd(p,r,_mm256_set1_pd(1.0/479001600.0));
+      p = _mm256_fmadd_pd(p,r,_mm256_set1_pd(1.0/39916800.0));
+      p = _mm256_fmadd_pd(p,r,_mm256_set1_pd(1.0/3628800.0));
+      p = _mm256_fmadd_pd(p,r,_mm256_set1_pd(1.0/362880.0));
+      p = _mm256_fmadd_pd(p,r,_mm256_set1_pd(1.0/40320.0));
+      p = _mm256_fmadd_pd(p,r,_mm256_set1_pd(1.0/5040.0));
+      p = _mm256_fmadd_pd(p,r,_mm256_set1_pd(1.0/720.0));
+      p = _mm256_fmadd_pd(p,r,_mm256_set1_pd(1.0/120.0));
+      p = _mm256_fmadd_pd(p,r,_mm256_set1_pd(1.0/24.0));
+      p = _mm256_fmadd_pd(p,r,_mm256_set1_pd(1.0/6.0));
+      p = _mm256_fmadd_pd(p,r,_mm256_set1_pd(0.5));
+      p = _mm256_fmadd_pd(p,r,ONE);
+      p = _mm256_fmadd_pd(p,r,ONE);
+
+      //************************************************************************
+      // Scale by 2^(n-1) then 2, so that n=1024 does not overflow the
+      // exponent field.
+      //************************************************************************
+      __m256i scale = _mm256_cvtepi32_epi64(
+         _mm256_cvtpd_epi32(_mm256_sub_pd(n,ONE)));
+      scale = _mm256_slli_epi64(
+         _mm256_add_epi64(scale,_mm256_set1_epi64x(1023)),52);
+      __m256d result = _mm256_mul_pd(
+         _mm256_mul_pd(p,_mm256_castsi256_pd(scale)),_mm256_set1_pd(2.0));
+
+      const __m256d INF =
+         _mm256_set1_pd(std::numeric_limits<double>::infinity());
+      result = _mm256_andnot_pd(_mm256_cmp_pd(x,MIN_ARG,_CMP_LT_OQ),result);
+      result = _mm256_blendv_pd(result,INF,
+                                _mm256_cmp_pd(x,MAX_ARG,_CMP_GT_OQ));
+      return _mm256_blendv_pd(result,x,_mm256_cmp_pd(x,x,_CMP_UNORD_Q));
+   }
+
+   /**
+    * Arc tangent of four values, using the range reduction and rational
+    * approximation from Cephes' atan.c, which is accurate to around 1e-16.
+    */
+   DECBRL_AVX2_TARGET inline __m256d atan4(const __m256d x)
+   {
+      const __m256d SIGN = _mm256_set1_pd(-0.0);
+      const __m256d ONE = _mm256_set1_pd(1.0);
+      const __m256d PIO2 = _mm256_set1_pd(1.57079632679489661923);
+      const __m256d MOREBITS = _mm256_set1_pd(6.123233995736765886130e-17);
+
+      //************************************************************************
+      // Reduce |x| to at most 0.66, using atan(x) = pi/2 - atan(1/x) above
+      // tan(3pi/8), and atan(x) = pi/4 + atan((x-1)/(x+1)) above 0.66.
+      //************************************************************************
+      const __m256d sign = _mm256_and_pd(x,SIGN);
+      const __m256d ax = _mm256_andnot_pd(SIGN,x);
+      const __m256d isBig = _mm256_cmp_pd(ax,
+         _mm256_set1_pd(2.41421356237309504880),_CMP_GT_OQ);
+      const __m256d isMid = _mm256_andnot_pd(isBig,
+         _mm256_cmp_pd(ax,_mm256_set1_pd(0.66),_CMP_GT_OQ));
+
+      __m256d xr = _mm256_blendv_pd(ax,_mm256_div_pd(_mm256_sub_pd(ax,ONE),
+                                    _mm256_add_pd(ax,ONE)),isMid);
+      xr = _mm256_blendv_pd(xr,_mm256_div_pd(_mm256_set1_pd(-1.0),ax),isBig);
+      __m256d y = _mm256_and_pd(isBig,PIO2);
+      y = _mm256_blendv_pd(y,_mm256_set1_pd(0.78539816339744830962),isMid);
+      __m256d extra = _mm256_and_pd(isBig,MOREBITS);
+      extra = _mm256_blendv_pd(extra,_mm256_mul_pd(_mm256_set1_pd(0.5),
+                               MOREBITS),isMid);
+
+      const __m256d z = _mm256_mul_pd(xr,xr);
+      __m256d p = _mm256_set1_pd(-8.750608600031904122785e-01);
+      p = _mm256_fmadd_pd(p,z,_mm256_set1_pd(-1.615753718733365076637e+01));
+      p = _mm256_fmadd_pd(p,z,_mm256_set1_pd(-7.500855792314704667340e+01));
+      p = _mm256_fmadd_pd(p,z,_mm256_set1_pd(-1.228866684490136173410e+02));
+      p = _mm256_fmadd_pd(p,z,_mm256_set1_pd(-6.485021904942025371773e+01));
+      __m256d q = _mm256_add_pd(z,_mm256_set1_pd(2.485846490142306297962e+01));
+      q = _mm256_fmadd_pd(q,z,_mm256_set1_pd(1.650270098316988542046e+02));
+      q = _mm256_fmadd_pd(q,z,_mm256_set1_pd(4.328810604912902668951e+02));
+      q = _mm256_fmadd_pd(q,z,_mm256_set1_pd(4.853903996359136964868e+02));
+      q = _mm256_fmadd_pd(q,z,_mm256_set1_pd(1.945506571482613964425e+02));
+      const __m256d r = _mm256_fmadd_pd(xr,
+         _mm256_div_pd(_mm256_mul_pd(z,p),q),xr);
+
+      return _mm256_or_pd(_mm256_add_pd(y,_mm256_add_pd(r,extra)),sign);
+   }
+
+   /**
+    * Standard normal CDF of four values, using the approximation of erfc
+    * in Abramowitz and Stegun (7.1.26), whose absolute error is less
+    * than 1.5e-7.
+    */
+   DECBRL_AVX2_TARGET inline __m256d normalCdf4(const __m256d z)
+   {
+      const __m256d SIGN = _mm256_set1_pd(-0.0);
+      const __m256d ONE = _mm256_set1_pd(1.0);
+
+      // Phi(z) = erfc(x)/2, where x = -z/sqrt(2)
+      const __m256d x = _mm256_mul_pd(z,
+         _mm256_set1_pd(-0.70710678118654752440));
+      const __m256d ax = _mm256_andnot_pd(SIGN,x);
+      const __m256d t = _mm256_div_pd(ONE,
+         _mm256_fmadd_pd(_mm256_set1_pd(0.3275911),ax,ONE));
+      __m256d p = _mm256_set1_pd(1.061405429);
+      p = _mm256_fmadd_pd(p,t,_mm256_set1_pd(-1.453152027));
+      p = _mm256_fmadd_pd(p,t,_mm256_set1_pd(1.421413741));
+      p = _mm256_fmadd_pd(p,t,_mm256_set1_pd(-0.284496736));
+      p = _mm256_fmadd_pd(p,t,_mm256_set1_pd(0.254829592));
+      p = _mm256_mul_pd(p,t);
+      const __m256d e = _mm256_mul_pd(p,exp4(_mm256_xor_pd(
+         _mm256_mul_pd(ax,ax),SIGN)));
+
+      // erfc(-|x|) = 2 - erfc(|x|)
+      const __m256d isNeg = _mm256_cmp_pd(x,_mm256_setzero_pd(),_CMP_LT_OQ);
+      const __m256d erfc = _mm256_blendv_pd(e,
+         _mm256_sub_pd(_mm256_set1_pd(2.0),e),isNeg);
+      return _mm256_mul_pd(_mm256_set1_pd(0.5),erfc);
+   }
+
+   /**
+    * Student's t CDF of four values, calculated in the same way as
+    * dec_brl::dist::studentsTCdf in fast CDF mode.
+    * @param[in] nu integer degrees of freedom of at least 1.
+    * @param[in] t the points at which to evaluate the CDF.
+    */
+   DECBRL_AVX2_TARGET inline __m256d studentsTCdf4
+   (
+    const __m256d nu,
+    const __m256d t
+   )
+   {
+      const __m256d ONE = _mm256_set1_pd(1.0);
+      const __m256d TWO = _mm256_set1_pd(2.0);
+      const __m256d HALF = _mm256_set1_pd(0.5);
+      const __m256d isSeries = _mm256_cmp_pd(nu,
+         _mm256_set1_pd(Mode::MAX_SERIES_DF),_CMP_LE_OQ);
+      const int seriesMask = _mm256_movemask_pd(isSeries);
+      __m256d result = _mm256_setzero_pd();
+
+      //************************************************************************
+      // Sum the finite series for all lanes at once. Each term is the
+      // previous term times cos^2(theta)*(k-1)/k, with k starting at 2 for
+      // even and 3 for odd degrees of freedom, and lanes stop adding terms
+      // once k passes nu-2.
+      //************************************************************************
+      if(0!=seriesMask)
+      {
+         const __m256d nt = _mm256_fmadd_pd(t,t,nu);
+         const __m256d cos2 = _mm256_div_pd(nu,nt);
+         const __m256d sinTheta = _mm256_div_pd(t,_mm256_sqrt_pd(nt));
+         const __m256d half = _mm256_mul_pd(nu,HALF);
+         const __m256d isOdd = _mm256_cmp_pd(_mm256_floor_pd(half),half,
+                                             _CMP_NEQ_OQ);
+         const int oddMask = _mm256_movemask_pd(_mm256_and_pd(isOdd,isSeries));
+
+         __m256d term = _mm256_blendv_pd(ONE,_mm256_sqrt_pd(cos2),isOdd);
+         __m256d sum = _mm256_blendv_pd(ONE,_mm256_and_pd(term,
+            _mm256_cmp_pd(nu,ONE,_CMP_GT_OQ)),isOdd);
+         __m256d k = _mm256_blendv_pd(TWO,_mm256_set1_pd(3.0),isOdd);
+         const __m256d last = _mm256_blendv_pd(_mm256_set1_pd(-1.0),
+                                               _mm256_sub_pd(nu,TWO),isSeries);
+         __m256d isActive = _mm256_cmp_pd(k,last,_CMP_LE_OQ);
+         while(0!=_mm256_movemask_pd(isActive))
+         {
+            const __m256d next = _mm256_mul_pd(term,_mm256_div_pd(
+               _mm256_mul_pd(cos2,_mm256_sub_pd(k,ONE)),k));
+            term = _mm256_blendv_pd(term,next,isActive);
+            sum = _mm256_add_pd(sum,_mm256_and_pd(term,isActive));
+            k = _mm256_add_pd(k,TWO);
+            isActive = _mm256_cmp_pd(k,last,_CMP_LE_OQ);
+         }
+
+         __m256d a = _mm256_mul_pd(sinTheta,sum);
+         if(0!=oddMask)
+         {
+            const __m256d theta = atan4(_mm256_div_pd(t,_mm256_sqrt_pd(nu)));
+            const __m256d aOdd = _mm256_mul_pd(_mm256_add_pd(theta,a),
+               _mm256_set1_pd(0.63661977236758134308)); // 2/pi
+            a = _mm256_blendv_pd(a,aOdd,isOdd);
+         }
+         result = _mm256_fmadd_pd(HALF,a,HALF);
+      }
+
+      //************************************************************************
+      // Use the normal approximation for large degrees of freedom.
+      //************************************************************************
+      if(0xF!=seriesMask)
+      {
+         const __m256d scale = _mm256_sub_pd(ONE,_mm256_div_pd(
+            _mm256_set1_pd(0.25),nu));
+         const __m256d z = _mm256_div_pd(_mm256_mul_pd(t,scale),
+            _mm256_sqrt_pd(_mm256_add_pd(ONE,_mm256_div_pd(
+            _mm256_mul_pd(t,t),_mm256_mul_pd(TWO,nu)))));
+         result = _mm256_blendv_pd(normalCdf4(z),result,isSeries);
+      }
+      return result;
+   }
+
+   /**
+    * Calculates exact VPI for four actions, in the same way as
+    * dec_brl::exactVPIArrays in fast CDF mode.
+    * @see dec_brl::avx2::exactVPIFast
+    */
+   DECBRL_AVX2_TARGET inline __m256d vpi4
+   (
+    const __m256d a,
+    const __m256d b,
+    const __m256d l,
+    const __m256d m,
+    const __m256d lgammaRatio,
+    const __m256d isBest,
+    const __m256d firstBestVal,
+    const __m256d secondBestVal,
+    const __m256d epsilon
+   )
+   {
+      const __m256d SIGN = _mm256_set1_pd(-0.0);
+      const __m256d ZERO = _mm256_setzero_pd();
+      const __m256d HALF = _mm256_set1_pd(0.5);
+      const __m256d LOG_2 = _mm256_set1_pd(0.69314718055994530942);
+      const __m256d LGAMMA_HALF = _mm256_set1_pd(0.57236494292470008707);
+
+      //************************************************************************
+      // Degrees of freedom must be integers for the fast CDF.
+      //************************************************************************
+      const __m256d nu = _mm256_add_pd(a,a);
+      const __m256d nuR = _mm256_round_pd(nu,
+         _MM_FROUND_TO_NEAREST_INT|_MM_FROUND_NO_EXC);
+      const __m256d isInt = _mm256_cmp_pd(
+         _mm256_andnot_pd(SIGN,_mm256_sub_pd(nu,nuR)),
+         _mm256_set1_pd(Mode::DF_TOLERANCE),_CMP_LE_OQ);
+      const __m256d isInvalid = _mm256_cmp_pd(a,HALF,_CMP_LT_OQ);
+
+      //************************************************************************
+      // The best action is compared with the 2nd best value, while all
+      // other actions are compared with the 1st best value.
+      //************************************************************************
+      const __m256d z = _mm256_sub_pd(
+         _mm256_blendv_pd(firstBestVal,secondBestVal,isBest),m);
+
+      //************************************************************************
+      // Log truncation bias.
+      //************************************************************************
+      const __m256d u = _mm256_div_pd(_mm256_mul_pd(l,_mm256_mul_pd(z,z)),
+                                      _mm256_add_pd(b,b));
+      __m256d lnBias = _mm256_sub_pd(lgammaRatio,LGAMMA_HALF);
+      lnBias = _mm256_fmadd_pd(HALF,_mm256_sub_pd(
+         log4(_mm256_div_pd(b,l)),LOG_2),lnBias);
+      lnBias = _mm256_fmadd_pd(_mm256_sub_pd(HALF,a),log1p4(u),lnBias);
+      __m256d vpi = exp4(lnBias);
+
+      //************************************************************************
+      // Prune elements bounded below epsilon by the truncation bias, or by
+      // the variance bound var/(2*(sqrt(var+d^2)+d)) where alpha>1.
+      //************************************************************************
+      __m256d isPruned = _mm256_cmp_pd(vpi,epsilon,_CMP_LT_OQ);
+      if(0!=_mm256_movemask_pd(_mm256_cmp_pd(ZERO,epsilon,_CMP_LT_OQ)))
+      {
+         const __m256d ONE = _mm256_set1_pd(1.0);
+         const __m256d d = _mm256_xor_pd(z,_mm256_and_pd(isBest,SIGN));
+         const __m256d var = _mm256_div_pd(b,
+            _mm256_mul_pd(l,_mm256_sub_pd(a,ONE)));
+         const __m256d bound = _mm256_div_pd(_mm256_mul_pd(HALF,var),
+            _mm256_add_pd(_mm256_sqrt_pd(_mm256_fmadd_pd(d,d,var)),d));
+         isPruned = _mm256_or_pd(isPruned,_mm256_and_pd(
+            _mm256_cmp_pd(a,ONE,_CMP_GT_OQ),
+            _mm256_cmp_pd(bound,epsilon,_CMP_LT_OQ)));
+      }
+
+      //************************************************************************
+      // Combine truncation bias with the expected difference in value,
+      // for the lanes that need it. Other lanes use 2 degrees of freedom,
+      // which needs no series terms and no arc tangent.
+      //************************************************************************
+      const __m256d needsCdf = _mm256_andnot_pd(_mm256_or_pd(isPruned,
+         isInvalid),isInt);
+      if(0!=_mm256_movemask_pd(needsCdf))
+      {
+         const __m256d t = _mm256_mul_pd(z,_mm256_sqrt_pd(
+            _mm256_div_pd(_mm256_mul_pd(l,a),b)));
+         const __m256d flip = _mm256_andnot_pd(isBest,SIGN);
+         const __m256d cdf = studentsTCdf4(
+            _mm256_blendv_pd(_mm256_set1_pd(2.0),nuR,needsCdf),
+            _mm256_xor_pd(t,flip));
+         vpi = _mm256_fmadd_pd(_mm256_xor_pd(z,flip),cdf,vpi);
+      }
+      vpi = _mm256_max_pd(vpi,ZERO);
+
+      //************************************************************************
+      // Leave non-integer degrees of freedom to the caller, unless pruned,
+      // and give infinite VPI where the truncation bias is undefined.
+      //************************************************************************
+      const __m256d NAN4 =
+         _mm256_set1_pd(std::numeric_limits<double>::quiet_NaN());
+      const __m256d INF =
+         _mm256_set1_pd(std::numeric_limits<double>::infinity());
+      vpi = _mm256_blendv_pd(vpi,NAN4,_mm256_andnot_pd(isInt,
+         _mm256_cmp_pd(ZERO,ZERO,_CMP_EQ_OQ)));
+      vpi = _mm256_andnot_pd(isPruned,vpi);
+      return _mm256_blendv_pd(vpi,INF,isInvalid);
+   }
+
+   /**
+    * Runs vpi4() over a batch.
+    * @see dec_brl::avx2::exactVPIFast
+    */
+   DECBRL_AVX2_TARGET void exactVPIKernel
+   (
+    const int n,
+    const double* alpha,
+    const double* beta,
+    const double* lambda,
+    const double* lgammaRatio,
+    const int* index,
+    const double* m,
+    const int firstBestInd,
+    const double firstBestVal,
+    const double secondBestVal,
+    const double epsilon,
+    double* result
+   )
+   {
+      const __m256d first = _mm256_set1_pd(firstBestVal);
+      const __m256d second = _mm256_set1_pd(secondBestVal);
+      const __m256d eps = _mm256_set1_pd(epsilon);
+      const __m256d bestInd = _mm256_set1_pd(firstBestInd);
+      const __m256d LANES = _mm256_set_pd(3.0,2.0,1.0,0.0);
+
+      //************************************************************************
+      // Process whole blocks of four, reading the hyperparameters directly
+      // or through the index.
+      //************************************************************************
+      int k = 0;
+      for(; k+4<=n; k+=4)
+      {
+         __m256d a, b, l, lgr;
+         if(0==index)
+         {
+            a = _mm256_loadu_pd(alpha+k);
+            b = _mm256_loadu_pd(beta+k);
+            l = _mm256_loadu_pd(lambda+k);
+            lgr = _mm256_loadu_pd(lgammaRatio+k);
+         }
+         else
+         {
+            const __m128i ind =
+               _mm_loadu_si128(reinterpret_cast<const __m128i*>(index+k));
+            a = _mm256_i32gather_pd(alpha,ind,8);
+            b = _mm256_i32gather_pd(beta,ind,8);
+            l = _mm256_i32gather_pd(lambda,ind,8);
+            lgr = _mm256_i32gather_pd(lgammaRatio,ind,8);
+         }
+         const __m256d isBest = _mm256_cmp_pd(_mm256_add_pd(
+            _mm256_set1_pd(k),LANES),bestInd,_CMP_EQ_OQ);
+         _mm256_storeu_pd(result+k,vpi4(a,b,l,_mm256_loadu_pd(m+k),lgr,
+                          isBest,first,second,eps));
+      }
+
+      //************************************************************************
+      // Pad the remaining elements, if any, to a full block.
+      //************************************************************************
+      if(k<n)
+      {
+         double a[4] = {1, 1, 1, 1};
+         double b[4] = {1, 1, 1, 1};
+         double l[4] = {1, 1, 1, 1};
+         double mk[4] = {0, 0, 0, 0};
+         double lgr[4] = {0, 0, 0, 0};
+         double vpi[4];
+         for(int j=0; k+j<n; ++j)
+         {
+            const int ind = (0==index) ? k+j : index[k+j];
+            a[j] = alpha[ind];
+            b[j] = beta[ind];
+            l[j] = lambda[ind];
+            lgr[j] = lgammaRatio[ind];
+            mk[j] = m[k+j];
+         }
+         const __m256d isBest = _mm256_cmp_pd(_mm256_add_pd(
+            _mm256_set1_pd(k),LANES),bestInd,_CMP_EQ_OQ);
+         _mm256_storeu_pd(vpi,vpi4(_mm256_loadu_pd(a),_mm256_loadu_pd(b),
+                          _mm256_loadu_pd(l),_mm256_loadu_pd(mk),
+                          _mm256_loadu_pd(lgr),isBest,first,second,eps));
+         for(int j=0; k+j<n; ++j)
+         {
+            result[k+j] = vpi[j];
+         }
+      }
+
+   } // exactVPIKernel
+
+#endif // DECBRL_AVX2_KERNEL
+
+} // module namespace
+
+/**
+ * Returns true iff the processor supports AVX2 and FMA instructions.
+ */
+bool dec_brl::avx2::isSupported()
+{
+#ifdef DECBRL_AVX2_KERNEL
+   __builtin_cpu_init(); // needed if called before static constructors
+   return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#else
+   return false;
+#endif
+}
+
+/**
+ * Returns true iff dec_brl::exactVPIArrays should use the kernel.
+ */
+bool dec_brl::avx2::isEnabled()
+{
+   return isEnabled_m;
+}
+
+/**
+ * Enables or disables the kernel, if it is supported.
+ */
+bool dec_brl::avx2::setEnabled(bool enable)
+{
+   const bool previous = isEnabled_m;
+   isEnabled_m = enable && isSupported();
+   return previous;
+}
+
+/**
+ * Calculates exact VPI for a batch of actions using AVX2.
+ */
+void dec_brl::avx2::exactVPIFast
+(
+ const int n,
+ const double* alpha,
+ const double* beta,
+ const double* lambda,
+ const double* lgammaRatio,
+ const int* index,
+ const double* m,
+ const int firstBestInd,
+ const double firstBestVal,
+ const double secondBestVal,
+ const double epsilon,
+ double* result
+)
+{
+#ifdef DECBRL_AVX2_KERNEL
+   exactVPIKernel(n, alpha, beta, lambda, lgammaRatio, index, m, firstBestInd,
+                  firstBestVal, secondBestVal, epsilon, result);
+#else
+   // leave every element to the caller
+   for(int k=0; k<n; ++k)
+   {
+      result[k] = std::numeric_limits<double>::quiet_NaN();
+   }
+#endif
+}
@@ -356,6 +356,35 @@ int main()
     std::cout << "expCPT is" << std::endl;
     std::cout << expCPT << std::endl << "ALL OK" << std::endl;
     
+    //**************************************************************************
+    //  Check that running totals and element means are consistent with the
+    //  hyperparameters.
+    //**************************************************************************
+    Eigen::RowVectorXd alphaTotals = beliefs.getAlpha().colwise().sum();
+    if(!beliefs.getTotals().isApprox(alphaTotals))
+    {
+        std::cout << "Incorrect running totals" << std::endl;
+        std::cout << beliefs.getTotals() << std::endl;
+        std::cout << "BUT SHOULD BE" << std::endl;
+        std::cout << alphaTotals << std::endl;
+        return EXIT_FAILURE;
+    }
+    
+    for(int c=0; c<beliefs.condSize(); ++c)
+    {
+        for(int d=0; d<beliefs.domainSize(); ++d)
+        {
+            if(std::abs(beliefs.getMeanElement(d,c)-expCPT(d,c)) > 1e-12)
+            {
+                std::cout << "Incorrect mean for element (" << d << "," << c
+                << "): " << beliefs.getMeanElement(d,c) << " should be "
+                << expCPT(d,c) << std::endl;
+                return EXIT_FAILURE;
+            }
+        }
+    }
+    std::cout << "Element means OK" << std::endl;
+    
     //**************************************************************************
     //  Try to get the expCPT for a specific set of conditions
     //**************************************************************************
@@ -0,0 +1,174 @@
+/**
+ * @file aliasBenchHarness.cpp
+ * Test harness and microbenchmark for drawing next states from a
+ * dec_brl::SampledTransProb using alias tables.
+ * Checks that next states drawn using alias tables follow the sampled CPT,
+ * and reports the number of draws per second with and without alias tables
+ * across a range of domain sizes.
+ */
+
+#include <dec_brl/TransBelief.h>
+#include "register.h"
+#include <algorithm>
+#include <cmath>
+#include <ctime>
+#include <iostream>
+#include <boost/random/mersenne_twister.hpp>
+
+/**
+ * Private module namespace.
+ */
+namespace {
+
+    /**
+     * Number of draws used to check the distribution of next states.
+     */
+    const int NUM_CHECK_DRAWS_M = 1000000;
+
+    /**
+     * Number of draws timed for each domain size.
+     */
+    const int NUM_BENCH_DRAWS_M = 2000000;
+
+    /**
+     * Largest number of variables in the benchmarked CPTs.
+     */
+    const int MAX_VARS_M = 4;
+
+    /**
+     * Domain size of each variable.
+     */
+    const int VAR_SIZE_M = 6;
+
+    /**
+     * Checks that next states drawn using alias tables from a fixed
+     * conditional distribution follow the sampled CPT, to within 6 standard
+     * deviations for each domain value.
+     */
+    int testAliasDistribution
+    (
+     dec_brl::TransBelief& beliefs,
+     dec_brl::SampledTransProb& cpt,
+     const Eigen::VectorXi& vars,
+     const Eigen::VectorXi& sizes
+    )
+    {
+        boost::mt19937 randGenerator;
+        Eigen::VectorXi prevStates(MAX_VARS_M+1), nxtStates(MAX_VARS_M+1);
+        prevStates.setZero();
+        nxtStates.setZero();
+        for(int k=0; k<vars.size(); ++k)
+        {
+            prevStates[vars[k]] = (k+1)%sizes[k];
+        }
+        int condInd = maxsum::sub2ind(sizes.begin(), sizes.end(),
+                                      prevStates.begin()+1,
+                                      prevStates.begin()+1+vars.size());
+
+        Eigen::VectorXd counts(beliefs.domainSize());
+        counts.setZero();
+        for(int k=0; k<NUM_CHECK_DRAWS_M; ++k)
+        {
+            cpt.drawNextStates(randGenerator, prevStates, nxtStates);
+            int domainInd = maxsum::sub2ind(sizes.begin(), sizes.end(),
+                                            nxtStates.begin()+1,
+                                            nxtStates.begin()+1+vars.size());
+            counts[domainInd] += 1;
+        }
+
+        for(int k=0; k<counts.size(); ++k)
+        {
+            double p = cpt.getCPT()(k,condInd);
+            double expected = p*NUM_CHECK_DRAWS_M;
+            double stddev = std::sqrt(expected*(1-p));
+            if(std::abs(counts[k]-expected) > 6*stddev+1)
+            {
+                std::cout << "Alias draws for domain value " << k
+                << " occurred " << counts[k] << " times, but expected "
+                << expected << std::endl;
+                return EXIT_FAILURE;
+            }
+        }
+        return EXIT_SUCCESS;
+
+    } // testAliasDistribution
+
+    /**
+     * Returns the number of next state draws per second for a chain of
+     * transitions, in which each set of next states is the condition for
+     * the next draw.
+     */
+    double drawsPerSecond
+    (
+     dec_brl::SampledTransProb& cpt,
+     boost::mt19937& randGenerator
+    )
+    {
+        Eigen::VectorXi prevStates(MAX_VARS_M+1), nxtStates(MAX_VARS_M+1);
+        prevStates.setZero();
+        nxtStates.setZero();
+        std::clock_t start = std::clock();
+        for(int k=0; k<NUM_BENCH_DRAWS_M; ++k)
+        {
+            prevStates.swap(nxtStates);
+            cpt.drawNextStates(randGenerator, prevStates, nxtStates);
+        }
+        double seconds = double(std::clock()-start)/CLOCKS_PER_SEC;
+        return NUM_BENCH_DRAWS_M/std::max(seconds,1e-9);
+
+    } // drawsPerSecond
+
+} // module namespace
+
+/**
+ * Main function.
+ */
+int main()
+{
+    using namespace dec_brl;
+
+    //**************************************************************************
+    // Register test variables 1..MAX_VARS_M with the maxsum library
+    //**************************************************************************
+    for(int v=1; v<=MAX_VARS_M; ++v)
+    {
+        maxsum::registerVariable(v,VAR_SIZE_M);
+    }
+
+    //**************************************************************************
+    // For each number of variables, create beliefs about the transition
+    // probabilities for those variables, given their previous values.
+    //**************************************************************************
+    boost::mt19937 randGenerator;
+    for(int noVars=1; noVars<=MAX_VARS_M; ++noVars)
+    {
+        Eigen::VectorXi vars(noVars), sizes(noVars);
+        for(int k=0; k<noVars; ++k)
+        {
+            vars[k] = k+1;
+            sizes[k] = VAR_SIZE_M;
+        }
+        TransBelief beliefs(vars,vars);
+
+        SampledTransProb linearCPT(beliefs,randGenerator);
+        SampledTransProb aliasCPT(beliefs,randGenerator,true);
+        if(EXIT_SUCCESS!=testAliasDistribution(beliefs,aliasCPT,vars,sizes))
+        {
+            return EXIT_FAILURE;
+        }
+
+        double linearRate = drawsPerSecond(linearCPT,randGenerator);
+        double aliasRate = drawsPerSecond(aliasCPT,randGenerator);
+        std::cout << "domain size: " << beliefs.domainSize()
+        << " linear scan draws/sec: " << linearRate
+        << " alias draws/sec: " << aliasRate
+        << " speed up: " << aliasRate/linearRate << std::endl;
+    }
+
+    //**************************************************************************
+    // If we get this far, everything passed.
+    //**************************************************************************
+    std::cout << "All alias table tests passed" << std::endl;
+    return EXIT_SUCCESS;
+
+} // function main
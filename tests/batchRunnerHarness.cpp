@@ -0,0 +1,326 @@
+/**
+ * @file batchRunnerHarness.cpp
+ * Test harness for dec_brl::BatchRunner and per-run random streams.
+ * Runs several epsilon-greedy DecQLearners on the factored MDP used by
+ * bqFacMDPHarness.cpp, and checks that each run's results depend only on
+ * its seed, whether runs are stepped in the calling thread or by a thread
+ * pool.
+ */
+
+#include <exception>
+#include <iostream>
+#include <map>
+#include "dec_brl/BatchRunner.h"
+#include "dec_brl/ThreadPool.h"
+#include "dec_brl/DecQLearner.h"
+#include "dec_brl/random.h"
+#include "register.h"
+#include "DiscreteFunction.h"
+
+/**
+ * Private Module namespace.
+ */
+namespace {
+
+using namespace dec_brl;
+
+/**
+ * Number of runs in each batch.
+ */
+const int NUM_RUNS_M = 8;
+
+/**
+ * Number of timesteps for which each run is stepped in each call to run().
+ */
+const int NUM_TIMESTEPS_M = 250;
+
+/**
+ * Exploration rate used by each learner, chosen so that results depend on
+ * the random stream.
+ */
+const double EPSILON_M = 0.3;
+
+/**
+ * A Simple Factored MDP for testing, identical to the one used by
+ * bqFacMDPHarness.cpp.
+ */
+class MultiFactorMDP
+{
+public:
+
+   /**
+    * Map type used to pass action and state values around.
+    */
+   typedef std::map<maxsum::VarID,maxsum::ValIndex> VarMap;
+
+   /**
+    * Map type for passing back Factored Rewards
+    */
+   typedef std::map<maxsum::FactorID,double> RewardMap;
+
+private:
+
+   /**
+    * Map containing the state variable mapped to its current value.
+    */
+   VarMap state_i;
+
+public:
+
+   /**
+    * Number of possible values for each variable.
+    */
+   const static int NUM_VALS = 2;
+
+   /**
+    * Default Constructor.
+    */
+   MultiFactorMDP() : state_i()
+   {
+      //************************************************************************
+      // Register the state and action variables with the maxsum library
+      //************************************************************************
+      for(int v=0; v<=8; ++v)
+      {
+         maxsum::registerVariable(v,NUM_VALS);
+      }
+
+      //************************************************************************
+      // Set the current state: first state is filled, rest are all empty
+      //************************************************************************
+      state_i[1] = 1;
+      for(int s=3; s<=7; s+=2)
+      {
+         state_i[s] = 0;
+      }
+
+   } // default constructor.
+
+   /**
+    * Inform learner of the factors defined by this MDP.
+    */
+   template<class Learner> void addFactors(Learner& learner)
+   {
+      int varIds[3];
+      for(int factor=1; factor<=7; factor+=2)
+      {
+         varIds[0]=factor-1;
+         varIds[1]=factor;
+         varIds[2]=factor+1;
+         learner.addFactor(factor,varIds,varIds+3);
+      }
+   }
+
+   /**
+    * Get the current state value.
+    */
+   VarMap& getState()
+   {
+      return state_i;
+   }
+
+   /**
+    * Perform an action and return the resulting reward.
+    * @returns total reward
+    */
+   double act(VarMap& action, RewardMap& reward)
+   {
+      double totReward = 0;
+      for(int s=1; s<=7; s+=2)
+      {
+         if( (1==action[s-1]) && (0==action[s+1]) && (1==state_i[s]) )
+         {
+            state_i[s]=0;
+            reward[s]=s*10;
+         }
+         else if(1==state_i[s])
+         {
+            reward[s] = (-s);
+         }
+         else if( (0==action[s-1]) && (1==action[s+1]) )
+         {
+            state_i[s]=1;
+            reward[s]=0;
+         }
+         else
+         {
+            reward[s]=0;
+         }
+         totReward += reward[s];
+      }
+      return totReward;
+
+   } // method act
+
+}; // class MultiFactorMDP
+
+/**
+ * Batch runner type used in these tests.
+ */
+typedef BatchRunner<DecQLearner,MultiFactorMDP> Runner;
+
+/**
+ * Adds one run for each of the seeds 1 to NUM_RUNS_M.
+ */
+void addRuns(Runner& runner)
+{
+   MultiFactorMDP mdp;
+   DecQLearner learner(DecQLearner::DEFAULT_ALPHA,
+         DecQLearner::DEFAULT_GAMMA,EPSILON_M);
+   mdp.addFactors(learner);
+   for(int k=1; k<=NUM_RUNS_M; ++k)
+   {
+      runner.addRun(learner,mdp,k);
+   }
+}
+
+/**
+ * Checks that two batches have identical statistics for each run.
+ */
+bool sameStats(const Runner& a, const Runner& b, const char* name)
+{
+   for(std::size_t k=0; k<a.size(); ++k)
+   {
+      const RunStats& x = a.stats(k);
+      const RunStats& y = b.stats(k);
+      if( (x.noSteps!=y.noSteps) || (x.sumReward!=y.sumReward) ||
+          (x.sumSquaredReward!=y.sumSquaredReward) )
+      {
+         std::cout << name << ": run " << k << " differs: mean "
+            << x.mean() << " vs " << y.mean() << std::endl;
+         return false;
+      }
+   }
+   return true;
+}
+
+/**
+ * Steps the same runs serially, on a thread pool, and serially again while
+ * the shared generator is in use, and checks that every run's statistics
+ * are reproduced, and that different seeds give different results.
+ */
+bool testReproducible()
+{
+   Runner serial, pooled, interleaved;
+   addRuns(serial);
+   addRuns(pooled);
+   addRuns(interleaved);
+
+   ThreadPool pool(4);
+   for(int pass=0; pass<2; ++pass)
+   {
+      serial.run(NUM_TIMESTEPS_M);
+      pooled.run(NUM_TIMESTEPS_M,pool);
+      for(int k=0; k<10; ++k)
+      {
+         random::unirnd(); // must not affect any run
+      }
+      interleaved.run(NUM_TIMESTEPS_M);
+   }
+
+   if(!sameStats(serial,pooled,"ThreadPool") ||
+      !sameStats(serial,interleaved,"Shared generator"))
+   {
+      return false;
+   }
+
+   bool isDifferent = false;
+   for(int k=0; k<NUM_RUNS_M; ++k)
+   {
+      const RunStats& stats = serial.stats(k);
+      std::cout << "seed " << k+1 << ": steps " << stats.noSteps
+         << " mean reward " << stats.mean() << " variance "
+         << stats.variance() << std::endl;
+      if(2*NUM_TIMESTEPS_M!=stats.noSteps)
+      {
+         std::cout << "Wrong number of steps" << std::endl;
+         return false;
+      }
+      isDifferent = isDifferent ||
+         (stats.sumReward!=serial.stats(0).sumReward);
+   }
+   std::cout << "mean over runs: " << serial.meanReward() << std::endl;
+
+   if(!isDifferent)
+   {
+      std::cout << "All seeds gave the same rewards" << std::endl;
+      return false;
+   }
+   return true;
+
+} // testReproducible
+
+/**
+ * Checks that a stream reproduces its sequence when reseeded, and that
+ * nested scopes restore the previous stream.
+ */
+bool testStreams()
+{
+   random::Stream outer(7), inner(11);
+   double first[3], second[3];
+   {
+      random::StreamScope scope(outer);
+      first[0] = random::unirnd();
+      {
+         random::StreamScope nested(inner);
+         first[1] = random::unirnd();
+      }
+      first[2] = random::unirnd();
+   }
+
+   outer.seed(7);
+   inner.seed(11);
+   {
+      random::StreamScope scope(outer);
+      second[0] = random::unirnd();
+      second[2] = random::unirnd();
+   }
+   {
+      random::StreamScope scope(inner);
+      second[1] = random::unirnd();
+   }
+
+   for(int k=0; k<3; ++k)
+   {
+      if(first[k]!=second[k])
+      {
+         std::cout << "Stream draw " << k << " not reproduced" << std::endl;
+         return false;
+      }
+   }
+   return true;
+
+} // testStreams
+
+} // module namespace
+
+/**
+ * Main function for harness - executes all tests.
+ */
+int main()
+{
+   try
+   {
+      if(!testStreams())
+      {
+         return EXIT_FAILURE;
+      }
+
+      if(!testReproducible())
+      {
+         return EXIT_FAILURE;
+      }
+   }
+   catch(std::exception& e)
+   {
+      std::cout << "Caught error: " << e.what() << std::endl;
+      return EXIT_FAILURE;
+   }
+
+   //***************************************************************************
+   // If we get this far, everything is ok.
+   //***************************************************************************
+   std::cout << "Passed." << std::endl;
+   return EXIT_SUCCESS;
+
+} // function main
@@ -379,6 +379,8 @@ int main(int argc, char* argv[])
    meanReward /= timesteps;
    std::cout << "DONE meanReward: " << meanReward
       << " Number of exploratory moves: " << nExploratoryMoves << std::endl;
+   std::cout << "VPI cache hit rate: " << learner.getVPICacheHitRate()
+      << std::endl;
    
    //***************************************************************************
    // Check for convergence by perform a few greedy actions - to be optimal
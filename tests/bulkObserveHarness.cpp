@@ -0,0 +1,136 @@
+/**
+ * @file bulkObserveHarness.cpp
+ * Test harness and microbenchmark for dec_brl::TransBelief::observeBulk.
+ * Checks that observing many transitions at once gives the same
+ * hyperparameters and totals as observing each in turn, and reports the
+ * time taken by observeByMap, observeByVec and observeBulk.
+ */
+
+#include <dec_brl/TransBelief.h>
+#include "register.h"
+#include <ctime>
+#include <iostream>
+#include <map>
+#include <boost/random/mersenne_twister.hpp>
+
+/**
+ * Private module namespace.
+ */
+namespace {
+
+    /**
+     * Number of logged transitions observed.
+     */
+    const int NUM_TRANSITIONS_M = 1000000;
+
+    /**
+     * Number of variables, which are both condition and domain variables.
+     */
+    const int NUM_VARS_M = 3;
+
+    /**
+     * Domain size of each variable.
+     */
+    const int VAR_SIZE_M = 5;
+
+} // module namespace
+
+/**
+ * Main function.
+ */
+int main()
+{
+    using namespace dec_brl;
+
+    //**************************************************************************
+    // Register test variables, and create two identical belief distributions.
+    //**************************************************************************
+    Eigen::VectorXi vars(NUM_VARS_M);
+    for(int k=0; k<NUM_VARS_M; ++k)
+    {
+        vars[k] = k+1;
+        maxsum::registerVariable(vars[k],VAR_SIZE_M);
+    }
+    TransBelief mapped(vars,vars);
+    TransBelief sequential(vars,vars);
+    TransBelief bulk(vars,vars);
+
+    //**************************************************************************
+    // Generate random logged transitions, one per row.
+    //**************************************************************************
+    boost::mt19937 randGenerator;
+    Eigen::MatrixXi condVals(NUM_TRANSITIONS_M,NUM_VARS_M);
+    Eigen::MatrixXi domainVals(NUM_TRANSITIONS_M,NUM_VARS_M);
+    for(int k=0; k<NUM_TRANSITIONS_M; ++k)
+    {
+        for(int v=0; v<NUM_VARS_M; ++v)
+        {
+            condVals(k,v) = randGenerator()%VAR_SIZE_M;
+            domainVals(k,v) = (condVals(k,v) + randGenerator()%2)%VAR_SIZE_M;
+        }
+    }
+
+    //**************************************************************************
+    // Observe each transition in turn, using maps and then vectors, and then
+    // all at once.
+    //**************************************************************************
+    std::map<int,int> condMap, domainMap;
+    std::clock_t start = std::clock();
+    for(int k=0; k<NUM_TRANSITIONS_M; ++k)
+    {
+        for(int v=0; v<NUM_VARS_M; ++v)
+        {
+            condMap[vars[v]] = condVals(k,v);
+            domainMap[vars[v]] = domainVals(k,v);
+        }
+        mapped.observeByMap(condMap, domainMap);
+    }
+    double mappedTime = double(std::clock()-start)/CLOCKS_PER_SEC;
+
+    Eigen::VectorXi condRow(NUM_VARS_M), domainRow(NUM_VARS_M);
+    start = std::clock();
+    for(int k=0; k<NUM_TRANSITIONS_M; ++k)
+    {
+        condRow = condVals.row(k).transpose();
+        domainRow = domainVals.row(k).transpose();
+        sequential.observeByVec(condRow.begin(), condRow.end(),
+                                domainRow.begin(), domainRow.end());
+    }
+    double sequentialTime = double(std::clock()-start)/CLOCKS_PER_SEC;
+
+    start = std::clock();
+    bulk.observeBulk(condVals,domainVals);
+    double bulkTime = double(std::clock()-start)/CLOCKS_PER_SEC;
+
+    std::cout << "transitions: " << NUM_TRANSITIONS_M
+    << " observeByMap time: " << mappedTime
+    << "s observeByVec time: " << sequentialTime
+    << "s observeBulk time: " << bulkTime << "s" << std::endl;
+
+    //**************************************************************************
+    // Check that both give the same posterior.
+    //**************************************************************************
+    if( (sequential.getAlpha()!=bulk.getAlpha()) ||
+        (sequential.getTotals()!=bulk.getTotals()) ||
+        (mapped.getAlpha()!=bulk.getAlpha()) )
+    {
+        std::cout << "Bulk observations differ from sequential observations"
+        << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    const double expectedTotal = NUM_TRANSITIONS_M +
+        TransBelief::DEFAULT_ALPHA*bulk.getAlpha().size();
+    if(expectedTotal!=bulk.getAlpha().sum())
+    {
+        std::cout << "Wrong number of bulk observations" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    //**************************************************************************
+    // If we get this far, everything passed.
+    //**************************************************************************
+    std::cout << "All bulk observation tests passed" << std::endl;
+    return EXIT_SUCCESS;
+
+} // function main
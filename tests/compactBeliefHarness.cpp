@@ -0,0 +1,321 @@
+/**
+ * @file compactBeliefHarness.cpp
+ * Test harness for single precision and interleaved belief storage.
+ * Runs learners that store their beliefs in double precision side by side
+ * with learners that store them in single precision, or in interleaved
+ * records, on identical copies of the factored MDP used by
+ * bqFacMDPHarness.cpp and bmFacMDPHarness.cpp, and checks that their
+ * learning curves are identical.
+ */
+
+#include <cmath>
+#include <exception>
+#include <iostream>
+#include <map>
+#include <boost/random/mersenne_twister.hpp>
+#include "dec_brl/CompactNormalGamma.h"
+#include "dec_brl/InterleavedNormalGamma.h"
+#include "dec_brl/DecBayesQ.h"
+#include "dec_brl/DecBayesModelLearner.h"
+#include "dec_brl/LearningSolver.h"
+#include "dec_brl/DecQLearner.h"
+#include "register.h"
+#include "DiscreteFunction.h"
+
+/**
+ * Private Module namespace.
+ */
+namespace {
+
+using namespace dec_brl;
+
+/**
+ * Number of timesteps for which each pair of learners is run.
+ */
+const int NUM_TIMESTEPS_M = 1000;
+
+/**
+ * Number of initial timesteps in which both learners are forced to perform
+ * the same random actions, so that they observe a wide range of rewards.
+ */
+const int NUM_RANDOM_STEPS_M = 200;
+
+/**
+ * A Simple Factored MDP for testing, identical to the one used by
+ * bqFacMDPHarness.cpp.
+ */
+class MultiFactorMDP
+{
+public:
+
+   /**
+    * Map type used to pass action and state values around.
+    */
+   typedef std::map<maxsum::VarID,maxsum::ValIndex> VarMap;
+
+   /**
+    * Map type for passing back Factored Rewards
+    */
+   typedef std::map<maxsum::FactorID,double> RewardMap;
+
+private:
+
+   /**
+    * Map containing the state variable mapped to its current value.
+    */
+   VarMap state_i;
+
+public:
+
+   /**
+    * Number of possible values for each variable.
+    */
+   const static int NUM_VALS = 2;
+
+   /**
+    * Default Constructor.
+    */
+   MultiFactorMDP() : state_i()
+   {
+      //************************************************************************
+      // Register the state and action variables with the maxsum library
+      //************************************************************************
+      for(int v=0; v<=8; ++v)
+      {
+         maxsum::registerVariable(v,NUM_VALS);
+      }
+
+      //************************************************************************
+      // Set the current state: first state is filled, rest are all empty
+      //************************************************************************
+      state_i[1] = 1;
+      for(int s=3; s<=7; s+=2)
+      {
+         state_i[s] = 0;
+      }
+
+   } // default constructor.
+
+   /**
+    * Inform learner of the factors defined by this MDP.
+    */
+   template<class Learner> void addFactors(Learner& learner)
+   {
+      int varIds[3];
+      for(int factor=1; factor<=7; factor+=2)
+      {
+         varIds[0]=factor-1;
+         varIds[1]=factor;
+         varIds[2]=factor+1;
+         learner.addFactor(factor,varIds,varIds+3);
+      }
+   }
+
+   /**
+    * Get the current state value.
+    */
+   VarMap& getState()
+   {
+      return state_i;
+   }
+
+   /**
+    * Perform an action and return the resulting reward.
+    * @returns total reward
+    */
+   double act(VarMap& action, RewardMap& reward)
+   {
+      double totReward = 0;
+      for(int s=1; s<=7; s+=2)
+      {
+         if( (1==action[s-1]) && (0==action[s+1]) && (1==state_i[s]) )
+         {
+            state_i[s]=0;
+            reward[s]=s*10;
+         }
+         else if(1==state_i[s])
+         {
+            reward[s] = (-s);
+         }
+         else if( (0==action[s-1]) && (1==action[s+1]) )
+         {
+            state_i[s]=1;
+            reward[s]=0;
+         }
+         else
+         {
+            reward[s]=0;
+         }
+         totReward += reward[s];
+      }
+      return totReward;
+
+   } // method act
+
+}; // class MultiFactorMDP
+
+/**
+ * Runs two learners side by side on separate copies of the MDP.
+ * For the first NUM_RANDOM_STEPS_M timesteps, both perform the same random
+ * actions, after which they choose their own.
+ * @returns true iff both learners choose the same actions at every timestep,
+ * and therefore receive the same rewards.
+ */
+template<class RefLearner, class TestLearner> bool runLockstep
+(
+ const char* name
+)
+{
+   MultiFactorMDP refMDP, testMDP;
+   RefLearner refLearner;
+   TestLearner testLearner;
+   refMDP.addFactors(refLearner);
+   testMDP.addFactors(testLearner);
+
+   MultiFactorMDP::VarMap refPrior, refPost(refMDP.getState()), refAction;
+   MultiFactorMDP::VarMap testPrior, testPost(testMDP.getState()), testAction;
+   MultiFactorMDP::RewardMap refReward, testReward;
+
+   boost::mt19937 rng;
+   double refTotal = 0;
+   double testTotal = 0;
+   for(int t=0; t<NUM_TIMESTEPS_M; ++t)
+   {
+      refPost.swap(refPrior);
+      testPost.swap(testPrior);
+
+      refLearner.act(refPrior,refAction);
+      testLearner.act(testPrior,testAction);
+      if(NUM_RANDOM_STEPS_M>t)
+      {
+         for(int a=0; a<=8; a+=2)
+         {
+            refAction[a] = testAction[a] = rng()%MultiFactorMDP::NUM_VALS;
+         }
+      }
+      else if(refAction!=testAction)
+      {
+         std::cout << name << ": actions diverged at timestep " << t
+            << std::endl;
+         return false;
+      }
+
+      refPost = refMDP.getState();
+      testPost = testMDP.getState();
+      refTotal += refMDP.act(refAction,refReward);
+      testTotal += testMDP.act(testAction,testReward);
+      if(refReward!=testReward)
+      {
+         std::cout << name << ": rewards diverged at timestep " << t
+            << std::endl;
+         return false;
+      }
+
+      refLearner.observe(refPrior,refAction,refPost,refReward);
+      testLearner.observe(testPrior,testAction,testPost,testReward);
+   }
+
+   std::cout << name << " mean reward: " << refTotal/NUM_TIMESTEPS_M
+      << " (reference) " << testTotal/NUM_TIMESTEPS_M << " (test)"
+      << std::endl;
+   return true;
+
+} // runLockstep
+
+/**
+ * Checks that compact hyperparameters round trip, and that conditioning
+ * them gives the same result as conditioning a maxsum::DiscreteFunction.
+ */
+bool testCondition()
+{
+   typedef dist::CachedNormalGamma_Tmpl<maxsum::DiscreteFunction> VecDist;
+   const maxsum::VarID vars[] = {0, 1, 2};
+
+   VecDist ref;
+   dist::CompactNormalGamma test;
+   dist::expand(ref,vars,vars+3);
+   dist::expand(test,vars,vars+3);
+   if(std::abs(test.alpha(0)-ref.alpha(0)) > 1e-15)
+   {
+      std::cout << "Default alpha not preserved: " << test.alpha(0)
+         << std::endl;
+      return false;
+   }
+
+   MultiFactorMDP::VarMap vals;
+   for(maxsum::ValIndex k=0; k<ref.m.domainSize(); ++k)
+   {
+      vals[0] = k%2; vals[1] = (k/2)%2; vals[2] = k/4;
+      dist::observe<MultiFactorMDP::VarMap&>(ref,vals,k*1.5,k+1.0,1);
+      dist::observe<MultiFactorMDP::VarMap&>(test,vals,k*1.5,k+1.0,1);
+   }
+
+   MultiFactorMDP::VarMap states;
+   states[1] = 1;
+   maxsum::DiscreteFunction refCond, testCond;
+   maxsum::condition(ref.m,refCond,states);
+   dist::condition(test.m,testCond,states);
+   if(refCond.domainSize()!=testCond.domainSize())
+   {
+      std::cout << "Conditioned domain size mismatch." << std::endl;
+      return false;
+   }
+   for(maxsum::ValIndex k=0; k<refCond.domainSize(); ++k)
+   {
+      if(std::abs(refCond(k)-testCond(k)) > 1e-6*std::abs(refCond(k)))
+      {
+         std::cout << "Conditioned value mismatch at " << k << ": "
+            << refCond(k) << " " << testCond(k) << std::endl;
+         return false;
+      }
+   }
+   return true;
+
+} // testCondition
+
+} // module namespace
+
+/**
+ * Main function for harness - executes all tests.
+ */
+int main()
+{
+   try
+   {
+      MultiFactorMDP mdp; // registers variables
+      if(!testCondition())
+      {
+         return EXIT_FAILURE;
+      }
+
+      if(!runLockstep<DecBayesQ,CompactDecBayesQ>("DecBayesQ"))
+      {
+         return EXIT_FAILURE;
+      }
+
+      if(!runLockstep<DecBayesQ,InterleavedDecBayesQ>("InterleavedDecBayesQ"))
+      {
+         return EXIT_FAILURE;
+      }
+
+      typedef LearningSolver<DecQLearner> Solver;
+      if(!runLockstep<DecBayesModelLearner<Solver>,
+          DecBayesModelLearner<Solver,dist::CompactNormalGamma> >
+          ("DecBayesModelLearner"))
+      {
+         return EXIT_FAILURE;
+      }
+   }
+   catch(std::exception& e)
+   {
+      std::cout << "Caught error: " << e.what() << std::endl;
+      return EXIT_FAILURE;
+   }
+
+   //***************************************************************************
+   // If we get this far, everything is ok.
+   //***************************************************************************
+   std::cout << "Passed." << std::endl;
+   return EXIT_SUCCESS;
+
+} // function main
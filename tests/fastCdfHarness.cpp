@@ -0,0 +1,275 @@
+/**
+ * @file fastCdfHarness.cpp
+ * Test harness for the fast Student's t CDF mode in NonCentralT.h.
+ * Checks that the fast CDF is within its stated maximum absolute error of
+ * the Boost.Math CDF, that VPI calculated in fast mode is within the
+ * corresponding error bound, and reports the time taken by both modes.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <ctime>
+#include <exception>
+#include <iostream>
+#include <vector>
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/normal_distribution.hpp>
+#include <boost/random/uniform_real.hpp>
+#include <boost/random/variate_generator.hpp>
+#include "dec_brl/vpi.h"
+#include "dec_brl/NonCentralT.h"
+#include "dec_brl/NormalGamma.h"
+#include "DiscreteFunction.h"
+#include "register.h"
+
+// private module namespace
+namespace
+{
+using namespace dec_brl::dist;
+
+/**
+ * Boost.Math policy used for all calculations.
+ */
+typedef boost::math::policies::policy<> Policy;
+
+/**
+ * Type of vectorised parameter distribution used for testing.
+ */
+typedef CachedNormalGamma_Tmpl<maxsum::DiscreteFunction> VecDist;
+
+/**
+ * Number of times each VPI calculation is repeated for timing purposes.
+ */
+const int NUM_REPEATS_M = 20;
+
+/**
+ * Returns the maximum absolute difference between the fast and exact
+ * CDF and CDF complement for the specified degrees of freedom, over a
+ * grid of points.
+ */
+double maxCdfError(double df)
+{
+   double result = 0;
+   for(double t=-50; t<=50; t+=0.01)
+   {
+      double exact = studentsTCdf<double,Policy>(df,t,ExactCdf());
+      double fast = studentsTCdf<double,Policy>(df,t,FastCdf());
+      result = std::max(result,std::abs(exact-fast));
+
+      exact = studentsTCdfComplement<double,Policy>(df,t,ExactCdf());
+      fast = studentsTCdfComplement<double,Policy>(df,t,FastCdf());
+      result = std::max(result,std::abs(exact-fast));
+   }
+   return result;
+}
+
+/**
+ * Checks the fast CDF against Boost.Math for integer, near integer
+ * (as produced by NormalGamma_Tmpl::DEFAULT_ALPHA), non-integer and
+ * large degrees of freedom.
+ * @returns true iff the error is always within FastCdf::MAX_ABS_ERROR.
+ */
+bool testCdfError()
+{
+   //***************************************************************************
+   // List degrees of freedom to test
+   //***************************************************************************
+   std::vector<double> dfList;
+   for(int df=1; df<=100; ++df)
+   {
+      dfList.push_back(df);
+      dfList.push_back(df+2e-8);
+   }
+   dfList.push_back(0.5);
+   dfList.push_back(3.7);
+   dfList.push_back(FastCdf::MAX_SERIES_DF+0.5);
+   for(double df=FastCdf::MAX_SERIES_DF+1; df<1e5; df*=1.5)
+   {
+      dfList.push_back(std::floor(df));
+   }
+
+   //***************************************************************************
+   // Check the error for each
+   //***************************************************************************
+   double worstError = 0;
+   for(std::vector<double>::const_iterator it=dfList.begin();
+       it!=dfList.end(); ++it)
+   {
+      const double error = maxCdfError(*it);
+      worstError = std::max(worstError,error);
+      if(FastCdf::MAX_ABS_ERROR < error)
+      {
+         std::cout << "Fast CDF error " << error << " for df=" << *it
+            << " exceeds " << FastCdf::MAX_ABS_ERROR << std::endl;
+         return false;
+      }
+   }
+   std::cout << "Worst fast CDF error: " << worstError << std::endl;
+
+   //***************************************************************************
+   // Check the NonCentralT overloads apply location and scale correctly.
+   //***************************************************************************
+   NonCentralT dist(7,3.5,2.0);
+   for(double x=-20; x<=20; x+=0.1)
+   {
+      double exact = boost::math::cdf(dist,x);
+      double fast = studentsTCdf(dist,x,FastCdf());
+      double exactC = boost::math::cdf(boost::math::complement(dist,x));
+      double fastC = studentsTCdfComplement(dist,x,FastCdf());
+      if( (FastCdf::MAX_ABS_ERROR < std::abs(exact-fast)) ||
+          (FastCdf::MAX_ABS_ERROR < std::abs(exactC-fastC)) )
+      {
+         std::cout << "NonCentralT fast CDF inconsistent at x=" << x
+            << std::endl;
+         return false;
+      }
+   }
+
+   //***************************************************************************
+   // Time both modes
+   //***************************************************************************
+   const int NUM_EVALS = 200000;
+   volatile double sink = 0;
+   std::clock_t start = std::clock();
+   for(int k=0; k<NUM_EVALS; ++k)
+   {
+      sink = sink + studentsTCdf<double,Policy>(11,(k%100)/10.0-5,ExactCdf());
+   }
+   double exactTime = double(std::clock()-start)/CLOCKS_PER_SEC;
+
+   start = std::clock();
+   for(int k=0; k<NUM_EVALS; ++k)
+   {
+      sink = sink + studentsTCdf<double,Policy>(11,(k%100)/10.0-5,FastCdf());
+   }
+   double fastTime = double(std::clock()-start)/CLOCKS_PER_SEC;
+
+   std::cout << NUM_EVALS << " CDF evaluations exact: " << exactTime
+      << "s fast: " << fastTime << 's' << std::endl;
+
+   return true;
+
+} // testCdfError
+
+/**
+ * Compares exact and fast VPI for a random distribution over a
+ * single variable, in which alpha takes the values produced by observations.
+ * @param[in] var id of a variable registered with the required domain size.
+ * @param[in] rng random number generator used to choose hyperparameters.
+ * @returns true iff fast VPI is within the stated error of exact VPI.
+ */
+bool testVPI(maxsum::VarID var, boost::mt19937& rng)
+{
+   //***************************************************************************
+   // Generate random hyperparameters for each element.
+   //***************************************************************************
+   VecDist dist;
+   expand(dist,var);
+
+   boost::uniform_real<> unirnd(0,1);
+   boost::normal_distribution<> normal;
+   boost::variate_generator<boost::mt19937&, boost::normal_distribution<> >
+      normrnd(rng,normal);
+   for(int k=0; k<dist.m.domainSize(); ++k)
+   {
+      int numObs = static_cast<int>(100*unirnd(rng));
+      dist.alpha(k) = NormalGamma::DEFAULT_ALPHA + 0.5*numObs;
+      dist.beta(k) = 0.1 + 10*unirnd(rng);
+      dist.lambda(k) = 0.5 + 20*unirnd(rng);
+      dist.m(k) = 10*normrnd();
+   }
+   resetLogGammaRatio(dist);
+
+   //***************************************************************************
+   // Time both modes
+   //***************************************************************************
+   maxsum::DiscreteFunction exactResult, fastResult;
+   std::clock_t start = std::clock();
+   for(int k=0; k<NUM_REPEATS_M; ++k)
+   {
+      dec_brl::exactVPI(dist,exactResult,ExactCdf());
+   }
+   double exactTime = double(std::clock()-start)/CLOCKS_PER_SEC;
+
+   start = std::clock();
+   for(int k=0; k<NUM_REPEATS_M; ++k)
+   {
+      dec_brl::exactVPI(dist,fastResult,FastCdf());
+   }
+   double fastTime = double(std::clock()-start)/CLOCKS_PER_SEC;
+
+   std::cout << "domain size: " << dist.m.domainSize() << " exact: "
+      << exactTime << "s fast: " << fastTime << 's' << std::endl;
+
+   //***************************************************************************
+   // Each result depends on the CDF multiplied by the distance between the
+   // expected value and the 1st or 2nd best value, so the error is bounded
+   // by the largest such distance times the CDF error.
+   //***************************************************************************
+   const maxsum::ValType bestVal = dist.m(dist.m.argmax());
+   maxsum::ValType maxDist = 0;
+   for(int k=0; k<dist.m.domainSize(); ++k)
+   {
+      maxDist = std::max(maxDist,bestVal-dist.m(k));
+   }
+   maxsum::ValType bound = maxDist * FastCdf::MAX_ABS_ERROR + 1e-12;
+   for(int k=0; k<dist.m.domainSize(); ++k)
+   {
+      if(bound < std::abs(exactResult(k)-fastResult(k)))
+      {
+         std::cout << "Inconsistent VPI at " << k << ": exact="
+            << exactResult(k) << " fast=" << fastResult(k) << std::endl;
+         return false;
+      }
+   }
+   return true;
+
+} // testVPI
+
+} // private module namespace
+
+/**
+ * Main function for harness - executes all tests.
+ */
+int main()
+{
+   try
+   {
+      if(!testCdfError())
+      {
+         return EXIT_FAILURE;
+      }
+
+      boost::mt19937 rng;
+
+      //************************************************************************
+      // Register one variable for each domain size to be tested.
+      //************************************************************************
+      const int NUM_SIZES = 4;
+      const maxsum::ValIndex sizes[NUM_SIZES] = {2, 16, 128, 1024};
+      for(int k=0; k<NUM_SIZES; ++k)
+      {
+         maxsum::registerVariable(k+1,sizes[k]);
+      }
+
+      for(int k=0; k<NUM_SIZES; ++k)
+      {
+         if(!testVPI(k+1,rng))
+         {
+            return EXIT_FAILURE;
+         }
+      }
+   }
+   catch(std::exception& e)
+   {
+      std::cout << "Caught error: " << e.what() << std::endl;
+      return EXIT_FAILURE;
+   }
+
+   //***************************************************************************
+   // If we get this far, everything is ok.
+   //***************************************************************************
+   std::cout << "Passed." << std::endl;
+   return EXIT_SUCCESS;
+
+} // function main
@@ -0,0 +1,233 @@
+/**
+ * @file flatVarMapHarness.cpp
+ * Test harness for dec_brl::FlatVarMap and dec_brl::FactorAccessPlan.
+ * Checks that FlatVarMap behaves like std::map for the operations used by
+ * the learners, that both it and FactorAccessPlan index
+ * maxsum::DiscreteFunction objects consistently, and that
+ * learners given states and actions in a FlatVarMap behave exactly as they
+ * do given a std::map.
+ */
+
+#include <exception>
+#include <iostream>
+#include <map>
+#include <boost/random/mersenne_twister.hpp>
+#include "dec_brl/FlatVarMap.h"
+#include "dec_brl/FactorAccessPlan.h"
+#include "dec_brl/DecBayesQ.h"
+#include "DiscreteFunction.h"
+#include "register.h"
+
+// private module namespace
+namespace
+{
+using namespace dec_brl;
+
+/**
+ * Standard map type used as a reference.
+ */
+typedef std::map<maxsum::VarID,maxsum::ValIndex> VarMap;
+
+/**
+ * Returns true iff a FlatVarMap contains the same key-value pairs as a
+ * std::map.
+ */
+bool isSame(const FlatVarMap& flat, const VarMap& ref)
+{
+   if(flat.size()!=ref.size())
+   {
+      std::cout << "Size mismatch: " << flat.size() << " vs " << ref.size()
+         << std::endl;
+      return false;
+   }
+   for(VarMap::const_iterator it=ref.begin(); it!=ref.end(); ++it)
+   {
+      FlatVarMap::const_iterator pos = flat.find(it->first);
+      if( (flat.end()==pos) || (it->second!=pos->second) )
+      {
+         std::cout << "Value mismatch for variable " << it->first
+            << std::endl;
+         return false;
+      }
+   }
+   return true;
+}
+
+/**
+ * Applies random operations to a FlatVarMap and a std::map, and checks that
+ * their contents stay the same.
+ */
+bool testMapSemantics(boost::mt19937& rng)
+{
+   FlatVarMap flat;
+   VarMap ref;
+   for(int k=0; k<10000; ++k)
+   {
+      const maxsum::VarID var = rng()%50;
+      const maxsum::ValIndex val = rng()%10;
+      switch(rng()%4)
+      {
+         case 0:
+            flat[var] = val;
+            ref[var] = val;
+            break;
+         case 1:
+            flat.insert(FlatVarMap::value_type(var,val));
+            ref.insert(VarMap::value_type(var,val));
+            break;
+         case 2:
+            if(flat.count(var)!=ref.count(var))
+            {
+               std::cout << "Count mismatch for " << var << std::endl;
+               return false;
+            }
+            break;
+         default:
+            if(0==rng()%20)
+            {
+               flat.clear();
+               ref.clear();
+            }
+      }
+      if(!isSame(flat,ref))
+      {
+         return false;
+      }
+   }
+
+   //***************************************************************************
+   // Range insertion does not overwrite existing values.
+   //***************************************************************************
+   VarMap other;
+   other[1] = 7;
+   other[60] = 3;
+   flat.insert(other.begin(),other.end());
+   ref.insert(other.begin(),other.end());
+   return isSame(flat,ref);
+
+} // testMapSemantics
+
+/**
+ * Checks that a DiscreteFunction returns the same values when indexed by
+ * a FlatVarMap and a std::map, and that a FactorAccessPlan for the function
+ * maps both to the same linear index.
+ */
+bool testFunctionIndex()
+{
+   const maxsum::VarID vars[] = {2, 5, 9};
+   maxsum::DiscreteFunction fun(vars,vars+3,0.0);
+   for(maxsum::ValIndex k=0; k<fun.domainSize(); ++k)
+   {
+      fun(k) = k;
+   }
+
+   const FactorAccessPlan plan(fun.varBegin(),fun.varEnd());
+   if(plan.domainSize()!=fun.domainSize())
+   {
+      std::cout << "Access plan domain size mismatch" << std::endl;
+      return false;
+   }
+
+   VarMap ref;
+   FlatVarMap flat;
+   for(maxsum::ValIndex k=0; k<fun.domainSize(); ++k)
+   {
+      ref[9] = k%3; ref[2] = (k/3)%2; ref[5] = k/6; ref[4] = 1;
+      flat.clear();
+      flat.insert(ref.begin(),ref.end());
+      if(fun(ref)!=fun(flat))
+      {
+         std::cout << "Function index mismatch at " << k << std::endl;
+         return false;
+      }
+      if( (fun(plan.index(ref))!=fun(ref)) ||
+          (plan.index(flat)!=plan.index(ref)) )
+      {
+         std::cout << "Access plan index mismatch at " << k << std::endl;
+         return false;
+      }
+   }
+   return true;
+
+} // testFunctionIndex
+
+/**
+ * Runs two learners side by side on a small problem with one state and
+ * two action variables, passing one std::map and the other FlatVarMap.
+ * @returns true iff both choose the same actions at every step.
+ */
+bool testLearner()
+{
+   DecBayesQ refLearner, flatLearner;
+   const maxsum::VarID vars[] = {2, 5, 9};
+   refLearner.addFactor(1,vars,vars+3);
+   flatLearner.addFactor(1,vars,vars+3);
+
+   VarMap refPrior, refAction, refPost;
+   FlatVarMap flatPrior, flatAction, flatPost;
+   std::map<maxsum::FactorID,double> reward;
+   refPost[5] = 0;
+   flatPost[5] = 0;
+
+   for(int t=0; t<200; ++t)
+   {
+      refPrior.swap(refPost);
+      flatPrior.swap(flatPost);
+      refLearner.act(refPrior,refAction);
+      flatLearner.act(flatPrior,flatAction);
+      if(!isSame(flatAction,refAction))
+      {
+         std::cout << "Learner actions diverged at step " << t << std::endl;
+         return false;
+      }
+
+      //************************************************************************
+      // Reward agreeing actions, and the state toggles with the first action.
+      //************************************************************************
+      const maxsum::ValIndex state = refPrior[5];
+      reward[1] = (refAction[2]==refAction[9]) ? 1.0+state : -1.0;
+      refPost.clear();
+      flatPost.clear();
+      refPost[5] = (state+refAction[2])%2;
+      flatPost[5] = refPost[5];
+
+      refLearner.observe(refPrior,refAction,refPost,reward);
+      flatLearner.observe(flatPrior,flatAction,flatPost,reward);
+   }
+   return true;
+
+} // testLearner
+
+} // private module namespace
+
+/**
+ * Main function for harness - executes all tests.
+ */
+int main()
+{
+   try
+   {
+      boost::mt19937 rng;
+      maxsum::registerVariable(2,2);
+      maxsum::registerVariable(4,2);
+      maxsum::registerVariable(5,2);
+      maxsum::registerVariable(9,3);
+
+      if(!testMapSemantics(rng) || !testFunctionIndex() || !testLearner())
+      {
+         return EXIT_FAILURE;
+      }
+   }
+   catch(std::exception& e)
+   {
+      std::cout << "Caught error: " << e.what() << std::endl;
+      return EXIT_FAILURE;
+   }
+
+   //***************************************************************************
+   // If we get this far, everything is ok.
+   //***************************************************************************
+   std::cout << "Passed." << std::endl;
+   return EXIT_SUCCESS;
+
+} // function main
@@ -0,0 +1,419 @@
+/**
+ * @file greedyCacheHarness.cpp
+ * Test harness for reuse of max-sum solutions and messages between observe
+ * and act, and between the passes of act.
+ * Runs each learner on the factored MDP used by bqFacMDPHarness.cpp, and at
+ * every timestep checks that its actions are the same as those chosen by a
+ * copy of it, which cannot reuse its greedy solution. Also checks that
+ * DecBayesQ chooses the same actions whether or not it notifies max-sum of
+ * unchanged factors, that skipped changes never drift further than the
+ * tolerance from the value max-sum was last notified of, and reports how
+ * many notifications are skipped for a range of tolerances.
+ */
+
+#include <exception>
+#include <iostream>
+#include <map>
+#include <boost/random/mersenne_twister.hpp>
+#include "dec_brl/GreedySolutionCache.h"
+#include "dec_brl/DecBayesQ.h"
+#include "dec_brl/DecBayesModelLearner.h"
+#include "dec_brl/LearningSolver.h"
+#include "dec_brl/DecQLearner.h"
+#include "register.h"
+#include "DiscreteFunction.h"
+
+/**
+ * Private Module namespace.
+ */
+namespace {
+
+using namespace dec_brl;
+
+/**
+ * Number of timesteps for which each learner is run.
+ */
+const int NUM_TIMESTEPS_M = 1000;
+
+/**
+ * Number of initial timesteps in which the learner is forced to perform
+ * random actions, so that it observes a wide range of rewards.
+ */
+const int NUM_RANDOM_STEPS_M = 200;
+
+/**
+ * A Simple Factored MDP for testing, identical to the one used by
+ * bqFacMDPHarness.cpp.
+ */
+class MultiFactorMDP
+{
+public:
+
+   /**
+    * Map type used to pass action and state values around.
+    */
+   typedef std::map<maxsum::VarID,maxsum::ValIndex> VarMap;
+
+   /**
+    * Map type for passing back Factored Rewards
+    */
+   typedef std::map<maxsum::FactorID,double> RewardMap;
+
+private:
+
+   /**
+    * Map containing the state variable mapped to its current value.
+    */
+   VarMap state_i;
+
+public:
+
+   /**
+    * Number of possible values for each variable.
+    */
+   const static int NUM_VALS = 2;
+
+   /**
+    * Default Constructor.
+    */
+   MultiFactorMDP() : state_i()
+   {
+      //************************************************************************
+      // Register the state and action variables with the maxsum library
+      //************************************************************************
+      for(int v=0; v<=8; ++v)
+      {
+         maxsum::registerVariable(v,NUM_VALS);
+      }
+
+      //************************************************************************
+      // Set the current state: first state is filled, rest are all empty
+      //************************************************************************
+      state_i[1] = 1;
+      for(int s=3; s<=7; s+=2)
+      {
+         state_i[s] = 0;
+      }
+
+   } // default constructor.
+
+   /**
+    * Inform learner of the factors defined by this MDP.
+    */
+   template<class Learner> void addFactors(Learner& learner)
+   {
+      int varIds[3];
+      for(int factor=1; factor<=7; factor+=2)
+      {
+         varIds[0]=factor-1;
+         varIds[1]=factor;
+         varIds[2]=factor+1;
+         learner.addFactor(factor,varIds,varIds+3);
+      }
+   }
+
+   /**
+    * Get the current state value.
+    */
+   VarMap& getState()
+   {
+      return state_i;
+   }
+
+   /**
+    * Perform an action and return the resulting reward.
+    * @returns total reward
+    */
+   double act(VarMap& action, RewardMap& reward)
+   {
+      double totReward = 0;
+      for(int s=1; s<=7; s+=2)
+      {
+         if( (1==action[s-1]) && (0==action[s+1]) && (1==state_i[s]) )
+         {
+            state_i[s]=0;
+            reward[s]=s*10;
+         }
+         else if(1==state_i[s])
+         {
+            reward[s] = (-s);
+         }
+         else if( (0==action[s-1]) && (1==action[s+1]) )
+         {
+            state_i[s]=1;
+            reward[s]=0;
+         }
+         else
+         {
+            reward[s]=0;
+         }
+         totReward += reward[s];
+      }
+      return totReward;
+
+   } // method act
+
+}; // class MultiFactorMDP
+
+/**
+ * Runs a learner on the MDP, and at each timestep, checks that it chooses
+ * the same actions as a copy made immediately beforehand.
+ * @returns true iff the actions are always the same, and the learner
+ * reused its greedy solution at least once.
+ */
+template<class Learner> bool runCheck(Learner& learner, const char* name)
+{
+   MultiFactorMDP mdp;
+   mdp.addFactors(learner);
+
+   MultiFactorMDP::VarMap prior, post(mdp.getState()), action, copyAction;
+   MultiFactorMDP::RewardMap reward;
+
+   boost::mt19937 rng;
+   double total = 0;
+   for(int t=0; t<NUM_TIMESTEPS_M; ++t)
+   {
+      post.swap(prior);
+
+      Learner copy(learner);
+      copy.act(prior,copyAction);
+      learner.act(prior,action);
+      if(action!=copyAction)
+      {
+         std::cout << name << ": actions differ from copy at timestep " << t
+            << std::endl;
+         return false;
+      }
+
+      if(NUM_RANDOM_STEPS_M>t)
+      {
+         for(int a=0; a<=8; a+=2)
+         {
+            action[a] = rng()%MultiFactorMDP::NUM_VALS;
+         }
+      }
+
+      post = mdp.getState();
+      total += mdp.act(action,reward);
+      learner.observe(prior,action,post,reward);
+   }
+
+   std::cout << name << " mean reward: " << total/NUM_TIMESTEPS_M
+      << " greedy solutions reused: " << learner.getGreedyReuseCount()
+      << std::endl;
+   if(0==learner.getGreedyReuseCount())
+   {
+      std::cout << name << ": greedy solution never reused" << std::endl;
+      return false;
+   }
+   return true;
+
+} // runCheck
+
+/**
+ * Runs DecBayesQ learners with different notify tolerances side by side,
+ * and checks that a learner with the default tolerance chooses the same
+ * actions as one that always notifies max-sum.
+ */
+bool testNotifyTolerance()
+{
+   const int NUM_LEARNERS = 4;
+   const maxsum::ValType tolerances[NUM_LEARNERS] = {-1, 0, 1e-1, 1};
+   MultiFactorMDP mdps[NUM_LEARNERS];
+   DecBayesQ learners[NUM_LEARNERS];
+   MultiFactorMDP::VarMap prior[NUM_LEARNERS], post[NUM_LEARNERS];
+   MultiFactorMDP::VarMap action[NUM_LEARNERS];
+   MultiFactorMDP::RewardMap reward;
+   double total[NUM_LEARNERS];
+   for(int k=0; k<NUM_LEARNERS; ++k)
+   {
+      mdps[k].addFactors(learners[k]);
+      learners[k].setNotifyTolerance(tolerances[k]);
+      post[k] = mdps[k].getState();
+      total[k] = 0;
+   }
+
+   boost::mt19937 rng;
+   for(int t=0; t<NUM_TIMESTEPS_M; ++t)
+   {
+      MultiFactorMDP::VarMap randomAction;
+      for(int a=0; a<=8; a+=2)
+      {
+         randomAction[a] = rng()%MultiFactorMDP::NUM_VALS;
+      }
+
+      for(int k=0; k<NUM_LEARNERS; ++k)
+      {
+         post[k].swap(prior[k]);
+         learners[k].act(prior[k],action[k]);
+         if(NUM_RANDOM_STEPS_M>t)
+         {
+            action[k] = randomAction;
+         }
+         post[k] = mdps[k].getState();
+         total[k] += mdps[k].act(action[k],reward);
+         learners[k].observe(prior[k],action[k],post[k],reward);
+      }
+
+      if(action[0]!=action[1])
+      {
+         std::cout << "Skipping unchanged factors changed actions at "
+            "timestep " << t << std::endl;
+         return false;
+      }
+   }
+
+   for(int k=0; k<NUM_LEARNERS; ++k)
+   {
+      std::cout << "notify tolerance: " << tolerances[k] << " mean reward: "
+         << total[k]/NUM_TIMESTEPS_M << " notified: "
+         << learners[k].getNoNotifications() << " skipped: "
+         << learners[k].getNoSkippedNotifications() << " skipped messages: "
+         << learners[k].getNoSkippedMessages() << " max unnotified change: "
+         << learners[k].getMaxUnnotifiedChange() << std::endl;
+   }
+   if( (0!=learners[0].getNoSkippedNotifications()) ||
+       (0!=learners[0].getNoSkippedMessages()) )
+   {
+      std::cout << "Negative tolerance skipped notifications" << std::endl;
+      return false;
+   }
+   for(int k=1; k<NUM_LEARNERS; ++k)
+   {
+      if(learners[k].getNoSkippedMessages() <
+            learners[k].getNoSkippedNotifications())
+      {
+         std::cout << "Skipped notifications saved no messages" << std::endl;
+         return false;
+      }
+
+      //************************************************************************
+      // Skipped changes are measured from the last notified value, so
+      // however many are skipped in a row, max-sum's view of each factor
+      // is never further than the tolerance from its true value.
+      //************************************************************************
+      if(learners[k].getMaxUnnotifiedChange() > tolerances[k])
+      {
+         std::cout << "notify tolerance: " << tolerances[k]
+            << " skipped changes accumulated to "
+            << learners[k].getMaxUnnotifiedChange() << std::endl;
+         return false;
+      }
+   }
+   if(0==learners[NUM_LEARNERS-1].getNoSkippedNotifications())
+   {
+      std::cout << "Positive tolerance skipped no notifications" << std::endl;
+      return false;
+   }
+   return true;
+
+} // testNotifyTolerance
+
+/**
+ * Checks that a GreedySolutionCache is only invalidated by updates to the
+ * slice of a factor conditioned on its states.
+ */
+bool testCache()
+{
+   GreedySolutionCache cache;
+   MultiFactorMDP::VarMap states, other, updated;
+   states[1] = 1;
+   states[3] = 0;
+   other[1] = 0;
+   other[3] = 0;
+   const maxsum::VarID vars[] = {0, 1, 2};
+
+   if(cache.reuse(states))
+   {
+      std::cout << "Empty cache reused" << std::endl;
+      return false;
+   }
+
+   cache.store(states,3);
+   if(cache.reuse(other) || !cache.reuse(states))
+   {
+      std::cout << "Cache reused for wrong states" << std::endl;
+      return false;
+   }
+   if(3!=cache.noIterations())
+   {
+      std::cout << "Wrong cached iteration count: " << cache.noIterations()
+         << std::endl;
+      return false;
+   }
+
+   updated = other;
+   updated[0] = 1;
+   updated[2] = 0;
+   cache.update(vars,vars+3,updated);
+   if(!cache.reuse(states))
+   {
+      std::cout << "Cache invalidated by update outside its slice"
+         << std::endl;
+      return false;
+   }
+
+   updated[1] = 1;
+   cache.update(vars,vars+3,updated);
+   if(cache.reuse(states))
+   {
+      std::cout << "Cache not invalidated by update to its slice"
+         << std::endl;
+      return false;
+   }
+   return true;
+
+} // testCache
+
+} // module namespace
+
+/**
+ * Main function for harness - executes all tests.
+ */
+int main()
+{
+   try
+   {
+      MultiFactorMDP mdp; // registers variables
+      if(!testCache())
+      {
+         return EXIT_FAILURE;
+      }
+
+      DecQLearner qLearner(DecQLearner::DEFAULT_ALPHA,
+            DecQLearner::DEFAULT_GAMMA,0.0);
+      if(!runCheck(qLearner,"DecQLearner"))
+      {
+         return EXIT_FAILURE;
+      }
+
+      DecBayesQ bayesQ;
+      if(!runCheck(bayesQ,"DecBayesQ"))
+      {
+         return EXIT_FAILURE;
+      }
+
+      if(!testNotifyTolerance())
+      {
+         return EXIT_FAILURE;
+      }
+
+      DecBayesModelLearner<LearningSolver<DecQLearner> > modelLearner;
+      if(!runCheck(modelLearner,"DecBayesModelLearner"))
+      {
+         return EXIT_FAILURE;
+      }
+   }
+   catch(std::exception& e)
+   {
+      std::cout << "Caught error: " << e.what() << std::endl;
+      return EXIT_FAILURE;
+   }
+
+   //***************************************************************************
+   // If we get this far, everything is ok.
+   //***************************************************************************
+   std::cout << "Passed." << std::endl;
+   return EXIT_SUCCESS;
+
+} // function main
@@ -0,0 +1,219 @@
+/**
+ * @file lazyCPTHarness.cpp
+ * Test harness and microbenchmark for lazily sampled CPTs in
+ * dec_brl::SampledTransProb.
+ * Checks that lazy CPTs only sample and store the columns that are queried,
+ * that each column is reused until the CPT is redrawn, and that lazily
+ * sampled columns follow the posterior. Reports the time taken to sample a model
+ * and perform a short rollout, with and without lazy sampling.
+ */
+
+#include <dec_brl/TransBelief.h>
+#include "register.h"
+#include <cmath>
+#include <ctime>
+#include <iostream>
+#include <boost/random/mersenne_twister.hpp>
+
+/**
+ * Private module namespace.
+ */
+namespace {
+
+    /**
+     * Number of condition variables, which are also the domain variables.
+     */
+    const int NUM_VARS_M = 4;
+
+    /**
+     * Domain size of each variable.
+     */
+    const int VAR_SIZE_M = 6;
+
+    /**
+     * Number of models sampled to check the posterior mean, and to time
+     * model sampling.
+     */
+    const int NUM_MODELS_M = 200;
+
+    /**
+     * Number of transitions drawn from each sampled model.
+     */
+    const int ROLLOUT_LENGTH_M = 20;
+
+    /**
+     * Checks that a lazy CPT only samples the columns that are queried,
+     * and that queried columns are reused until the CPT is redrawn.
+     */
+    int testMemoisation(dec_brl::TransBelief& beliefs)
+    {
+        boost::mt19937 randGenerator;
+        dec_brl::SampledTransProb cpt(beliefs,randGenerator,false,true);
+        for(int c=0; c<beliefs.condSize(); ++c)
+        {
+            if(cpt.isColumnDrawn(c))
+            {
+                std::cout << "Column " << c << " sampled before query"
+                << std::endl;
+                return EXIT_FAILURE;
+            }
+        }
+
+        //**********************************************************************
+        //  Draw repeatedly from the same condition, which should only sample
+        //  one column, and leave it unchanged.
+        //**********************************************************************
+        Eigen::VectorXi prevStates(NUM_VARS_M+1), nxtStates(NUM_VARS_M+1);
+        prevStates.setZero();
+        nxtStates.setZero();
+        prevStates[2] = 1;
+        int condInd = VAR_SIZE_M; // 2nd condition variable is 1, rest are 0
+        cpt.drawNextStates(randGenerator, prevStates, nxtStates);
+        Eigen::VectorXd column = cpt.getColumn(randGenerator,condInd);
+        for(int k=0; k<100; ++k)
+        {
+            cpt.drawNextStates(randGenerator, prevStates, nxtStates);
+        }
+        if(!cpt.isColumnDrawn(condInd) || cpt.isColumnDrawn(0) ||
+           (1!=cpt.noColumnsDrawn()) ||
+           (column!=cpt.getColumn(randGenerator,condInd)))
+        {
+            std::cout << "Queried column not reused" << std::endl;
+            return EXIT_FAILURE;
+        }
+        if(0!=cpt.getCPT().size())
+        {
+            std::cout << "Lazy CPT allocated the full table" << std::endl;
+            return EXIT_FAILURE;
+        }
+        if(std::abs(column.sum()-1) > 1e-9)
+        {
+            std::cout << "Lazy column does not sum to one" << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        //**********************************************************************
+        //  Redrawing should discard the column, and give a different one
+        //  when it is next queried.
+        //**********************************************************************
+        cpt.drawNewCPT(randGenerator);
+        if(cpt.isColumnDrawn(condInd) || (0!=cpt.noColumnsDrawn()))
+        {
+            std::cout << "Column not discarded after redraw" << std::endl;
+            return EXIT_FAILURE;
+        }
+        if(column==cpt.getColumn(randGenerator,condInd))
+        {
+            std::cout << "Column unchanged after redraw" << std::endl;
+            return EXIT_FAILURE;
+        }
+        return EXIT_SUCCESS;
+
+    } // testMemoisation
+
+    /**
+     * Checks that the mean of lazily sampled columns is close to the
+     * posterior mean.
+     */
+    int testPosteriorMean(dec_brl::TransBelief& beliefs)
+    {
+        boost::mt19937 randGenerator;
+        dec_brl::SampledTransProb cpt(beliefs,randGenerator,false,true);
+        const int condInd = beliefs.condSize()/2;
+        Eigen::VectorXd sampleMean(beliefs.domainSize());
+        sampleMean.setZero();
+        for(int k=0; k<NUM_MODELS_M; ++k)
+        {
+            cpt.drawNewCPT(randGenerator);
+            sampleMean += cpt.getColumn(randGenerator,condInd);
+        }
+        sampleMean /= NUM_MODELS_M;
+
+        Eigen::VectorXd expected;
+        beliefs.getMeanByInd(expected,condInd);
+        double maxDiff = (sampleMean-expected).array().abs().maxCoeff();
+        double stdErr = std::sqrt(expected.maxCoeff()/NUM_MODELS_M);
+        if(maxDiff > 6*stdErr)
+        {
+            std::cout << "Lazy sample mean differs from posterior by "
+            << maxDiff << std::endl;
+            return EXIT_FAILURE;
+        }
+        return EXIT_SUCCESS;
+
+    } // testPosteriorMean
+
+    /**
+     * Returns the time taken to sample NUM_MODELS_M models, and draw a
+     * rollout of ROLLOUT_LENGTH_M transitions from each.
+     */
+    double rolloutTime(dec_brl::SampledTransProb& cpt)
+    {
+        boost::mt19937 randGenerator;
+        Eigen::VectorXi prevStates(NUM_VARS_M+1), nxtStates(NUM_VARS_M+1);
+        std::clock_t start = std::clock();
+        for(int m=0; m<NUM_MODELS_M; ++m)
+        {
+            cpt.drawNewCPT(randGenerator);
+            nxtStates.setZero();
+            for(int t=0; t<ROLLOUT_LENGTH_M; ++t)
+            {
+                prevStates.swap(nxtStates);
+                cpt.drawNextStates(randGenerator, prevStates, nxtStates);
+            }
+        }
+        return double(std::clock()-start)/CLOCKS_PER_SEC;
+
+    } // rolloutTime
+
+} // module namespace
+
+/**
+ * Main function.
+ */
+int main()
+{
+    using namespace dec_brl;
+
+    //**************************************************************************
+    // Register test variables, and create beliefs about their transition
+    // probabilities given their previous values.
+    //**************************************************************************
+    Eigen::VectorXi vars(NUM_VARS_M);
+    for(int k=0; k<NUM_VARS_M; ++k)
+    {
+        vars[k] = k+1;
+        maxsum::registerVariable(vars[k],VAR_SIZE_M);
+    }
+    TransBelief beliefs(vars,vars);
+    beliefs.observeByInd(beliefs.condSize()/2, 3);
+    beliefs.observeByInd(beliefs.condSize()/2, 3);
+
+    if( (EXIT_SUCCESS!=testMemoisation(beliefs)) ||
+        (EXIT_SUCCESS!=testPosteriorMean(beliefs)) )
+    {
+        return EXIT_FAILURE;
+    }
+    std::cout << "Lazy sampling OK" << std::endl;
+
+    //**************************************************************************
+    // Compare the time taken to sample models and perform short rollouts.
+    //**************************************************************************
+    boost::mt19937 randGenerator;
+    SampledTransProb eagerCPT(beliefs,randGenerator);
+    SampledTransProb lazyCPT(beliefs,randGenerator,false,true);
+    double eagerTime = rolloutTime(eagerCPT);
+    double lazyTime = rolloutTime(lazyCPT);
+    std::cout << "table size: " << beliefs.domainSize() << " x "
+    << beliefs.condSize() << " models: " << NUM_MODELS_M
+    << " rollout length: " << ROLLOUT_LENGTH_M
+    << " eager time: " << eagerTime << "s lazy time: " << lazyTime << "s"
+    << std::endl;
+
+    //**************************************************************************
+    // If we get this far, everything passed.
+    //**************************************************************************
+    std::cout << "All lazy CPT tests passed" << std::endl;
+    return EXIT_SUCCESS;
+
+} // function main
@@ -0,0 +1,544 @@
+/**
+ * @file observeBenchHarness.cpp
+ * Test harness and microbenchmark for the fused whole-function observe
+ * kernels and batched observe in NormalGamma.h.
+ * Checks that the fused kernels give the same results as updating each
+ * hyperparameter with DiscreteFunction arithmetic, and expand hyperparameters
+ * with smaller domains first, that batched observations
+ * give the same results as observing each in turn, that interleaved
+ * hyperparameters give the same results as separate ones, and reports the
+ * time taken by each across a range of domain sizes.
+ */
+
+#include <cmath>
+#include <ctime>
+#include <exception>
+#include <iostream>
+#include <map>
+#include <utility>
+#include <vector>
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/uniform_real.hpp>
+#include "dec_brl/NormalGamma.h"
+#include "dec_brl/InterleavedNormalGamma.h"
+#include "dec_brl/DecBayesQ.h"
+#include "DiscreteFunction.h"
+#include "register.h"
+
+// private module namespace
+namespace
+{
+using namespace dec_brl::dist;
+
+/**
+ * Type of vectorised parameter distribution used for testing.
+ */
+typedef NormalGamma_Tmpl<maxsum::DiscreteFunction> VecDist;
+
+/**
+ * Type of cached vectorised parameter distribution used for testing.
+ */
+typedef CachedNormalGamma_Tmpl<maxsum::DiscreteFunction> CachedVecDist;
+
+/**
+ * Total number of element updates performed for each timing run, so that
+ * small domains are repeated more often than large ones.
+ */
+const long NUM_ELEMENT_UPDATES_M = 1L << 24;
+
+/**
+ * Number of observations in each batch passed to observeBatch.
+ */
+const int BATCH_SIZE_M = 1 << 20;
+
+/**
+ * Number of transitions observed by each learner in testLearnerObserve.
+ */
+const int NUM_TRANSITIONS_M = 1 << 20;
+
+/**
+ * Reference single observation update using DiscreteFunction arithmetic,
+ * which makes several passes and allocates two temporaries.
+ */
+void referenceObserve(VecDist& dist, maxsum::ValType x)
+{
+   maxsum::DiscreteFunction newLambda(dist.lambda);
+   newLambda += 1;
+   dist.alpha += 0.5;
+
+   maxsum::DiscreteFunction tmp(dist.m);
+   tmp -= x;
+   tmp *= tmp;
+   tmp *= dist.lambda;
+   tmp /= 2.0;
+   tmp /= newLambda;
+   dist.beta += tmp;
+
+   dist.m *= dist.lambda;
+   dist.m += x;
+   dist.m /= newLambda;
+   dist.lambda.swap(newLambda);
+}
+
+/**
+ * Reference sufficient statistics update using DiscreteFunction arithmetic.
+ */
+void referenceObserve
+(
+ VecDist& dist,
+ maxsum::ValType sm,
+ maxsum::ValType s2,
+ int n
+)
+{
+   maxsum::DiscreteFunction newLambda(dist.lambda);
+   newLambda += n;
+   dist.alpha += n/2.0;
+
+   maxsum::DiscreteFunction tmp(dist.m);
+   tmp -= sm;
+   tmp *= tmp;
+   tmp *= dist.lambda;
+   tmp *= n/2.0;
+   tmp /= newLambda;
+   dist.beta += s2/2.0;
+   dist.beta += tmp;
+
+   dist.m *= dist.lambda;
+   dist.m += n*sm;
+   dist.m /= newLambda;
+   dist.lambda.swap(newLambda);
+}
+
+/**
+ * Generates a distribution with random hyperparameters.
+ */
+template<class Dist>
+void randomDist(maxsum::VarID var, boost::mt19937& rng, Dist& dist)
+{
+   expand(dist,var);
+   boost::uniform_real<> unirnd(0,1);
+   for(int k=0; k<dist.m.domainSize(); ++k)
+   {
+      dist.alpha(k) = 1.0 + 10*unirnd(rng);
+      dist.beta(k) = 0.1 + 10*unirnd(rng);
+      dist.lambda(k) = 0.5 + 5*unirnd(rng);
+      dist.m(k) = 20*unirnd(rng) - 10;
+   }
+}
+
+/**
+ * Returns true iff each hyperparameter of two distributions is identical.
+ */
+bool isSame(const VecDist& d1, const VecDist& d2)
+{
+   for(int k=0; k<d1.m.domainSize(); ++k)
+   {
+      if( (d1.alpha(k)!=d2.alpha(k)) || (d1.beta(k)!=d2.beta(k)) ||
+          (d1.lambda(k)!=d2.lambda(k)) || (d1.m(k)!=d2.m(k)) )
+      {
+         std::cout << "Fused update inconsistent at " << k << std::endl;
+         return false;
+      }
+   }
+   return true;
+}
+
+/**
+ * Returns true iff two values differ only by accumulated rounding error.
+ */
+bool isClose(maxsum::ValType v1, maxsum::ValType v2)
+{
+   const maxsum::ValType TOL = 1e-8;
+   return TOL*(1+std::abs(v2)) >= std::abs(v1-v2);
+}
+
+/**
+ * Checks fused updates against the reference updates, and reports the time
+ * taken by both, for a domain of the specified variable.
+ */
+bool testDomain(maxsum::VarID var, boost::mt19937& rng)
+{
+   VecDist fused;
+   randomDist(var,rng,fused);
+   VecDist reference(fused);
+
+   //***************************************************************************
+   // Check results are identical.
+   //***************************************************************************
+   observe(fused,2.5);
+   referenceObserve(reference,2.5);
+   observe(fused,-1.5,3.0,4);
+   referenceObserve(reference,-1.5,3.0,4);
+   if(!isSame(fused,reference))
+   {
+      return false;
+   }
+
+   //***************************************************************************
+   // Time both.
+   //***************************************************************************
+   const int size = fused.m.domainSize();
+   const long repeats = NUM_ELEMENT_UPDATES_M / size;
+
+   std::clock_t start = std::clock();
+   for(long r=0; r<repeats; ++r)
+   {
+      referenceObserve(reference,0.5,1.0,2);
+   }
+   double referenceTime = double(std::clock()-start)/CLOCKS_PER_SEC;
+
+   start = std::clock();
+   for(long r=0; r<repeats; ++r)
+   {
+      observe(fused,0.5,1.0,2);
+   }
+   double fusedTime = double(std::clock()-start)/CLOCKS_PER_SEC;
+
+   std::cout << "domain size: " << size << " x " << repeats
+      << " updates reference: " << referenceTime << "s fused: " << fusedTime
+      << 's' << std::endl;
+
+   return isSame(fused,reference);
+
+} // testDomain
+
+/**
+ * Checks that whole-function updates expand hyperparameters with smaller
+ * domains before updating them, giving the same result as updating a
+ * distribution whose hyperparameters were all expanded beforehand.
+ */
+bool testMismatchedDomains(maxsum::VarID var, boost::mt19937& rng)
+{
+   CachedVecDist partial;
+   partial.m.expand(var);
+   boost::uniform_real<> unirnd(0,1);
+   for(int k=0; k<partial.m.domainSize(); ++k)
+   {
+      partial.m(k) = 20*unirnd(rng) - 10;
+   }
+   CachedVecDist expanded(partial);
+   expand(expanded,var);
+
+   observe(partial,2.5);
+   observe(expanded,2.5);
+   observe(partial,-1.5,3.0,4);
+   observe(expanded,-1.5,3.0,4);
+   if( (partial.alpha.domainSize()!=expanded.alpha.domainSize()) ||
+       (partial.beta.domainSize()!=expanded.beta.domainSize()) ||
+       (partial.lambda.domainSize()!=expanded.lambda.domainSize()) ||
+       (partial.lgammaRatio.domainSize()!=expanded.lgammaRatio.domainSize()) )
+   {
+      std::cout << "Hyperparameters not expanded before update" << std::endl;
+      return false;
+   }
+   for(int k=0; k<expanded.lgammaRatio.domainSize(); ++k)
+   {
+      if(partial.lgammaRatio(k)!=expanded.lgammaRatio(k))
+      {
+         std::cout << "Log gamma ratio inconsistent at " << k << std::endl;
+         return false;
+      }
+   }
+   return isSame(partial,expanded);
+
+} // testMismatchedDomains
+
+/**
+ * Checks that observing a batch of observations gives the same result as
+ * observing each in turn, and reports the time taken by both.
+ */
+bool testBatch(maxsum::VarID var, boost::mt19937& rng)
+{
+   CachedVecDist batched;
+   randomDist(var,rng,batched);
+   resetLogGammaRatio(batched);
+   CachedVecDist sequential(batched);
+
+   //***************************************************************************
+   // Generate a batch of observations with repeated indices.
+   //***************************************************************************
+   const int size = batched.m.domainSize();
+   boost::uniform_real<> unirnd(0,1);
+   typedef std::pair<maxsum::ValIndex,maxsum::ValType> Observation;
+   std::vector<Observation> obs(BATCH_SIZE_M);
+   for(int k=0; k<BATCH_SIZE_M; ++k)
+   {
+      obs[k].first = static_cast<maxsum::ValIndex>(size*unirnd(rng));
+      obs[k].second = 10*unirnd(rng) - 5;
+   }
+
+   //***************************************************************************
+   // Time both.
+   //***************************************************************************
+   std::clock_t start = std::clock();
+   for(int k=0; k<BATCH_SIZE_M; ++k)
+   {
+      observe(sequential,obs[k].first,obs[k].second);
+   }
+   double sequentialTime = double(std::clock()-start)/CLOCKS_PER_SEC;
+
+   start = std::clock();
+   observeBatch(batched,obs.begin(),obs.end());
+   double batchTime = double(std::clock()-start)/CLOCKS_PER_SEC;
+
+   std::cout << "domain size: " << size << " batch of " << BATCH_SIZE_M
+      << " sequential: " << sequentialTime << "s batched: " << batchTime
+      << 's' << std::endl;
+
+   //***************************************************************************
+   // Observe the same batch again in two halves, reusing scratch space,
+   // which should be left zeroed after each half.
+   //***************************************************************************
+   ObserveBatchScratch scratch;
+   const std::vector<Observation>::iterator mid = obs.begin()+BATCH_SIZE_M/2;
+   observeBatch(batched,obs.begin(),mid,scratch);
+   observeBatch(batched,mid,obs.end(),scratch);
+   for(int k=0; k<BATCH_SIZE_M; ++k)
+   {
+      observe(sequential,obs[k].first,obs[k].second);
+   }
+   for(int k=0; k<static_cast<int>(scratch.count.size()); ++k)
+   {
+      if( (0!=scratch.count[k]) || (0!=scratch.mean[k]) ||
+          (0!=scratch.s2[k]) )
+      {
+         std::cout << "Scratch space not reset at " << k << std::endl;
+         return false;
+      }
+   }
+
+   //***************************************************************************
+   // Results should only differ by rounding.
+   //***************************************************************************
+   for(int k=0; k<size; ++k)
+   {
+      if( !isClose(batched.alpha(k),sequential.alpha(k)) ||
+          !isClose(batched.beta(k),sequential.beta(k)) ||
+          !isClose(batched.lambda(k),sequential.lambda(k)) ||
+          !isClose(batched.m(k),sequential.m(k)) ||
+          !isClose(batched.lgammaRatio(k),sequential.lgammaRatio(k)) )
+      {
+         std::cout << "Batched update inconsistent at " << k << std::endl;
+         return false;
+      }
+   }
+   return true;
+
+} // testBatch
+
+/**
+ * Checks that interleaved hyperparameters round trip through the separate
+ * layout, and that random access updates give identical results in both
+ * layouts, and reports the time taken by both.
+ */
+bool testInterleaved(maxsum::VarID var, boost::mt19937& rng)
+{
+   CachedVecDist separate;
+   randomDist(var,rng,separate);
+   resetLogGammaRatio(separate);
+   InterleavedNormalGamma interleaved;
+   toInterleaved(separate,interleaved);
+
+   //***************************************************************************
+   // Generate random element indices and observations.
+   //***************************************************************************
+   const int size = separate.m.domainSize();
+   boost::uniform_real<> unirnd(0,1);
+   typedef std::pair<maxsum::ValIndex,maxsum::ValType> Observation;
+   std::vector<Observation> obs(BATCH_SIZE_M);
+   for(int k=0; k<BATCH_SIZE_M; ++k)
+   {
+      obs[k].first = static_cast<maxsum::ValIndex>(size*unirnd(rng));
+      obs[k].second = 10*unirnd(rng) - 5;
+   }
+
+   //***************************************************************************
+   // Time both.
+   //***************************************************************************
+   std::clock_t start = std::clock();
+   for(int k=0; k<BATCH_SIZE_M; ++k)
+   {
+      observe<maxsum::ValIndex>(separate,obs[k].first,obs[k].second,1.0,1);
+   }
+   double separateTime = double(std::clock()-start)/CLOCKS_PER_SEC;
+
+   start = std::clock();
+   for(int k=0; k<BATCH_SIZE_M; ++k)
+   {
+      observe<maxsum::ValIndex>(interleaved,obs[k].first,obs[k].second,1.0,1);
+   }
+   double interleavedTime = double(std::clock()-start)/CLOCKS_PER_SEC;
+
+   std::cout << "domain size: " << size << " random updates "
+      << BATCH_SIZE_M << " separate: " << separateTime << "s interleaved: "
+      << interleavedTime << 's' << std::endl;
+
+   //***************************************************************************
+   // Results should be identical, both after converting back, and when read
+   // through the interleaved distribution's fields.
+   //***************************************************************************
+   CachedVecDist converted;
+   toSeparate(interleaved,converted);
+   if(!isSame(separate,converted))
+   {
+      return false;
+   }
+   for(int k=0; k<size; ++k)
+   {
+      const NormalGammaRecord rec = getRecord(separate,k);
+      if( (interleaved.alpha(k)!=rec.alpha) ||
+          (interleaved.beta(k)!=rec.beta) ||
+          (interleaved.lambda(k)!=rec.lambda) ||
+          (interleaved.m(k)!=rec.m) ||
+          (interleaved.lgammaRatio(k)!=separate.lgammaRatio(k)) ||
+          (converted.lgammaRatio(k)!=separate.lgammaRatio(k)) )
+      {
+         std::cout << "Interleaved update inconsistent at " << k << std::endl;
+         return false;
+      }
+   }
+
+   //***************************************************************************
+   // Copies should view their own records.
+   //***************************************************************************
+   InterleavedNormalGamma copy(interleaved);
+   observe<maxsum::ValIndex>(copy,0,1.0,1.0,1);
+   if( (copy.m.domainSize()!=size) || (copy.m(0)==interleaved.m(0)) )
+   {
+      std::cout << "Interleaved copy shares records" << std::endl;
+      return false;
+   }
+   return true;
+
+} // testInterleaved
+
+/**
+ * Reports the time taken by learners that store their beliefs in separate
+ * and interleaved layouts to observe the same random transitions, for a
+ * single factor over the specified state and action variables.
+ */
+template<class Learner> double timeLearnerObserve
+(
+ maxsum::VarID stateVar,
+ maxsum::VarID actionVar,
+ unsigned seed
+)
+{
+   typedef std::map<maxsum::VarID,maxsum::ValIndex> VarMap;
+   typedef std::map<maxsum::FactorID,double> RewardMap;
+   const maxsum::VarID vars[] = {stateVar, actionVar};
+   const maxsum::ValIndex numStates = maxsum::getDomainSize(stateVar);
+   const maxsum::ValIndex numActions = maxsum::getDomainSize(actionVar);
+
+   Learner learner;
+   learner.addFactor(0,vars,vars+2);
+
+   boost::mt19937 rng(seed);
+   boost::uniform_real<> unirnd(0,1);
+   VarMap prior, action, next;
+   RewardMap reward;
+   std::clock_t start = std::clock();
+   for(int t=0; t<NUM_TRANSITIONS_M; ++t)
+   {
+      prior[stateVar] = static_cast<maxsum::ValIndex>(numStates*unirnd(rng));
+      action[actionVar] =
+         static_cast<maxsum::ValIndex>(numActions*unirnd(rng));
+      next[stateVar] = static_cast<maxsum::ValIndex>(numStates*unirnd(rng));
+      next[actionVar] =
+         static_cast<maxsum::ValIndex>(numActions*unirnd(rng));
+      reward[0] = 10*unirnd(rng) - 5;
+      learner.observeGreedy(prior,action,next,reward);
+   }
+   return double(std::clock()-start)/CLOCKS_PER_SEC;
+
+} // timeLearnerObserve
+
+/**
+ * Reports the time taken by dec_brl::DecBayesQ and
+ * dec_brl::InterleavedDecBayesQ to observe the same random transitions.
+ */
+void testLearnerObserve(maxsum::VarID stateVar, maxsum::VarID actionVar)
+{
+   const double separateTime =
+      timeLearnerObserve<dec_brl::DecBayesQ>(stateVar,actionVar,7);
+   const double interleavedTime =
+      timeLearnerObserve<dec_brl::InterleavedDecBayesQ>(stateVar,actionVar,7);
+   std::cout << "factor size: " << maxsum::getDomainSize(stateVar)*
+      maxsum::getDomainSize(actionVar) << " observeGreedy x "
+      << NUM_TRANSITIONS_M << " separate: " << separateTime
+      << "s interleaved: " << interleavedTime << 's' << std::endl;
+
+} // testLearnerObserve
+
+} // private module namespace
+
+/**
+ * Main function for harness - executes all tests.
+ */
+int main()
+{
+   try
+   {
+      boost::mt19937 rng;
+
+      //************************************************************************
+      // Register one variable for each domain size to be tested.
+      //************************************************************************
+      const int NUM_SIZES = 4;
+      const maxsum::ValIndex sizes[NUM_SIZES] = {16, 256, 4096, 65536};
+      for(int k=0; k<NUM_SIZES; ++k)
+      {
+         maxsum::registerVariable(k+1,sizes[k]);
+      }
+
+      for(int k=0; k<NUM_SIZES; ++k)
+      {
+         if(!testDomain(k+1,rng))
+         {
+            return EXIT_FAILURE;
+         }
+      }
+
+      if(!testMismatchedDomains(1,rng))
+      {
+         return EXIT_FAILURE;
+      }
+
+      for(int k=0; k<NUM_SIZES; ++k)
+      {
+         if(!testBatch(k+1,rng))
+         {
+            return EXIT_FAILURE;
+         }
+      }
+
+      for(int k=0; k<NUM_SIZES; ++k)
+      {
+         if(!testInterleaved(k+1,rng))
+         {
+            return EXIT_FAILURE;
+         }
+      }
+
+      //************************************************************************
+      // Time learners on a factor whose beliefs do not fit in cache.
+      //************************************************************************
+      maxsum::registerVariable(NUM_SIZES+1,1024);
+      maxsum::registerVariable(NUM_SIZES+2,1024);
+      testLearnerObserve(NUM_SIZES+1,NUM_SIZES+2);
+
+   }
+   catch(std::exception& e)
+   {
+      std::cout << "Caught error: " << e.what() << std::endl;
+      return EXIT_FAILURE;
+   }
+
+   //***************************************************************************
+   // If we get this far, everything is ok.
+   //***************************************************************************
+   std::cout << "Passed." << std::endl;
+   return EXIT_SUCCESS;
+
+} // function main
@@ -0,0 +1,527 @@
+/**
+ * @file replayBufferHarness.cpp
+ * Test harness for dec_brl::ReplayBuffer.
+ * Checks that the buffer keeps the most recent transitions, that it groups
+ * transitions by post state even when the joint state space is too large
+ * to index, that observe is equivalent to actGreedy followed by
+ * observeGreedy, and that replaying
+ * minibatches to DecQLearner and DecBayesQ on the factored MDP used by
+ * bqFacMDPHarness.cpp calculates greedy actions once per distinct post
+ * state.
+ */
+
+#include <exception>
+#include <iostream>
+#include <map>
+#include <boost/random/mersenne_twister.hpp>
+#include "dec_brl/ReplayBuffer.h"
+#include "dec_brl/DecBayesQ.h"
+#include "dec_brl/DecQLearner.h"
+#include "dec_brl/random.h"
+#include "register.h"
+#include "DiscreteFunction.h"
+
+/**
+ * Private Module namespace.
+ */
+namespace {
+
+using namespace dec_brl;
+
+/**
+ * Number of timesteps for which each learner is run.
+ */
+const int NUM_TIMESTEPS_M = 500;
+
+/**
+ * Number of initial timesteps in which the learner is forced to perform
+ * random actions, so that it observes a wide range of rewards.
+ */
+const int NUM_RANDOM_STEPS_M = 100;
+
+/**
+ * Number of transitions replayed after each timestep.
+ */
+const int BATCH_SIZE_M = 32;
+
+/**
+ * A Simple Factored MDP for testing, identical to the one used by
+ * bqFacMDPHarness.cpp.
+ */
+class MultiFactorMDP
+{
+public:
+
+   /**
+    * Map type used to pass action and state values around.
+    */
+   typedef std::map<maxsum::VarID,maxsum::ValIndex> VarMap;
+
+   /**
+    * Map type for passing back Factored Rewards
+    */
+   typedef std::map<maxsum::FactorID,double> RewardMap;
+
+private:
+
+   /**
+    * Map containing the state variable mapped to its current value.
+    */
+   VarMap state_i;
+
+public:
+
+   /**
+    * Number of possible values for each variable.
+    */
+   const static int NUM_VALS = 2;
+
+   /**
+    * Default Constructor.
+    */
+   MultiFactorMDP() : state_i()
+   {
+      //************************************************************************
+      // Register the state and action variables with the maxsum library
+      //************************************************************************
+      for(int v=0; v<=8; ++v)
+      {
+         maxsum::registerVariable(v,NUM_VALS);
+      }
+
+      //************************************************************************
+      // Set the current state: first state is filled, rest are all empty
+      //************************************************************************
+      state_i[1] = 1;
+      for(int s=3; s<=7; s+=2)
+      {
+         state_i[s] = 0;
+      }
+
+   } // default constructor.
+
+   /**
+    * Inform learner of the factors defined by this MDP.
+    */
+   template<class Learner> void addFactors(Learner& learner)
+   {
+      int varIds[3];
+      for(int factor=1; factor<=7; factor+=2)
+      {
+         varIds[0]=factor-1;
+         varIds[1]=factor;
+         varIds[2]=factor+1;
+         learner.addFactor(factor,varIds,varIds+3);
+      }
+   }
+
+   /**
+    * Get the current state value.
+    */
+   VarMap& getState()
+   {
+      return state_i;
+   }
+
+   /**
+    * Perform an action and return the resulting reward.
+    * @returns total reward
+    */
+   double act(VarMap& action, RewardMap& reward)
+   {
+      double totReward = 0;
+      for(int s=1; s<=7; s+=2)
+      {
+         if( (1==action[s-1]) && (0==action[s+1]) && (1==state_i[s]) )
+         {
+            state_i[s]=0;
+            reward[s]=s*10;
+         }
+         else if(1==state_i[s])
+         {
+            reward[s] = (-s);
+         }
+         else if( (0==action[s-1]) && (1==action[s+1]) )
+         {
+            state_i[s]=1;
+            reward[s]=0;
+         }
+         else
+         {
+            reward[s]=0;
+         }
+         totReward += reward[s];
+      }
+      return totReward;
+
+   } // method act
+
+}; // class MultiFactorMDP
+
+/**
+ * Checks that the buffer holds the most recent transitions, oldest first.
+ */
+bool testRing()
+{
+   ReplayBuffer buffer(3);
+   MultiFactorMDP::VarMap prior, action, post;
+   MultiFactorMDP::RewardMap reward;
+   for(int t=0; t<5; ++t)
+   {
+      for(int s=1; s<=7; s+=2)
+      {
+         prior[s] = t%2;
+         post[s] = (t+1)%2;
+         reward[s] = 10*t+s;
+      }
+      for(int a=0; a<=8; a+=2)
+      {
+         action[a] = (t+a/2)%2;
+      }
+      buffer.add(prior,action,post,reward);
+   }
+
+   if( (3!=buffer.size()) || (3!=buffer.capacity()) )
+   {
+      std::cout << "Wrong buffer size: " << buffer.size() << std::endl;
+      return false;
+   }
+
+   FlatVarMap storedPrior, storedAction, storedPost;
+   ReplayBuffer::RewardList storedReward;
+   for(int k=0; k<3; ++k)
+   {
+      const int t = k+2;
+      buffer.get(k,storedPrior,storedAction,storedPost,storedReward);
+      if( (4!=storedPrior.size()) || (5!=storedAction.size()) ||
+          (4!=storedReward.size()) )
+      {
+         std::cout << "Transition " << k << " has wrong size" << std::endl;
+         return false;
+      }
+      for(int s=1; s<=7; s+=2)
+      {
+         if( (t%2!=storedPrior[s]) || ((t+1)%2!=storedPost[s]) )
+         {
+            std::cout << "Transition " << k << " has wrong states"
+               << std::endl;
+            return false;
+         }
+      }
+      for(int a=0; a<=8; a+=2)
+      {
+         if((t+a/2)%2!=storedAction[a])
+         {
+            std::cout << "Transition " << k << " has wrong actions"
+               << std::endl;
+            return false;
+         }
+      }
+      for(std::size_t j=0; j<storedReward.size(); ++j)
+      {
+         const int s = storedReward[j].first;
+         if(10*t+s!=storedReward[j].second)
+         {
+            std::cout << "Transition " << k << " has wrong rewards"
+               << std::endl;
+            return false;
+         }
+      }
+   }
+   return true;
+
+} // testRing
+
+/**
+ * Stand in learner that records the post states passed to actGreedy, and
+ * checks that each transition passed to observeGreedy is paired with its
+ * own post state.
+ */
+class PostStateChecker
+{
+public:
+
+   /**
+    * State variables, whose joint domain is too large to index with
+    * maxsum::ValIndex.
+    */
+   static const maxsum::VarID STATE_VARS[3];
+
+   /**
+    * Domain size of each state variable.
+    */
+   static const maxsum::ValIndex STATE_SIZE = 65536;
+
+   /**
+    * Number of calls made to actGreedy.
+    */
+   int noGreedy;
+
+   /**
+    * True if every transition was replayed with the right post state.
+    */
+   bool isConsistent;
+
+   /**
+    * Constructs a checker with no calls recorded.
+    */
+   PostStateChecker() : noGreedy(0), isConsistent(true) {}
+
+   /**
+    * Records a call to calculate greedy actions. There are no actions to
+    * choose, so none are returned.
+    */
+   template<class VarMap> void actGreedy(const VarMap&, VarMap& next)
+   {
+      next.clear();
+      ++noGreedy;
+   }
+
+   /**
+    * Checks that the post states of a transition, which are a function of
+    * its prior states, match those passed to the last call to actGreedy.
+    */
+   template<class VarMap, class RewardMap> void observeGreedy
+   (
+    const VarMap& prior,
+    const VarMap&,
+    const VarMap& next,
+    const RewardMap&
+   )
+   {
+      typename VarMap::const_iterator pos = prior.find(STATE_VARS[0]);
+      for(int k=0; k<3; ++k)
+      {
+         typename VarMap::const_iterator nextPos = next.find(STATE_VARS[k]);
+         if( (next.end()==nextPos) ||
+             (nextPos->second!=postValue(pos->second,k)) )
+         {
+            isConsistent = false;
+         }
+      }
+   }
+
+   /**
+    * Returns the value of the kth post state variable for a transition
+    * with the specified id. Post states differ only in the last variable,
+    * whose stride is too large for a linear index of the joint state.
+    */
+   static maxsum::ValIndex postValue(maxsum::ValIndex id, int k)
+   {
+      return (2==k) ? id : 1;
+   }
+
+}; // class PostStateChecker
+
+/**
+ * State variables used by PostStateChecker.
+ */
+const maxsum::VarID PostStateChecker::STATE_VARS[3] = {101, 102, 103};
+
+/**
+ * Checks that transitions are grouped by their full post states, even when
+ * the joint state space is too large for a linear index.
+ */
+bool testLargeStateSpace()
+{
+   const int NUM_POST_STATES = 4;
+   for(int k=0; k<3; ++k)
+   {
+      maxsum::registerVariable(PostStateChecker::STATE_VARS[k],
+                               PostStateChecker::STATE_SIZE);
+   }
+
+   ReplayBuffer buffer(NUM_POST_STATES);
+   MultiFactorMDP::VarMap prior, action, post;
+   MultiFactorMDP::RewardMap reward;
+   action[0] = 0;
+   reward[1] = 0;
+   for(int id=0; id<NUM_POST_STATES; ++id)
+   {
+      for(int k=0; k<3; ++k)
+      {
+         prior[PostStateChecker::STATE_VARS[k]] = id;
+         post[PostStateChecker::STATE_VARS[k]] =
+            PostStateChecker::postValue(id,k);
+      }
+      buffer.add(prior,action,post,reward);
+   }
+
+   PostStateChecker checker;
+   const int n = buffer.replay(checker,BATCH_SIZE_M);
+   if( !checker.isConsistent || (n!=checker.noGreedy) ||
+       (NUM_POST_STATES<n) || (1>=n) )
+   {
+      std::cout << "Transitions with large post states grouped wrongly: "
+         << n << " greedy evaluations" << std::endl;
+      return false;
+   }
+   return true;
+
+} // testLargeStateSpace
+
+/**
+ * Runs two copies of a learner side by side, one updated with observe, and
+ * the other with actGreedy followed by observeGreedy, and checks that they
+ * always choose the same actions.
+ */
+template<class Learner> bool testObserveGreedy
+(
+ const Learner& init,
+ const char* name
+)
+{
+   MultiFactorMDP mdp1, mdp2;
+   Learner learner1(init), learner2(init);
+   mdp1.addFactors(learner1);
+   mdp2.addFactors(learner2);
+
+   MultiFactorMDP::VarMap prior, post(mdp1.getState());
+   MultiFactorMDP::VarMap action1, action2, next;
+   MultiFactorMDP::RewardMap reward;
+   random::Stream stream1(1), stream2(1);
+   boost::mt19937 rng;
+   for(int t=0; t<NUM_TIMESTEPS_M; ++t)
+   {
+      post.swap(prior);
+      {
+         random::StreamScope scope(stream1);
+         learner1.act(prior,action1);
+      }
+      {
+         random::StreamScope scope(stream2);
+         learner2.act(prior,action2);
+      }
+      if(action1!=action2)
+      {
+         std::cout << name << ": observeGreedy changed actions at timestep "
+            << t << std::endl;
+         return false;
+      }
+
+      if(NUM_RANDOM_STEPS_M>t)
+      {
+         for(int a=0; a<=8; a+=2)
+         {
+            action1[a] = rng()%MultiFactorMDP::NUM_VALS;
+         }
+      }
+
+      mdp1.act(action1,reward);
+      post = mdp1.getState();
+      learner1.observe(prior,action1,post,reward);
+      learner2.actGreedy(post,next);
+      next.insert(post.begin(),post.end());
+      learner2.observeGreedy(prior,action1,next,reward);
+   }
+   return true;
+
+} // testObserveGreedy
+
+/**
+ * Runs a learner on the MDP, with and without replaying a minibatch after
+ * each timestep, and checks that each minibatch calculates greedy actions
+ * at most once per distinct post state.
+ */
+template<class Learner> bool testReplay(const Learner& init, const char* name)
+{
+   double total[2] = {0, 0};
+   long noGreedy = 0;
+   for(int useReplay=0; useReplay<2; ++useReplay)
+   {
+      MultiFactorMDP mdp;
+      Learner learner(init);
+      mdp.addFactors(learner);
+      ReplayBuffer buffer(NUM_TIMESTEPS_M);
+      random::Stream stream(1);
+      random::StreamScope scope(stream);
+
+      MultiFactorMDP::VarMap prior, post(mdp.getState()), action;
+      MultiFactorMDP::RewardMap reward;
+      boost::mt19937 rng;
+      for(int t=0; t<NUM_TIMESTEPS_M; ++t)
+      {
+         post.swap(prior);
+         learner.act(prior,action);
+         if(NUM_RANDOM_STEPS_M>t)
+         {
+            for(int a=0; a<=8; a+=2)
+            {
+               action[a] = rng()%MultiFactorMDP::NUM_VALS;
+            }
+         }
+         total[useReplay] += mdp.act(action,reward);
+         post = mdp.getState();
+         learner.observe(prior,action,post,reward);
+
+         if(0==useReplay)
+         {
+            continue;
+         }
+         buffer.add(prior,action,post,reward);
+         const int n = buffer.replay(learner,BATCH_SIZE_M);
+
+         //*********************************************************************
+         // The MDP has four binary state variables, so there are at most 16
+         // distinct post states in each minibatch.
+         //*********************************************************************
+         if( (0>=n) || (16<n) || (BATCH_SIZE_M<n) )
+         {
+            std::cout << name << ": wrong number of greedy evaluations: "
+               << n << std::endl;
+            return false;
+         }
+         noGreedy += n;
+      }
+   }
+
+   std::cout << name << " mean reward without replay: "
+      << total[0]/NUM_TIMESTEPS_M << " with replay: "
+      << total[1]/NUM_TIMESTEPS_M << " greedy evaluations per minibatch: "
+      << static_cast<double>(noGreedy)/NUM_TIMESTEPS_M << std::endl;
+   return true;
+
+} // testReplay
+
+} // module namespace
+
+/**
+ * Main function for harness - executes all tests.
+ */
+int main()
+{
+   try
+   {
+      MultiFactorMDP mdp; // registers variables
+      if(!testRing() || !testLargeStateSpace())
+      {
+         return EXIT_FAILURE;
+      }
+
+      DecQLearner qLearner;
+      DecBayesQ bayesQ;
+      if(!testObserveGreedy(qLearner,"DecQLearner") ||
+         !testObserveGreedy(bayesQ,"DecBayesQ"))
+      {
+         return EXIT_FAILURE;
+      }
+
+      if(!testReplay(qLearner,"DecQLearner") ||
+         !testReplay(bayesQ,"DecBayesQ"))
+      {
+         return EXIT_FAILURE;
+      }
+   }
+   catch(std::exception& e)
+   {
+      std::cout << "Caught error: " << e.what() << std::endl;
+      return EXIT_FAILURE;
+   }
+
+   //***************************************************************************
+   // If we get this far, everything is ok.
+   //***************************************************************************
+   std::cout << "Passed." << std::endl;
+   return EXIT_SUCCESS;
+
+} // function main
@@ -0,0 +1,268 @@
+/**
+ * @file sampledVPIHarness.cpp
+ * Test harness for the batched sampled VPI engine in vpi.h.
+ * Checks the bulk normal and gamma variate generators in random.h, checks
+ * that sampled VPI converges to exact VPI, checks that reusing scratch space
+ * does not change the results, and reports the time taken by both.
+ */
+
+#include <cmath>
+#include <ctime>
+#include <exception>
+#include <iostream>
+#include <vector>
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/normal_distribution.hpp>
+#include <boost/random/uniform_real.hpp>
+#include <boost/random/variate_generator.hpp>
+#include "dec_brl/random.h"
+#include "dec_brl/vpi.h"
+#include "dec_brl/NormalGamma.h"
+#include "DiscreteFunction.h"
+#include "register.h"
+
+// private module namespace
+namespace
+{
+using namespace dec_brl::dist;
+
+/**
+ * Type of vectorised parameter distribution used for testing.
+ */
+typedef NormalGamma_Tmpl<maxsum::DiscreteFunction> VecDist;
+
+/**
+ * Number of variates used to check sample moments.
+ */
+const int NUM_VARIATES_M = 200000;
+
+/**
+ * Checks that the sample mean and variance of some values are within
+ * tolerance of the expected moments.
+ */
+bool checkMoments
+(
+ const std::vector<double>& values,
+ double mean,
+ double variance,
+ const char* name
+)
+{
+   double sum = 0;
+   double sum2 = 0;
+   for(std::vector<double>::const_iterator it=values.begin();
+       it!=values.end(); ++it)
+   {
+      sum += *it;
+      sum2 += (*it)*(*it);
+   }
+   const double sampleMean = sum/values.size();
+   const double sampleVar = sum2/values.size() - sampleMean*sampleMean;
+
+   //***************************************************************************
+   // Allow for about 5 standard errors in the mean, and 5% in the variance.
+   //***************************************************************************
+   const double meanTol = 5*std::sqrt(variance/values.size());
+   if( (meanTol < std::abs(sampleMean-mean)) ||
+       (0.05*variance < std::abs(sampleVar-variance)) )
+   {
+      std::cout << name << " sample mean " << sampleMean << " variance "
+         << sampleVar << " expected " << mean << " and " << variance
+         << std::endl;
+      return false;
+   }
+   return true;
+}
+
+/**
+ * Checks the moments of the bulk variate generators.
+ */
+bool testVariates()
+{
+   std::vector<double> values(NUM_VARIATES_M);
+
+   dec_brl::random::normalVariates(NUM_VARIATES_M, &values[0],
+                                   dec_brl::random::unirnd);
+   if(!checkMoments(values,0,1,"normal"))
+   {
+      return false;
+   }
+
+   const double shapes[] = {0.3, 1.0, 2.5, 20.0};
+   for(int k=0; k<4; ++k)
+   {
+      dec_brl::random::gammaVariates(NUM_VARIATES_M, shapes[k], &values[0],
+                                     dec_brl::random::unirnd);
+      if(!checkMoments(values,shapes[k],shapes[k],"gamma"))
+      {
+         return false;
+      }
+   }
+   return true;
+}
+
+/**
+ * Generates a distribution with random hyperparameters.
+ */
+void randomDist(maxsum::VarID var, boost::mt19937& rng, VecDist& dist)
+{
+   expand(dist,var);
+
+   boost::uniform_real<> unirnd(0,1);
+   boost::normal_distribution<> normal;
+   boost::variate_generator<boost::mt19937&, boost::normal_distribution<> >
+      normrnd(rng,normal);
+   for(int k=0; k<dist.m.domainSize(); ++k)
+   {
+      dist.alpha(k) = 2.0 + 10*unirnd(rng);
+      dist.beta(k) = 0.1 + 10*unirnd(rng);
+      dist.lambda(k) = 0.5 + 5*unirnd(rng);
+      dist.m(k) = normrnd();
+   }
+}
+
+/**
+ * Checks that sampled VPI with many samples is close to exact VPI.
+ */
+bool testConvergence(maxsum::VarID var, boost::mt19937& rng)
+{
+   VecDist dist;
+   randomDist(var,rng,dist);
+
+   maxsum::DiscreteFunction exactResult, sampledResult;
+   dec_brl::exactVPI(dist,exactResult);
+   dec_brl::sampledVPI(dist,sampledResult,NUM_VARIATES_M,
+                       dec_brl::random::unirnd);
+
+   for(int k=0; k<dist.m.domainSize(); ++k)
+   {
+      const double tol = 0.02 + 0.05*exactResult(k);
+      if(tol < std::abs(exactResult(k)-sampledResult(k)))
+      {
+         std::cout << "Sampled VPI inconsistent at " << k << ": exact="
+            << exactResult(k) << " sampled=" << sampledResult(k) << std::endl;
+         return false;
+      }
+   }
+   return true;
+}
+
+/**
+ * Checks that estimating sampled VPI with reused scratch space, which may
+ * hold variates left over from a larger batch, gives the same results as
+ * estimating it with temporary scratch space from the same random stream.
+ */
+bool testScratch(maxsum::VarID var, boost::mt19937& rng)
+{
+   using namespace dec_brl;
+   VecDist dist;
+   randomDist(var,rng,dist);
+   const int n = dist.m.domainSize();
+   const int noSamples = 100;
+
+   int firstBestInd = 0;
+   maxsum::ValType firstBestVal = 0;
+   maxsum::ValType secondBestVal = 0;
+   findBestTwo(n, &dist.m(0), firstBestInd, firstBestVal, secondBestVal);
+
+   std::vector<maxsum::ValType> expected(n), actual(n);
+   random::Stream stream(42);
+   {
+      random::StreamScope scope(stream);
+      sampledVPIArrays(n, &dist.alpha(0), &dist.beta(0), &dist.lambda(0),
+                       &dist.m(0), firstBestInd, firstBestVal, secondBestVal,
+                       noSamples, random::unirnd, &expected[0]);
+   }
+
+   SampledVPIScratch scratch;
+   std::vector<maxsum::ValType> larger(n);
+   sampledVPIArrays(n, &dist.alpha(0), &dist.beta(0), &dist.lambda(0),
+                    &dist.m(0), firstBestInd, firstBestVal, secondBestVal,
+                    2*noSamples, random::unirnd, &larger[0], scratch);
+   stream.seed(42);
+   {
+      random::StreamScope scope(stream);
+      sampledVPIArrays(n, &dist.alpha(0), &dist.beta(0), &dist.lambda(0),
+                       &dist.m(0), firstBestInd, firstBestVal, secondBestVal,
+                       noSamples, random::unirnd, &actual[0], scratch);
+   }
+
+   for(int k=0; k<n; ++k)
+   {
+      if(expected[k]!=actual[k])
+      {
+         std::cout << "Sampled VPI with reused scratch inconsistent at " << k
+            << ": expected=" << expected[k] << " actual=" << actual[k]
+            << std::endl;
+         return false;
+      }
+   }
+   return true;
+}
+
+/**
+ * Reports the time taken by exact and sampled VPI for a given domain size.
+ */
+void timeVPI(maxsum::VarID var, boost::mt19937& rng, int noSamples)
+{
+   VecDist dist;
+   randomDist(var,rng,dist);
+
+   maxsum::DiscreteFunction result;
+   std::clock_t start = std::clock();
+   dec_brl::exactVPI(dist,result);
+   double exactTime = double(std::clock()-start)/CLOCKS_PER_SEC;
+
+   start = std::clock();
+   dec_brl::sampledVPI(dist,result,noSamples,dec_brl::random::unirnd);
+   double sampledTime = double(std::clock()-start)/CLOCKS_PER_SEC;
+
+   std::cout << "domain size: " << dist.m.domainSize() << " exact: "
+      << exactTime << "s sampled (" << noSamples << " samples): "
+      << sampledTime << 's' << std::endl;
+}
+
+} // private module namespace
+
+/**
+ * Main function for harness - executes all tests.
+ */
+int main()
+{
+   try
+   {
+      boost::mt19937 rng;
+      maxsum::registerVariable(1,8);
+      maxsum::registerVariable(2,8192);
+
+      if(!testVariates())
+      {
+         return EXIT_FAILURE;
+      }
+
+      if(!testConvergence(1,rng))
+      {
+         return EXIT_FAILURE;
+      }
+
+      if(!testScratch(1,rng))
+      {
+         return EXIT_FAILURE;
+      }
+
+      timeVPI(2,rng,10);
+      timeVPI(2,rng,50);
+   }
+   catch(std::exception& e)
+   {
+      std::cout << "Caught error: " << e.what() << std::endl;
+      return EXIT_FAILURE;
+   }
+
+   //***************************************************************************
+   // If we get this far, everything is ok.
+   //***************************************************************************
+   std::cout << "Passed." << std::endl;
+   return EXIT_SUCCESS;
+
+} // function main
@@ -0,0 +1,324 @@
+/**
+ * @file sparseTransBeliefHarness.cpp
+ * Test harness for dec_brl::SparseTransBelief.
+ * Checks that sparse beliefs give the same hyperparameters and means as
+ * dense dec_brl::TransBelief objects given the same observations, that
+ * sampled CPTs are valid and centred on the mean, and that memory use is
+ * proportional to the number of observed elements for a CPT too large to
+ * store densely.
+ */
+
+#include <dec_brl/SparseTransBelief.h>
+#include <dec_brl/TransBelief.h>
+#include "register.h"
+#include <cmath>
+#include <iostream>
+#include <boost/random/mersenne_twister.hpp>
+
+/**
+ * Private module namespace.
+ */
+namespace {
+
+    /**
+     * Number of random observations made in each test.
+     */
+    const int NUM_OBSERVATIONS_M = 2000;
+
+    /**
+     * Number of CPTs sampled to check the sample mean.
+     */
+    const int NUM_SAMPLES_M = 400;
+
+    /**
+     * Checks that sparse and dense beliefs agree on hyperparameters and
+     * expected CPTs, after the same observations.
+     */
+    int testAgainstDense
+    (
+     dec_brl::TransBelief& dense,
+     dec_brl::SparseTransBelief& sparse,
+     const Eigen::VectorXi& sizes,
+     boost::mt19937& randGenerator
+    )
+    {
+        //**********************************************************************
+        //  Make the same observations using each method. Only a few
+        //  conditions are observed, so most columns remain at the prior.
+        //**********************************************************************
+        Eigen::VectorXi condMap(sizes.size()+1), domainMap(sizes.size()+1);
+        for(int k=0; k<NUM_OBSERVATIONS_M; ++k)
+        {
+            for(int v=1; v<=sizes.size(); ++v)
+            {
+                condMap[v] = randGenerator()%2;
+                domainMap[v] = randGenerator()%sizes[v-1];
+            }
+            switch(k%3)
+            {
+            case 0:
+                dense.observeByMap(condMap, domainMap);
+                sparse.observeByMap(condMap, domainMap);
+                break;
+            case 1:
+                dense.observeByVec(condMap.begin()+1, condMap.end(),
+                                   domainMap.begin()+1, domainMap.end());
+                sparse.observeByVec(condMap.begin()+1, condMap.end(),
+                                    domainMap.begin()+1, domainMap.end());
+                break;
+            default:
+                int condInd = maxsum::sub2ind(sizes.begin(), sizes.end(),
+                                              condMap.begin()+1,
+                                              condMap.end());
+                int domainInd = maxsum::sub2ind(sizes.begin(), sizes.end(),
+                                                domainMap.begin()+1,
+                                                domainMap.end());
+                dense.observeByInd(condInd, domainInd);
+                sparse.observeByInd(condInd, domainInd);
+            }
+        }
+
+        //**********************************************************************
+        //  Check hyperparameters
+        //**********************************************************************
+        const Eigen::MatrixXd& alpha = dense.getAlpha();
+        int noObserved = 0;
+        for(int c=0; c<alpha.cols(); ++c)
+        {
+            for(int d=0; d<alpha.rows(); ++d)
+            {
+                if(alpha(d,c)!=sparse.getAlpha(d,c))
+                {
+                    std::cout << "Hyperparameter (" << d << "," << c
+                    << ") is " << sparse.getAlpha(d,c) << " but should be "
+                    << alpha(d,c) << std::endl;
+                    return EXIT_FAILURE;
+                }
+                if(alpha(d,c)!=sparse.getPrior())
+                {
+                    ++noObserved;
+                }
+            }
+        }
+        if(noObserved!=sparse.noObserved())
+        {
+            std::cout << "Wrong number of observed elements: "
+            << sparse.noObserved() << " should be " << noObserved
+            << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        //**********************************************************************
+        //  Check expected CPTs
+        //**********************************************************************
+        Eigen::MatrixXd denseMean, sparseMean;
+        dense.getMean(denseMean);
+        sparse.getMean(sparseMean);
+        if(!denseMean.isApprox(sparseMean))
+        {
+            std::cout << "Inconsistent expected CPTs" << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        Eigen::VectorXd denseCol, sparseCol;
+        for(int c=0; c<dense.condSize(); ++c)
+        {
+            dense.getMeanByInd(denseCol,c);
+            sparse.getMeanByInd(sparseCol,c);
+            if(!denseCol.isApprox(sparseCol))
+            {
+                std::cout << "Inconsistent expected CPT for condition " << c
+                << std::endl;
+                return EXIT_FAILURE;
+            }
+        }
+
+        condMap.setZero();
+        dense.getMeanByMap(denseCol,condMap);
+        sparse.getMeanByMap(sparseCol,condMap);
+        if(!denseCol.isApprox(sparseCol))
+        {
+            std::cout << "Inconsistent expected CPT for mapped condition"
+            << std::endl;
+            return EXIT_FAILURE;
+        }
+        return EXIT_SUCCESS;
+
+    } // testAgainstDense
+
+    /**
+     * Checks that sampled CPTs have columns that sum to one, and that their
+     * mean is close to the expected CPT.
+     */
+    int testSample
+    (
+     dec_brl::SparseTransBelief& sparse,
+     boost::mt19937& randGenerator
+    )
+    {
+        Eigen::MatrixXd expected, cpt;
+        sparse.getMean(expected);
+        Eigen::MatrixXd sampleMean(expected.rows(),expected.cols());
+        sampleMean.setZero();
+        for(int k=0; k<NUM_SAMPLES_M; ++k)
+        {
+            sparse.sample(randGenerator,cpt);
+            Eigen::RowVectorXd totals = cpt.colwise().sum();
+            if(!totals.isApproxToConstant(1))
+            {
+                std::cout << "Sampled columns do not sum to one" << std::endl;
+                return EXIT_FAILURE;
+            }
+            sampleMean += cpt;
+        }
+        sampleMean /= NUM_SAMPLES_M;
+
+        double maxDiff = (sampleMean-expected).array().abs().maxCoeff();
+        double stdErr = std::sqrt(expected.maxCoeff()/NUM_SAMPLES_M);
+        if(maxDiff > 6*stdErr)
+        {
+            std::cout << "Sample mean differs from expected CPT by "
+            << maxDiff << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        //**********************************************************************
+        //  CPTs sampled through SparseSampledTransProb should also be valid.
+        //**********************************************************************
+        dec_brl::SparseSampledTransProb sampled(sparse,randGenerator);
+        Eigen::RowVectorXd totals = sampled.getCPT().colwise().sum();
+        if( (expected.rows()!=sampled.getCPT().rows()) ||
+            (expected.cols()!=sampled.getCPT().cols()) ||
+            !totals.isApproxToConstant(1) )
+        {
+            std::cout << "Invalid CPT sampled from sparse beliefs" << std::endl;
+            return EXIT_FAILURE;
+        }
+        return EXIT_SUCCESS;
+
+    } // testSample
+
+    /**
+     * Makes observations for a CPT too large to store densely, and checks
+     * that only the observed elements are stored, and that the expected
+     * and sampled distributions for observed conditions are valid.
+     */
+    int testLargeCPT(boost::mt19937& randGenerator)
+    {
+        const int NUM_VARS = 6;
+        const int VAR_SIZE = 10;
+        Eigen::VectorXi vars(NUM_VARS);
+        for(int k=0; k<NUM_VARS; ++k)
+        {
+            vars[k] = 10+k;
+            maxsum::registerVariable(vars[k],VAR_SIZE);
+        }
+
+        //**********************************************************************
+        //  A million by a million CPT.
+        //**********************************************************************
+        dec_brl::SparseTransBelief sparse(vars,vars);
+        for(int k=0; k<NUM_OBSERVATIONS_M; ++k)
+        {
+            int condInd = randGenerator()%100;
+            int domainInd = randGenerator()%sparse.domainSize();
+            sparse.observeByInd(condInd, domainInd);
+        }
+        if(NUM_OBSERVATIONS_M<sparse.noObserved())
+        {
+            std::cout << "Too many elements stored: " << sparse.noObserved()
+            << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        Eigen::VectorXd mean;
+        sparse.getMeanByInd(mean,0);
+        if(std::abs(mean.sum()-1) > 1e-9)
+        {
+            std::cout << "Expected CPT for large domain does not sum to one"
+            << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        Eigen::VectorXd column(sparse.domainSize());
+        sparse.sampleColumn(randGenerator,0,column);
+        if(std::abs(column.sum()-1) > 1e-9)
+        {
+            std::cout << "Sampled column for large domain does not sum to one"
+            << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        //**********************************************************************
+        //  A lazy CPT sampled from these beliefs should only store the
+        //  columns that are drawn from, even when using alias tables.
+        //**********************************************************************
+        dec_brl::SparseSampledTransProb lazy(sparse,randGenerator,true,true);
+        Eigen::VectorXi prevStates(NUM_VARS+10), nxtStates(NUM_VARS+10);
+        prevStates.setZero();
+        nxtStates.setZero();
+        for(int k=0; k<10; ++k)
+        {
+            lazy.drawNextStates(randGenerator, prevStates, nxtStates);
+        }
+        if( (1!=lazy.noColumnsDrawn()) || (0!=lazy.getCPT().size()) ||
+            !lazy.isColumnDrawn(0) )
+        {
+            std::cout << "Lazy CPT for large domain stored "
+            << lazy.noColumnsDrawn() << " columns" << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        std::cout << "CPT size: " << sparse.domainSize() << " x "
+        << sparse.condSize() << " stored elements: " << sparse.noObserved()
+        << std::endl;
+        return EXIT_SUCCESS;
+
+    } // testLargeCPT
+
+} // module namespace
+
+/**
+ * Main function.
+ */
+int main()
+{
+    using namespace dec_brl;
+
+    //**************************************************************************
+    // Register some test variables with the maxsum library
+    //**************************************************************************
+    Eigen::Vector3i vars, sizes;
+    vars << 1,2,3;
+    sizes << 2,3,4;
+    maxsum::registerVariables(vars.begin(), vars.end(),
+                              sizes.begin(), sizes.end());
+
+    boost::mt19937 randGenerator;
+    for(int k=0; k<2; ++k)
+    {
+        const double prior = (0==k) ? TransBelief::DEFAULT_ALPHA : 0.5;
+        TransBelief dense(vars,vars,prior);
+        SparseTransBelief sparse(vars,vars,prior);
+        Eigen::VectorXi sizeVec(sizes);
+        if( (EXIT_SUCCESS!=testAgainstDense(dense,sparse,sizeVec,
+                                            randGenerator)) ||
+            (EXIT_SUCCESS!=testSample(sparse,randGenerator)) )
+        {
+            return EXIT_FAILURE;
+        }
+    }
+    std::cout << "Sparse beliefs match dense beliefs" << std::endl;
+
+    if(EXIT_SUCCESS!=testLargeCPT(randGenerator))
+    {
+        return EXIT_FAILURE;
+    }
+
+    //**************************************************************************
+    // If we get this far, everything passed.
+    //**************************************************************************
+    std::cout << "All SparseTransBelief tests passed" << std::endl;
+    return EXIT_SUCCESS;
+
+} // function main
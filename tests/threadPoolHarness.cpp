@@ -0,0 +1,362 @@
+/**
+ * @file threadPoolHarness.cpp
+ * Test harness for dec_brl::ThreadPool, and for its use by the learners to
+ * condition beliefs and calculate VPI for each factor in parallel.
+ * Checks that the pool runs every task exactly once, including when tasks
+ * take very different times, that exceptions thrown by tasks are reported,
+ * and that learners choose the same actions with and without a pool.
+ */
+
+#include <exception>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <vector>
+#include <boost/random/mersenne_twister.hpp>
+#include "dec_brl/ThreadPool.h"
+#include "dec_brl/DecBayesQ.h"
+#include "dec_brl/DecBayesModelLearner.h"
+#include "dec_brl/LearningSolver.h"
+#include "dec_brl/DecQLearner.h"
+#include "register.h"
+#include "DiscreteFunction.h"
+
+/**
+ * Private Module namespace.
+ */
+namespace {
+
+using namespace dec_brl;
+
+/**
+ * Number of timesteps for which each pair of learners is run.
+ */
+const int NUM_TIMESTEPS_M = 500;
+
+/**
+ * Number of initial timesteps in which both learners are forced to perform
+ * the same random actions, so that they observe a wide range of rewards.
+ */
+const int NUM_RANDOM_STEPS_M = 100;
+
+/**
+ * Task that counts how many times each index is run, and does an amount of
+ * busy work that varies widely between indices.
+ */
+class CountTask : public Executor::Task
+{
+private:
+
+   /**
+    * Number of times each index has been run.
+    */
+   std::vector<int>& counts_i;
+
+   /**
+    * Result of busy work for each index, so that it is not optimised away.
+    */
+   std::vector<double>& results_i;
+
+public:
+
+   /**
+    * Constructs a task that records its results in the specified vectors.
+    */
+   CountTask(std::vector<int>& counts, std::vector<double>& results)
+   : counts_i(counts), results_i(results) {}
+
+   /**
+    * Runs the k-th task.
+    */
+   void operator()(std::size_t k)
+   {
+      ++counts_i[k];
+      double sum = 0;
+      const long noSteps = (0==k%7) ? 200000 : 100;
+      for(long i=1; i<=noSteps; ++i)
+      {
+         sum += 1.0/i;
+      }
+      results_i[k] = sum;
+   }
+};
+
+/**
+ * Task that throws an exception for one index.
+ */
+class ThrowTask : public Executor::Task
+{
+public:
+
+   /**
+    * Runs the k-th task.
+    */
+   void operator()(std::size_t k)
+   {
+      if(13==k)
+      {
+         throw std::logic_error("expected failure");
+      }
+   }
+};
+
+/**
+ * Checks that a pool runs every task exactly once, for various numbers of
+ * tasks and threads, and that task exceptions are reported.
+ */
+bool testPool()
+{
+   const std::size_t noThreads[] = {1, 3, 8};
+   const std::size_t noTasks[] = {0, 1, 5, 100, 1000};
+   for(int t=0; t<3; ++t)
+   {
+      ThreadPool pool(noThreads[t]);
+      for(int n=0; n<5; ++n)
+      {
+         std::vector<int> counts(noTasks[n],0);
+         std::vector<double> results(noTasks[n],0);
+         CountTask task(counts,results);
+         for(int repeat=0; repeat<3; ++repeat)
+         {
+            pool.run(noTasks[n],task);
+         }
+         for(std::size_t k=0; k<noTasks[n]; ++k)
+         {
+            if(3!=counts[k])
+            {
+               std::cout << "Task " << k << " of " << noTasks[n] << " run "
+                  << counts[k] << " times by " << noThreads[t]
+                  << " threads." << std::endl;
+               return false;
+            }
+         }
+      }
+
+      ThrowTask throwTask;
+      bool isCaught = false;
+      try
+      {
+         pool.run(100,throwTask);
+      }
+      catch(std::runtime_error&)
+      {
+         isCaught = true;
+      }
+      if(!isCaught)
+      {
+         std::cout << "Task exception not reported." << std::endl;
+         return false;
+      }
+   }
+   return true;
+
+} // testPool
+
+/**
+ * A Simple Factored MDP for testing, identical to the one used by
+ * bqFacMDPHarness.cpp.
+ */
+class MultiFactorMDP
+{
+public:
+
+   /**
+    * Map type used to pass action and state values around.
+    */
+   typedef std::map<maxsum::VarID,maxsum::ValIndex> VarMap;
+
+   /**
+    * Map type for passing back Factored Rewards
+    */
+   typedef std::map<maxsum::FactorID,double> RewardMap;
+
+private:
+
+   /**
+    * Map containing the state variable mapped to its current value.
+    */
+   VarMap state_i;
+
+public:
+
+   /**
+    * Number of possible values for each variable.
+    */
+   const static int NUM_VALS = 2;
+
+   /**
+    * Default Constructor.
+    */
+   MultiFactorMDP() : state_i()
+   {
+      //************************************************************************
+      // Register the state and action variables with the maxsum library
+      //************************************************************************
+      for(int v=0; v<=8; ++v)
+      {
+         maxsum::registerVariable(v,NUM_VALS);
+      }
+
+      //************************************************************************
+      // Set the current state: first state is filled, rest are all empty
+      //************************************************************************
+      state_i[1] = 1;
+      for(int s=3; s<=7; s+=2)
+      {
+         state_i[s] = 0;
+      }
+
+   } // default constructor.
+
+   /**
+    * Inform learner of the factors defined by this MDP.
+    */
+   template<class Learner> void addFactors(Learner& learner)
+   {
+      int varIds[3];
+      for(int factor=1; factor<=7; factor+=2)
+      {
+         varIds[0]=factor-1;
+         varIds[1]=factor;
+         varIds[2]=factor+1;
+         learner.addFactor(factor,varIds,varIds+3);
+      }
+   }
+
+   /**
+    * Get the current state value.
+    */
+   VarMap& getState()
+   {
+      return state_i;
+   }
+
+   /**
+    * Perform an action and return the resulting reward.
+    * @returns total reward
+    */
+   double act(VarMap& action, RewardMap& reward)
+   {
+      double totReward = 0;
+      for(int s=1; s<=7; s+=2)
+      {
+         if( (1==action[s-1]) && (0==action[s+1]) && (1==state_i[s]) )
+         {
+            state_i[s]=0;
+            reward[s]=s*10;
+         }
+         else if(1==state_i[s])
+         {
+            reward[s] = (-s);
+         }
+         else if( (0==action[s-1]) && (1==action[s+1]) )
+         {
+            state_i[s]=1;
+            reward[s]=0;
+         }
+         else
+         {
+            reward[s]=0;
+         }
+         totReward += reward[s];
+      }
+      return totReward;
+
+   } // method act
+
+}; // class MultiFactorMDP
+
+/**
+ * Runs two learners side by side on separate copies of the MDP, one of
+ * which uses a thread pool.
+ * @returns true iff both learners choose the same actions at every timestep.
+ */
+template<class Learner> bool runLockstep(ThreadPool& pool, const char* name)
+{
+   MultiFactorMDP refMDP, testMDP;
+   Learner refLearner, testLearner;
+   refMDP.addFactors(refLearner);
+   testMDP.addFactors(testLearner);
+   testLearner.setExecutor(&pool);
+
+   MultiFactorMDP::VarMap refPrior, refPost(refMDP.getState()), refAction;
+   MultiFactorMDP::VarMap testPrior, testPost(testMDP.getState()), testAction;
+   MultiFactorMDP::RewardMap refReward, testReward;
+
+   boost::mt19937 rng;
+   double total = 0;
+   for(int t=0; t<NUM_TIMESTEPS_M; ++t)
+   {
+      refPost.swap(refPrior);
+      testPost.swap(testPrior);
+
+      refLearner.act(refPrior,refAction);
+      testLearner.act(testPrior,testAction);
+      if(refAction!=testAction)
+      {
+         std::cout << name << ": actions diverged at timestep " << t
+            << std::endl;
+         return false;
+      }
+      if(NUM_RANDOM_STEPS_M>t)
+      {
+         for(int a=0; a<=8; a+=2)
+         {
+            refAction[a] = testAction[a] = rng()%MultiFactorMDP::NUM_VALS;
+         }
+      }
+
+      refPost = refMDP.getState();
+      testPost = testMDP.getState();
+      total += refMDP.act(refAction,refReward);
+      testMDP.act(testAction,testReward);
+      refLearner.observe(refPrior,refAction,refPost,refReward);
+      testLearner.observe(testPrior,testAction,testPost,testReward);
+   }
+
+   std::cout << name << " mean reward: " << total/NUM_TIMESTEPS_M
+      << std::endl;
+   return true;
+
+} // runLockstep
+
+} // module namespace
+
+/**
+ * Main function for harness - executes all tests.
+ */
+int main()
+{
+   try
+   {
+      if(!testPool())
+      {
+         return EXIT_FAILURE;
+      }
+
+      MultiFactorMDP mdp; // registers variables
+      ThreadPool pool(4);
+      if(!runLockstep<DecBayesQ>(pool,"DecBayesQ"))
+      {
+         return EXIT_FAILURE;
+      }
+
+      if(!runLockstep<DecBayesModelLearner<LearningSolver<DecQLearner> > >
+            (pool,"DecBayesModelLearner"))
+      {
+         return EXIT_FAILURE;
+      }
+   }
+   catch(std::exception& e)
+   {
+      std::cout << "Caught error: " << e.what() << std::endl;
+      return EXIT_FAILURE;
+   }
+
+   //***************************************************************************
+   // If we get this far, everything is ok.
+   //***************************************************************************
+   std::cout << "Passed." << std::endl;
+   return EXIT_SUCCESS;
+
+} // function main
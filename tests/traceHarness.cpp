@@ -0,0 +1,350 @@
+/**
+ * @file traceHarness.cpp
+ * Test harness for eligibility traces in dec_brl::DecQLearner.
+ * Checks the dec_brl::SparseTrace container, and compares the number of
+ * timesteps, and the processor time, that one-step Q-learning and Q(lambda)
+ * take to learn the optimal policy for a chain MDP in which reward is only
+ * received at the far end of the chain.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <ctime>
+#include <exception>
+#include <iostream>
+#include <map>
+#include "dec_brl/DecQLearner.h"
+#include "dec_brl/SparseTrace.h"
+#include "dec_brl/random.h"
+#include "register.h"
+
+/**
+ * Private Module namespace.
+ */
+namespace {
+
+using namespace dec_brl;
+
+/**
+ * Number of independent runs averaged for each learner.
+ */
+const int NUM_RUNS_M = 10;
+
+/**
+ * Maximum number of timesteps in each run.
+ */
+const long MAX_TIMESTEPS_M = 200000;
+
+/**
+ * Number of timesteps between checks of the greedy policy.
+ */
+const long CHECK_INTERVAL_M = 10;
+
+/**
+ * Probability of exploratory actions.
+ */
+const double EPSILON_M = 0.3;
+
+/**
+ * Trace decay parameter used for Q(lambda).
+ */
+const double LAMBDA_M = 0.9;
+
+/**
+ * Number of states in the chain MDP.
+ */
+const int NUM_STATES_M = 12;
+
+/**
+ * Id of the chain MDP's state variable.
+ */
+const maxsum::VarID STATE_M = 0;
+
+/**
+ * Id of the chain MDP's action variable.
+ */
+const maxsum::VarID ACTION_M = 1;
+
+/**
+ * Action value for staying in the current state.
+ */
+const maxsum::ValIndex STAY_M = 0;
+
+/**
+ * Action value for advancing to the next state.
+ */
+const maxsum::ValIndex ADVANCE_M = 1;
+
+/**
+ * A chain of states, in which the agent may either stay where it is or
+ * advance to the next state at a small cost. Advancing from the last state
+ * earns a reward, and returns the agent to the first state.
+ */
+class ChainMDP
+{
+public:
+
+   /**
+    * Map type used to pass action and state values around.
+    */
+   typedef std::map<maxsum::VarID,maxsum::ValIndex> VarMap;
+
+   /**
+    * Map type for passing back Factored Rewards
+    */
+   typedef std::map<maxsum::FactorID,double> RewardMap;
+
+private:
+
+   /**
+    * Map containing the state variable mapped to its current value.
+    */
+   VarMap state_i;
+
+public:
+
+   /**
+    * Default Constructor.
+    */
+   ChainMDP() : state_i()
+   {
+      maxsum::registerVariable(STATE_M,NUM_STATES_M);
+      maxsum::registerVariable(ACTION_M,ADVANCE_M+1);
+      state_i[STATE_M] = 0;
+   }
+
+   /**
+    * Inform learner of the single factor defined by this MDP.
+    */
+   template<class Learner> void addFactors(Learner& learner)
+   {
+      maxsum::VarID varIds[2] = {STATE_M, ACTION_M};
+      learner.addFactor(0,varIds,varIds+2);
+   }
+
+   /**
+    * Get the current state value.
+    */
+   VarMap& getState()
+   {
+      return state_i;
+   }
+
+   /**
+    * Perform an action and return the resulting reward.
+    * @returns total reward
+    */
+   double act(VarMap& action, RewardMap& reward)
+   {
+      reward[0] = 0;
+      if(ADVANCE_M==action[ACTION_M])
+      {
+         if(NUM_STATES_M-1==state_i[STATE_M])
+         {
+            state_i[STATE_M] = 0;
+            reward[0] = 1;
+         }
+         else
+         {
+            ++state_i[STATE_M];
+            reward[0] = -0.01;
+         }
+      }
+      return reward[0];
+   }
+
+   /**
+    * Returns true if the learner's greedy action is to advance in every
+    * state.
+    */
+   template<class Learner> static bool isOptimal(Learner& learner)
+   {
+      VarMap state, action;
+      for(int s=0; s<NUM_STATES_M; ++s)
+      {
+         state[STATE_M] = s;
+         learner.actGreedy(state,action);
+         if(ADVANCE_M!=action[ACTION_M])
+         {
+            return false;
+         }
+      }
+      return true;
+   }
+
+}; // class ChainMDP
+
+/**
+ * Checks that dec_brl::SparseTrace sets, decays and discards traces
+ * correctly, including when its hash table grows.
+ */
+bool testSparseTrace()
+{
+   SparseTrace trace;
+   for(int k=0; k<100; ++k)
+   {
+      trace.set(7*k,1.0+k);
+   }
+   trace.set(7,5.0); // replace existing trace
+   if(100!=trace.size())
+   {
+      std::cout << "Wrong number of traces: " << trace.size() << std::endl;
+      return false;
+   }
+   for(int k=0; k<100; ++k)
+   {
+      const double expected = (1==k) ? 5.0 : 1.0+k;
+      if( (expected!=trace(7*k)) || (0!=trace(7*k+1)) )
+      {
+         std::cout << "Wrong trace for element " << 7*k << std::endl;
+         return false;
+      }
+   }
+
+   //***************************************************************************
+   // Halving the traces should discard those that were less than 98.
+   //***************************************************************************
+   trace.decay(0.5,49.0);
+   if( (3!=trace.size()) || (49!=trace(7*97)) || (49.5!=trace(7*98)) ||
+       (50!=trace(7*99)) || (0!=trace(7*96)) || (0!=trace(7)) )
+   {
+      std::cout << "Wrong traces after decay" << std::endl;
+      return false;
+   }
+
+   trace.clear();
+   if( (0!=trace.size()) || (0!=trace(7*99)) )
+   {
+      std::cout << "Traces not cleared" << std::endl;
+      return false;
+   }
+   return true;
+
+} // testSparseTrace
+
+/**
+ * Runs a learner on the chain MDP until its greedy policy is optimal.
+ * @param[in] init learner to copy.
+ * @param[in] seed seed for the run's random stream.
+ * @param[out] maxTraces largest number of active traces during the run.
+ * @returns the number of timesteps taken, or -1 if the policy was not
+ * optimal after MAX_TIMESTEPS_M timesteps.
+ */
+long stepsToConverge(const DecQLearner& init, int seed, std::size_t& maxTraces)
+{
+   ChainMDP mdp;
+   DecQLearner learner(init);
+   mdp.addFactors(learner);
+   random::Stream stream(seed);
+   random::StreamScope scope(stream);
+
+   ChainMDP::VarMap prior, post(mdp.getState()), action;
+   ChainMDP::RewardMap reward;
+   maxTraces = 0;
+   for(long t=1; t<=MAX_TIMESTEPS_M; ++t)
+   {
+      post.swap(prior);
+      learner.act(prior,action);
+      mdp.act(action,reward);
+      post = mdp.getState();
+      learner.observe(prior,action,post,reward);
+      if(maxTraces<learner.getNoActiveTraces())
+      {
+         maxTraces = learner.getNoActiveTraces();
+      }
+      if( (0==t%CHECK_INTERVAL_M) && ChainMDP::isOptimal(learner) )
+      {
+         return t;
+      }
+   }
+   return -1;
+
+} // stepsToConverge
+
+/**
+ * Compares the mean number of timesteps and processor time taken by
+ * one-step Q-learning and Q(lambda) to converge, and checks that Q(lambda)
+ * needs fewer timesteps while keeping the number of active traces bounded.
+ */
+bool testConvergence()
+{
+   DecQLearner oneStep(DecQLearner::DEFAULT_ALPHA,DecQLearner::DEFAULT_GAMMA,
+         EPSILON_M);
+   DecQLearner qLambda(oneStep);
+   qLambda.setTraceDecay(LAMBDA_M);
+
+   const double decay = DecQLearner::DEFAULT_GAMMA*LAMBDA_M;
+   const std::size_t traceBound = 1 + static_cast<std::size_t>
+      (std::log(DecQLearner::DEFAULT_TRACE_CUTOFF)/std::log(decay));
+
+   const DecQLearner* learners[2] = {&oneStep, &qLambda};
+   const char* names[2] = {"Q-learning", "Q(lambda)"};
+   double meanSteps[2] = {0, 0};
+   for(int k=0; k<2; ++k)
+   {
+      std::size_t maxTraces = 0;
+      std::clock_t start = std::clock();
+      for(int run=0; run<NUM_RUNS_M; ++run)
+      {
+         std::size_t runTraces = 0;
+         const long steps = stepsToConverge(*learners[k],run+1,runTraces);
+         if(0>steps)
+         {
+            std::cout << names[k] << " did not converge in run " << run
+               << std::endl;
+            return false;
+         }
+         meanSteps[k] += static_cast<double>(steps)/NUM_RUNS_M;
+         maxTraces = std::max(maxTraces,runTraces);
+      }
+      const double seconds =
+         static_cast<double>(std::clock()-start)/CLOCKS_PER_SEC;
+
+      std::cout << names[k] << " mean timesteps to converge: "
+         << meanSteps[k] << " mean time: " << seconds/NUM_RUNS_M
+         << "s max active traces: " << maxTraces << std::endl;
+
+      if(traceBound<maxTraces)
+      {
+         std::cout << names[k] << " has too many active traces: "
+            << maxTraces << " > " << traceBound << std::endl;
+         return false;
+      }
+   }
+
+   if(meanSteps[1]>=meanSteps[0])
+   {
+      std::cout << "Q(lambda) did not converge faster" << std::endl;
+      return false;
+   }
+   return true;
+
+} // testConvergence
+
+} // module namespace
+
+/**
+ * Main function for harness - executes all tests.
+ */
+int main()
+{
+   try
+   {
+      if(!testSparseTrace() || !testConvergence())
+      {
+         return EXIT_FAILURE;
+      }
+   }
+   catch(std::exception& e)
+   {
+      std::cout << "Caught error: " << e.what() << std::endl;
+      return EXIT_FAILURE;
+   }
+
+   //***************************************************************************
+   // If we get this far, everything is ok.
+   //***************************************************************************
+   std::cout << "Passed." << std::endl;
+   return EXIT_SUCCESS;
+
+} // function main
@@ -135,6 +135,7 @@ int main()
       NormalGamma scalarParams1;
       NormalGamma scalarParams2;
       NormalGamma_Tmpl<maxsum::DiscreteFunction> vecParams;
+      CachedNormalGamma_Tmpl<maxsum::DiscreteFunction> cachedParams;
 
       //************************************************************************
       // Try to expand domain of belief distribution
@@ -142,6 +143,8 @@ int main()
       expand(vecParams,1);
       maxsum::VarID otherVars[] = {2,3};
       expand(vecParams,otherVars,otherVars+2);
+      expand(cachedParams,1);
+      expand(cachedParams,otherVars,otherVars+2);
       maxsum::ValIndex vecIndex = vecParams.m.domainSize()/2;
 
       std::cout << "selected index for dual update: " << vecIndex << std::endl;
@@ -184,6 +187,8 @@ int main()
          observe(scalarParams2,obs2);
          observe(vecParams,obs1);
          observe(vecParams,vecIndex,obs2);
+         observe(cachedParams,obs1);
+         observe(cachedParams,vecIndex,obs2);
 
          //*********************************************************************
          // Check hyperparameters for consistency
@@ -220,6 +225,19 @@ int main()
                std::cout << "Incorrect mean at location " << k << std::endl;
                return EXIT_FAILURE;
             }
+
+            //******************************************************************
+            // Cached log gamma ratios should match direct calculation
+            //******************************************************************
+            double correctRatio = logGammaRatio<double,
+               boost::math::policies::policy<> >(cachedParams.alpha(k));
+            if(std::abs(cachedParams.lgammaRatio(k)-correctRatio) > 1e-8)
+            {
+               std::cout << "Incorrect cached ratio at location " << k
+                  << ": " << cachedParams.lgammaRatio(k) << " should be "
+                  << correctRatio << std::endl;
+               return EXIT_FAILURE;
+            }
          }
 
       } // for loop
@@ -0,0 +1,477 @@
+/**
+ * @file vpiBatchHarness.cpp
+ * Test harness and benchmark for the batched VPI kernel in vpi.h.
+ * Checks that dec_brl::exactVPIBatch is consistent with the per-element
+ * scalar calculation, and reports the time taken by both. Also checks that
+ * pruning negligible VPI values changes no result by more than epsilon, and
+ * that the AVX2 fast CDF kernel agrees with the scalar path, for both
+ * contiguous arrays and conditioned views, and reports its speed up.
+ */
+
+#include <cmath>
+#include <ctime>
+#include <exception>
+#include <iostream>
+#include <map>
+#include <vector>
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/normal_distribution.hpp>
+#include <boost/random/uniform_real.hpp>
+#include <boost/random/variate_generator.hpp>
+#include "dec_brl/vpi.h"
+#include "dec_brl/vpiAvx2.h"
+#include "dec_brl/ConditionedView.h"
+#include "dec_brl/NormalGamma.h"
+#include "DiscreteFunction.h"
+#include "register.h"
+
+// private module namespace
+namespace
+{
+using namespace dec_brl::dist;
+
+/**
+ * Type of vectorised parameter distribution used for testing.
+ */
+typedef NormalGamma_Tmpl<maxsum::DiscreteFunction> VecDist;
+
+/**
+ * Number of times each VPI calculation is repeated for timing purposes.
+ */
+const int NUM_REPEATS_M = 20;
+
+/**
+ * Tolerance used to prune negligible VPI values.
+ */
+const double PRUNE_EPSILON_M = 1e-6;
+
+/**
+ * Check that two doubles are equal within margin of error.
+ */
+bool equalWithinTol_m(double v1, double v2, double tol=0.0001)
+{
+   if(v1==v2)
+   {
+      return true;
+   }
+   return tol > (std::abs(v1-v2)/std::max(std::abs(v1),std::abs(v2)));
+}
+
+/**
+ * Calculates VPI for each element separately, by constructing a scalar
+ * distribution per element. This is the way VPI was calculated before the
+ * batched kernel was introduced, and is used here as the reference.
+ */
+void perElementVPI(const VecDist& dist, maxsum::DiscreteFunction& result)
+{
+   using namespace maxsum;
+   const ValIndex firstBestInd = dist.m.argmax();
+   const ValIndex secondBestInd = dist.m.argmax2(firstBestInd);
+   const ValType firstBestVal = dist.m(firstBestInd);
+   const ValType secondBestVal = dist.m(secondBestInd);
+
+   result = dist.m;
+   for(int k=0; k<result.domainSize(); ++k)
+   {
+      NormalGamma_Tmpl<ValType> scalarDist(dist.alpha(k), dist.beta(k),
+                                           dist.lambda(k), dist.m(k));
+      bool isBest = (firstBestInd==k);
+      result(k) = dec_brl::exactVPI(isBest, firstBestVal, secondBestVal,
+                                    scalarDist);
+   }
+}
+
+/**
+ * Compares batched and per-element VPI for a random distribution over a
+ * single variable with the specified domain size.
+ * @param[in] var id of a variable registered with the required domain size.
+ * @param[in] rng random number generator used to choose hyperparameters.
+ * @returns true iff both methods produce consistent results.
+ */
+bool testDomainSize(maxsum::VarID var, boost::mt19937& rng)
+{
+   //***************************************************************************
+   // Generate random hyperparameters for each element.
+   //***************************************************************************
+   CachedNormalGamma_Tmpl<maxsum::DiscreteFunction> dist;
+   expand(dist,var);
+
+   boost::uniform_real<> unirnd(0,1);
+   boost::normal_distribution<> normal;
+   boost::variate_generator<boost::mt19937&, boost::normal_distribution<> >
+      normrnd(rng,normal);
+   for(int k=0; k<dist.m.domainSize(); ++k)
+   {
+      dist.alpha(k) = 1.0 + 20*unirnd(rng);
+      dist.beta(k) = 0.1 + 10*unirnd(rng);
+      dist.lambda(k) = 0.5 + 20*unirnd(rng);
+      dist.m(k) = 10*normrnd();
+   }
+   resetLogGammaRatio(dist);
+
+   //***************************************************************************
+   // Time both methods
+   //***************************************************************************
+   const VecDist& uncachedDist = dist;
+   maxsum::DiscreteFunction refResult, batchResult, cachedResult, prunedResult;
+   std::clock_t start = std::clock();
+   for(int k=0; k<NUM_REPEATS_M; ++k)
+   {
+      perElementVPI(uncachedDist,refResult);
+   }
+   double refTime = double(std::clock()-start)/CLOCKS_PER_SEC;
+
+   start = std::clock();
+   for(int k=0; k<NUM_REPEATS_M; ++k)
+   {
+      dec_brl::exactVPI(uncachedDist,batchResult);
+   }
+   double batchTime = double(std::clock()-start)/CLOCKS_PER_SEC;
+
+   start = std::clock();
+   for(int k=0; k<NUM_REPEATS_M; ++k)
+   {
+      dec_brl::exactVPI(dist,cachedResult);
+   }
+   double cachedTime = double(std::clock()-start)/CLOCKS_PER_SEC;
+
+   start = std::clock();
+   for(int k=0; k<NUM_REPEATS_M; ++k)
+   {
+      dec_brl::exactVPI(dist,prunedResult,ExactCdf(),PRUNE_EPSILON_M);
+   }
+   double prunedTime = double(std::clock()-start)/CLOCKS_PER_SEC;
+
+   std::cout << "domain size: " << dist.m.domainSize()
+      << " per-element: " << refTime << "s batched: " << batchTime
+      << "s cached lgamma: " << cachedTime << "s pruned: " << prunedTime
+      << 's';
+
+   int noPruned = 0;
+   for(int k=0; k<dist.m.domainSize(); ++k)
+   {
+      if((0==prunedResult(k)) && (0!=refResult(k)))
+      {
+         ++noPruned;
+      }
+   }
+   std::cout << " (" << noPruned << " pruned)" << std::endl;
+
+   //***************************************************************************
+   // Check for consistency
+   //***************************************************************************
+   for(int k=0; k<dist.m.domainSize(); ++k)
+   {
+      if(!equalWithinTol_m(refResult(k),batchResult(k)))
+      {
+         std::cout << "Inconsistent VPI at " << k << ": per-element="
+            << refResult(k) << " batched=" << batchResult(k) << std::endl;
+         return false;
+      }
+
+      if(!equalWithinTol_m(refResult(k),cachedResult(k)))
+      {
+         std::cout << "Inconsistent cached VPI at " << k << ": per-element="
+            << refResult(k) << " cached=" << cachedResult(k) << std::endl;
+         return false;
+      }
+
+      if(PRUNE_EPSILON_M < std::abs(refResult(k)-prunedResult(k)) &&
+         !equalWithinTol_m(refResult(k),prunedResult(k)))
+      {
+         std::cout << "Inconsistent pruned VPI at " << k << ": per-element="
+            << refResult(k) << " pruned=" << prunedResult(k) << std::endl;
+         return false;
+      }
+   }
+   return true;
+
+} // testDomainSize
+
+/**
+ * Type of cached parameter distribution used to test the AVX2 kernel.
+ */
+typedef CachedNormalGamma_Tmpl<maxsum::DiscreteFunction> CachedDist;
+
+/**
+ * Sets random hyperparameters for the AVX2 kernel tests. Unlike
+ * testDomainSize(), most alpha values are multiples of 0.5, as they are
+ * after observations from an integer prior, so that the kernel's series
+ * and normal approximations are both used. Every 37th alpha is less than
+ * 0.5, and every 41st gives non-integer degrees of freedom, which are
+ * handled by the scalar path.
+ */
+void randomIntegerDist(boost::mt19937& rng, CachedDist& dist)
+{
+   boost::uniform_real<> unirnd(0,1);
+   boost::normal_distribution<> normal;
+   boost::variate_generator<boost::mt19937&, boost::normal_distribution<> >
+      normrnd(rng,normal);
+   for(int k=0; k<dist.m.domainSize(); ++k)
+   {
+      dist.alpha(k) = 0.5*(2+static_cast<int>(200*unirnd(rng)));
+      if(0==k%37)
+      {
+         dist.alpha(k) = 0.3;
+      }
+      else if(0==k%41)
+      {
+         dist.alpha(k) += 0.25;
+      }
+      dist.beta(k) = 0.1 + 10*unirnd(rng);
+      dist.lambda(k) = 0.5 + 20*unirnd(rng);
+      dist.m(k) = 10*normrnd();
+   }
+   resetLogGammaRatio(dist);
+}
+
+/**
+ * Checks that VPI calculated in fast CDF mode is within the documented
+ * error of VPI calculated with the exact CDF, and that infinite results
+ * agree.
+ * @param[in] m expected values of each action.
+ * @param[in] exact VPI calculated using dec_brl::dist::ExactCdf.
+ * @param[in] fast VPI calculated using dec_brl::dist::FastCdf.
+ * @param[in] name name of the method used to calculate \c fast.
+ */
+bool checkFast
+(
+ const maxsum::DiscreteFunction& m,
+ const maxsum::DiscreteFunction& exact,
+ const maxsum::DiscreteFunction& fast,
+ const char* name
+)
+{
+   int firstBestInd = 0;
+   double firstBestVal = 0;
+   double secondBestVal = 0;
+   dec_brl::findBestTwo(m.domainSize(), &m(0), firstBestInd, firstBestVal,
+                        secondBestVal);
+   for(int k=0; k<m.domainSize(); ++k)
+   {
+      const double z = ((firstBestInd==k) ? secondBestVal : firstBestVal) -
+                       m(k);
+      const double tol = FastCdf::MAX_ABS_ERROR*std::abs(z) +
+                         1e-9*exact(k) + 1e-12;
+      const bool isOk = (exact(k)==fast(k)) ||
+                        (tol >= std::abs(exact(k)-fast(k)));
+      if(!isOk)
+      {
+         std::cout << "Inconsistent " << name << " VPI at " << k
+            << ": exact=" << exact(k) << ' ' << name << '=' << fast(k)
+            << std::endl;
+         return false;
+      }
+   }
+   return true;
+}
+
+/**
+ * Compares VPI calculated by the AVX2 kernel with VPI calculated by the
+ * scalar path in fast CDF mode, and with the exact CDF, for a random
+ * distribution over a single variable, and reports the time taken by each.
+ * @param[in] var id of a variable registered with the required domain size.
+ * @param[in] rng random number generator used to choose hyperparameters.
+ * @returns true iff the results are consistent.
+ */
+bool testAvx2(maxsum::VarID var, boost::mt19937& rng)
+{
+   CachedDist dist;
+   expand(dist,var);
+   randomIntegerDist(rng,dist);
+
+   maxsum::DiscreteFunction exactResult, scalarResult, avx2Result;
+   maxsum::DiscreteFunction scalarPruned, avx2Pruned;
+   dec_brl::exactVPI(dist,exactResult,ExactCdf());
+
+   const bool wasEnabled = dec_brl::avx2::setEnabled(false);
+   std::clock_t start = std::clock();
+   for(int k=0; k<NUM_REPEATS_M; ++k)
+   {
+      dec_brl::exactVPI(dist,scalarResult,FastCdf());
+   }
+   double scalarTime = double(std::clock()-start)/CLOCKS_PER_SEC;
+   dec_brl::exactVPI(dist,scalarPruned,FastCdf(),PRUNE_EPSILON_M);
+
+   dec_brl::avx2::setEnabled(true);
+   start = std::clock();
+   for(int k=0; k<NUM_REPEATS_M; ++k)
+   {
+      dec_brl::exactVPI(dist,avx2Result,FastCdf());
+   }
+   double avx2Time = double(std::clock()-start)/CLOCKS_PER_SEC;
+   dec_brl::exactVPI(dist,avx2Pruned,FastCdf(),PRUNE_EPSILON_M);
+   dec_brl::avx2::setEnabled(wasEnabled);
+
+   std::cout << "domain size: " << dist.m.domainSize() << " fast scalar: "
+      << scalarTime << "s fast avx2: " << avx2Time << 's' << std::endl;
+
+   if(!checkFast(dist.m,exactResult,scalarResult,"scalar") ||
+      !checkFast(dist.m,exactResult,avx2Result,"avx2"))
+   {
+      return false;
+   }
+   for(int k=0; k<dist.m.domainSize(); ++k)
+   {
+      if(PRUNE_EPSILON_M < std::abs(avx2Result(k)-avx2Pruned(k)))
+      {
+         std::cout << "Pruned avx2 VPI inconsistent at " << k << ": "
+            << avx2Result(k) << " pruned=" << avx2Pruned(k) << std::endl;
+         return false;
+      }
+      if(PRUNE_EPSILON_M < std::abs(scalarPruned(k)-avx2Pruned(k)) &&
+         !equalWithinTol_m(scalarPruned(k),avx2Pruned(k)))
+      {
+         std::cout << "Pruned scalar and avx2 VPI inconsistent at " << k
+            << ": scalar=" << scalarPruned(k) << " avx2=" << avx2Pruned(k)
+            << std::endl;
+         return false;
+      }
+   }
+   return true;
+
+} // testAvx2
+
+/**
+ * Checks that the AVX2 kernel gives the same results when it gathers
+ * hyperparameters through conditioned views, as the scalar path does
+ * through the same views, when conditioned on each of two variables.
+ * @param[in] state id of a variable to condition on.
+ * @param[in] action id of a variable to condition on.
+ * @param[in] rng random number generator used to choose hyperparameters.
+ * @returns true iff the results are consistent.
+ */
+bool testAvx2Views
+(
+ maxsum::VarID state,
+ maxsum::VarID action,
+ boost::mt19937& rng
+)
+{
+   using dec_brl::ConditionedView;
+   typedef ConditionedView<maxsum::DiscreteFunction> View;
+
+   CachedDist dist;
+   const maxsum::VarID vars[] = {state, action};
+   expand(dist,vars,vars+2);
+   randomIntegerDist(rng,dist);
+
+   for(int v=0; v<2; ++v)
+   {
+      std::map<maxsum::VarID,maxsum::ValIndex> states;
+      states[vars[v]] = 1;
+      dec_brl::ConditionedLayout layout;
+      layout.reset(dist.m.varBegin(),dist.m.varEnd(),states);
+      const View alpha(dist.alpha,layout);
+      const View beta(dist.beta,layout);
+      const View lambda(dist.lambda,layout);
+      const View lgammaRatio(dist.lgammaRatio,layout);
+
+      maxsum::DiscreteFunction m;
+      maxsum::condition(dist.m,m,states);
+      const int n = m.domainSize();
+      int firstBestInd = 0;
+      double firstBestVal = 0;
+      double secondBestVal = 0;
+      dec_brl::findBestTwo(n, &m(0), firstBestInd, firstBestVal,
+                           secondBestVal);
+
+      std::vector<double> scalarResult(n), avx2Result(n);
+      const bool wasEnabled = dec_brl::avx2::setEnabled(false);
+      dec_brl::exactVPIArrays<CachedDist::policy_type>(n, alpha, beta, lambda,
+         &m(0), firstBestInd, firstBestVal, secondBestVal, &scalarResult[0],
+         &lgammaRatio, FastCdf());
+      dec_brl::avx2::setEnabled(true);
+      dec_brl::exactVPIArrays<CachedDist::policy_type>(n, alpha, beta, lambda,
+         &m(0), firstBestInd, firstBestVal, secondBestVal, &avx2Result[0],
+         &lgammaRatio, FastCdf());
+      dec_brl::avx2::setEnabled(wasEnabled);
+
+      for(int k=0; k<n; ++k)
+      {
+         const double z = ((firstBestInd==k) ? secondBestVal : firstBestVal)
+                          - m(k);
+         const double tol = 2e-7*std::abs(z) + 1e-9*scalarResult[k] + 1e-12;
+         if( (scalarResult[k]!=avx2Result[k]) &&
+             (tol < std::abs(scalarResult[k]-avx2Result[k])) )
+         {
+            std::cout << "Inconsistent avx2 VPI through view at " << k
+               << ": scalar=" << scalarResult[k] << " avx2="
+               << avx2Result[k] << std::endl;
+            return false;
+         }
+      }
+   }
+   return true;
+
+} // testAvx2Views
+
+} // private module namespace
+
+/**
+ * Main function for harness - executes all tests.
+ */
+int main()
+{
+   try
+   {
+      boost::mt19937 rng;
+
+      //************************************************************************
+      // Register one variable for each domain size to be tested.
+      //************************************************************************
+      const int NUM_SIZES = 5;
+      const maxsum::ValIndex sizes[NUM_SIZES] = {2, 16, 128, 1024, 8192};
+      for(int k=0; k<NUM_SIZES; ++k)
+      {
+         maxsum::registerVariable(k+1,sizes[k]);
+      }
+
+      for(int k=0; k<NUM_SIZES; ++k)
+      {
+         if(!testDomainSize(k+1,rng))
+         {
+            return EXIT_FAILURE;
+         }
+      }
+
+      //************************************************************************
+      // Compare the AVX2 kernel with the scalar path, including a domain
+      // size that is not a multiple of four, if the processor supports it.
+      //************************************************************************
+      if(dec_brl::avx2::isSupported())
+      {
+         const maxsum::VarID ODD_VAR = NUM_SIZES+1;
+         const maxsum::VarID STATE_VAR = NUM_SIZES+2;
+         maxsum::registerVariable(ODD_VAR,1027);
+         maxsum::registerVariable(STATE_VAR,3);
+         for(int k=0; k<NUM_SIZES; ++k)
+         {
+            if(!testAvx2(k+1,rng))
+            {
+               return EXIT_FAILURE;
+            }
+         }
+         if(!testAvx2(ODD_VAR,rng) || !testAvx2Views(STATE_VAR,ODD_VAR,rng))
+         {
+            return EXIT_FAILURE;
+         }
+      }
+      else
+      {
+         std::cout << "AVX2 not supported: kernel not tested." << std::endl;
+      }
+   }
+   catch(std::exception& e)
+   {
+      std::cout << "Caught error: " << e.what() << std::endl;
+      return EXIT_FAILURE;
+   }
+
+   //***************************************************************************
+   // If we get this far, everything is ok.
+   //***************************************************************************
+   std::cout << "Passed." << std::endl;
+   return EXIT_SUCCESS;
+
+} // function main
@@ -0,0 +1,497 @@
+/**
+ * @file vpiCacheHarness.cpp
+ * Test harness for dec_brl::FactorVPICache.
+ * Checks that conditioned beliefs and VPI are recalculated iff a factor's
+ * beliefs, states or total value change, that revisited states are reused
+ * from a bounded cache, and that the cached results agree with calculating
+ * VPI from scratch, and that an observation only invalidates the state at
+ * which it was made. Also checks that dec_brl::ConditionedView reads the
+ * same values as conditioning a function by copying.
+ */
+
+#include <exception>
+#include <iostream>
+#include <map>
+#include "dec_brl/FactorVPICache.h"
+#include "dec_brl/ConditionedView.h"
+#include "dec_brl/CompactNormalGamma.h"
+#include "dec_brl/NormalGamma.h"
+#include "dec_brl/vpi.h"
+#include "DiscreteFunction.h"
+#include "register.h"
+
+// private module namespace
+namespace
+{
+using namespace dec_brl;
+using namespace dec_brl::dist;
+
+/**
+ * Type of vectorised parameter distribution used for testing.
+ */
+typedef CachedNormalGamma_Tmpl<maxsum::DiscreteFunction> VecDist;
+
+/**
+ * Type of state map used for testing.
+ */
+typedef std::map<maxsum::VarID,maxsum::ValIndex> VarMap;
+
+/**
+ * Checks that the cached expected value and VPI are the same as those
+ * calculated from scratch, with the specified CDF mode and pruning
+ * threshold.
+ */
+bool checkVPI
+(
+ const FactorVPICache<VecDist>& cache,
+ const VecDist& dist,
+ const VarMap& states,
+ const maxsum::DiscreteFunction& totalValue,
+ const bool isFastCdf=false,
+ const maxsum::ValType epsilon=0
+)
+{
+   VecDist totValDist;
+   totValDist.m = totalValue;
+   maxsum::condition(dist.alpha,totValDist.alpha,states);
+   maxsum::condition(dist.beta,totValDist.beta,states);
+   maxsum::condition(dist.lambda,totValDist.lambda,states);
+   maxsum::condition(dist.lgammaRatio,totValDist.lgammaRatio,states);
+
+   maxsum::DiscreteFunction expected;
+   if(isFastCdf)
+   {
+      exactVPI(totValDist,expected,FastCdf(),epsilon);
+   }
+   else
+   {
+      exactVPI(totValDist,expected,ExactCdf(),epsilon);
+   }
+
+   maxsum::DiscreteFunction expectedValue;
+   maxsum::condition(dist.m,expectedValue,states);
+   const maxsum::DiscreteFunction& cachedValue = cache.expectedValue();
+   if(expectedValue.domainSize()!=cachedValue.domainSize())
+   {
+      std::cout << "Cached expected value has wrong domain size." << std::endl;
+      return false;
+   }
+   for(int k=0; k<expectedValue.domainSize(); ++k)
+   {
+      if(expectedValue(k)!=cachedValue(k))
+      {
+         std::cout << "Cached expected value inconsistent at " << k
+            << std::endl;
+         return false;
+      }
+   }
+
+   const maxsum::DiscreteFunction& actual = cache.vpi();
+   if(expected.domainSize()!=actual.domainSize())
+   {
+      std::cout << "Cached VPI has wrong domain size." << std::endl;
+      return false;
+   }
+   for(int k=0; k<expected.domainSize(); ++k)
+   {
+      if(expected(k)!=actual(k))
+      {
+         std::cout << "Cached VPI inconsistent at " << k << ": expected="
+            << expected(k) << " cached=" << actual(k) << std::endl;
+         return false;
+      }
+   }
+   return true;
+}
+
+/**
+ * Checks that a view of a function conditioned on the specified states
+ * reads the same values as the function conditioned by copying.
+ */
+template<class Function> bool checkView
+(
+ const Function& fun,
+ const VarMap& states,
+ ConditionedLayout& layout
+)
+{
+   maxsum::DiscreteFunction expected;
+   dist::condition(fun,expected,states);
+   layout.reset(fun.varBegin(),fun.varEnd(),states);
+   const ConditionedView<Function> view(fun,layout);
+   if(expected.domainSize()!=view.size())
+   {
+      std::cout << "Conditioned view has wrong size." << std::endl;
+      return false;
+   }
+   for(int k=0; k<expected.domainSize(); ++k)
+   {
+      if(expected(k)!=view[k])
+      {
+         std::cout << "Conditioned view inconsistent at " << k
+            << ": expected=" << expected(k) << " view=" << view[k]
+            << std::endl;
+         return false;
+      }
+   }
+   return true;
+}
+
+/**
+ * Checks conditioned views of dense and compact functions over three
+ * variables, conditioned on each of them in turn, and on none.
+ */
+bool testConditionedView()
+{
+   const maxsum::VarID vars[] = {11, 12, 13};
+   maxsum::registerVariable(vars[0],2);
+   maxsum::registerVariable(vars[1],3);
+   maxsum::registerVariable(vars[2],4);
+
+   maxsum::DiscreteFunction dense(vars,vars+3,0.0);
+   CompactFunction compact(0.0,1.0);
+   compact.expand(vars,vars+3);
+   for(int k=0; k<dense.domainSize(); ++k)
+   {
+      dense(k) = k;
+      compact.set(k,0.5*k);
+   }
+
+   //***************************************************************************
+   // Reuse one layout throughout, as FactorVPICache does.
+   //***************************************************************************
+   ConditionedLayout layout;
+   VarMap states;
+   if(!checkView(dense,states,layout) || !checkView(compact,states,layout))
+   {
+      return false;
+   }
+   for(int v=0; v<3; ++v)
+   {
+      for(int val=0; val<maxsum::getDomainSize(vars[v]); ++val)
+      {
+         states.clear();
+         states[vars[v]] = val;
+         if(!checkView(dense,states,layout) ||
+            !checkView(compact,states,layout))
+         {
+            return false;
+         }
+      }
+   }
+   return true;
+}
+
+} // private module namespace
+
+/**
+ * Main function for harness - executes all tests.
+ */
+int main()
+{
+   try
+   {
+      if(!testConditionedView())
+      {
+         return EXIT_FAILURE;
+      }
+
+      //************************************************************************
+      // Set up a factor with one state and one action variable.
+      //************************************************************************
+      const maxsum::VarID STATE = 1;
+      const maxsum::VarID ACTION = 2;
+      maxsum::registerVariable(STATE,3);
+      maxsum::registerVariable(ACTION,4);
+      const maxsum::VarID vars[] = {STATE, ACTION};
+
+      VecDist dist;
+      expand(dist,vars,vars+2);
+      for(int k=0; k<dist.m.domainSize(); ++k)
+      {
+         dist.m(k) = k;
+      }
+
+      VarMap states;
+      states[STATE] = 1;
+
+      FactorVPICache<VecDist> cache;
+      cache.touch();
+
+      //************************************************************************
+      // First use always calculates results.
+      //************************************************************************
+      if(!cache.condition(dist,states))
+      {
+         std::cout << "Initial conditioning not calculated." << std::endl;
+         return EXIT_FAILURE;
+      }
+
+      maxsum::DiscreteFunction totalValue = cache.expectedValue();
+      if(!cache.updateVPI(totalValue))
+      {
+         std::cout << "Initial VPI not calculated." << std::endl;
+         return EXIT_FAILURE;
+      }
+      if(!checkVPI(cache,dist,states,totalValue))
+      {
+         return EXIT_FAILURE;
+      }
+
+      //************************************************************************
+      // Clean factors are not recalculated.
+      //************************************************************************
+      if(cache.condition(dist,states) || cache.updateVPI(totalValue))
+      {
+         std::cout << "Clean factor was recalculated." << std::endl;
+         return EXIT_FAILURE;
+      }
+
+      //************************************************************************
+      // Changing the total value recalculates VPI only.
+      //************************************************************************
+      totalValue(0) += 10;
+      if(cache.condition(dist,states) || !cache.updateVPI(totalValue))
+      {
+         std::cout << "Total value change not handled." << std::endl;
+         return EXIT_FAILURE;
+      }
+      if(!checkVPI(cache,dist,states,totalValue))
+      {
+         return EXIT_FAILURE;
+      }
+
+      //************************************************************************
+      // Changing the states recalculates everything.
+      //************************************************************************
+      states[STATE] = 2;
+      if(!cache.condition(dist,states) || !cache.updateVPI(totalValue))
+      {
+         std::cout << "State change not handled." << std::endl;
+         return EXIT_FAILURE;
+      }
+      if(!checkVPI(cache,dist,states,totalValue))
+      {
+         return EXIT_FAILURE;
+      }
+
+      //************************************************************************
+      // Changing the beliefs recalculates everything, once touched.
+      //************************************************************************
+      VarMap obsVars(states);
+      obsVars[ACTION] = 0;
+      observe<VarMap&>(dist,obsVars,5.0,30.0,1);
+      cache.touch();
+      if(!cache.condition(dist,states) || !cache.updateVPI(totalValue))
+      {
+         std::cout << "Belief change not handled." << std::endl;
+         return EXIT_FAILURE;
+      }
+      if(!checkVPI(cache,dist,states,totalValue))
+      {
+         return EXIT_FAILURE;
+      }
+
+      //************************************************************************
+      // Sampled VPI is recalculated on every call, even when clean, and
+      // exact VPI is recalculated when switching back from sampling.
+      //************************************************************************
+      if(cache.condition(dist,states) || !cache.updateVPI(totalValue,10) ||
+         !cache.updateVPI(totalValue,10) || !cache.updateVPI(totalValue))
+      {
+         std::cout << "Sampled VPI was reused." << std::endl;
+         return EXIT_FAILURE;
+      }
+      if(cache.updateVPI(totalValue) || !checkVPI(cache,dist,states,totalValue))
+      {
+         std::cout << "Exact VPI not reused after sampling." << std::endl;
+         return EXIT_FAILURE;
+      }
+
+      //************************************************************************
+      // Changing the CDF mode or pruning threshold recalculates VPI.
+      //************************************************************************
+      if(!cache.updateVPI(totalValue,0,true) ||
+         cache.updateVPI(totalValue,0,true) ||
+         !checkVPI(cache,dist,states,totalValue,true))
+      {
+         std::cout << "CDF mode change not handled." << std::endl;
+         return EXIT_FAILURE;
+      }
+      if(!cache.updateVPI(totalValue,0,true,0.5) ||
+         cache.updateVPI(totalValue,0,true,0.5) ||
+         !checkVPI(cache,dist,states,totalValue,true,0.5))
+      {
+         std::cout << "Pruning threshold change not handled." << std::endl;
+         return EXIT_FAILURE;
+      }
+      if(!cache.updateVPI(totalValue) || !checkVPI(cache,dist,states,totalValue))
+      {
+         std::cout << "Exact CDF not restored." << std::endl;
+         return EXIT_FAILURE;
+      }
+
+      //************************************************************************
+      // With a larger capacity, revisited states are reused until evicted.
+      //************************************************************************
+      FactorVPICache<VecDist> multiCache(2);
+      multiCache.touch();
+      for(int s=0; s<3; ++s)
+      {
+         states[STATE] = s;
+         if(!multiCache.condition(dist,states))
+         {
+            std::cout << "New state " << s << " not conditioned." << std::endl;
+            return EXIT_FAILURE;
+         }
+         multiCache.updateVPI(multiCache.expectedValue());
+      }
+
+      states[STATE] = 2;
+      totalValue = multiCache.expectedValue();
+      if(multiCache.condition(dist,states) || multiCache.updateVPI(totalValue))
+      {
+         std::cout << "Revisited state was recalculated." << std::endl;
+         return EXIT_FAILURE;
+      }
+      if(!checkVPI(multiCache,dist,states,totalValue))
+      {
+         return EXIT_FAILURE;
+      }
+
+      states[STATE] = 0; // least recently used, so should have been evicted
+      if(!multiCache.condition(dist,states))
+      {
+         std::cout << "Evicted state was not recalculated." << std::endl;
+         return EXIT_FAILURE;
+      }
+
+      states[STATE] = 2; // still cached
+      if(multiCache.condition(dist,states))
+      {
+         std::cout << "Recently used state was evicted." << std::endl;
+         return EXIT_FAILURE;
+      }
+
+      if( (6!=multiCache.noLookups()) || (2!=multiCache.noHits()) )
+      {
+         std::cout << "Wrong hit statistics: " << multiCache.noHits() << '/'
+            << multiCache.noLookups() << std::endl;
+         return EXIT_FAILURE;
+      }
+
+      //************************************************************************
+      // Touching the factor invalidates every cached state.
+      //************************************************************************
+      multiCache.touch();
+      if(!multiCache.condition(dist,states))
+      {
+         std::cout << "Touched factor was not recalculated." << std::endl;
+         return EXIT_FAILURE;
+      }
+
+      //************************************************************************
+      // Touching a single state only invalidates the entry for that state.
+      // Observations are made at prior states and actions, so the action
+      // in the map is ignored.
+      //************************************************************************
+      totalValue = multiCache.expectedValue();
+      multiCache.updateVPI(totalValue);
+      states[STATE] = 0;
+      multiCache.condition(dist,states);
+      VarMap touchedVars(states);
+      touchedVars[ACTION] = 3;
+      observe<VarMap&>(dist,touchedVars,-2.0,8.0,2);
+      multiCache.touchState(touchedVars);
+      states[STATE] = 2;
+      if(multiCache.condition(dist,states) || multiCache.updateVPI(totalValue)
+         || !checkVPI(multiCache,dist,states,totalValue))
+      {
+         std::cout << "Untouched state was recalculated." << std::endl;
+         return EXIT_FAILURE;
+      }
+      states[STATE] = 0;
+      if(!multiCache.condition(dist,states))
+      {
+         std::cout << "Touched state was not recalculated." << std::endl;
+         return EXIT_FAILURE;
+      }
+      totalValue = multiCache.expectedValue();
+      if(!multiCache.updateVPI(totalValue) ||
+         !checkVPI(multiCache,dist,states,totalValue))
+      {
+         std::cout << "Touched state VPI not recalculated." << std::endl;
+         return EXIT_FAILURE;
+      }
+
+      //************************************************************************
+      // Reusing a state makes it the most recently used, so the other state
+      // is evicted next.
+      //************************************************************************
+      states[STATE] = 0;
+      multiCache.condition(dist,states);
+      states[STATE] = 2;
+      multiCache.condition(dist,states);
+      states[STATE] = 1;
+      multiCache.condition(dist,states);
+      states[STATE] = 2;
+      if(multiCache.condition(dist,states))
+      {
+         std::cout << "Reused state was evicted." << std::endl;
+         return EXIT_FAILURE;
+      }
+      states[STATE] = 0;
+      if(!multiCache.condition(dist,states))
+      {
+         std::cout << "Least recently used state was not evicted."
+            << std::endl;
+         return EXIT_FAILURE;
+      }
+
+      //************************************************************************
+      // Reducing the capacity keeps only the most recently used states, and
+      // increasing it reuses the remaining slots.
+      //************************************************************************
+      multiCache.setCapacity(1);
+      if(multiCache.condition(dist,states))
+      {
+         std::cout << "Most recent state discarded by resize." << std::endl;
+         return EXIT_FAILURE;
+      }
+      states[STATE] = 2;
+      if(!multiCache.condition(dist,states))
+      {
+         std::cout << "Older state kept by resize." << std::endl;
+         return EXIT_FAILURE;
+      }
+      multiCache.setCapacity(3);
+      for(int s=0; s<3; ++s)
+      {
+         states[STATE] = s;
+         multiCache.condition(dist,states);
+         totalValue = multiCache.expectedValue();
+         multiCache.updateVPI(totalValue);
+         if(!checkVPI(multiCache,dist,states,totalValue))
+         {
+            return EXIT_FAILURE;
+         }
+      }
+      if(multiCache.condition(dist,states) || multiCache.updateVPI(totalValue))
+      {
+         std::cout << "Resized cache did not reuse state." << std::endl;
+         return EXIT_FAILURE;
+      }
+   }
+   catch(std::exception& e)
+   {
+      std::cout << "Caught error: " << e.what() << std::endl;
+      return EXIT_FAILURE;
+   }
+
+   //***************************************************************************
+   // If we get this far, everything is ok.
+   //***************************************************************************
+   std::cout << "Passed." << std::endl;
+   return EXIT_SUCCESS;
+
+} // function main